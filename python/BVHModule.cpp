@@ -0,0 +1,220 @@
+#include "ExportBVHTensor.h"
+#include "ParseBVH.h"
+#include <boost/python.hpp>
+#include <boost/python/numpy.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace bp = boost::python;
+namespace np = boost::python::numpy;
+using namespace usdBVHAnimPlugin;
+
+using BVHDocumentPtr = std::shared_ptr<BVHDocument>;
+
+static_assert(sizeof(BVHOffset) == 3 * sizeof(double), "BVHOffset must be viewable as 3 doubles");
+static_assert(sizeof(BVHTransform) == 7 * sizeof(double), "BVHTransform must be viewable as 7 doubles");
+
+//! Releases the Python global interpreter lock for the lifetime of this object, so that
+//! other Python threads can run while parsing.
+class ScopedGILRelease {
+public:
+    ScopedGILRelease()
+        : m_State(PyEval_SaveThread())
+    {
+    }
+
+    ~ScopedGILRelease()
+    {
+        PyEval_RestoreThread(m_State);
+    }
+
+private:
+    PyThreadState* m_State;
+};
+
+//! Returns a list of the strings in the given Python sequence
+static std::vector<std::string> ToStrings(bp::object const& sequence)
+{
+    std::vector<std::string> result;
+    for (bp::ssize_t i = 0; i < bp::len(sequence); ++i) {
+        result.push_back(bp::extract<std::string>(sequence[i]));
+    }
+    return result;
+}
+
+static BVHJointSelection ToJointSelection(bp::object const& joints, bp::object const& subtrees)
+{
+    BVHJointSelection selection;
+    if (!joints.is_none()) {
+        selection.m_Joints = ToStrings(joints);
+    }
+    if (!subtrees.is_none()) {
+        selection.m_SubtreeRoots = ToStrings(subtrees);
+    }
+    return selection;
+}
+
+//! Returns a read-only NumPy array that views the given document's storage, and that keeps
+//! the document alive for as long as the array (or any view of it) is alive. If `data` is null,
+//! as it is for storage that holds no elements, an empty array of the given shape is returned.
+template <typename T>
+static np::ndarray ViewDocument(bp::object const& self, T const* data, bp::tuple const& shape, bp::tuple const& strides)
+{
+    if (!data) {
+        return np::empty(shape, np::dtype::get_builtin<T>());
+    }
+    return np::from_data(data, np::dtype::get_builtin<T>(), shape, strides, self);
+}
+
+static BVHDocument const& GetDocument(bp::object const& self)
+{
+    return bp::extract<BVHDocument const&>(self);
+}
+
+static size_t GetNumJoints(BVHDocument const& document)
+{
+    return document.m_JointNames.size();
+}
+
+static size_t GetNumFrames(BVHDocument const& document)
+{
+    return document.m_JointNames.empty() ? 0 : document.m_FrameTransforms.size() / document.m_JointNames.size();
+}
+
+static double GetFrameTime(BVHDocument const& document)
+{
+    return document.m_FrameTime;
+}
+
+static bp::list GetJointNames(BVHDocument const& document)
+{
+    bp::list result;
+    for (std::pmr::string const& name : document.m_JointNames) {
+        result.append(std::string(name));
+    }
+    return result;
+}
+
+static np::ndarray GetJointParents(bp::object const& self)
+{
+    BVHDocument const& document = GetDocument(self);
+    return ViewDocument(self, document.m_JointParents.empty() ? nullptr : document.m_JointParents.data(), bp::make_tuple(GetNumJoints(document)), bp::make_tuple(sizeof(int)));
+}
+
+static np::ndarray GetJointOffsets(bp::object const& self)
+{
+    BVHDocument const& document = GetDocument(self);
+    return ViewDocument(self, document.m_JointOffsets.empty() ? nullptr : document.m_JointOffsets.data()->m_Translation, bp::make_tuple(GetNumJoints(document), 3), bp::make_tuple(sizeof(BVHOffset), sizeof(double)));
+}
+
+//! Returns a view of the frame transforms with the shape [frames, joints, 7], where the last
+//! axis holds the X/Y/Z/W rotation quaternion followed by the X/Y/Z translation
+static np::ndarray GetFrameTransforms(bp::object const& self)
+{
+    BVHDocument const& document = GetDocument(self);
+    size_t const numJoints = GetNumJoints(document);
+    return ViewDocument(self, document.m_FrameTransforms.empty() ? nullptr : document.m_FrameTransforms.data()->m_RotationQuat, bp::make_tuple(GetNumFrames(document), numJoints, 7),
+        bp::make_tuple(numJoints * sizeof(BVHTransform), sizeof(BVHTransform), sizeof(double)));
+}
+
+static np::ndarray GetRotations(bp::object const& self)
+{
+    BVHDocument const& document = GetDocument(self);
+    size_t const numJoints = GetNumJoints(document);
+    return ViewDocument(self, document.m_FrameTransforms.empty() ? nullptr : document.m_FrameTransforms.data()->m_RotationQuat, bp::make_tuple(GetNumFrames(document), numJoints, 4),
+        bp::make_tuple(numJoints * sizeof(BVHTransform), sizeof(BVHTransform), sizeof(double)));
+}
+
+static np::ndarray GetTranslations(bp::object const& self)
+{
+    BVHDocument const& document = GetDocument(self);
+    size_t const numJoints = GetNumJoints(document);
+    return ViewDocument(self, document.m_FrameTransforms.empty() ? nullptr : document.m_FrameTransforms.data()->m_Translation, bp::make_tuple(GetNumFrames(document), numJoints, 3),
+        bp::make_tuple(numJoints * sizeof(BVHTransform), sizeof(BVHTransform), sizeof(double)));
+}
+
+static BVHDocumentPtr Parse(std::string const& filePath, bp::object const& joints, bp::object const& subtrees)
+{
+    BVHJointSelection const selection = ToJointSelection(joints, subtrees);
+    BVHDocumentPtr document = std::make_shared<BVHDocument>();
+    bool parsed = false;
+    {
+        ScopedGILRelease release;
+        parsed = ParseBVH(filePath, *document, selection);
+    }
+    if (!parsed) {
+        PyErr_SetString(PyExc_RuntimeError, ("Failed to parse BVH file '" + filePath + "'").c_str());
+        bp::throw_error_already_set();
+    }
+    return document;
+}
+
+static bp::list ParseFiles(bp::object const& filePathsSequence, bp::object const& joints, bp::object const& subtrees, size_t maxThreads)
+{
+    std::vector<std::string> const filePaths = ToStrings(filePathsSequence);
+    BVHJointSelection const selection = ToJointSelection(joints, subtrees);
+
+    // Each file is parsed straight into the document that is returned, without the GIL
+    std::vector<BVHDocumentPtr> documents(filePaths.size());
+    {
+        ScopedGILRelease release;
+        ParseBVHFiles(filePaths, [&](size_t fileIndex, bool parsed, BVHDocument& document) {
+            if (parsed) {
+                documents[fileIndex] = std::make_shared<BVHDocument>(std::move(document));
+            }
+        }, selection, maxThreads);
+    }
+
+    bp::list result;
+    for (BVHDocumentPtr const& document : documents) {
+        result.append(document ? bp::object(document) : bp::object());
+    }
+    return result;
+}
+
+static bp::list ExportTensors(bp::object const& filePathsSequence, std::string const& outputDirectory, bool singlePrecision, size_t maxThreads)
+{
+    std::vector<std::string> const filePaths = ToStrings(filePathsSequence);
+    BVHTensorOptions options;
+    options.m_SinglePrecision = singlePrecision;
+
+    std::vector<std::string> failedPaths;
+    {
+        ScopedGILRelease release;
+        ExportBVHTensors(filePaths, outputDirectory, options, maxThreads, &failedPaths);
+    }
+
+    bp::list result;
+    for (std::string const& failedPath : failedPaths) {
+        result.append(failedPath);
+    }
+    return result;
+}
+
+BOOST_PYTHON_MODULE(usdBVHAnim)
+{
+    np::initialize();
+
+    bp::class_<BVHDocument, BVHDocumentPtr, boost::noncopyable>("BVHDocument", "A parsed BVH file", bp::no_init)
+        .add_property("num_joints", &GetNumJoints, "The number of joints in the skeleton")
+        .add_property("num_frames", &GetNumFrames, "The number of frames in the animation")
+        .add_property("frame_time", &GetFrameTime, "The time in seconds between each frame")
+        .add_property("joint_names", &GetJointNames, "A list of the name of each joint")
+        .add_property("joint_parents", &GetJointParents, "An int32 array of shape [joints] holding the index of each joint's parent, or -1 for the root")
+        .add_property("joint_offsets", &GetJointOffsets, "A float64 array of shape [joints, 3] holding each joint's offset from its parent")
+        .add_property("frame_transforms", &GetFrameTransforms, "A float64 array of shape [frames, joints, 7] holding each joint's X/Y/Z/W rotation and X/Y/Z translation")
+        .add_property("rotations", &GetRotations, "A float64 array of shape [frames, joints, 4] holding each joint's X/Y/Z/W rotation")
+        .add_property("translations", &GetTranslations, "A float64 array of shape [frames, joints, 3] holding each joint's X/Y/Z translation");
+
+    bp::def("parse_bvh", &Parse, (bp::arg("file_path"), bp::arg("joints") = bp::object(), bp::arg("subtrees") = bp::object()),
+        "Parse the BVH file at the given path, optionally keeping only the given joints and the joints below the given subtree roots. "
+        "Raises a RuntimeError if the file could not be parsed.");
+    bp::def("parse_bvh_files", &ParseFiles, (bp::arg("file_paths"), bp::arg("joints") = bp::object(), bp::arg("subtrees") = bp::object(), bp::arg("max_threads") = 0),
+        "Parse each of the BVH files at the given paths in parallel, returning a list holding a BVHDocument for each file, or None for each "
+        "file that could not be parsed. Parsing runs without holding the GIL.");
+    bp::def("export_bvh_tensors", &ExportTensors, (bp::arg("file_paths"), bp::arg("output_dir"), bp::arg("single_precision") = false, bp::arg("max_threads") = 0),
+        "Export each of the BVH files at the given paths in parallel to a '<name>.npy' tensor of shape [frames, joints, 7] and a '<name>.json' "
+        "description of its skeleton in the given directory, returning a list of the paths that could not be exported. Files with the "
+        "same name in different directories are written to subdirectories mirroring their directories. Exporting runs without holding the GIL.");
+}
@@ -0,0 +1,128 @@
+"""Tests for the usdBVHAnim Python module, run from the repository root."""
+import gc
+import json
+import os
+import shutil
+import tempfile
+import sys
+import threading
+import unittest
+
+import numpy as np
+import usdBVHAnim
+
+
+class ParseBVHTests(unittest.TestCase):
+    def test_parse_bvh_returns_document(self):
+        document = usdBVHAnim.parse_bvh("data/test_bvh.bvh")
+        self.assertEqual(document.joint_names, ["Root", "Foo"])
+        self.assertEqual(document.num_joints, 2)
+        self.assertEqual(document.num_frames, 20)
+        self.assertTrue(np.array_equal(document.joint_parents, [-1, 0]))
+        self.assertTrue(np.allclose(document.joint_offsets, [[0.0, 0.0, 0.0], [0.0, 0.0, 1.0]]))
+        self.assertEqual(document.frame_transforms.shape, (20, 2, 7))
+        self.assertEqual(document.rotations.shape, (20, 2, 4))
+        self.assertEqual(document.translations.shape, (20, 2, 3))
+        self.assertTrue(np.array_equal(document.rotations, document.frame_transforms[:, :, :4]))
+        self.assertTrue(np.array_equal(document.translations, document.frame_transforms[:, :, 4:]))
+        self.assertTrue(np.allclose(np.linalg.norm(document.rotations, axis=2), 1.0))
+
+    def test_arrays_view_document_without_copies(self):
+        document = usdBVHAnim.parse_bvh("data/test_bvh.bvh")
+        transforms = document.frame_transforms
+        self.assertFalse(transforms.flags.owndata)
+        self.assertFalse(transforms.flags.writeable)
+        self.assertEqual(transforms.ctypes.data, document.rotations.ctypes.data)
+        self.assertEqual(document.translations.ctypes.data, transforms.ctypes.data + 4 * transforms.itemsize)
+
+        # Arrays keep the document alive after every other reference to it has gone
+        expected = transforms.copy()
+        del document
+        gc.collect()
+        self.assertTrue(np.array_equal(transforms, expected))
+
+    def test_arrays_of_file_without_frames_are_empty(self):
+        with tempfile.TemporaryDirectory() as directory:
+            file_path = os.path.join(directory, "no_frames.bvh")
+            with open(file_path, "w") as file:
+                file.write("HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 3 Xposition Yposition Zposition\n"
+                           "  End Site\n  {\n    OFFSET 0 1 0\n  }\n}\nMOTION\nFrames: 0\nFrame Time: 0.1\n")
+            document = usdBVHAnim.parse_bvh(file_path)
+        self.assertEqual(document.num_frames, 0)
+        self.assertEqual(document.frame_transforms.shape, (0, 1, 7))
+        self.assertEqual(document.rotations.shape, (0, 1, 4))
+        self.assertEqual(document.translations.shape, (0, 1, 3))
+        self.assertEqual(document.joint_offsets.shape, (1, 3))
+
+    def test_parse_bvh_selects_joints(self):
+        document = usdBVHAnim.parse_bvh("data/test_bvh.bvh", joints=["Root"])
+        self.assertEqual(document.joint_names, ["Root"])
+        self.assertEqual(document.frame_transforms.shape, (20, 1, 7))
+
+    def test_parse_bvh_raises_on_failure(self):
+        with self.assertRaises(RuntimeError):
+            usdBVHAnim.parse_bvh("data/missing.bvh")
+
+    def test_parse_bvh_files_matches_parse_bvh(self):
+        expected = usdBVHAnim.parse_bvh("data/test_bvh.bvh")
+        documents = usdBVHAnim.parse_bvh_files(["data/test_bvh.bvh", "data/missing.bvh"] * 8, max_threads=4)
+        self.assertEqual(len(documents), 16)
+        for i, document in enumerate(documents):
+            if i % 2:
+                self.assertIsNone(document)
+            else:
+                self.assertTrue(np.array_equal(document.frame_transforms, expected.frame_transforms))
+
+    def test_parse_bvh_files_releases_gil(self):
+        # A Python thread keeps running while files are parsed
+        counter = [0]
+        stop = threading.Event()
+
+        def count():
+            while not stop.is_set():
+                counter[0] += 1
+
+        thread = threading.Thread(target=count)
+        thread.start()
+        try:
+            usdBVHAnim.parse_bvh_files(["data/test_bvh.bvh"] * 2000, max_threads=2)
+        finally:
+            stop.set()
+            thread.join()
+        self.assertGreater(counter[0], 0)
+
+
+class ExportBVHTensorsTests(unittest.TestCase):
+    def setUp(self):
+        self.output_dir = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.output_dir)
+
+    def test_export_bvh_tensors_writes_memory_mappable_tensor(self):
+        expected = usdBVHAnim.parse_bvh("data/test_bvh.bvh")
+        failed = usdBVHAnim.export_bvh_tensors(["data/test_bvh.bvh", "data/missing.bvh"], self.output_dir)
+        self.assertEqual(failed, ["data/missing.bvh"])
+
+        tensor = np.load(os.path.join(self.output_dir, "test_bvh.npy"), mmap_mode="r")
+        self.assertIsInstance(tensor, np.memmap)
+        self.assertEqual(tensor.dtype, np.float64)
+        self.assertTrue(np.array_equal(tensor, expected.frame_transforms))
+
+        with open(os.path.join(self.output_dir, "test_bvh.json")) as stream:
+            description = json.load(stream)
+        self.assertEqual(description["joint_names"], expected.joint_names)
+        self.assertEqual(description["joint_parents"], expected.joint_parents.tolist())
+        self.assertEqual(description["shape"], list(tensor.shape))
+        self.assertAlmostEqual(description["fps"], 1.0 / expected.frame_time)
+
+    def test_export_bvh_tensors_single_precision(self):
+        expected = usdBVHAnim.parse_bvh("data/test_bvh.bvh")
+        self.assertEqual(usdBVHAnim.export_bvh_tensors(["data/test_bvh.bvh"], self.output_dir, single_precision=True), [])
+        tensor = np.load(os.path.join(self.output_dir, "test_bvh.npy"), mmap_mode="r")
+        self.assertEqual(tensor.dtype, np.float32)
+        self.assertTrue(np.array_equal(tensor, expected.frame_transforms.astype(np.float32)))
+
+
+if __name__ == "__main__":
+    sys.exit(0 if unittest.main(exit=False).result.wasSuccessful() else 1)
@@ -0,0 +1,138 @@
+#include "AuthorBVH.h"
+#include <pxr/base/gf/matrix4f.h>
+#include <pxr/base/gf/quatd.h>
+#include <pxr/base/gf/rotation.h>
+#include <pxr/base/work/loops.h>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
+
+namespace usdBVHAnimPlugin {
+namespace {
+    //! A skeleton shared by every document with the same skeleton and scale, registered by a layer
+    struct SharedSkeleton {
+        pxr::VtArray<pxr::TfToken> m_JointPaths;
+        pxr::VtArray<pxr::GfMatrix4d> m_RestTransforms;
+        pxr::SdfLayerHandle m_Layer;
+        std::string m_AssetPath;
+    };
+
+    //! The process-wide set of shared skeletons, bucketed by the hash of their hierarchy and scale
+    struct SharedSkeletonStore {
+        std::mutex m_Mutex;
+        std::unordered_multimap<uint64_t, SharedSkeleton> m_Skeletons;
+
+        static SharedSkeletonStore& Get()
+        {
+            // Intentionally leaked, so that layer handles are never destroyed after USD's own registries
+            static SharedSkeletonStore* s_Store = new SharedSkeletonStore();
+            return *s_Store;
+        }
+    };
+} // namespace
+
+pxr::VtArray<pxr::TfToken> ComputeBVHJointPaths(BVHDocument const& document)
+{
+    pxr::VtArray<pxr::TfToken> jointPaths;
+    jointPaths.reserve(document.m_JointNames.size());
+    for (size_t jointIndex = 0; jointIndex < document.m_JointNames.size(); ++jointIndex) {
+        std::string jointPath(document.m_JointNames[jointIndex]);
+        int parentIndex = document.m_JointParents[jointIndex];
+        while (parentIndex != BVHDocument::c_RootParentIndex) {
+            jointPath = std::string(document.m_JointNames[parentIndex]) + "/" + jointPath;
+            parentIndex = document.m_JointParents[parentIndex];
+        }
+        jointPaths.push_back(pxr::TfToken(jointPath));
+    }
+    return jointPaths;
+}
+
+void ComputeBVHBindTransforms(BVHDocument const& document, float scale, pxr::VtArray<pxr::GfMatrix4d>& bindTransformsLS, pxr::VtArray<pxr::GfMatrix4d>& bindTransformsMS)
+{
+    // Walk the joint hierarchy from root to leaf, so that each parent's model space
+    // transform is known before any of its children
+    bindTransformsLS.clear();
+    bindTransformsMS.clear();
+    bindTransformsLS.reserve(document.m_JointNames.size());
+    bindTransformsMS.reserve(document.m_JointNames.size());
+    for (size_t i = 0; i < document.m_JointNames.size(); ++i) {
+        pxr::GfMatrix4d parentMS;
+        parentMS.SetIdentity();
+        if (document.m_JointParents[i] >= 0) {
+            parentMS = bindTransformsMS[document.m_JointParents[i]];
+        }
+
+        auto offset = document.m_JointOffsets[i];
+        auto matrix = pxr::GfMatrix4d();
+        matrix.SetTranslate(pxr::GfVec3d(offset.m_Translation[0], offset.m_Translation[1], offset.m_Translation[2]) * scale);
+
+        bindTransformsLS.push_back(matrix);
+        bindTransformsMS.push_back(matrix * parentMS);
+    }
+}
+
+void ComputeBVHFrameSamples(BVHDocument const& document, size_t frameIndex, float scale, pxr::VtArray<pxr::GfVec3f>& translations, pxr::VtArray<pxr::GfQuatf>& rotations)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    translations.clear();
+    rotations.clear();
+    translations.reserve(numJoints);
+    rotations.reserve(numJoints);
+    for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+        auto const& frame = document.m_FrameTransforms[frameIndex * numJoints + jointIndex];
+        pxr::GfRotation frameRotation = pxr::GfQuatd(frame.m_RotationQuat[3], frame.m_RotationQuat[0], frame.m_RotationQuat[1], frame.m_RotationQuat[2]);
+        auto localTransform = pxr::GfMatrix4f();
+        localTransform.SetTransform(frameRotation, pxr::GfVec3f(static_cast<float>(frame.m_Translation[0]), static_cast<float>(frame.m_Translation[1]), static_cast<float>(frame.m_Translation[2])) * scale);
+        translations.push_back(localTransform.ExtractTranslation());
+        rotations.push_back(localTransform.ExtractRotationQuat());
+    }
+}
+
+void ComputeBVHAnimationSamples(BVHDocument const& document, float scale, std::vector<pxr::VtArray<pxr::GfVec3f>>& frameTranslations, std::vector<pxr::VtArray<pxr::GfQuatf>>& frameRotations)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    size_t const numFrames = numJoints > 0 ? document.m_FrameTransforms.size() / numJoints : 0;
+    frameTranslations.clear();
+    frameRotations.clear();
+    frameTranslations.resize(numFrames);
+    frameRotations.resize(numFrames);
+
+    // Each frame's arrays are only written by the task that computes it, so no synchronisation is needed
+    pxr::WorkParallelForN(numFrames, [&](size_t begin, size_t end) {
+        for (size_t frameIndex = begin; frameIndex < end; ++frameIndex) {
+            ComputeBVHFrameSamples(document, frameIndex, scale, frameTranslations[frameIndex], frameRotations[frameIndex]);
+        }
+    });
+}
+
+std::string FindOrAddBVHSkeletonAsset(BVHDocument const& document, float scale, pxr::SdfLayerHandle const& layer, std::string const& assetPath, pxr::VtArray<pxr::TfToken>& jointPaths)
+{
+    pxr::VtArray<pxr::GfMatrix4d> bindPoseLS;
+    pxr::VtArray<pxr::GfMatrix4d> bindPoseMS;
+    ComputeBVHBindTransforms(document, scale, bindPoseLS, bindPoseMS);
+    jointPaths = ComputeBVHJointPaths(document);
+
+    // Hashes may collide, so a skeleton is only shared if its joints and transforms match exactly
+    uint32_t scaleBits = 0;
+    std::memcpy(&scaleBits, &scale, sizeof(scale));
+    uint64_t const hash = HashBVHHierarchy(document) ^ (scaleBits * 0x9e3779b97f4a7c15ull);
+
+    // Skeletons are removed once the layer that registered them has been destroyed, so that the
+    // store only ever holds the skeletons of live layers
+    SharedSkeletonStore& store = SharedSkeletonStore::Get();
+    std::lock_guard<std::mutex> lock(store.m_Mutex);
+    for (auto it = store.m_Skeletons.begin(); it != store.m_Skeletons.end();) {
+        it = it->second.m_Layer ? std::next(it) : store.m_Skeletons.erase(it);
+    }
+    auto const range = store.m_Skeletons.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.m_JointPaths == jointPaths && it->second.m_RestTransforms == bindPoseLS) {
+            jointPaths = it->second.m_JointPaths;
+            return it->second.m_AssetPath;
+        }
+    }
+    store.m_Skeletons.emplace(hash, SharedSkeleton { jointPaths, bindPoseLS, layer, assetPath });
+    return assetPath;
+}
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,65 @@
+#pragma once
+#include "ParseBVH.h"
+#include <pxr/base/gf/matrix4d.h>
+#include <pxr/base/gf/quatf.h>
+#include <pxr/base/gf/vec3f.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/value.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/types.h>
+#include <string>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! Returns the path of each joint in the given document, relative to the root joint and
+//! including it, in the form expected by the `joints` attribute of a UsdSkelSkeleton.
+pxr::VtArray<pxr::TfToken> ComputeBVHJointPaths(BVHDocument const& document);
+
+//! Compute the bind pose of each joint in the given document from the OFFSET data in the
+//! BVH, storing the local space transforms in `bindTransformsLS` and the model space
+//! transforms in `bindTransformsMS`. Translations are multiplied by the given scale.
+void ComputeBVHBindTransforms(BVHDocument const& document, float scale, pxr::VtArray<pxr::GfMatrix4d>& bindTransformsLS, pxr::VtArray<pxr::GfMatrix4d>& bindTransformsMS);
+
+//! Returns the asset path of a layer that holds the skeleton of the given document as its default
+//! prim, with translations multiplied by the given scale, which is shared by every layer of a document
+//! with the same skeleton (see `HashBVHHierarchy`) and scale, so that clip layers can reference it
+//! rather than authoring their own copy of the skeleton. If no live layer has registered a matching
+//! skeleton, the given layer is registered with the given asset path, which is returned. Each
+//! registration holds a weak reference to its layer, and is removed once the layer is destroyed,
+//! after which the next layer with the same skeleton registers its own asset path. `jointPaths` is
+//! set to the joints of the skeleton. This may be called concurrently from multiple threads.
+std::string FindOrAddBVHSkeletonAsset(BVHDocument const& document, float scale, pxr::SdfLayerHandle const& layer, std::string const& assetPath, pxr::VtArray<pxr::TfToken>& jointPaths);
+
+//! Compute the local space translation and rotation of each joint at the given frame of the
+//! given document, as authored to a UsdSkelAnimation. Translations are multiplied by the
+//! given scale.
+void ComputeBVHFrameSamples(BVHDocument const& document, size_t frameIndex, float scale, pxr::VtArray<pxr::GfVec3f>& translations, pxr::VtArray<pxr::GfQuatf>& rotations);
+
+//! Compute the samples of every frame of the given document with `ComputeBVHFrameSamples`,
+//! storing the samples of each frame at its index in `frameTranslations` and `frameRotations`.
+//! Frames are independent of each other, so they are computed in parallel with
+//! `WorkParallelForN`, on at most as many threads as `WorkSetConcurrencyLimit` allows.
+void ComputeBVHAnimationSamples(BVHDocument const& document, float scale, std::vector<pxr::VtArray<pxr::GfVec3f>>& frameTranslations, std::vector<pxr::VtArray<pxr::GfQuatf>>& frameRotations);
+
+//! Returns a time sample map holding every `frameStride`th of the given per-frame values, with
+//! the first frame at time code `startTime`. The last frame is always included, so that the samples span
+//! the whole animation. The map can be authored in a single call to `SdfLayer::SetField` with
+//! `SdfFieldKeys->TimeSamples`, rather than with a call to `SdfLayer::SetTimeSample` per frame.
+//! Array values share their storage with the given values, so no samples are copied.
+template <typename T>
+pxr::SdfTimeSampleMap MakeBVHTimeSamples(std::vector<T> const& frameValues, size_t frameStride = 1, double startTime = 1.0)
+{
+    // Samples are inserted in time order, so each insertion is at the end of the map
+    pxr::SdfTimeSampleMap timeSamples;
+    size_t const numFrames = frameValues.size();
+    for (size_t frameIndex = 0; frameIndex < numFrames; frameIndex += frameStride) {
+        timeSamples.emplace_hint(timeSamples.end(), startTime + frameIndex, pxr::VtValue(frameValues[frameIndex]));
+    }
+    if (numFrames > 0 && (numFrames - 1) % frameStride != 0) {
+        timeSamples.emplace_hint(timeSamples.end(), startTime + static_cast<double>(numFrames - 1), pxr::VtValue(frameValues[numFrames - 1]));
+    }
+    return timeSamples;
+}
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,463 @@
+#include "BVHChunkReaders.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <sys/stat.h>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(USDBVHANIM_WITH_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(USDBVHANIM_WITH_ZSTD)
+#include <zstd.h>
+#endif
+
+//! Returns `true` if the given contents begin with the magic number of a gzip member
+static bool IsGzipContents(char const* contents, size_t size)
+{
+    return size >= 2 && std::memcmp(contents, "\x1f\x8b", 2) == 0;
+}
+
+//! Returns `true` if the given contents begin with the magic number of a Zstandard frame
+static bool IsZstdContents(char const* contents, size_t size)
+{
+    return size >= 4 && std::memcmp(contents, "\x28\xb5\x2f\xfd", 4) == 0;
+}
+
+//! Tell the operating system that the given region of the given file (to the end of the file
+//! if `size` is zero) will be read sequentially, so that it reads further ahead of each read
+static void AdviseSequentialRead(std::FILE* file, size_t offset, size_t size)
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fileno(file), static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_SEQUENTIAL);
+#else
+    (void)file;
+    (void)offset;
+    (void)size;
+#endif
+}
+
+//! Returns the size of the given file in bytes, or `SIZE_MAX` if it could not be determined
+static size_t GetFileSize(std::FILE* file)
+{
+#if defined(_WIN32)
+    struct _stat64 status;
+    return _fstat64(_fileno(file), &status) == 0 ? static_cast<size_t>(status.st_size) : SIZE_MAX;
+#else
+    struct stat status;
+    return fstat(fileno(file), &status) == 0 && S_ISREG(status.st_mode) ? static_cast<size_t>(status.st_size) : SIZE_MAX;
+#endif
+}
+
+//! Ask the operating system to start reading the given region of the given file in the background
+static void AdviseWillRead(std::FILE* file, size_t offset, size_t size)
+{
+#if defined(POSIX_FADV_WILLNEED)
+    if (size > 0) {
+        posix_fadvise(fileno(file), static_cast<off_t>(offset), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+    }
+#else
+    (void)file;
+    (void)offset;
+    (void)size;
+#endif
+}
+
+namespace usdBVHAnimPlugin {
+namespace {
+#if defined(USDBVHANIM_WITH_ZLIB)
+    //! A `BVHChunkReader` that decompresses gzip contents (including contents made up of
+    //! several concatenated gzip members) read from another `BVHChunkReader`.
+    class GzipChunkReader : public BVHChunkReader {
+    public:
+        explicit GzipChunkReader(std::unique_ptr<BVHChunkReader> source)
+            : m_File(std::move(source))
+            , m_Input(1 << 16)
+        {
+            // Adding 32 to the window size enables gzip header detection
+            m_Failed = m_File->Failed() || inflateInit2(&m_Stream, 15 + 32) != Z_OK;
+            m_Initialised = !m_Failed;
+        }
+
+        ~GzipChunkReader() override
+        {
+            if (m_Initialised) {
+                inflateEnd(&m_Stream);
+            }
+        }
+
+        size_t Read(char* buffer, size_t capacity) override
+        {
+            if (m_Failed || m_EndOfInput) {
+                return 0;
+            }
+
+            m_Stream.next_out = reinterpret_cast<Bytef*>(buffer);
+            m_Stream.avail_out = static_cast<uInt>(std::min<size_t>(capacity, UINT_MAX));
+            uInt const availOut = m_Stream.avail_out;
+            while (m_Stream.avail_out > 0) {
+                if (m_Stream.avail_in == 0) {
+                    size_t const numRead = m_File->Read(m_Input.data(), m_Input.size());
+                    if (numRead == 0) {
+                        // Running out of input part way through a member means the file is truncated
+                        m_Failed = m_File->Failed() || m_InMember;
+                        m_EndOfInput = true;
+                        break;
+                    }
+                    m_Stream.next_in = reinterpret_cast<Bytef*>(m_Input.data());
+                    m_Stream.avail_in = static_cast<uInt>(numRead);
+                }
+
+                int const status = inflate(&m_Stream, Z_NO_FLUSH);
+                if (status == Z_STREAM_END) {
+                    inflateReset(&m_Stream);
+                    m_InMember = false;
+                } else if (status == Z_OK || status == Z_BUF_ERROR) {
+                    m_InMember = true;
+                } else {
+                    m_Failed = true;
+                    break;
+                }
+            }
+            return availOut - m_Stream.avail_out;
+        }
+
+        bool Failed() const override { return m_Failed; }
+
+    private:
+        std::unique_ptr<BVHChunkReader> m_File;
+        std::vector<char> m_Input;
+        z_stream m_Stream = {};
+        bool m_Initialised = false;
+        bool m_InMember = false;
+        bool m_EndOfInput = false;
+        bool m_Failed = false;
+    };
+#endif
+
+#if defined(USDBVHANIM_WITH_ZSTD)
+    //! A `BVHChunkReader` that decompresses Zstandard contents read from another `BVHChunkReader`.
+    class ZstdChunkReader : public BVHChunkReader {
+    public:
+        explicit ZstdChunkReader(std::unique_ptr<BVHChunkReader> source)
+            : m_File(std::move(source))
+            , m_Input(ZSTD_DStreamInSize())
+            , m_Stream(ZSTD_createDStream())
+        {
+            m_Failed = m_File->Failed() || !m_Stream || ZSTD_isError(ZSTD_initDStream(m_Stream));
+        }
+
+        ~ZstdChunkReader() override
+        {
+            ZSTD_freeDStream(m_Stream);
+        }
+
+        size_t Read(char* buffer, size_t capacity) override
+        {
+            if (m_Failed || m_EndOfInput) {
+                return 0;
+            }
+
+            ZSTD_outBuffer output = { buffer, capacity, 0 };
+            while (output.pos < output.size) {
+                if (m_InputBuffer.pos == m_InputBuffer.size) {
+                    size_t const numRead = m_File->Read(m_Input.data(), m_Input.size());
+                    if (numRead == 0) {
+                        // A non-zero hint from the last call means a frame was left incomplete
+                        m_Failed = m_File->Failed() || m_LastHint != 0;
+                        m_EndOfInput = true;
+                        break;
+                    }
+                    m_InputBuffer = { m_Input.data(), numRead, 0 };
+                }
+
+                size_t const hint = ZSTD_decompressStream(m_Stream, &output, &m_InputBuffer);
+                if (ZSTD_isError(hint)) {
+                    m_Failed = true;
+                    break;
+                }
+                m_LastHint = hint;
+            }
+            return output.pos;
+        }
+
+        bool Failed() const override { return m_Failed; }
+
+    private:
+        std::unique_ptr<BVHChunkReader> m_File;
+        std::vector<char> m_Input;
+        ZSTD_DStream* m_Stream = nullptr;
+        ZSTD_inBuffer m_InputBuffer = { nullptr, 0, 0 };
+        size_t m_LastHint = 0;
+        bool m_EndOfInput = false;
+        bool m_Failed = false;
+    };
+#endif
+}
+
+BVHFileChunkReader::BVHFileChunkReader(std::string const& filePath)
+    : m_File(std::fopen(filePath.c_str(), "rb"))
+    , m_OwnsFile(true)
+    , m_Failed(m_File == nullptr)
+{
+    if (m_File) {
+        // Reads are large, so buffering them would only add a copy
+        std::setvbuf(m_File, nullptr, _IONBF, 0);
+        AdviseSequentialRead(m_File, 0, 0);
+        m_Size = GetFileSize(m_File);
+    }
+}
+
+BVHFileChunkReader::BVHFileChunkReader(std::FILE* file, size_t offset, size_t size)
+    : m_File(file)
+    , m_Offset(offset)
+    , m_End(offset + size)
+    , m_Size(size)
+    , m_Failed(file == nullptr)
+{
+    if (m_File) {
+        AdviseSequentialRead(m_File, offset, size);
+    }
+}
+
+BVHFileChunkReader::~BVHFileChunkReader()
+{
+    if (m_File && m_OwnsFile) {
+        std::fclose(m_File);
+    }
+}
+
+size_t BVHFileChunkReader::Read(char* buffer, size_t capacity)
+{
+    capacity = std::min(capacity, m_End - m_Offset);
+    if (!m_File || m_Failed || capacity == 0) {
+        return 0;
+    }
+
+    // Files opened by this reader are read from their current position, whereas regions of
+    // files that are given to it are read from their offset, without changing the position
+    size_t numRead = 0;
+#if !defined(_WIN32)
+    while (numRead < capacity) {
+        ssize_t const result = pread(fileno(m_File), buffer + numRead, capacity - numRead, static_cast<off_t>(m_Offset + numRead));
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result <= 0) {
+            // Regions of files must be read in full, so ending early means the file is truncated
+            m_Failed = result < 0 || !m_OwnsFile;
+            break;
+        }
+        numRead += static_cast<size_t>(result);
+    }
+#else
+    if (m_OwnsFile || _fseeki64(m_File, static_cast<__int64>(m_Offset), SEEK_SET) == 0) {
+        numRead = std::fread(buffer, 1, capacity, m_File);
+    }
+    m_Failed = numRead < capacity && (!m_OwnsFile || std::ferror(m_File) != 0);
+#endif
+    m_Offset += numRead;
+
+    // Ask for the contents after this read while they are being parsed
+    if (numRead > 0) {
+        AdviseWillRead(m_File, m_Offset, std::min(capacity * c_ReadAheadChunks, m_End - m_Offset));
+    }
+    return numRead;
+}
+
+BVHMemoryChunkReader::BVHMemoryChunkReader(char const* contents, size_t size)
+    : m_Contents(contents)
+    , m_Size(size)
+{
+}
+
+size_t BVHMemoryChunkReader::Read(char* buffer, size_t capacity)
+{
+    size_t const numRead = std::min(capacity, m_Size - m_Offset);
+    std::memcpy(buffer, m_Contents + m_Offset, numRead);
+    m_Offset += numRead;
+    return numRead;
+}
+
+BVHPipelinedChunkReader::BVHPipelinedChunkReader(BVHChunkReader& source, size_t chunkSize, size_t numChunks)
+    : m_Source(source)
+    , m_Size(source.GetSize())
+    , m_ChunkSize(std::max<size_t>(chunkSize, 1))
+    , m_Chunks(std::max<size_t>(numChunks, 1))
+    , m_ChunkSizes(m_Chunks.size(), 0)
+{
+    // Chunks are always filled before they are read, so they are not initialised
+    for (std::unique_ptr<char[]>& chunk : m_Chunks) {
+        chunk.reset(new char[m_ChunkSize]);
+    }
+    m_Producer = std::thread([this]() { RunProducer(); });
+}
+
+BVHPipelinedChunkReader::~BVHPipelinedChunkReader()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_ChunkConsumed.notify_all();
+    m_Producer.join();
+}
+
+void BVHPipelinedChunkReader::RunProducer()
+{
+    size_t const numChunks = m_Chunks.size();
+    while (true) {
+        size_t chunkIndex = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_ChunkConsumed.wait(lock, [&]() { return m_Stop || m_NumProduced - m_NumConsumed < numChunks; });
+            if (m_Stop) {
+                return;
+            }
+            chunkIndex = m_NumProduced % numChunks;
+        }
+
+        // The consumer never touches a chunk until it has been produced, so the chunk
+        // can be filled without holding the lock
+        char* const chunk = m_Chunks[chunkIndex].get();
+        size_t size = 0;
+        bool endOfInput = false;
+        while (size < m_ChunkSize) {
+            size_t const numRead = m_Source.Read(chunk + size, m_ChunkSize - size);
+            if (numRead == 0) {
+                endOfInput = true;
+                break;
+            }
+            size += numRead;
+        }
+        bool const failed = m_Source.Failed();
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ChunkSizes[chunkIndex] = size;
+            ++m_NumProduced;
+            m_EndOfInput = endOfInput || failed;
+            m_Failed = failed;
+        }
+        m_ChunkProduced.notify_one();
+        if (endOfInput || failed) {
+            return;
+        }
+    }
+}
+
+size_t BVHPipelinedChunkReader::Read(char* buffer, size_t capacity)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_ChunkProduced.wait(lock, [&]() { return m_NumConsumed < m_NumProduced || m_EndOfInput; });
+    if (m_NumConsumed == m_NumProduced) {
+        return 0;
+    }
+
+    size_t const chunkIndex = m_NumConsumed % m_Chunks.size();
+    size_t const numRead = std::min(capacity, m_ChunkSizes[chunkIndex] - m_ReadOffset);
+    std::memcpy(buffer, m_Chunks[chunkIndex].get() + m_ReadOffset, numRead);
+    m_ReadOffset += numRead;
+
+    if (m_ReadOffset == m_ChunkSizes[chunkIndex]) {
+        m_ReadOffset = 0;
+        ++m_NumConsumed;
+        lock.unlock();
+        m_ChunkConsumed.notify_one();
+    }
+    return numRead;
+}
+
+bool BVHPipelinedChunkReader::Failed() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Failed;
+}
+
+size_t FindLastWhitespaceEnd(char const* begin, char const* end)
+{
+    for (char const* cursor = end; cursor > begin; --cursor) {
+        char const c = cursor[-1];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            return cursor - begin;
+        }
+    }
+    return 0;
+}
+
+bool EndsWithIgnoringCase(std::string const& value, char const* suffix)
+{
+    size_t const suffixLength = std::strlen(suffix);
+    if (value.size() < suffixLength) {
+        return false;
+    }
+    for (size_t i = 0; i < suffixLength; ++i) {
+        char const c = static_cast<char>(std::tolower(static_cast<unsigned char>(value[value.size() - suffixLength + i])));
+        if (c != suffix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool IsCompressedBVHPath(std::string const& filePath)
+{
+    return EndsWithIgnoringCase(filePath, ".bvh.gz") || EndsWithIgnoringCase(filePath, ".bvh.zst");
+}
+
+bool IsCompressedBVHContents(char const* contents, size_t size)
+{
+    return IsGzipContents(contents, size) || IsZstdContents(contents, size);
+}
+
+std::unique_ptr<BVHChunkReader> OpenBVHChunkReader(std::string const& filePath)
+{
+    std::unique_ptr<BVHChunkReader> reader;
+    if (EndsWithIgnoringCase(filePath, ".bvh.gz")) {
+#if defined(USDBVHANIM_WITH_ZLIB)
+        reader = std::make_unique<GzipChunkReader>(std::make_unique<BVHFileChunkReader>(filePath));
+#endif
+    } else if (EndsWithIgnoringCase(filePath, ".bvh.zst")) {
+#if defined(USDBVHANIM_WITH_ZSTD)
+        reader = std::make_unique<ZstdChunkReader>(std::make_unique<BVHFileChunkReader>(filePath));
+#endif
+    } else {
+        reader = std::make_unique<BVHFileChunkReader>(filePath);
+    }
+
+    if (reader && reader->Failed()) {
+        reader.reset();
+    }
+    return reader;
+}
+
+std::unique_ptr<BVHChunkReader> OpenBVHChunkReader(char const* contents, size_t size)
+{
+    std::unique_ptr<BVHChunkReader> reader;
+    auto source = std::make_unique<BVHMemoryChunkReader>(contents, size);
+    if (IsGzipContents(contents, size)) {
+#if defined(USDBVHANIM_WITH_ZLIB)
+        reader = std::make_unique<GzipChunkReader>(std::move(source));
+#endif
+    } else if (IsZstdContents(contents, size)) {
+#if defined(USDBVHANIM_WITH_ZSTD)
+        reader = std::make_unique<ZstdChunkReader>(std::move(source));
+#endif
+    } else {
+        reader = std::move(source);
+    }
+
+    if (reader && reader->Failed()) {
+        reader.reset();
+    }
+    return reader;
+}
+} // namespace usdBVHAnimPlugin
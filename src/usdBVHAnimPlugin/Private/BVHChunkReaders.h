@@ -0,0 +1,134 @@
+#pragma once
+#include "ParseBVH.h"
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! A `BVHChunkReader` that reads the contents of an uncompressed file.
+//!
+//! Contents are read sequentially, straight into the caller's buffer without being buffered by
+//! the C library, and on platforms that support it the operating system is told that the file
+//! will be read sequentially, and asked to read ahead of each read by `c_ReadAheadChunks` times
+//! its size. On network file systems (e.g. NFS), this keeps requests for the next contents in
+//! flight while the current contents are being parsed.
+class BVHFileChunkReader : public BVHChunkReader {
+public:
+    //! The number of reads' worth of contents beyond each read that are read ahead.
+    static constexpr size_t c_ReadAheadChunks = 4;
+
+    //! Open the file at the given path for reading. `Failed()` returns `true` if the
+    //! file could not be opened.
+    explicit BVHFileChunkReader(std::string const& filePath);
+
+    //! Read the `size` bytes at the given offset of an already open file, which must outlive
+    //! the reader, and is not closed by it. On platforms that support it, the file's position
+    //! is not used, so the file may be shared with other readers.
+    BVHFileChunkReader(std::FILE* file, size_t offset, size_t size);
+    ~BVHFileChunkReader() override;
+
+    size_t Read(char* buffer, size_t capacity) override;
+    bool Failed() const override { return m_Failed; }
+    size_t GetSize() const override { return m_Size; }
+
+private:
+    std::FILE* m_File = nullptr;
+    bool m_OwnsFile = false;
+    size_t m_Offset = 0;
+    size_t m_End = SIZE_MAX;
+    size_t m_Size = SIZE_MAX;
+    bool m_Failed = false;
+};
+
+//! A `BVHChunkReader` that reads contents held in memory, which must outlive the reader.
+class BVHMemoryChunkReader : public BVHChunkReader {
+public:
+    BVHMemoryChunkReader(char const* contents, size_t size);
+
+    size_t Read(char* buffer, size_t capacity) override;
+    bool Failed() const override { return false; }
+    size_t GetSize() const override { return m_Size; }
+
+private:
+    char const* m_Contents;
+    size_t m_Size;
+    size_t m_Offset = 0;
+};
+
+//! A `BVHChunkReader` that reads contents from another `BVHChunkReader` on a separate thread,
+//! into a fixed ring of chunks. This allows reading from a slow file system, decompression, or
+//! any other slow source of contents to overlap with parsing, such that the total time taken is
+//! close to the slower of the two, rather than their sum. Values that span the boundary between
+//! two chunks are handled by the parser, which only parses values once they are complete.
+class BVHPipelinedChunkReader : public BVHChunkReader {
+public:
+    //! The default size of each chunk in the ring.
+    static constexpr size_t c_DefaultChunkSize = 1 << 20;
+    //! The default number of chunks in the ring.
+    static constexpr size_t c_DefaultNumChunks = 4;
+
+    //! Begin reading from the given source on a separate thread. The source must outlive
+    //! this reader, and must not be used by any other thread until this reader is destroyed.
+    explicit BVHPipelinedChunkReader(BVHChunkReader& source, size_t chunkSize = c_DefaultChunkSize, size_t numChunks = c_DefaultNumChunks);
+
+    //! Stop reading from the source, and wait for the reading thread to finish.
+    ~BVHPipelinedChunkReader() override;
+
+    size_t Read(char* buffer, size_t capacity) override;
+    bool Failed() const override;
+    size_t GetSize() const override { return m_Size; }
+
+private:
+    void RunProducer();
+
+    BVHChunkReader& m_Source;
+    size_t m_Size;
+    size_t m_ChunkSize;
+    std::vector<std::unique_ptr<char[]>> m_Chunks;
+    std::vector<size_t> m_ChunkSizes;
+    size_t m_NumProduced = 0;
+    size_t m_NumConsumed = 0;
+    size_t m_ReadOffset = 0;
+    bool m_EndOfInput = false;
+    bool m_Failed = false;
+    bool m_Stop = false;
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_ChunkProduced;
+    std::condition_variable m_ChunkConsumed;
+    std::thread m_Producer;
+};
+
+//! Returns the offset just beyond the last whitespace character in the given contents, or zero
+//! if it contains no whitespace. Every value of a chunk of BVH contents before this offset is
+//! known to be complete, so chunks are split at this offset to avoid splitting any value.
+size_t FindLastWhitespaceEnd(char const* begin, char const* end);
+
+//! Returns `true` if the given value ends with the given suffix, ignoring the case of the value.
+//! The suffix must be given in lower case (e.g. `.bvh.gz`).
+bool EndsWithIgnoringCase(std::string const& value, char const* suffix);
+
+//! Returns `true` if the given file path names a compressed BVH file (`.bvh.gz` or
+//! `.bvh.zst`), regardless of whether support for its compression has been compiled in.
+bool IsCompressedBVHPath(std::string const& filePath);
+
+//! Open a `BVHChunkReader` for the file at the given path, which decompresses its contents
+//! if the file path names a compressed BVH file. Returns `nullptr` if the file could not be
+//! opened, or if support for its compression has not been compiled in.
+std::unique_ptr<BVHChunkReader> OpenBVHChunkReader(std::string const& filePath);
+
+//! Returns `true` if the given contents are compressed with gzip or Zstandard, as identified by
+//! the magic number at their start, regardless of whether support for their compression has been
+//! compiled in.
+bool IsCompressedBVHContents(char const* contents, size_t size);
+
+//! Open a `BVHChunkReader` for the given contents held in memory, which decompresses them if
+//! they are compressed (see `IsCompressedBVHContents`). The contents must outlive the reader.
+//! Returns `nullptr` if support for their compression has not been compiled in.
+std::unique_ptr<BVHChunkReader> OpenBVHChunkReader(char const* contents, size_t size);
+} // namespace usdBVHAnimPlugin
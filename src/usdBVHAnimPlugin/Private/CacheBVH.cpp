@@ -0,0 +1,551 @@
+#include "CacheBVH.h"
+#include "BVHChunkReaders.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//! The prefix of the name of every file in the cache directory that belongs to the cache
+static char const* const c_CachePrefix = "usdBVHAnim-";
+
+//! The extension of cached document files
+static char const* const c_CacheExtension = ".bvhcache";
+
+//! The extension of the file that a process holds while it parses and publishes a document
+static char const* const c_LockExtension = ".lock";
+
+//! The extension of a cached document file while it is being written
+static char const* const c_TemporaryExtension = ".tmp";
+
+//! How long a lock or temporary file may go unmodified before the process that created it
+//! is assumed to have died
+static auto constexpr c_StaleAge = std::chrono::seconds(60);
+
+//! How often a process parsing a document marks its lock as modified, so that the lock never
+//! becomes stale while its holder is alive, however long the parse takes
+static auto constexpr c_LockRefreshInterval = c_StaleAge / 4;
+
+//! How often a process waiting for another to publish a document checks whether it has finished
+static auto constexpr c_LockPollInterval = std::chrono::milliseconds(5);
+
+//! The size of each block of a file read while hashing its contents, which is a whole number of words
+static size_t constexpr c_HashBlockSize = 1 << 20;
+
+//! Identifies a cached document file
+static char const c_CacheMagic[8] = { 'B', 'V', 'H', 'C', 'A', 'C', 'H', 'E' };
+
+//! The version of the layout of cached document files, which is incremented whenever it changes
+static uint32_t constexpr c_CacheVersion = 1;
+
+static_assert(sizeof(int) == sizeof(int32_t) && sizeof(unsigned int) == sizeof(uint32_t), "Joint arrays are cached as 32-bit values");
+
+namespace {
+//! The header at the start of each cached document file, which is followed by the arrays
+//! of the document at the offsets given by `CacheLayout`
+struct CacheHeader {
+    char m_Magic[8];
+    uint32_t m_Version;
+    uint32_t m_TransformSize;
+    uint64_t m_ContentHash;
+    uint64_t m_ContentSize;
+    uint64_t m_NumJoints;
+    uint64_t m_NumFrames;
+    uint64_t m_NamesSize;
+    double m_FrameTime;
+};
+
+//! The offset of each array of a document within a cached document file, and the size of the file
+struct CacheLayout {
+    size_t m_JointParents;
+    size_t m_JointNumChannels;
+    size_t m_JointChannels;
+    size_t m_JointNames;
+    size_t m_JointOffsets;
+    size_t m_FrameTransforms;
+    size_t m_Size;
+};
+}
+
+static size_t AlignToWord(size_t value)
+{
+    return (value + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+}
+
+//! Compute the layout of a cached document file holding the given number of joints and frames,
+//! and joint names of the given total size. Returns `false` if the file would be larger than
+//! `maxSize`, which also guards against overflow when the counts are read from a corrupt file.
+static bool ComputeCacheLayout(uint64_t numJoints, uint64_t numFrames, uint64_t namesSize, size_t maxSize, CacheLayout& layout)
+{
+    maxSize = std::min(maxSize, std::numeric_limits<size_t>::max() / 8);
+    if (numJoints > maxSize / sizeof(usdBVHAnimPlugin::BVHTransform) || namesSize > maxSize
+        || (numJoints > 0 && numFrames > maxSize / (numJoints * sizeof(usdBVHAnimPlugin::BVHTransform)))) {
+        return false;
+    }
+    layout.m_JointParents = sizeof(CacheHeader);
+    layout.m_JointNumChannels = layout.m_JointParents + numJoints * sizeof(int32_t);
+    layout.m_JointChannels = layout.m_JointNumChannels + numJoints * sizeof(uint32_t);
+    layout.m_JointNames = layout.m_JointChannels + numJoints * sizeof(uint32_t);
+    layout.m_JointOffsets = AlignToWord(layout.m_JointNames + namesSize);
+    layout.m_FrameTransforms = layout.m_JointOffsets + numJoints * sizeof(usdBVHAnimPlugin::BVHOffset);
+    layout.m_Size = layout.m_FrameTransforms + numJoints * numFrames * sizeof(usdBVHAnimPlugin::BVHTransform);
+    return layout.m_Size <= maxSize;
+}
+
+static uint64_t MixHash(uint64_t hash, uint64_t value)
+{
+    hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+    return hash ^ (hash >> 29);
+}
+
+//! Mix the given contents into the given hash a word at a time, padding the last word with zeros
+static uint64_t HashWords(uint64_t hash, char const* contents, size_t size)
+{
+    size_t const numWholeWords = size / sizeof(uint64_t);
+    for (size_t i = 0; i < numWholeWords; ++i) {
+        uint64_t word;
+        std::memcpy(&word, contents + i * sizeof(uint64_t), sizeof(word));
+        hash = MixHash(hash, word);
+    }
+    if (size_t const remainder = size % sizeof(uint64_t)) {
+        uint64_t word = 0;
+        std::memcpy(&word, contents + numWholeWords * sizeof(uint64_t), remainder);
+        hash = MixHash(hash, word);
+    }
+    return hash;
+}
+
+//! The hash of contents before any words have been mixed into it
+static uint64_t constexpr c_HashSeed = 0xcbf29ce484222325ull;
+
+//! Hash the given contents, such that the hash matches that of a file with the same contents
+static uint64_t HashContents(char const* contents, size_t size)
+{
+    return MixHash(HashWords(c_HashSeed, contents, size), size);
+}
+
+//! Hash the contents of the file at the given path, storing the hash and the size of the contents
+static bool HashFile(std::string const& filePath, uint64_t& hash, uint64_t& size)
+{
+    std::FILE* file = std::fopen(filePath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // Only the last block can be short, so the hash matches that of the contents as a whole
+    // regardless of how they were split into blocks
+    std::vector<char> block(c_HashBlockSize);
+    hash = c_HashSeed;
+    size = 0;
+    while (size_t const numRead = std::fread(block.data(), 1, block.size(), file)) {
+        hash = HashWords(hash, block.data(), numRead);
+        size += numRead;
+    }
+    bool const failed = std::ferror(file) != 0;
+    std::fclose(file);
+    hash = MixHash(hash, size);
+    return !failed;
+}
+
+static bool IsCacheFileName(std::string const& name, char const* extension)
+{
+    return name.compare(0, std::strlen(c_CachePrefix), c_CachePrefix) == 0 && usdBVHAnimPlugin::EndsWithIgnoringCase(name, extension);
+}
+
+//! Copy the document held in the given cached document file contents into `result`, if the file
+//! is valid and was cached from contents with the given hash and size. Returns `true` on success.
+static bool ReadCachedDocument(char const* data, size_t dataSize, uint64_t contentHash, uint64_t contentSize, usdBVHAnimPlugin::BVHDocument& result)
+{
+    using namespace usdBVHAnimPlugin;
+
+    CacheHeader header;
+    CacheLayout layout;
+    if (dataSize < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.m_Magic, c_CacheMagic, sizeof(c_CacheMagic)) != 0 || header.m_Version != c_CacheVersion
+        || header.m_TransformSize != sizeof(BVHTransform) || header.m_ContentHash != contentHash || header.m_ContentSize != contentSize
+        || !ComputeCacheLayout(header.m_NumJoints, header.m_NumFrames, header.m_NamesSize, dataSize, layout) || layout.m_Size != dataSize) {
+        return false;
+    }
+
+    size_t const numJoints = header.m_NumJoints;
+    size_t const numTransforms = numJoints * header.m_NumFrames;
+    BVHDocument document(result.m_FrameTransforms.get_allocator().resource());
+    document.m_FrameTime = header.m_FrameTime;
+    document.m_JointNames.reserve(numJoints);
+    char const* name = data + layout.m_JointNames;
+    char const* const namesEnd = name + header.m_NamesSize;
+    for (size_t j = 0; j < numJoints; ++j) {
+        char const* const nameEnd = static_cast<char const*>(std::memchr(name, '\0', namesEnd - name));
+        if (!nameEnd) {
+            return false;
+        }
+        document.m_JointNames.emplace_back(name, nameEnd);
+        name = nameEnd + 1;
+    }
+
+    document.m_JointParents.resize(numJoints);
+    document.m_JointNumChannels.resize(numJoints);
+    document.m_JointChannels.resize(numJoints);
+    document.m_JointOffsets.resize(numJoints);
+    document.m_FrameTransforms.resize(numTransforms);
+    std::memcpy(document.m_JointParents.data(), data + layout.m_JointParents, numJoints * sizeof(int32_t));
+    std::memcpy(document.m_JointNumChannels.data(), data + layout.m_JointNumChannels, numJoints * sizeof(uint32_t));
+    std::memcpy(document.m_JointChannels.data(), data + layout.m_JointChannels, numJoints * sizeof(uint32_t));
+    std::memcpy(document.m_JointOffsets.data(), data + layout.m_JointOffsets, numJoints * sizeof(BVHOffset));
+    if (numTransforms > 0) {
+        std::memcpy(document.m_FrameTransforms.data(), data + layout.m_FrameTransforms, numTransforms * sizeof(BVHTransform));
+    }
+
+    // Parents always precede their children, which later stages rely on
+    for (size_t j = 0; j < numJoints; ++j) {
+        int const parent = document.m_JointParents[j];
+        if (parent != BVHDocument::c_RootParentIndex && (parent < 0 || static_cast<size_t>(parent) >= j)) {
+            return false;
+        }
+    }
+
+    result = std::move(document);
+    return true;
+}
+
+#if !defined(_WIN32)
+//! The result of trying to take the lock on publishing a document
+enum class LockResult {
+    //! This process holds the lock, and must publish the document and then release the lock
+    Acquired,
+    //! Another process holds the lock
+    Held,
+    //! The lock could not be created, such as when the cache directory does not exist
+    Failed
+};
+
+static LockResult AcquireLock(std::string const& lockPath)
+{
+    int const fd = open(lockPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        close(fd);
+        return LockResult::Acquired;
+    }
+    return errno == EEXIST ? LockResult::Held : LockResult::Failed;
+}
+
+//! Wait for the process holding the given lock to release it. The holder marks the lock as
+//! modified while it parses, so if the lock becomes stale, its holder is assumed to have died,
+//! and the lock is removed.
+static void WaitForLock(std::string const& lockPath)
+{
+    while (true) {
+        struct stat status;
+        if (stat(lockPath.c_str(), &status) != 0) {
+            return;
+        }
+        // Two waiters may both remove a stale lock, in which case a third process can lose
+        // its fresh lock, but at worst this parses the file twice
+        if (std::chrono::system_clock::now() - std::chrono::system_clock::from_time_t(status.st_mtime) > c_StaleAge) {
+            unlink(lockPath.c_str());
+            return;
+        }
+        std::this_thread::sleep_for(c_LockPollInterval);
+    }
+}
+
+namespace {
+//! Marks the given lock as modified every `c_LockRefreshInterval` from a background thread,
+//! from construction until destruction
+class LockRefresher {
+public:
+    explicit LockRefresher(std::string const& lockPath)
+        : m_Thread([this, lockPath]() {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (!m_CondVar.wait_for(lock, c_LockRefreshInterval, [this]() { return m_Stopped; })) {
+                utimensat(AT_FDCWD, lockPath.c_str(), nullptr, 0);
+            }
+        })
+    {
+    }
+
+    LockRefresher(LockRefresher const&) = delete;
+    LockRefresher& operator=(LockRefresher const&) = delete;
+
+    ~LockRefresher()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopped = true;
+        }
+        m_CondVar.notify_one();
+        m_Thread.join();
+    }
+
+private:
+    std::mutex m_Mutex;
+    std::condition_variable m_CondVar;
+    bool m_Stopped = false;
+    std::thread m_Thread;
+};
+}
+
+//! Map the given cached document file read-only, and copy its document into `result`
+static bool LoadCachedDocument(std::string const& cachePath, uint64_t contentHash, uint64_t contentSize, usdBVHAnimPlugin::BVHDocument& result)
+{
+    int const fd = open(cachePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t const size = static_cast<size_t>(status.st_size);
+    void* const mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    bool const loaded = ReadCachedDocument(static_cast<char const*>(mapping), size, contentHash, contentSize, result);
+    munmap(mapping, size);
+
+    // Reading a document marks it as recently used, so that it is evicted last
+    if (loaded) {
+        utimensat(AT_FDCWD, cachePath.c_str(), nullptr, 0);
+    }
+    return loaded;
+}
+
+static bool WriteAll(int fd, void const* data, size_t size)
+{
+    char const* bytes = static_cast<char const*>(data);
+    while (size > 0) {
+        ssize_t const numWritten = write(fd, bytes, size);
+        if (numWritten < 0 && errno == EINTR) {
+            continue;
+        }
+        if (numWritten <= 0) {
+            return false;
+        }
+        bytes += numWritten;
+        size -= static_cast<size_t>(numWritten);
+    }
+    return true;
+}
+
+//! Write the given document to a temporary file, then rename it to the given cached document
+//! file, such that the document is published atomically
+static bool PublishCachedDocument(std::string const& cachePath, uint64_t contentHash, uint64_t contentSize, usdBVHAnimPlugin::BVHDocument const& document)
+{
+    using namespace usdBVHAnimPlugin;
+
+    size_t const numJoints = document.m_JointNames.size();
+    size_t const numFrames = numJoints > 0 ? document.m_FrameTransforms.size() / numJoints : 0;
+    size_t namesSize = 0;
+    for (std::pmr::string const& name : document.m_JointNames) {
+        namesSize += name.size() + 1;
+    }
+    CacheLayout layout;
+    if (!ComputeCacheLayout(numJoints, numFrames, namesSize, std::numeric_limits<size_t>::max(), layout)) {
+        return false;
+    }
+
+    CacheHeader header;
+    std::memcpy(header.m_Magic, c_CacheMagic, sizeof(c_CacheMagic));
+    header.m_Version = c_CacheVersion;
+    header.m_TransformSize = sizeof(BVHTransform);
+    header.m_ContentHash = contentHash;
+    header.m_ContentSize = contentSize;
+    header.m_NumJoints = numJoints;
+    header.m_NumFrames = numFrames;
+    header.m_NamesSize = namesSize;
+    header.m_FrameTime = document.m_FrameTime;
+
+    // Each writer uses its own temporary file, so that concurrent writers never interleave
+    static std::atomic<uint64_t> s_NumTemporaryFiles { 0 };
+    std::string const temporaryPath = cachePath + "." + std::to_string(getpid()) + "." + std::to_string(s_NumTemporaryFiles++) + c_TemporaryExtension;
+    int const fd = open(temporaryPath.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    char const padding[sizeof(uint64_t)] = {};
+    bool written = WriteAll(fd, &header, sizeof(header))
+        && WriteAll(fd, document.m_JointParents.data(), numJoints * sizeof(int32_t))
+        && WriteAll(fd, document.m_JointNumChannels.data(), numJoints * sizeof(uint32_t))
+        && WriteAll(fd, document.m_JointChannels.data(), numJoints * sizeof(uint32_t));
+    for (size_t j = 0; j < numJoints && written; ++j) {
+        written = WriteAll(fd, document.m_JointNames[j].c_str(), document.m_JointNames[j].size() + 1);
+    }
+    written = written
+        && WriteAll(fd, padding, layout.m_JointOffsets - layout.m_JointNames - namesSize)
+        && WriteAll(fd, document.m_JointOffsets.data(), numJoints * sizeof(BVHOffset))
+        && WriteAll(fd, document.m_FrameTransforms.data(), numJoints * numFrames * sizeof(BVHTransform));
+    written = close(fd) == 0 && written;
+
+    if (!written || rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+    return true;
+}
+#endif
+
+#if !defined(_WIN32)
+//! Read the document with the given content hash from the cache if it has been cached, otherwise
+//! parse it with the given function and publish it to the cache. Returns `false` without parsing
+//! if the cache is unavailable.
+template <typename ParseFunction>
+static bool ParseCachedDocument(uint64_t contentHash, uint64_t contentSize, ParseFunction const& parse, usdBVHAnimPlugin::BVHDocument& result, usdBVHAnimPlugin::BVHSharedCacheOptions const& options, bool* cacheHit, bool& parsed)
+{
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%016llx%s", c_CachePrefix, static_cast<unsigned long long>(contentHash), c_CacheExtension);
+    std::string const cachePath = (std::filesystem::path(options.m_Directory) / name).string();
+    std::string const lockPath = cachePath + c_LockExtension;
+    while (true) {
+        if (LoadCachedDocument(cachePath, contentHash, contentSize, result)) {
+            *cacheHit = true;
+            parsed = true;
+            return true;
+        }
+
+        LockResult const lock = AcquireLock(lockPath);
+        if (lock == LockResult::Failed) {
+            return false;
+        }
+        if (lock == LockResult::Held) {
+            WaitForLock(lockPath);
+            continue;
+        }
+
+        // Another process may have published the document and released the lock since it was last checked
+        parsed = LoadCachedDocument(cachePath, contentHash, contentSize, result);
+        if (parsed) {
+            *cacheHit = true;
+        } else {
+            bool published = false;
+            {
+                LockRefresher const refresher(lockPath);
+                parsed = parse(result);
+                published = parsed && PublishCachedDocument(cachePath, contentHash, contentSize, result);
+            }
+            if (published) {
+                usdBVHAnimPlugin::EvictSharedBVH(options);
+            }
+        }
+        unlink(lockPath.c_str());
+        return true;
+    }
+}
+#endif
+
+namespace usdBVHAnimPlugin {
+bool ParseSharedBVH(std::string const& filePath, BVHDocument& result, BVHSharedCacheOptions const& options, bool* cacheHit)
+{
+    bool hit = false;
+    bool parsed = false;
+    auto parse = [&](BVHDocument& document) { return ParseBVH(filePath, document); };
+#if !defined(_WIN32)
+    uint64_t contentHash = 0;
+    uint64_t contentSize = 0;
+    if (!HashFile(filePath, contentHash, contentSize) || !ParseCachedDocument(contentHash, contentSize, parse, result, options, &hit, parsed)) {
+        parsed = parse(result);
+    }
+#else
+    parsed = parse(result);
+#endif
+    if (cacheHit) {
+        *cacheHit = hit;
+    }
+    return parsed;
+}
+
+bool ParseSharedBVH(char const* contents, size_t size, BVHDocument& result, BVHSharedCacheOptions const& options, bool* cacheHit)
+{
+    bool hit = false;
+    bool parsed = false;
+    auto parse = [&](BVHDocument& document) { return ParseBVH(contents, size, document); };
+#if !defined(_WIN32)
+    if (!ParseCachedDocument(HashContents(contents, size), size, parse, result, options, &hit, parsed)) {
+        parsed = parse(result);
+    }
+#else
+    parsed = parse(result);
+#endif
+    if (cacheHit) {
+        *cacheHit = hit;
+    }
+    return parsed;
+}
+
+void EvictSharedBVH(BVHSharedCacheOptions const& options)
+{
+    struct CachedFile {
+        std::filesystem::path m_Path;
+        uintmax_t m_Size;
+        std::filesystem::file_time_type m_LastWriteTime;
+    };
+
+    std::vector<CachedFile> cachedFiles;
+    uintmax_t totalSize = 0;
+    auto const now = std::filesystem::file_time_type::clock::now();
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(options.m_Directory, error), end; !error && it != end; it.increment(error)) {
+        std::string const name = it->path().filename().string();
+        std::error_code entryError;
+        auto const lastWriteTime = it->last_write_time(entryError);
+        if (entryError) {
+            continue;
+        }
+        if (IsCacheFileName(name, c_TemporaryExtension)) {
+            // Temporary files are only left behind by processes that died while publishing
+            if (now - lastWriteTime > c_StaleAge) {
+                std::filesystem::remove(it->path(), entryError);
+            }
+        } else if (IsCacheFileName(name, c_CacheExtension)) {
+            uintmax_t const size = it->file_size(entryError);
+            if (!entryError) {
+                cachedFiles.push_back({ it->path(), size, lastWriteTime });
+                totalSize += size;
+            }
+        }
+    }
+
+    // Removing a file that other processes have mapped is safe, as their mappings remain valid
+    std::sort(cachedFiles.begin(), cachedFiles.end(), [](CachedFile const& a, CachedFile const& b) { return a.m_LastWriteTime < b.m_LastWriteTime; });
+    for (CachedFile const& cachedFile : cachedFiles) {
+        if (totalSize <= options.m_MaxBytes) {
+            break;
+        }
+        if (std::filesystem::remove(cachedFile.m_Path, error)) {
+            totalSize -= cachedFile.m_Size;
+        }
+    }
+}
+
+void ClearSharedBVH(BVHSharedCacheOptions const& options)
+{
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(options.m_Directory, error), end; !error && it != end; it.increment(error)) {
+        if (IsCacheFileName(it->path().filename().string(), c_CacheExtension)) {
+            std::error_code entryError;
+            std::filesystem::remove(it->path(), entryError);
+        }
+    }
+}
+} // namespace usdBVHAnimPlugin
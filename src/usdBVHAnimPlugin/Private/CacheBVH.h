@@ -0,0 +1,54 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+#include <string>
+
+namespace usdBVHAnimPlugin {
+
+//! Options for the cross-process shared document cache used by `ParseSharedBVH`.
+struct BVHSharedCacheOptions {
+    //! The directory that cached documents are published to, which should be on a memory
+    //! backed file system (such as `/dev/shm`) that is shared by every process on the machine.
+    std::string m_Directory = "/dev/shm";
+    //! The maximum total size in bytes of the cached documents in the directory, beyond which
+    //! the least recently used documents are evicted.
+    size_t m_MaxBytes = size_t(1) << 30;
+};
+
+//! Parse a BVH file at the given file path in the same way as `ParseBVH`, sharing the result
+//! with every other process on the machine through the cache directory given in the options.
+//!
+//! Documents are cached by a hash of the file's contents, so a file that changes on disk is
+//! parsed again, and identical files at different paths share a single cached document. The
+//! file is read to compute its hash on every call, even when its document has been cached. If
+//! the file's document has already been cached, its decoded data is mapped read-only and copied
+//! into `result`, which owns its own arrays, so a cache hit saves parsing the file but not the
+//! cost of copying its document. Otherwise the file is parsed, and the document is published
+//! to the cache, after which older documents are evicted if the cache has grown beyond its
+//! maximum size.
+//!
+//! Documents are published atomically, so no process ever maps a partially written document,
+//! and while one process is parsing a file, any other process that needs the same file waits
+//! for it to be published rather than parsing the file too. The parsing process marks its lock
+//! as modified periodically, so waiting processes only parse the file themselves if it dies.
+//!
+//! Returns `true` on success, or `false` on failure. If `cacheHit` is given, it is set to
+//! whether the document was read from the cache. If the cache is unavailable (e.g. its
+//! directory does not exist, or on platforms without shared memory), the file is parsed
+//! without being cached.
+bool ParseSharedBVH(std::string const& filePath, BVHDocument& result, BVHSharedCacheOptions const& options = {}, bool* cacheHit = nullptr);
+
+//! Parse BVH file contents held in memory in the same way as `ParseBVH`, sharing the result with
+//! every other process on the machine through the cache directory given in the options, as with
+//! the overload of `ParseSharedBVH` that reads a file. Contents are cached by the same hash as
+//! files, so contents read from memory and from a file share a single cached document.
+bool ParseSharedBVH(char const* contents, size_t size, BVHDocument& result, BVHSharedCacheOptions const& options = {}, bool* cacheHit = nullptr);
+
+//! Remove the least recently used documents from the cache directory given in the options,
+//! until the total size of the cached documents is within its maximum size.
+void EvictSharedBVH(BVHSharedCacheOptions const& options = {});
+
+//! Remove every document from the cache directory given in the options. Processes that have
+//! already mapped a document are unaffected.
+void ClearSharedBVH(BVHSharedCacheOptions const& options = {});
+} // namespace usdBVHAnimPlugin
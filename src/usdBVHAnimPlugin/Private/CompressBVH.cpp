@@ -0,0 +1,286 @@
+#include "CompressBVH.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define USDBVHANIM_SSE2 1
+#endif
+
+// The three smallest components of a unit quaternion lie within +/- 1/sqrt(2)
+static double const c_QuatComponentRange = 0.70710678118654752440;
+static uint16_t const c_QuatComponentMask = 0x7FFF;
+static uint16_t const c_TranslationMask = 0xFFFF;
+static double const c_QuatComponentMaxValue = static_cast<double>(c_QuatComponentMask);
+static double const c_TranslationMaxValue = static_cast<double>(c_TranslationMask);
+
+static void PackQuat(double const quat[4], uint16_t words[3])
+{
+    size_t largest = 0;
+    for (size_t c = 1; c < 4; ++c) {
+        if (std::fabs(quat[c]) > std::fabs(quat[largest])) {
+            largest = c;
+        }
+    }
+
+    // The largest component is always reconstructed as positive, so negate the
+    // quaternion (which represents the same rotation) if required
+    double const sign = quat[largest] < 0.0 ? -1.0 : 1.0;
+    for (size_t c = 0, i = 0; c < 4; ++c) {
+        if (c == largest) {
+            continue;
+        }
+        double normalised = (quat[c] * sign + c_QuatComponentRange) / (2.0 * c_QuatComponentRange);
+        double quantized = std::round(normalised * c_QuatComponentMaxValue);
+        quantized = std::min(std::max(quantized, 0.0), c_QuatComponentMaxValue);
+        words[i++] = static_cast<uint16_t>(quantized);
+    }
+    words[0] |= static_cast<uint16_t>((largest & 1) << 15);
+    words[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+}
+
+static void UnpackQuat(uint16_t const words[3], float const components[3], double quat[4])
+{
+    size_t const largest = (words[0] >> 15) | ((words[1] >> 15) << 1);
+    double sumSquares = 0.0;
+    for (size_t c = 0, i = 0; c < 4; ++c) {
+        if (c == largest) {
+            continue;
+        }
+        quat[c] = components[i++];
+        sumSquares += quat[c] * quat[c];
+    }
+    quat[largest] = std::sqrt(std::max(0.0, 1.0 - sumSquares));
+}
+
+//! Dequantize `count` words as `(word & mask) * steps[i] + offsets[i]`, storing the
+//! results in `result`. This is the inner loop of decompression, so uses SSE2 where available.
+static void DequantizeWords(uint16_t const* words, float const* steps, float const* offsets, uint16_t mask, size_t count, float* result)
+{
+    size_t i = 0;
+#if defined(USDBVHANIM_SSE2)
+    __m128i const maskVec = _mm_set1_epi16(static_cast<short>(mask));
+    __m128i const zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<__m128i const*>(words + i)), maskVec);
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(packed, zero));
+        _mm_storeu_ps(result + i, _mm_add_ps(_mm_mul_ps(lo, _mm_loadu_ps(steps + i)), _mm_loadu_ps(offsets + i)));
+        _mm_storeu_ps(result + i + 4, _mm_add_ps(_mm_mul_ps(hi, _mm_loadu_ps(steps + i + 4)), _mm_loadu_ps(offsets + i + 4)));
+    }
+#endif
+    for (; i < count; ++i) {
+        result[i] = static_cast<float>(words[i] & mask) * steps[i] + offsets[i];
+    }
+}
+
+namespace usdBVHAnimPlugin {
+static bool IsConstantRotation(BVHTransform const* frames, size_t numFrames, size_t stride, double tolerance)
+{
+    double const* first = frames[0].m_RotationQuat;
+    for (size_t frameIndex = 1; frameIndex < numFrames; ++frameIndex) {
+        double const* quat = frames[frameIndex * stride].m_RotationQuat;
+        double dot = first[0] * quat[0] + first[1] * quat[1] + first[2] * quat[2] + first[3] * quat[3];
+        double sign = dot < 0.0 ? -1.0 : 1.0;
+        for (size_t c = 0; c < 4; ++c) {
+            if (std::fabs(quat[c] * sign - first[c]) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool IsConstantTranslation(BVHTransform const* frames, size_t numFrames, size_t stride, double tolerance)
+{
+    double const* first = frames[0].m_Translation;
+    for (size_t frameIndex = 1; frameIndex < numFrames; ++frameIndex) {
+        double const* translation = frames[frameIndex * stride].m_Translation;
+        for (size_t c = 0; c < 3; ++c) {
+            if (std::fabs(translation[c] - first[c]) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+size_t BVHCompressedAnimation::GetSizeInBytes() const
+{
+    return m_RotationTracks.size() * sizeof(uint32_t)
+        + m_TranslationTracks.size() * sizeof(uint32_t)
+        + m_ConstantRotations.size() * sizeof(uint16_t)
+        + m_ConstantTranslations.size() * sizeof(float)
+        + m_TranslationMins.size() * sizeof(float)
+        + m_TranslationSteps.size() * sizeof(float)
+        + m_Rotations.size() * sizeof(uint16_t)
+        + m_Translations.size() * sizeof(uint16_t);
+}
+
+bool CompressBVH(BVHDocument const& document, BVHCompressionSettings const& settings, BVHCompressedAnimation& result)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    if (numJoints == 0 || document.m_FrameTransforms.size() % numJoints != 0) {
+        return false;
+    }
+
+    size_t const numFrames = document.m_FrameTransforms.size() / numJoints;
+    BVHTransform const* frames = document.m_FrameTransforms.data();
+
+    result = BVHCompressedAnimation {};
+    result.m_NumJoints = numJoints;
+    result.m_NumFrames = numFrames;
+    result.m_FrameTime = document.m_FrameTime;
+    result.m_RotationTracks.resize(numJoints, BVHCompressedAnimation::c_ConstantTrack);
+    result.m_TranslationTracks.resize(numJoints, BVHCompressedAnimation::c_ConstantTrack);
+    result.m_ConstantRotations.resize(numJoints * 3, 0);
+    result.m_ConstantTranslations.resize(numJoints * 3, 0.0f);
+
+    // Classify each joint's tracks, and compute the quantization range of animated translations
+    uint32_t numRotationTracks = 0;
+    uint32_t numTranslationTracks = 0;
+    for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+        bool const elide = settings.m_ElideConstantTracks || numFrames == 0;
+        if (elide && (numFrames == 0 || IsConstantRotation(frames + jointIndex, numFrames, numJoints, settings.m_ConstantRotationTolerance))) {
+            if (numFrames > 0) {
+                PackQuat(frames[jointIndex].m_RotationQuat, &result.m_ConstantRotations[jointIndex * 3]);
+            }
+        } else {
+            result.m_RotationTracks[jointIndex] = numRotationTracks++;
+        }
+
+        if (elide && (numFrames == 0 || IsConstantTranslation(frames + jointIndex, numFrames, numJoints, settings.m_ConstantTranslationTolerance))) {
+            for (size_t c = 0; c < 3 && numFrames > 0; ++c) {
+                result.m_ConstantTranslations[jointIndex * 3 + c] = static_cast<float>(frames[jointIndex].m_Translation[c]);
+            }
+        } else {
+            result.m_TranslationTracks[jointIndex] = numTranslationTracks++;
+            for (size_t c = 0; c < 3; ++c) {
+                double minValue = frames[jointIndex].m_Translation[c];
+                double maxValue = minValue;
+                for (size_t frameIndex = 1; frameIndex < numFrames; ++frameIndex) {
+                    double value = frames[frameIndex * numJoints + jointIndex].m_Translation[c];
+                    minValue = std::min(minValue, value);
+                    maxValue = std::max(maxValue, value);
+                }
+                result.m_TranslationMins.push_back(static_cast<float>(minValue));
+                result.m_TranslationSteps.push_back(static_cast<float>((maxValue - minValue) / c_TranslationMaxValue));
+            }
+        }
+    }
+
+    // Quantize the animated tracks
+    result.m_Rotations.resize(numFrames * numRotationTracks * 3);
+    result.m_Translations.resize(numFrames * numTranslationTracks * 3);
+    for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
+        uint16_t* rotations = result.m_Rotations.data() + frameIndex * numRotationTracks * 3;
+        uint16_t* translations = result.m_Translations.data() + frameIndex * numTranslationTracks * 3;
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            BVHTransform const& transform = frames[frameIndex * numJoints + jointIndex];
+
+            uint32_t const rotationTrack = result.m_RotationTracks[jointIndex];
+            if (rotationTrack != BVHCompressedAnimation::c_ConstantTrack) {
+                PackQuat(transform.m_RotationQuat, rotations + rotationTrack * 3);
+            }
+
+            uint32_t const translationTrack = result.m_TranslationTracks[jointIndex];
+            if (translationTrack != BVHCompressedAnimation::c_ConstantTrack) {
+                for (size_t c = 0; c < 3; ++c) {
+                    double const minValue = result.m_TranslationMins[translationTrack * 3 + c];
+                    double const step = result.m_TranslationSteps[translationTrack * 3 + c];
+                    double quantized = step > 0.0 ? std::round((transform.m_Translation[c] - minValue) / step) : 0.0;
+                    quantized = std::min(std::max(quantized, 0.0), c_TranslationMaxValue);
+                    translations[translationTrack * 3 + c] = static_cast<uint16_t>(quantized);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool DecompressBVHFrames(BVHCompressedAnimation const& animation, size_t firstFrame, size_t numFrames, BVHTransform* result)
+{
+    if (firstFrame > animation.m_NumFrames || numFrames > animation.m_NumFrames - firstFrame) {
+        return false;
+    }
+
+    size_t const numJoints = animation.m_NumJoints;
+    size_t const numRotationWords = animation.GetNumRotationTracks() * 3;
+    size_t const numTranslationWords = animation.GetNumTranslationTracks() * 3;
+
+    // Build the constant portion of the pose once, which each frame then starts from
+    std::vector<BVHTransform> basePose(numJoints);
+    float const c_RotationStep = static_cast<float>(2.0 * c_QuatComponentRange / c_QuatComponentMaxValue);
+    float const c_RotationOffset = static_cast<float>(-c_QuatComponentRange);
+    for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+        uint16_t const* words = &animation.m_ConstantRotations[jointIndex * 3];
+        float components[3];
+        for (size_t c = 0; c < 3; ++c) {
+            components[c] = static_cast<float>(words[c] & c_QuatComponentMask) * c_RotationStep + c_RotationOffset;
+        }
+        UnpackQuat(words, components, basePose[jointIndex].m_RotationQuat);
+        for (size_t c = 0; c < 3; ++c) {
+            basePose[jointIndex].m_Translation[c] = animation.m_ConstantTranslations[jointIndex * 3 + c];
+        }
+    }
+
+    std::vector<float> rotationSteps(numRotationWords, c_RotationStep);
+    std::vector<float> rotationOffsets(numRotationWords, c_RotationOffset);
+    std::vector<float> rotations(numRotationWords);
+    std::vector<float> translations(numTranslationWords);
+
+    for (size_t frameIndex = firstFrame; frameIndex < firstFrame + numFrames; ++frameIndex) {
+        uint16_t const* rotationWords = animation.m_Rotations.data() + frameIndex * numRotationWords;
+        uint16_t const* translationWords = animation.m_Translations.data() + frameIndex * numTranslationWords;
+        DequantizeWords(rotationWords, rotationSteps.data(), rotationOffsets.data(), c_QuatComponentMask, numRotationWords, rotations.data());
+        DequantizeWords(translationWords, animation.m_TranslationSteps.data(), animation.m_TranslationMins.data(), c_TranslationMask, numTranslationWords, translations.data());
+
+        BVHTransform* pose = result + (frameIndex - firstFrame) * numJoints;
+        std::copy(basePose.begin(), basePose.end(), pose);
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            uint32_t const rotationTrack = animation.m_RotationTracks[jointIndex];
+            if (rotationTrack != BVHCompressedAnimation::c_ConstantTrack) {
+                UnpackQuat(rotationWords + rotationTrack * 3, &rotations[rotationTrack * 3], pose[jointIndex].m_RotationQuat);
+            }
+            uint32_t const translationTrack = animation.m_TranslationTracks[jointIndex];
+            if (translationTrack != BVHCompressedAnimation::c_ConstantTrack) {
+                for (size_t c = 0; c < 3; ++c) {
+                    pose[jointIndex].m_Translation[c] = translations[translationTrack * 3 + c];
+                }
+            }
+        }
+    }
+    return true;
+}
+
+BVHCompressionReport MeasureBVHCompression(BVHDocument const& document, BVHCompressedAnimation const& animation)
+{
+    size_t constexpr c_UncompressedBytesPerJoint = sizeof(float) * 7;
+
+    BVHCompressionReport report;
+    report.m_UncompressedBytes = animation.m_NumFrames * animation.m_NumJoints * c_UncompressedBytesPerJoint;
+    report.m_CompressedBytes = animation.GetSizeInBytes();
+    report.m_CompressionRatio = report.m_CompressedBytes ? static_cast<double>(report.m_UncompressedBytes) / static_cast<double>(report.m_CompressedBytes) : 0.0;
+
+    std::vector<BVHTransform> decompressed(animation.m_NumFrames * animation.m_NumJoints);
+    if (decompressed.size() != document.m_FrameTransforms.size()
+        || !DecompressBVHFrames(animation, 0, animation.m_NumFrames, decompressed.data())) {
+        return report;
+    }
+
+    for (size_t i = 0; i < decompressed.size(); ++i) {
+        double const* a = document.m_FrameTransforms[i].m_RotationQuat;
+        double const* b = decompressed[i].m_RotationQuat;
+        double dot = std::min(1.0, std::fabs(a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3]));
+        report.m_MaxRotationError = std::max(report.m_MaxRotationError, 2.0 * std::acos(dot));
+
+        double sumSquares = 0.0;
+        for (size_t c = 0; c < 3; ++c) {
+            double delta = document.m_FrameTransforms[i].m_Translation[c] - decompressed[i].m_Translation[c];
+            sumSquares += delta * delta;
+        }
+        report.m_MaxTranslationError = std::max(report.m_MaxTranslationError, std::sqrt(sumSquares));
+    }
+    return report;
+}
+} // namespace usdBVHAnimPlugin
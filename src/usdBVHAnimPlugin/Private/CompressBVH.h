@@ -0,0 +1,105 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! Settings that control how `CompressBVH` compresses the frame data of a `BVHDocument`.
+struct BVHCompressionSettings {
+    //! When `true`, joint rotation and translation tracks that do not change over the
+    //! course of the animation are stored once, rather than once per frame.
+    bool m_ElideConstantTracks = true;
+    //! The maximum per-component deviation from the first frame for which a rotation
+    //! track is considered to be constant.
+    double m_ConstantRotationTolerance = 1e-5;
+    //! The maximum per-component deviation from the first frame for which a translation
+    //! track is considered to be constant.
+    double m_ConstantTranslationTolerance = 1e-5;
+};
+
+//! A compressed representation of the frame data in a `BVHDocument`.
+//!
+//! Rotations are stored as 48-bit "smallest three" quaternions, where the three smallest
+//! components of the quaternion are each quantized to 15 bits, and the index of the largest
+//! component (which is reconstructed from the other three) is stored in the remaining bits.
+//!
+//! Translations are range-quantized to 16 bits per component, using a range that is
+//! computed per joint and per component.
+//!
+//! Tracks that are constant over the animation are optionally stored once, in which
+//! case they occupy no space in the per-frame data.
+struct BVHCompressedAnimation {
+    //! A track index value used for tracks that have been elided as constant.
+    static constexpr uint32_t c_ConstantTrack = 0xFFFFFFFFu;
+    //! The number of joints in the animation.
+    size_t m_NumJoints = 0;
+    //! The number of frames in the animation.
+    size_t m_NumFrames = 0;
+    //! The amount of time in seconds between each frame of the animation.
+    double m_FrameTime = 0.0;
+    //! For each joint, the index of its rotation track within each frame of
+    //! `m_Rotations`, or `c_ConstantTrack` if the joint's rotation is constant.
+    std::vector<uint32_t> m_RotationTracks;
+    //! For each joint, the index of its translation track within each frame of
+    //! `m_Translations`, or `c_ConstantTrack` if the joint's translation is constant.
+    std::vector<uint32_t> m_TranslationTracks;
+    //! For each joint, the packed rotation used when its rotation track is constant
+    //! (three 16-bit words per joint).
+    std::vector<uint16_t> m_ConstantRotations;
+    //! For each joint, the translation used when its translation track is constant
+    //! (three components per joint).
+    std::vector<float> m_ConstantTranslations;
+    //! For each translation track, the minimum value of each component (three per track).
+    std::vector<float> m_TranslationMins;
+    //! For each translation track, the quantization step of each component (three per track).
+    std::vector<float> m_TranslationSteps;
+    //! The packed rotation tracks, ordered first by frame, then by track, with three
+    //! 16-bit words per track.
+    std::vector<uint16_t> m_Rotations;
+    //! The quantized translation tracks, ordered first by frame, then by track, with
+    //! three 16-bit words per track.
+    std::vector<uint16_t> m_Translations;
+
+    //! Returns the number of animated rotation tracks (per frame).
+    size_t GetNumRotationTracks() const { return m_NumFrames ? m_Rotations.size() / (m_NumFrames * 3) : 0; }
+
+    //! Returns the number of animated translation tracks (per frame).
+    size_t GetNumTranslationTracks() const { return m_NumFrames ? m_Translations.size() / (m_NumFrames * 3) : 0; }
+
+    //! Returns the total number of bytes occupied by the compressed data.
+    size_t GetSizeInBytes() const;
+};
+
+//! A report describing the effectiveness of compressing a `BVHDocument`.
+struct BVHCompressionReport {
+    //! The number of bytes required to store the frame data uncompressed in single
+    //! precision (a four-component rotation and three-component translation per joint per frame).
+    size_t m_UncompressedBytes = 0;
+    //! The number of bytes occupied by the compressed data.
+    size_t m_CompressedBytes = 0;
+    //! The ratio of `m_UncompressedBytes` to `m_CompressedBytes`.
+    double m_CompressionRatio = 0.0;
+    //! The maximum angular error (in radians) of any decompressed joint rotation.
+    double m_MaxRotationError = 0.0;
+    //! The maximum distance between any decompressed joint translation and its source value.
+    double m_MaxTranslationError = 0.0;
+};
+
+//! Compress the frame data of the given `BVHDocument` into the given `BVHCompressedAnimation`,
+//! using the given settings. Returns `true` on success, or `false` if the document's frame
+//! data is inconsistent with its joint count.
+bool CompressBVH(BVHDocument const& document, BVHCompressionSettings const& settings, BVHCompressedAnimation& result);
+
+//! Decompress a range of `numFrames` frames beginning at `firstFrame` from the given
+//! `BVHCompressedAnimation`, storing `numFrames * m_NumJoints` joint transforms in `result`,
+//! ordered first by frame, then by joint (matching `BVHDocument::m_FrameTransforms`).
+//!
+//! Returns `true` on success, or `false` if the requested range lies outside of the animation.
+bool DecompressBVHFrames(BVHCompressedAnimation const& animation, size_t firstFrame, size_t numFrames, BVHTransform* result);
+
+//! Decompress every frame of the given `BVHCompressedAnimation` and compare it against
+//! the frame data of the given `BVHDocument`, from which it is expected to have been compressed.
+BVHCompressionReport MeasureBVHCompression(BVHDocument const& document, BVHCompressedAnimation const& animation);
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,208 @@
+#include "ConvertBVH.h"
+#include "AuthorBVH.h"
+#include "BVHChunkReaders.h"
+#include <filesystem>
+#include <memory>
+#include <pxr/base/gf/vec2d.h>
+#include <pxr/base/tf/token.h>
+#include <pxr/base/vt/array.h>
+#include <pxr/base/vt/types.h>
+#include <pxr/usd/sdf/assetPath.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/changeBlock.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/clipsAPI.h>
+#include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usdGeom/boundable.h>
+#include <pxr/usd/usdGeom/tokens.h>
+#include <pxr/usd/usdSkel/animation.h>
+#include <pxr/usd/usdSkel/bindingAPI.h>
+#include <pxr/usd/usdSkel/root.h>
+#include <pxr/usd/usdSkel/skeleton.h>
+#include <pxr/usd/usdSkel/tokens.h>
+#include <pxr/usd/usdSkel/topology.h>
+#include <pxr/usd/usdSkel/utils.h>
+#include <vector>
+
+using namespace pxr;
+
+namespace usdBVHAnimPlugin {
+namespace {
+    //! The time samples of a single frame, in every layer that a frame is written to
+    struct FrameSamples {
+        VtArray<GfVec3f> m_Translations;
+        VtArray<GfQuatf> m_Rotations;
+        VtVec3fArray m_Extent;
+    };
+
+    //! Author the animated attributes of the skeleton root and animation as specs in the
+    //! given layer, returning the paths of the extent, translations and rotations attributes.
+    bool DeclareAnimatedAttributes(SdfLayerHandle const& layer, SdfPath& extentPath, SdfPath& translationsPath, SdfPath& rotationsPath)
+    {
+        SdfPrimSpecHandle root = SdfCreatePrimInLayer(layer, SdfPath("/Root"));
+        SdfPrimSpecHandle animation = SdfCreatePrimInLayer(layer, SdfPath("/Root/Animation"));
+        if (!root || !animation) {
+            return false;
+        }
+        SdfAttributeSpecHandle extent = SdfAttributeSpec::New(root, UsdGeomTokens->extent.GetString(), SdfValueTypeNames->Float3Array);
+        SdfAttributeSpecHandle translations = SdfAttributeSpec::New(animation, UsdSkelTokens->translations.GetString(), SdfValueTypeNames->Float3Array);
+        SdfAttributeSpecHandle rotations = SdfAttributeSpec::New(animation, UsdSkelTokens->rotations.GetString(), SdfValueTypeNames->QuatfArray);
+        if (!extent || !translations || !rotations) {
+            return false;
+        }
+        extentPath = extent->GetPath();
+        translationsPath = translations->GetPath();
+        rotationsPath = rotations->GetPath();
+        return true;
+    }
+}
+
+bool ConvertBVHToUsd(std::string const& bvhPath, std::string const& outputPath, BVHConversionOptions const& options)
+{
+    std::unique_ptr<BVHChunkReader> source = OpenBVHChunkReader(bvhPath);
+    if (!source) {
+        return false;
+    }
+    BVHPipelinedChunkReader reader(*source);
+
+    std::filesystem::path const output(outputPath);
+    std::string const stem = output.stem().string();
+    std::filesystem::path const directory = output.parent_path();
+    float const scale = options.m_Scale;
+
+    // Everything needed to compute the extent of each frame is derived from the skeleton
+    // once, before the first chunk of frames
+    VtArray<TfToken> jointPaths;
+    UsdSkelTopology topology;
+    VtArray<GfVec3h> scales;
+    VtArray<GfMatrix4d> localTransforms;
+    VtArray<GfMatrix4d> skelTransforms;
+    auto computeFrameSamples = [&](BVHDocument const& document, size_t frameIndex, FrameSamples& samples) {
+        ComputeBVHFrameSamples(document, frameIndex, scale, samples.m_Translations, samples.m_Rotations);
+        UsdSkelMakeTransforms(samples.m_Translations, samples.m_Rotations, scales, localTransforms);
+        UsdSkelConcatJointTransforms(topology, localTransforms, skelTransforms);
+        samples.m_Extent.clear();
+        UsdSkelComputeJointsExtent(skelTransforms, &samples.m_Extent);
+    };
+
+    // Each chunk is written to its own clip layer, which also holds the last frame of the
+    // previous chunk, so that time samples are still interpolated across the boundary between
+    // two clips. Each clip layer is released as soon as it has been saved.
+    BVHDocument document;
+    VtArray<SdfAssetPath> clipAssetPaths;
+    VtVec2dArray clipActive;
+    size_t numFrames = 0;
+    FrameSamples samples;
+    FrameSamples previousSamples;
+    auto writeChunk = [&](BVHDocument const& chunk, size_t firstFrame, size_t numChunkFrames) {
+        if (firstFrame == 0) {
+            jointPaths = ComputeBVHJointPaths(chunk);
+            topology = UsdSkelTopology(jointPaths);
+            scales.assign(jointPaths.size(), GfVec3h(1.0f, 1.0f, 1.0f));
+            localTransforms.resize(jointPaths.size());
+            skelTransforms.resize(jointPaths.size());
+        }
+
+        std::string const clipFileName = stem + "." + std::to_string(clipAssetPaths.size()) + ".usdc";
+        SdfLayerRefPtr clipLayer = SdfLayer::CreateNew((directory / clipFileName).string());
+        SdfPath extentPath, translationsPath, rotationsPath;
+        if (!clipLayer || !DeclareAnimatedAttributes(clipLayer, extentPath, translationsPath, rotationsPath)) {
+            return false;
+        }
+
+        auto setSamples = [&](double time, FrameSamples const& frameSamples) {
+            clipLayer->SetTimeSample(extentPath, time, frameSamples.m_Extent);
+            clipLayer->SetTimeSample(translationsPath, time, frameSamples.m_Translations);
+            clipLayer->SetTimeSample(rotationsPath, time, frameSamples.m_Rotations);
+        };
+        double const startTime = firstFrame > 0 ? static_cast<double>(firstFrame) : 1.0;
+        {
+            SdfChangeBlock changeBlock;
+            if (firstFrame > 0) {
+                setSamples(startTime, previousSamples);
+            }
+            for (size_t frameIndex = 0; frameIndex < numChunkFrames; ++frameIndex) {
+                computeFrameSamples(chunk, frameIndex, samples);
+                setSamples(1.0 + static_cast<double>(firstFrame + frameIndex), samples);
+            }
+        }
+        if (!clipLayer->Save()) {
+            return false;
+        }
+
+        std::swap(samples, previousSamples);
+        clipActive.push_back(GfVec2d(startTime, static_cast<double>(clipAssetPaths.size())));
+        clipAssetPaths.push_back(SdfAssetPath("./" + clipFileName));
+        numFrames = firstFrame + numChunkFrames;
+        return true;
+    };
+    if (!ParseBVHFrameChunks(reader, document, options.m_FramesPerChunk, writeChunk, options.m_JointSelection)) {
+        return false;
+    }
+    if (jointPaths.empty()) {
+        jointPaths = ComputeBVHJointPaths(document);
+    }
+
+    // The manifest declares the attributes that the clips provide, so that USD does not need to
+    // open every clip layer to discover them
+    std::string const manifestFileName = stem + ".manifest.usda";
+    {
+        SdfLayerRefPtr manifestLayer = SdfLayer::CreateNew((directory / manifestFileName).string());
+        SdfPath extentPath, translationsPath, rotationsPath;
+        if (!manifestLayer || !DeclareAnimatedAttributes(manifestLayer, extentPath, translationsPath, rotationsPath) || !manifestLayer->Save()) {
+            return false;
+        }
+    }
+
+    // Author the skeleton and the static attributes of the animation, as `BvhFileFormat::Read` does
+    SdfLayerRefPtr layer = SdfLayer::CreateNew(outputPath);
+    if (!layer) {
+        return false;
+    }
+    UsdStageRefPtr stage = UsdStage::Open(layer);
+    UsdSkelRoot skelRoot = UsdSkelRoot::Define(stage, SdfPath("/Root"));
+    UsdSkelSkeleton skeleton = UsdSkelSkeleton::Define(stage, SdfPath("/Root/Skeleton"));
+
+    VtArray<GfMatrix4d> bindPoseLS;
+    VtArray<GfMatrix4d> bindPoseMS;
+    ComputeBVHBindTransforms(document, scale, bindPoseLS, bindPoseMS);
+    skeleton.CreateJointsAttr().Set(jointPaths);
+    skeleton.CreateBindTransformsAttr().Set(bindPoseMS);
+    skeleton.CreateRestTransformsAttr().Set(bindPoseLS);
+
+    UsdSkelAnimation animation = UsdSkelAnimation::Define(stage, SdfPath("/Root/Animation"));
+    animation.CreateJointsAttr().Set(jointPaths);
+    animation.CreateTranslationsAttr();
+    animation.CreateRotationsAttr();
+    animation.CreateScalesAttr().Set(VtArray<GfVec3h>(jointPaths.size(), GfVec3h(1.0f, 1.0f, 1.0f)), UsdTimeCode(1.0));
+    UsdGeomBoundable(skelRoot.GetPrim()).CreateExtentAttr();
+
+    layer->SetTimeCodesPerSecond(1.0 / document.m_FrameTime);
+    layer->SetStartTimeCode(1.0);
+    layer->SetEndTimeCode(static_cast<double>(1 + numFrames));
+
+    UsdSkelBindingAPI::Apply(skelRoot.GetPrim());
+    UsdSkelBindingAPI::Apply(skeleton.GetPrim());
+    UsdSkelBindingAPI(skelRoot.GetPrim()).CreateSkeletonRel().AddTarget(SdfPath("/Root/Skeleton"));
+    UsdSkelBindingAPI(skeleton.GetPrim()).CreateAnimationSourceRel().AddTarget(SdfPath("/Root/Animation"));
+
+    // Refer to the animated samples in each clip layer, at the same times as they were authored
+    if (!clipAssetPaths.empty()) {
+        UsdClipsAPI clips(skelRoot.GetPrim());
+        clips.SetClipAssetPaths(clipAssetPaths);
+        clips.SetClipPrimPath("/Root");
+        clips.SetClipActive(clipActive);
+        VtVec2dArray clipTimes { GfVec2d(1.0, 1.0) };
+        if (numFrames > 1) {
+            clipTimes.push_back(GfVec2d(static_cast<double>(numFrames), static_cast<double>(numFrames)));
+        }
+        clips.SetClipTimes(clipTimes);
+        clips.SetClipManifestAssetPath(SdfAssetPath("./" + manifestFileName));
+    }
+
+    stage->SetDefaultPrim(skelRoot.GetPrim());
+    return layer->Save();
+}
+} // namespace usdBVHAnimPlugin
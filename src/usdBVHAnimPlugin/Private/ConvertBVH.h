@@ -0,0 +1,36 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+#include <string>
+
+namespace usdBVHAnimPlugin {
+
+//! Options for converting a BVH file to USD with `ConvertBVHToUsd`.
+struct BVHConversionOptions {
+    //! The maximum number of frames that are held in memory at once, each chunk of which is
+    //! written to its own clip layer.
+    size_t m_FramesPerChunk = 1024;
+
+    //! The scale applied to the skeleton and animation, as with the `scale` file format argument.
+    float m_Scale = 1.0f;
+
+    //! The joints to convert, as with the `joints` file format argument.
+    BVHJointSelection m_JointSelection;
+};
+
+//! Convert the BVH file at the given path to a USD layer at the given output path, with the
+//! same prims and attributes as `BvhFileFormat::Read` authors, without ever holding the whole
+//! file, the whole animation or its whole set of time samples in memory.
+//!
+//! The MOTION block is parsed in chunks of `m_FramesPerChunk` frames, and the time samples of
+//! each chunk are written to their own crate file as soon as the chunk has been parsed, after
+//! which they are released. Each chunk file is named after the output layer, e.g. `walk.usda`
+//! writes `walk.0.usdc`, `walk.1.usdc` and so on alongside it, and `walk.manifest.usda`
+//! declares the animated attributes. The output layer holds the skeleton and refers to the
+//! chunk files as value clips on the `/Root` prim. Peak memory is therefore proportional to
+//! the chunk size and the size of the skeleton, rather than to the length of the take.
+//!
+//! Returns `true` on success, or `false` if the BVH file could not be read or parsed, or if
+//! any of the output layers could not be written.
+bool ConvertBVHToUsd(std::string const& bvhPath, std::string const& outputPath, BVHConversionOptions const& options = {});
+} // namespace usdBVHAnimPlugin
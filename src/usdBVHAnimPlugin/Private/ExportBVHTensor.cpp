@@ -0,0 +1,255 @@
+#include "ExportBVHTensor.h"
+#include "BVHChunkReaders.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string_view>
+#include <unordered_map>
+
+//! The number of values stored for each joint in each frame
+static size_t constexpr c_ValuesPerTransform = 7;
+
+//! The number of frames converted to single precision at a time
+static size_t constexpr c_FramesPerBlock = 256;
+
+static_assert(sizeof(usdBVHAnimPlugin::BVHTransform) == c_ValuesPerTransform * sizeof(double), "BVHTransform must be stored as contiguous doubles");
+
+namespace {
+struct FileCloser {
+    void operator()(std::FILE* file) const { std::fclose(file); }
+};
+using FilePtr = std::unique_ptr<std::FILE, FileCloser>;
+}
+
+//! Returns `true` if values are stored in little-endian byte order, as written to `.npy` files
+static bool IsLittleEndian()
+{
+    uint16_t const value = 1;
+    return *reinterpret_cast<unsigned char const*>(&value) == 1;
+}
+
+//! Append the given string to a JSON document as a quoted, escaped JSON string
+static void AppendJsonString(std::string& json, std::string_view value)
+{
+    json += '"';
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            json += escaped;
+        } else {
+            json += c;
+        }
+    }
+    json += '"';
+}
+
+static void AppendJsonNumber(std::string& json, double value)
+{
+    char number[32];
+    std::snprintf(number, sizeof(number), "%.17g", value);
+    json += number;
+}
+
+//! Write the header of a version 1.0 `.npy` file, describing a C-ordered tensor of the given shape
+static bool WriteNpyHeader(std::FILE* file, char const* descr, size_t numFrames, size_t numJoints)
+{
+    char dictionary[256];
+    int const dictionaryLength = std::snprintf(dictionary, sizeof(dictionary), "{'descr': '%s', 'fortran_order': False, 'shape': (%zu, %zu, %zu), }", descr, numFrames, numJoints, c_ValuesPerTransform);
+    if (dictionaryLength < 0 || static_cast<size_t>(dictionaryLength) >= sizeof(dictionary)) {
+        return false;
+    }
+
+    // The header is padded with spaces and terminated with a newline, such that the tensor
+    // that follows it is aligned to 64 bytes
+    size_t constexpr c_PreambleLength = 10;
+    size_t const headerLength = (c_PreambleLength + dictionaryLength + 1 + 63) / 64 * 64 - c_PreambleLength;
+    std::string header(dictionary, dictionaryLength);
+    header.resize(headerLength - 1, ' ');
+    header += '\n';
+
+    unsigned char const preamble[c_PreambleLength] = { 0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0, static_cast<unsigned char>(headerLength & 0xff), static_cast<unsigned char>(headerLength >> 8) };
+    return std::fwrite(preamble, 1, c_PreambleLength, file) == c_PreambleLength && std::fwrite(header.data(), 1, header.size(), file) == header.size();
+}
+
+namespace usdBVHAnimPlugin {
+bool ExportBVHTensor(BVHDocument const& document, std::string const& npyPath, std::string const& jsonPath, BVHTensorOptions const& options)
+{
+    if (!IsLittleEndian()) {
+        return false;
+    }
+
+    size_t const numJoints = document.m_JointNames.size();
+    size_t const numFrames = numJoints > 0 ? document.m_FrameTransforms.size() / numJoints : 0;
+    char const* const descr = options.m_SinglePrecision ? "<f4" : "<f8";
+    {
+        FilePtr file(std::fopen(npyPath.c_str(), "wb"));
+        if (!file || !WriteNpyHeader(file.get(), descr, numFrames, numJoints)) {
+            return false;
+        }
+
+        // Transforms are already stored in the tensor's layout, so double precision tensors are
+        // written directly from the document, while single precision tensors are converted a
+        // block of frames at a time
+        size_t const numValues = numFrames * numJoints * c_ValuesPerTransform;
+        double const* values = numValues > 0 ? document.m_FrameTransforms.data()->m_RotationQuat : nullptr;
+        if (!options.m_SinglePrecision) {
+            if (std::fwrite(values, sizeof(double), numValues, file.get()) != numValues) {
+                return false;
+            }
+        } else {
+            std::vector<float> block(std::min(numValues, c_FramesPerBlock * numJoints * c_ValuesPerTransform));
+            for (size_t offset = 0; offset < numValues; offset += block.size()) {
+                size_t const count = std::min(block.size(), numValues - offset);
+                for (size_t i = 0; i < count; ++i) {
+                    block[i] = static_cast<float>(values[offset + i]);
+                }
+                if (std::fwrite(block.data(), sizeof(float), count, file.get()) != count) {
+                    return false;
+                }
+            }
+        }
+        if (std::fflush(file.get()) != 0) {
+            return false;
+        }
+    }
+
+    std::string json = "{\n  \"joint_names\": [";
+    for (size_t j = 0; j < numJoints; ++j) {
+        json += j > 0 ? ", " : "";
+        AppendJsonString(json, document.m_JointNames[j]);
+    }
+    json += "],\n  \"joint_parents\": [";
+    for (size_t j = 0; j < numJoints; ++j) {
+        json += j > 0 ? ", " : "";
+        json += std::to_string(document.m_JointParents[j]);
+    }
+    json += "],\n  \"joint_offsets\": [";
+    for (size_t j = 0; j < numJoints; ++j) {
+        json += j > 0 ? ", [" : "[";
+        for (size_t i = 0; i < 3; ++i) {
+            json += i > 0 ? ", " : "";
+            AppendJsonNumber(json, document.m_JointOffsets[j].m_Translation[i]);
+        }
+        json += "]";
+    }
+    json += "],\n  \"frame_time\": ";
+    AppendJsonNumber(json, document.m_FrameTime);
+    json += ",\n  \"fps\": ";
+    AppendJsonNumber(json, document.m_FrameTime > 0.0 ? 1.0 / document.m_FrameTime : 0.0);
+    json += ",\n  \"shape\": [" + std::to_string(numFrames) + ", " + std::to_string(numJoints) + ", " + std::to_string(c_ValuesPerTransform) + "]";
+    json += ",\n  \"dtype\": \"";
+    json += descr;
+    json += "\",\n  \"channels\": [\"qx\", \"qy\", \"qz\", \"qw\", \"tx\", \"ty\", \"tz\"]\n}\n";
+
+    FilePtr file(std::fopen(jsonPath.c_str(), "wb"));
+    return file && std::fwrite(json.data(), 1, json.size(), file.get()) == json.size() && std::fflush(file.get()) == 0;
+}
+
+//! Returns the name of the tensor exported from the given BVH file, which is the name of the file
+//! without its extension, or without both `.bvh` and its compression extension if it is compressed
+static std::filesystem::path GetTensorName(std::string const& bvhPath)
+{
+    std::filesystem::path name = std::filesystem::path(bvhPath).filename();
+    if (IsCompressedBVHPath(bvhPath)) {
+        name = name.stem();
+    }
+    return name.stem();
+}
+
+//! Returns the deepest directory that contains both of the given directories
+static std::filesystem::path GetCommonDirectory(std::filesystem::path const& first, std::filesystem::path const& second)
+{
+    std::filesystem::path result;
+    auto const [firstEnd, secondEnd] = std::mismatch(first.begin(), first.end(), second.begin(), second.end());
+    for (auto it = first.begin(); it != firstEnd; ++it) {
+        result /= *it;
+    }
+    return result;
+}
+
+//! Returns the path, relative to the output directory and without an extension, of the tensor exported
+//! from each of the given BVH files. Files with the same name (e.g. `s01/walk.bvh` and `s02/walk.bvh`)
+//! are instead written to their directories relative to the deepest directory containing all such
+//! files (e.g. `s01/walk` and `s02/walk`). Files that would still be written to the same path, as
+//! they are the same file, are given an empty path, except for the first of them.
+static std::vector<std::filesystem::path> GetTensorPaths(std::vector<std::string> const& bvhPaths)
+{
+    std::vector<std::filesystem::path> result;
+    std::unordered_map<std::string, size_t> nameCounts;
+    for (std::string const& bvhPath : bvhPaths) {
+        result.push_back(GetTensorName(bvhPath));
+        ++nameCounts[result.back().string()];
+    }
+
+    std::vector<std::filesystem::path> directories(bvhPaths.size());
+    std::filesystem::path commonDirectory;
+    bool anyCollisions = false;
+    for (size_t i = 0; i < bvhPaths.size(); ++i) {
+        if (nameCounts[result[i].string()] > 1) {
+            std::error_code error;
+            directories[i] = std::filesystem::absolute(bvhPaths[i], error).lexically_normal().parent_path();
+            commonDirectory = anyCollisions ? GetCommonDirectory(commonDirectory, directories[i]) : directories[i];
+            anyCollisions = true;
+        }
+    }
+
+    std::set<std::filesystem::path> tensorPaths;
+    for (size_t i = 0; i < bvhPaths.size(); ++i) {
+        if (nameCounts[result[i].string()] > 1) {
+            result[i] = (directories[i].lexically_relative(commonDirectory) / result[i]).lexically_normal();
+        }
+        if (!tensorPaths.insert(result[i]).second) {
+            result[i].clear();
+        }
+    }
+    return result;
+}
+
+bool ExportBVHTensors(std::vector<std::string> const& bvhPaths, std::string const& outputDirectory, BVHTensorOptions const& options, size_t maxThreads, std::vector<std::string>* failedPaths)
+{
+    std::mutex mutex;
+    bool succeeded = true;
+    auto fail = [&](std::string const& bvhPath) {
+        std::lock_guard<std::mutex> lock(mutex);
+        succeeded = false;
+        if (failedPaths) {
+            failedPaths->push_back(bvhPath);
+        }
+    };
+
+    // Files that would overwrite the tensor of another file fail without being parsed, and the
+    // directories of files that are disambiguated by their directories are created up front
+    std::vector<std::filesystem::path> const tensorPaths = GetTensorPaths(bvhPaths);
+    std::vector<std::string> exportedPaths;
+    std::vector<std::filesystem::path> outputPaths;
+    for (size_t i = 0; i < bvhPaths.size(); ++i) {
+        if (tensorPaths[i].empty()) {
+            fail(bvhPaths[i]);
+            continue;
+        }
+        std::filesystem::path const outputPath = std::filesystem::path(outputDirectory) / tensorPaths[i];
+        if (tensorPaths[i].has_parent_path()) {
+            std::error_code error;
+            std::filesystem::create_directories(outputPath.parent_path(), error);
+        }
+        exportedPaths.push_back(bvhPaths[i]);
+        outputPaths.push_back(outputPath);
+    }
+
+    ParseBVHFiles(exportedPaths, [&](size_t fileIndex, bool parsed, BVHDocument& document) {
+        std::string const outputPath = outputPaths[fileIndex].string();
+        if (!parsed || !ExportBVHTensor(document, outputPath + ".npy", outputPath + ".json", options)) {
+            fail(exportedPaths[fileIndex]);
+        }
+    }, {}, maxThreads);
+    return succeeded;
+}
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,40 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! Options for exporting BVH animation as dense tensors with `ExportBVHTensor`.
+struct BVHTensorOptions {
+    //! Store values as 32-bit floats, rather than the 64-bit floats that they are parsed as.
+    bool m_SinglePrecision = false;
+};
+
+//! Write the animation of the given document to a NumPy `.npy` file at `npyPath`, holding a
+//! single contiguous, C-ordered tensor of shape [frames, joints, 7]. The last axis holds the
+//! X/Y/Z/W rotation quaternion of each joint followed by its X/Y/Z translation, as in
+//! `BVHTransform`. The tensor can be memory-mapped directly, e.g. with
+//! `numpy.load(path, mmap_mode="r")`.
+//!
+//! A JSON sidecar is written to `jsonPath`, holding the joint names, parent indices and offsets,
+//! the frame time and frame rate, and the shape and element type of the tensor.
+//!
+//! Returns `true` on success, or `false` if either file could not be written.
+bool ExportBVHTensor(BVHDocument const& document, std::string const& npyPath, std::string const& jsonPath, BVHTensorOptions const& options = {});
+
+//! Parse each of the given BVH files and export it with `ExportBVHTensor`, in parallel on up to
+//! `maxThreads` threads (or one thread per hardware thread if `maxThreads` is zero). Each file is
+//! written to the given output directory, named after the BVH file, e.g. `walk.bvh` and `walk.bvh.gz`
+//! are written to `walk.npy` and `walk.json`. Each document is released as soon as it has been written.
+//!
+//! Files with the same name in different directories (e.g. `s01/walk.bvh` and `s02/walk.bvh`) are
+//! written to subdirectories of the output directory that mirror their directories, relative to the
+//! deepest directory that contains all of them (e.g. `s01/walk.npy` and `s02/walk.npy`). A file that
+//! is given more than once is only exported once, and its later occurrences fail.
+//!
+//! Returns `true` if every file was exported, or `false` otherwise, in which case the paths of
+//! the files that failed to parse or write are stored in `failedPaths`, if given.
+bool ExportBVHTensors(std::vector<std::string> const& bvhPaths, std::string const& outputDirectory, BVHTensorOptions const& options = {}, size_t maxThreads = 0, std::vector<std::string>* failedPaths = nullptr);
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,254 @@
+#include "IndexBVH.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define USDBVHANIM_WITH_X86_KERNELS
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// Kernels for instruction sets beyond the baseline are compiled for that instruction set alone,
+// and only called once the processor is known to support it
+#if defined(USDBVHANIM_WITH_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+#define USDBVHANIM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define USDBVHANIM_TARGET_AVX2
+#endif
+
+//! The number of bytes of contents classified at once, one bit per byte
+static size_t constexpr c_BlockSize = 64;
+
+static unsigned CountTrailingZeros(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+}
+
+static unsigned CountBits(uint64_t value)
+{
+#if defined(_MSC_VER)
+    return static_cast<unsigned>(__popcnt64(value));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(value));
+#endif
+}
+
+namespace usdBVHAnimPlugin {
+namespace {
+    //! The offsets found so far, written through raw pointers so that a whole block of offsets can
+    //! be appended without checking the capacity of the vectors for each one
+    struct IndexWriter {
+        BVHValueIndex& m_Index;
+        size_t m_NumValues = 0;
+        size_t m_NumLines = 0;
+        //! Whether the byte before the current block was whitespace (the start of the contents is)
+        uint64_t m_PreviousWhitespace = 1;
+
+        static void Append(std::vector<uint32_t>& offsets, size_t& count, size_t base, uint64_t bits)
+        {
+            if (count + c_BlockSize > offsets.size()) {
+                offsets.resize(std::max({ offsets.size() * 2, offsets.capacity(), count + c_BlockSize }));
+            }
+            uint32_t* out = offsets.data() + count;
+            count += CountBits(bits);
+            while (bits != 0) {
+                *out++ = static_cast<uint32_t>(base + CountTrailingZeros(bits));
+                bits &= bits - 1;
+            }
+        }
+
+        //! Append the offsets of a block at the given offset, given one bit per byte that is set for
+        //! each whitespace byte and for each line feed
+        void AppendBlock(size_t offset, uint64_t whitespace, uint64_t lineFeeds)
+        {
+            // A value starts wherever a byte that isn't whitespace follows one that is
+            uint64_t const valueStarts = ~whitespace & ((whitespace << 1) | m_PreviousWhitespace);
+            m_PreviousWhitespace = whitespace >> 63;
+            if (valueStarts != 0) {
+                Append(m_Index.m_ValueStarts, m_NumValues, offset, valueStarts);
+            }
+            if (lineFeeds != 0) {
+                Append(m_Index.m_LineStarts, m_NumLines, offset + 1, lineFeeds);
+            }
+        }
+    };
+
+    void ClassifyBlockScalar(char const* block, uint64_t& whitespace, uint64_t& lineFeeds)
+    {
+        whitespace = 0;
+        lineFeeds = 0;
+        for (size_t i = 0; i < c_BlockSize; ++i) {
+            char const c = block[i];
+            whitespace |= static_cast<uint64_t>(c == ' ' || c == '\t' || c == '\r' || c == '\n') << i;
+            lineFeeds |= static_cast<uint64_t>(c == '\n') << i;
+        }
+    }
+
+    //! Index every whole block of the given contents, returning the number of bytes indexed
+    size_t IndexBlocksScalar(char const* contents, size_t size, IndexWriter& writer)
+    {
+        size_t offset = 0;
+        for (; offset + c_BlockSize <= size; offset += c_BlockSize) {
+            uint64_t whitespace, lineFeeds;
+            ClassifyBlockScalar(contents + offset, whitespace, lineFeeds);
+            writer.AppendBlock(offset, whitespace, lineFeeds);
+        }
+        return offset;
+    }
+
+#if defined(USDBVHANIM_WITH_X86_KERNELS)
+    size_t IndexBlocksSSE2(char const* contents, size_t size, IndexWriter& writer)
+    {
+        __m128i const space = _mm_set1_epi8(' ');
+        __m128i const tab = _mm_set1_epi8('\t');
+        __m128i const carriageReturn = _mm_set1_epi8('\r');
+        __m128i const lineFeed = _mm_set1_epi8('\n');
+        size_t offset = 0;
+        for (; offset + c_BlockSize <= size; offset += c_BlockSize) {
+            uint64_t whitespace = 0;
+            uint64_t lineFeeds = 0;
+            for (size_t i = 0; i < c_BlockSize; i += 16) {
+                __m128i const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const*>(contents + offset + i));
+                __m128i const isLineFeed = _mm_cmpeq_epi8(bytes, lineFeed);
+                __m128i const isWhitespace = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bytes, space), _mm_cmpeq_epi8(bytes, tab)),
+                    _mm_or_si128(_mm_cmpeq_epi8(bytes, carriageReturn), isLineFeed));
+                whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(isWhitespace))) << i;
+                lineFeeds |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(isLineFeed))) << i;
+            }
+            writer.AppendBlock(offset, whitespace, lineFeeds);
+        }
+        return offset;
+    }
+
+    USDBVHANIM_TARGET_AVX2 size_t IndexBlocksAVX2(char const* contents, size_t size, IndexWriter& writer)
+    {
+        __m256i const space = _mm256_set1_epi8(' ');
+        __m256i const tab = _mm256_set1_epi8('\t');
+        __m256i const carriageReturn = _mm256_set1_epi8('\r');
+        __m256i const lineFeed = _mm256_set1_epi8('\n');
+        size_t offset = 0;
+        for (; offset + c_BlockSize <= size; offset += c_BlockSize) {
+            uint64_t whitespace = 0;
+            uint64_t lineFeeds = 0;
+            for (size_t i = 0; i < c_BlockSize; i += 32) {
+                __m256i const bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(contents + offset + i));
+                __m256i const isLineFeed = _mm256_cmpeq_epi8(bytes, lineFeed);
+                __m256i const isWhitespace = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(bytes, space), _mm256_cmpeq_epi8(bytes, tab)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(bytes, carriageReturn), isLineFeed));
+                whitespace |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(isWhitespace))) << i;
+                lineFeeds |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(isLineFeed))) << i;
+            }
+            writer.AppendBlock(offset, whitespace, lineFeeds);
+        }
+        return offset;
+    }
+
+    bool IsAVX2Supported()
+    {
+#if defined(_MSC_VER)
+        // AVX2 also requires the operating system to save the AVX registers on context switches
+        int info[4];
+        __cpuid(info, 1);
+        bool const osSavesAVX = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        if (!osSavesAVX) {
+            return false;
+        }
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    bool IsSSE2Supported()
+    {
+#if defined(__x86_64__) || defined(_M_X64)
+        return true;
+#elif defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[3] & (1 << 26)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+#endif
+    }
+#endif
+} // namespace
+
+bool IsBVHIndexKernelSupported(BVHIndexKernel kernel)
+{
+    switch (kernel) {
+    case BVHIndexKernel::Scalar:
+        return true;
+#if defined(USDBVHANIM_WITH_X86_KERNELS)
+    case BVHIndexKernel::SSE2:
+        return IsSSE2Supported();
+    case BVHIndexKernel::AVX2:
+        return IsAVX2Supported();
+#endif
+    default:
+        return false;
+    }
+}
+
+BVHIndexKernel GetBVHIndexKernel()
+{
+    static BVHIndexKernel const s_Kernel = []() {
+        for (BVHIndexKernel kernel : { BVHIndexKernel::AVX2, BVHIndexKernel::SSE2 }) {
+            if (IsBVHIndexKernelSupported(kernel)) {
+                return kernel;
+            }
+        }
+        return BVHIndexKernel::Scalar;
+    }();
+    return s_Kernel;
+}
+
+void IndexBVHValues(char const* contents, size_t size, BVHValueIndex& index, BVHIndexKernel kernel)
+{
+    IndexWriter writer { index };
+    size = std::min(size, c_MaxBVHIndexSize);
+    if (!IsBVHIndexKernelSupported(kernel)) {
+        kernel = BVHIndexKernel::Scalar;
+    }
+
+    size_t offset = 0;
+    switch (kernel) {
+#if defined(USDBVHANIM_WITH_X86_KERNELS)
+    case BVHIndexKernel::AVX2:
+        offset = IndexBlocksAVX2(contents, size, writer);
+        break;
+    case BVHIndexKernel::SSE2:
+        offset = IndexBlocksSSE2(contents, size, writer);
+        break;
+#endif
+    default:
+        offset = IndexBlocksScalar(contents, size, writer);
+        break;
+    }
+
+    // The last partial block is padded with whitespace, which starts no values, so that it can be
+    // classified as a whole block without reading beyond the end of the contents
+    if (offset < size) {
+        char block[c_BlockSize];
+        std::memset(block, ' ', sizeof(block));
+        std::memcpy(block, contents + offset, size - offset);
+        uint64_t whitespace, lineFeeds;
+        ClassifyBlockScalar(block, whitespace, lineFeeds);
+        writer.AppendBlock(offset, whitespace, lineFeeds);
+    }
+
+    index.m_ValueStarts.resize(writer.m_NumValues);
+    index.m_LineStarts.resize(writer.m_NumLines);
+}
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! The instruction sets that `IndexBVHValues` can classify contents with.
+enum class BVHIndexKernel {
+    //! Classify one character at a time, on any processor
+    Scalar,
+    //! Classify 16 characters at a time with SSE2 instructions
+    SSE2,
+    //! Classify 32 characters at a time with AVX2 instructions
+    AVX2
+};
+
+//! Returns `true` if the given kernel is supported by the processor that this process is running
+//! on, and was compiled in.
+bool IsBVHIndexKernelSupported(BVHIndexKernel kernel);
+
+//! Returns the fastest kernel supported by the processor that this process is running on, which
+//! is detected once, on first use.
+BVHIndexKernel GetBVHIndexKernel();
+
+//! The offsets of the values and lines within a block of BVH contents (e.g. the frames of the
+//! MOTION section), as found by `IndexBVHValues`.
+struct BVHValueIndex {
+    //! The offset of the first character of each value, where a value is any run of characters
+    //! other than whitespace
+    std::vector<uint32_t> m_ValueStarts;
+    //! The offset just after each line feed, i.e. the offset of the first character of each line
+    //! other than the first
+    std::vector<uint32_t> m_LineStarts;
+};
+
+//! The largest number of bytes of contents that can be indexed at once, such that every offset
+//! fits in 32 bits.
+static constexpr size_t c_MaxBVHIndexSize = UINT32_MAX;
+
+//! Index the values and lines of the given contents, of at most `c_MaxBVHIndexSize` bytes, which
+//! are classified as whitespace or not 64 bytes at a time with the given kernel, before any value
+//! is converted. Values can then be converted from their offsets alone, in any order (e.g. in
+//! parallel), without scanning the contents character by character. The contents are not
+//! required to be terminated, and are never read beyond their end.
+//!
+//! The index replaces any offsets already held by `index`, reusing its storage.
+void IndexBVHValues(char const* contents, size_t size, BVHValueIndex& index, BVHIndexKernel kernel = GetBVHIndexKernel());
+} // namespace usdBVHAnimPlugin
@@ -127,12 +127,14 @@ struct Parse {
     //!
     //! The given function can also be permitted to return an invalid `Parse` object,
     //! in which case, the `result` string will be emptied and the invalid `Parse` object
-    //! will be returned by this function.
-    Parse Capture(std::string& result, std::function<Parse(Parse)> const& function) const
+    //! will be returned by this function. The `result` string keeps its allocator (e.g. the
+    //! memory resource of a `std::pmr::string`).
+    template <typename String>
+    Parse Capture(String& result, std::function<Parse(Parse)> const& function) const
     {
         Parse next = function(*this);
         if (next) {
-            result = std::string(m_Begin, next.m_Begin - m_Begin);
+            result.assign(m_Begin, next.m_Begin - m_Begin);
             return next;
         } else {
             return {};
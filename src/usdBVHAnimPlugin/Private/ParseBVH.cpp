@@ -1,9 +1,15 @@
 #include "ParseBVH.h"
+#include "BVHChunkReaders.h"
+#include "IndexBVH.h"
 #include "Parse.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
 #include <cmath>
 #include <cstdio>
-#include <fstream>
+#include <cstring>
 #include <iostream>
+#include <thread>
 
 #define CHECK_GOOD(stream) \
     if (!stream.good()) {  \
@@ -14,6 +20,30 @@ static const char* const c_WS = " \t\r\n";
 static const char* const c_AlphaNumeric = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
 static const char* const c_Double = "+-0123456789.eE";
 
+// Scratch buffers larger than this are released after parsing, rather than being
+// retained by the thread for subsequent reads
+static size_t const c_MaxRetainedScratchBytes = 16 * 1024 * 1024;
+
+//! Count the number of joints declared in the HIERARCHY section of the given BVH
+//! contents, so that the joint arrays of a `BVHDocument` can be sized up front.
+static size_t CountJoints(char const* begin, char const* end)
+{
+    static char const c_Joint[] = "JOINT";
+    static char const c_Motion[] = "MOTION";
+    size_t constexpr c_JointLength = sizeof(c_Joint) - 1;
+    size_t constexpr c_MotionLength = sizeof(c_Motion) - 1;
+
+    size_t count = 1;
+    for (char const* cursor = begin; cursor + c_MotionLength <= end; ++cursor) {
+        if (*cursor == 'J' && std::memcmp(cursor, c_Joint, c_JointLength) == 0) {
+            ++count;
+        } else if (*cursor == 'M' && std::memcmp(cursor, c_Motion, c_MotionLength) == 0) {
+            break;
+        }
+    }
+    return count;
+}
+
 static void MultiplyBVHQuat(double a[4], double const b[4])
 {
     double result[4];
@@ -28,7 +58,108 @@ static void MultiplyBVHQuat(double a[4], double const b[4])
     a[3] = result[3];
 }
 
+//! Returns `true` if the given character is whitespace
+static bool IsWhitespace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
 namespace usdBVHAnimPlugin {
+//! Resolve the given joint selection against the joints of the given document, storing
+//! the index that each joint has once unselected joints are removed, or -1 if the joint
+//! is not selected. Stores an empty joint map if every joint is selected. Returns `false`
+//! if any selected joint does not exist.
+static bool ResolveJointSelection(BVHDocument const& document, BVHJointSelection const& selection, std::vector<int>& jointMap)
+{
+    jointMap.clear();
+    if (selection.IsEmpty()) {
+        return true;
+    }
+
+    size_t const numJoints = document.m_JointNames.size();
+    std::vector<char> selected(numJoints, 0);
+    std::vector<char> selectedSubtree(numJoints, 0);
+    auto select = [&](std::vector<std::string> const& names, std::vector<char>& flags) {
+        for (std::string const& name : names) {
+            auto it = std::find(document.m_JointNames.begin(), document.m_JointNames.end(), std::string_view(name));
+            if (it == document.m_JointNames.end()) {
+                return false;
+            }
+            flags[it - document.m_JointNames.begin()] = 1;
+        }
+        return true;
+    };
+    if (!select(selection.m_Joints, selected) || !select(selection.m_SubtreeRoots, selectedSubtree)) {
+        return false;
+    }
+
+    // Joints are stored in depth-first order, with every parent before its children, so
+    // subtrees can be selected in a forward pass, and ancestors in a backward pass
+    for (size_t j = 0; j < numJoints; ++j) {
+        int const parent = document.m_JointParents[j];
+        if (parent != BVHDocument::c_RootParentIndex && selectedSubtree[parent]) {
+            selectedSubtree[j] = 1;
+        }
+        selected[j] |= selectedSubtree[j];
+    }
+    for (size_t j = numJoints; j-- > 0;) {
+        int const parent = document.m_JointParents[j];
+        if (selected[j] && parent != BVHDocument::c_RootParentIndex) {
+            selected[parent] = 1;
+        }
+    }
+
+    jointMap.resize(numJoints);
+    int numSelected = 0;
+    for (size_t j = 0; j < numJoints; ++j) {
+        jointMap[j] = selected[j] ? numSelected++ : -1;
+    }
+    return true;
+}
+
+//! Returns the number of joints that are stored for each frame, given a joint map
+//! returned by `ResolveJointSelection`.
+static size_t CountSelectedJoints(BVHDocument const& document, std::vector<int> const& jointMap)
+{
+    if (jointMap.empty()) {
+        return document.m_JointNames.size();
+    }
+    return std::count_if(jointMap.begin(), jointMap.end(), [](int index) { return index >= 0; });
+}
+
+//! Remove the unselected joints from the joint hierarchy of the given document, given a
+//! joint map returned by `ResolveJointSelection`.
+static void RemoveUnselectedJoints(BVHDocument& document, std::vector<int> const& jointMap)
+{
+    if (jointMap.empty()) {
+        return;
+    }
+
+    // Selected joints only ever move towards the front, so they can be compacted in place
+    size_t const numJoints = jointMap.size();
+    for (size_t j = 0; j < numJoints; ++j) {
+        int const index = jointMap[j];
+        if (index < 0) {
+            continue;
+        }
+        int const parent = document.m_JointParents[j];
+        if (static_cast<size_t>(index) != j) {
+            document.m_JointNames[index] = std::move(document.m_JointNames[j]);
+        }
+        document.m_JointParents[index] = parent == BVHDocument::c_RootParentIndex ? parent : jointMap[parent];
+        document.m_JointOffsets[index] = document.m_JointOffsets[j];
+        document.m_JointNumChannels[index] = document.m_JointNumChannels[j];
+        document.m_JointChannels[index] = document.m_JointChannels[j];
+    }
+
+    size_t const numSelected = CountSelectedJoints(document, jointMap);
+    document.m_JointNames.resize(numSelected);
+    document.m_JointParents.resize(numSelected);
+    document.m_JointOffsets.resize(numSelected);
+    document.m_JointNumChannels.resize(numSelected);
+    document.m_JointChannels.resize(numSelected);
+}
+
 Parse ParseDouble(Parse cursor, double& result)
 {
     constexpr size_t c_NumberBufferSize = 64;
@@ -54,16 +185,30 @@ Parse ParseDouble(Parse cursor, double& result)
     return cursor;
 }
 
+// The number of bits taken by each channel of a joint, and so the most channels a joint can hold
+static unsigned int constexpr c_BitCount = static_cast<unsigned int>(BVHChannel::BitCount);
+static unsigned int constexpr c_MaxJointChannels = 32 / c_BitCount;
+
+// Joints nested deeper than this fail to parse, which bounds the recursion of the parser
+static size_t constexpr c_MaxJointDepth = 256;
+
 Parse ParseUInt(Parse cursor, unsigned int& result)
 {
-    if (!cursor) {
-        return cursor;
+    // Digits are read up to the end of the cursor, as the contents need not be NUL-terminated, and
+    // values that do not fit are rejected rather than clamped
+    if (!cursor || cursor.m_Begin == cursor.m_End || *cursor.m_Begin < '0' || *cursor.m_Begin > '9') {
+        return {};
     }
 
-    constexpr int c_Base = 10;
-    char* end = nullptr;
-    result = std::strtoul(cursor.m_Begin, &end, c_Base);
-    cursor.m_Begin = end;
+    constexpr uint64_t c_Base = 10;
+    uint64_t value = 0;
+    for (; cursor.m_Begin != cursor.m_End && *cursor.m_Begin >= '0' && *cursor.m_Begin <= '9'; ++cursor.m_Begin) {
+        value = value * c_Base + static_cast<uint64_t>(*cursor.m_Begin - '0');
+        if (value > UINT_MAX) {
+            return {};
+        }
+    }
+    result = static_cast<unsigned int>(value);
     return cursor;
 }
 
@@ -79,8 +224,8 @@ Parse ParseJointChannels(Parse cursor, unsigned int& numChannels, uint32_t& chan
 {
     cursor = cursor.String("CHANNELS").Skip(c_WS);
     cursor = ParseUInt(cursor, numChannels).Skip(c_WS);
-    if (!cursor) {
-        return cursor;
+    if (!cursor || numChannels > c_MaxJointChannels) {
+        return {};
     }
 
     for (size_t i = 0; i < numChannels; ++i) {
@@ -99,7 +244,6 @@ Parse ParseJointChannels(Parse cursor, unsigned int& numChannels, uint32_t& chan
             return cursor;
         }
 
-        constexpr unsigned int c_BitCount = static_cast<unsigned int>(BVHChannel::BitCount);
         if (token == "Xposition") {
             channels |= static_cast<unsigned int>(BVHChannel::XPosition) << (c_BitCount * i);
         } else if (token == "Yposition") {
@@ -117,8 +261,11 @@ Parse ParseJointChannels(Parse cursor, unsigned int& numChannels, uint32_t& chan
     return cursor.Skip(c_WS);
 }
 
-Parse ParseJointHierarchy(Parse cursor, size_t currentJointIndex, BVHDocument& document)
+Parse ParseJointHierarchy(Parse cursor, size_t currentJointIndex, size_t depth, BVHDocument& document)
 {
+    if (depth > c_MaxJointDepth) {
+        return {};
+    }
     cursor = cursor.Char('{').Skip(c_WS);
     cursor = ParseJointOffset(cursor, document.m_JointOffsets[currentJointIndex]);
     cursor = ParseJointChannels(cursor, document.m_JointNumChannels[currentJointIndex], document.m_JointChannels[currentJointIndex]);
@@ -129,90 +276,650 @@ Parse ParseJointHierarchy(Parse cursor, size_t currentJointIndex, BVHDocument& d
         cursor = ParseJointOffset(next, offset);
         cursor = cursor.Char('}').Skip(c_WS);
     } else {
-        cursor = cursor.AtLeast(0, [&](Parse const& cursor) {
-            std::string childName;
-            Parse result = cursor
-                               .String("JOINT")
-                               .Skip(c_WS)
-                               .Capture(childName, [&](Parse const& cursor) {
-                                   return cursor.AtLeast(1, [](Parse const& cursor) {
-                                       return cursor.AnyOf(c_AlphaNumeric);
-                                   });
-                               })
-                               .Skip(c_WS);
-            ;
-            if (result) {
-                document.m_JointNames.push_back(childName);
-                document.m_JointParents.push_back(static_cast<unsigned int>(currentJointIndex));
-                document.m_JointOffsets.push_back({});
-                document.m_JointNumChannels.push_back(0);
-                document.m_JointChannels.push_back(0);
-                result = ParseJointHierarchy(result, document.m_JointNames.size() - 1, document);
+        // Child joints are parsed in a loop rather than with `Parse::AtLeast`, as a `std::function`
+        // holding the state of this joint would otherwise be allocated for every joint with children
+        while (cursor) {
+            std::pmr::string childName(document.m_JointNames.get_allocator());
+            Parse child = cursor
+                              .String("JOINT")
+                              .Skip(c_WS)
+                              .Capture(childName, [](Parse const& cursor) {
+                                  return cursor.AtLeast(1, [](Parse const& cursor) {
+                                      return cursor.AnyOf(c_AlphaNumeric);
+                                  });
+                              })
+                              .Skip(c_WS);
+            if (!child) {
+                break;
+            }
+            document.m_JointNames.push_back(std::move(childName));
+            document.m_JointParents.push_back(static_cast<unsigned int>(currentJointIndex));
+            document.m_JointOffsets.push_back({});
+            document.m_JointNumChannels.push_back(0);
+            document.m_JointChannels.push_back(0);
+            child = ParseJointHierarchy(child, document.m_JointNames.size() - 1, depth + 1, document);
+            if (!child) {
+                break;
             }
-            return result;
-        });
+            cursor = child;
+        }
     }
     return cursor.Char('}').Skip(c_WS);
 }
 
-Parse ParseMotion(Parse cursor, BVHDocument& result)
+//! Apply the value of a single channel to the given joint transform
+static void ApplyChannel(BVHTransform& transform, BVHChannel channel, double value)
+{
+    double const c_DegToRad = M_PI / 180.0;
+    switch (channel) {
+    case BVHChannel::XPosition:
+        transform.m_Translation[0] = value;
+        break;
+    case BVHChannel::YPosition:
+        transform.m_Translation[1] = value;
+        break;
+    case BVHChannel::ZPosition:
+        transform.m_Translation[2] = value;
+        break;
+    case BVHChannel::XRotation: {
+        double quat[4] = { std::sin(value * 0.5 * c_DegToRad), 0.0f, 0.0f, std::cos(value * 0.5 * c_DegToRad) };
+        MultiplyBVHQuat(transform.m_RotationQuat, quat);
+        break;
+    }
+    case BVHChannel::YRotation: {
+        double quat[4] = { 0.0f, std::sin(value * 0.5 * c_DegToRad), 0.0f, std::cos(value * 0.5 * c_DegToRad) };
+        MultiplyBVHQuat(transform.m_RotationQuat, quat);
+        break;
+    }
+    case BVHChannel::ZRotation: {
+        double quat[4] = { 0.0f, 0.0f, std::sin(value * 0.5 * c_DegToRad), std::cos(value * 0.5 * c_DegToRad) };
+        MultiplyBVHQuat(transform.m_RotationQuat, quat);
+        break;
+    }
+    default:
+        break;
+    };
+}
+
+//! Returns `true` if the given character can be part of a value converted by `ParseDouble`
+static bool IsDoubleChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '.' || c == '+' || c == '-' || c == 'e' || c == 'E';
+}
+
+//! Convert the value that starts at `begin` and ends at the next whitespace character or at `end`,
+//! in the same way as `ParseDouble`. Returns `false` if the value is not a number.
+static bool ConvertValue(char const* begin, char const* end, double& result)
+{
+    constexpr size_t c_NumberBufferSize = 64;
+    char numberBuffer[c_NumberBufferSize];
+
+    size_t length = 0;
+    for (; begin + length < end && !IsWhitespace(begin[length]); ++length) {
+        if (length + 1 >= c_NumberBufferSize || !IsDoubleChar(begin[length])) {
+            return false;
+        }
+        numberBuffer[length] = begin[length];
+    }
+    numberBuffer[length] = '\0';
+    result = std::atof(numberBuffer);
+    return true;
+}
+
+//! Convert a single frame from its values, given as the offset of each value within `contents`
+static bool ConvertFrame(char const* contents, char const* end, uint32_t const* valueStarts, BVHDocument const& document, BVHTransform* frameTransforms, int const* jointMap)
+{
+    size_t const numJoints = document.m_JointChannels.size();
+    for (size_t j = 0; j < numJoints; ++j) {
+        // The channels of unselected joints are skipped without being converted
+        unsigned int const numChannels = document.m_JointNumChannels[j];
+        if (jointMap && jointMap[j] < 0) {
+            valueStarts += numChannels;
+            continue;
+        }
+
+        uint32_t channels = document.m_JointChannels[j];
+        BVHTransform transform = {
+            { 0.0, 0.0, 0.0, 1.0 }, { document.m_JointOffsets[j].m_Translation[0], document.m_JointOffsets[j].m_Translation[1], document.m_JointOffsets[j].m_Translation[2] }
+        };
+        for (size_t n = 0; n < numChannels; ++n, channels >>= 3) {
+            double value = 0.0;
+            if (!ConvertValue(contents + *valueStarts++, end, value)) {
+                return false;
+            }
+            ApplyChannel(transform, channels & BVHChannel::BitMask, value);
+        }
+        frameTransforms[jointMap ? jointMap[j] : j] = transform;
+    }
+    return true;
+}
+
+//! The number of bytes of contents that are indexed at once by `ParseIndexedFrames`, which is
+//! small enough for the index of each slice to stay in cache while its values are converted
+static size_t constexpr c_IndexSliceSize = 64 * 1024;
+
+//! Parse up to `maxFrames` frames from the given contents, every value of which must be complete,
+//! storing the transforms of the selected joints of each frame at `frameTransforms`, or skipping
+//! over the frames without converting their values if `frameTransforms` is null. The offsets of
+//! values are found a slice of the contents at a time with `IndexBVHValues`, and only then are the
+//! values of each frame converted. Stores the number of frames that were parsed in `numParsed`,
+//! and the offset just beyond the values of the last of them in `consumed`, such that the values
+//! of a partial frame at the end of the contents are left for a later call. Returns `false` if any
+//! value is not a number.
+static bool ParseIndexedFrames(char const* contents, size_t size, BVHDocument const& document, int const* jointMap, size_t numSelectedJoints,
+    BVHTransform* frameTransforms, size_t maxFrames, size_t& numParsed, size_t& consumed)
+{
+    size_t valuesPerFrame = 0;
+    for (unsigned int numChannels : document.m_JointNumChannels) {
+        valuesPerFrame += numChannels;
+    }
+
+    numParsed = 0;
+    consumed = 0;
+    if (valuesPerFrame == 0) {
+        for (; numParsed < maxFrames && frameTransforms; ++numParsed) {
+            ConvertFrame(contents, contents, nullptr, document, frameTransforms + numParsed * numSelectedJoints, jointMap);
+        }
+        numParsed = maxFrames;
+        return true;
+    }
+
+    // The index is owned by the calling thread, and sized for a whole slice of short values up front,
+    // so that it is only allocated once per thread, regardless of the size of the contents
+    thread_local BVHValueIndex t_Index;
+    t_Index.m_ValueStarts.reserve(c_IndexSliceSize / 2);
+    t_Index.m_LineStarts.reserve(c_IndexSliceSize / 8);
+    size_t sliceSize = c_IndexSliceSize;
+    while (numParsed < maxFrames && consumed < size) {
+        // Slices end just after whitespace, so that no value is split between two slices
+        size_t sliceEnd = std::min(size, consumed + sliceSize);
+        if (sliceEnd < size) {
+            size_t const wholeValuesEnd = FindLastWhitespaceEnd(contents + consumed, contents + sliceEnd);
+            if (wholeValuesEnd == 0) {
+                if (sliceSize > c_MaxBVHIndexSize / 2) {
+                    return false;
+                }
+                sliceSize *= 2;
+                continue;
+            }
+            sliceEnd = consumed + wholeValuesEnd;
+        }
+
+        char const* const slice = contents + consumed;
+        IndexBVHValues(slice, sliceEnd - consumed, t_Index);
+        size_t const numValues = t_Index.m_ValueStarts.size();
+        size_t const numFrames = std::min(numValues / valuesPerFrame, maxFrames - numParsed);
+        if (numFrames == 0) {
+            // A frame that is larger than a slice needs a larger slice
+            if (sliceEnd == size || sliceSize > c_MaxBVHIndexSize / 2) {
+                break;
+            }
+            sliceSize *= 2;
+            continue;
+        }
+
+        for (size_t f = 0; f < numFrames && frameTransforms; ++f) {
+            BVHTransform* const transforms = frameTransforms + (numParsed + f) * numSelectedJoints;
+            if (!ConvertFrame(slice, contents + sliceEnd, t_Index.m_ValueStarts.data() + f * valuesPerFrame, document, transforms, jointMap)) {
+                return false;
+            }
+        }
+        numParsed += numFrames;
+        size_t const nextValue = numFrames * valuesPerFrame;
+        consumed = nextValue < numValues ? consumed + t_Index.m_ValueStarts[nextValue] : sliceEnd;
+    }
+    return true;
+}
+
+Parse ParseMotionHeader(Parse cursor, BVHDocument& result, unsigned int& numFrames)
 {
     cursor = cursor.String("MOTION").Skip(c_WS);
 
-    unsigned int numFrames = 0;
+    numFrames = 0;
     cursor = cursor.String("Frames:").Skip(c_WS);
     cursor = ParseUInt(cursor, numFrames).Skip(c_WS);
 
     cursor = cursor.String("Frame Time:").Skip(c_WS);
     cursor = ParseDouble(cursor, result.m_FrameTime).Skip(c_WS);
+    return cursor;
+}
 
-    for (size_t i = 0; i < numFrames; ++i) {
-        for (size_t j = 0; j < result.m_JointChannels.size(); ++j) {
-            uint32_t channels = result.m_JointChannels[j];
-            BVHTransform transform = {
-                { 0.0, 0.0, 0.0, 1.0 }, { result.m_JointOffsets[j].m_Translation[0], result.m_JointOffsets[j].m_Translation[1], result.m_JointOffsets[j].m_Translation[2] }
-            };
-            for (size_t n = 0; n < result.m_JointNumChannels[j]; ++n, channels >>= 3) {
-                double value = 0.0;
-                double const c_DegToRad = M_PI / 180.0;
-                cursor = ParseDouble(cursor, value).Skip(c_WS);
-                BVHChannel channel = channels & BVHChannel::BitMask;
-                switch (channel) {
-                case BVHChannel::XPosition:
-                    transform.m_Translation[0] = value;
-                    break;
-                case BVHChannel::YPosition:
-                    transform.m_Translation[1] = value;
-                    break;
-                case BVHChannel::ZPosition:
-                    transform.m_Translation[2] = value;
-                    break;
-                case BVHChannel::XRotation: {
-                    double quat[4] = { std::sin(value * 0.5 * c_DegToRad), 0.0f, 0.0f, std::cos(value * 0.5 * c_DegToRad) };
-                    MultiplyBVHQuat(transform.m_RotationQuat, quat);
-                    break;
-                }
-                case BVHChannel::YRotation: {
-                    double quat[4] = { 0.0f, std::sin(value * 0.5 * c_DegToRad), 0.0f, std::cos(value * 0.5 * c_DegToRad) };
-                    MultiplyBVHQuat(transform.m_RotationQuat, quat);
-                    break;
-                }
-                case BVHChannel::ZRotation: {
-                    double quat[4] = { 0.0f, 0.0f, std::sin(value * 0.5 * c_DegToRad), std::cos(value * 0.5 * c_DegToRad) };
-                    MultiplyBVHQuat(transform.m_RotationQuat, quat);
-                    break;
-                }
-                default:
-                    break;
-                };
+Parse ParseHierarchy(Parse cursor, BVHDocument& result)
+{
+    size_t const numJoints = CountJoints(cursor.m_Begin, cursor.m_End);
+    result.m_JointNames.reserve(numJoints);
+    result.m_JointParents.reserve(numJoints);
+    result.m_JointOffsets.reserve(numJoints);
+    result.m_JointNumChannels.reserve(numJoints);
+    result.m_JointChannels.reserve(numJoints);
+
+    result.m_JointNames.push_back({});
+    result.m_JointParents.push_back(BVHDocument::c_RootParentIndex);
+    result.m_JointOffsets.push_back({});
+    result.m_JointNumChannels.push_back(0);
+    result.m_JointChannels.push_back(0);
+
+    cursor = cursor
+                 .String("HIERARCHY")
+                 .Skip(c_WS)
+                 .String("ROOT")
+                 .Skip(c_WS)
+                 .Capture(result.m_JointNames[0], [=](Parse const& cursor) {
+                     return cursor.AtLeast(1, [=](Parse const& cursor) {
+                         return cursor.AnyOf(c_AlphaNumeric);
+                     });
+                 })
+                 .Skip(c_WS);
+
+    if (!cursor) {
+        return cursor;
+    }
+    return ParseJointHierarchy(cursor, 0, 0, result);
+}
+
+//! Report the selected joints of the given document to the given visitor, given a joint map
+//! returned by `ResolveJointSelection`
+static bool VisitHierarchy(BVHDocument const& document, std::vector<int> const& jointMap, BVHVisitor& visitor)
+{
+    if (!visitor.OnHierarchy(CountSelectedJoints(document, jointMap))) {
+        return false;
+    }
+    for (size_t j = 0; j < document.m_JointNames.size(); ++j) {
+        int const index = jointMap.empty() ? static_cast<int>(j) : jointMap[j];
+        if (index < 0) {
+            continue;
+        }
+        int const parent = document.m_JointParents[j];
+        int const selectedParent = parent == BVHDocument::c_RootParentIndex || jointMap.empty() ? parent : jointMap[parent];
+        if (!visitor.OnJoint(static_cast<size_t>(index), document.m_JointNames[j], selectedParent, document.m_JointOffsets[j], document.m_JointNumChannels[j], document.m_JointChannels[j])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! The largest number of bytes of joint transforms that are decoded at once for a visitor
+//! without frame storage of its own
+static size_t constexpr c_MaxVisitorBatchBytes = 1024 * 1024;
+
+//! Returns the number of frames decoded at once for a visitor without frame storage of its own.
+//! A batch holds at least as many frames as a slice of the index can (where each value takes at
+//! least two bytes), so that each slice of the contents is only indexed once.
+static size_t GetVisitorFramesPerBatch(BVHDocument const& document, size_t numSelectedJoints)
+{
+    size_t valuesPerFrame = 0;
+    for (unsigned int numChannels : document.m_JointNumChannels) {
+        valuesPerFrame += numChannels;
+    }
+    size_t const framesPerSlice = c_IndexSliceSize / (2 * std::max<size_t>(valuesPerFrame, 1));
+    size_t const maxFrames = c_MaxVisitorBatchBytes / (std::max<size_t>(numSelectedJoints, 1) * sizeof(BVHTransform));
+    return std::max<size_t>(1, std::min(framesPerSlice, maxFrames));
+}
+
+//! Returns the most frames of the given layout that the given number of bytes of motion data could
+//! hold. Each value takes at least one character, and is separated from the next by at least one
+//! whitespace character. Frames without values take no contents at all, so any number of them can
+//! be held. Files that declare more frames than their contents can hold are rejected before storage
+//! is allocated for them.
+static size_t CountHoldableFrames(BVHDocument const& layout, size_t motionSize)
+{
+    size_t valuesPerFrame = 0;
+    for (unsigned int numChannels : layout.m_JointNumChannels) {
+        valuesPerFrame += numChannels;
+    }
+    return valuesPerFrame > 0 ? (motionSize + 1) / (2 * valuesPerFrame) : SIZE_MAX;
+}
+
+//! Parse BVH contents held in memory, reporting them to the given visitor. The hierarchy of every
+//! joint in the file is parsed into `layout`, against which frames are decoded.
+static bool VisitContents(char const* contents, size_t size, BVHDocument& layout, BVHJointSelection const& selection, BVHVisitor& visitor)
+{
+    Parse cursor = ParseHierarchy(Parse { contents, contents + size }, layout);
+    std::vector<int> jointMap;
+    if (!cursor || !ResolveJointSelection(layout, selection, jointMap) || !VisitHierarchy(layout, jointMap, visitor)) {
+        return false;
+    }
+
+    unsigned int numFrames = 0;
+    cursor = ParseMotionHeader(cursor, layout, numFrames);
+    if (!cursor || numFrames > CountHoldableFrames(layout, cursor.m_End - cursor.m_Begin) || !visitor.OnMotion(numFrames, layout.m_FrameTime)) {
+        return false;
+    }
+
+    // Frames are decoded straight into the visitor's frame storage if it has any, all at once, or
+    // otherwise a batch at a time into a buffer that is reused for each batch
+    size_t const numSelectedJoints = CountSelectedJoints(layout, jointMap);
+    BVHTransform* const frameStorage = visitor.GetFrameStorage(numFrames);
+    size_t const framesPerBatch = frameStorage ? numFrames : std::min<size_t>(numFrames, GetVisitorFramesPerBatch(layout, numSelectedJoints));
+    std::vector<BVHTransform> batch(frameStorage ? 0 : framesPerBatch * numSelectedJoints);
+
+    int const* const jointMapData = jointMap.empty() ? nullptr : jointMap.data();
+    char const* const motion = cursor.m_Begin;
+    size_t const motionSize = cursor.m_End - cursor.m_Begin;
+    size_t consumed = 0;
+    for (size_t frameIndex = 0; frameIndex < numFrames;) {
+        size_t const maxFrames = std::min(framesPerBatch, numFrames - frameIndex);
+        BVHTransform* const frameTransforms = frameStorage ? frameStorage + frameIndex * numSelectedJoints : batch.data();
+        size_t numParsed = 0;
+        size_t numConsumed = 0;
+        if (!ParseIndexedFrames(motion + consumed, motionSize - consumed, layout, jointMapData, numSelectedJoints, frameTransforms, maxFrames, numParsed, numConsumed)
+            || numParsed < maxFrames) {
+            return false;
+        }
+        for (size_t f = 0; f < numParsed; ++f) {
+            if (!visitor.OnFrame(frameIndex + f, frameTransforms + f * numSelectedJoints)) {
+                return false;
             }
-            result.m_FrameTransforms.push_back(transform);
         }
+        frameIndex += numParsed;
+        consumed += numConsumed;
     }
-    return cursor;
+    return true;
+}
+
+namespace {
+    //! A visitor that builds a `BVHDocument`, into whose frame transforms frames are decoded directly.
+    //! Each array of the document is sized exactly once.
+    class DocumentBuilder : public BVHVisitor {
+    public:
+        explicit DocumentBuilder(BVHDocument& document)
+            : m_Document(document)
+        {
+        }
+
+        bool OnHierarchy(size_t numJoints) override
+        {
+            m_Document.m_JointNames.resize(numJoints);
+            m_Document.m_JointParents.resize(numJoints);
+            m_Document.m_JointOffsets.resize(numJoints);
+            m_Document.m_JointNumChannels.resize(numJoints);
+            m_Document.m_JointChannels.resize(numJoints);
+            return true;
+        }
+
+        bool OnJoint(size_t jointIndex, std::string_view name, int parentIndex, BVHOffset const& offset, unsigned int numChannels, uint32_t channels) override
+        {
+            m_Document.m_JointNames[jointIndex] = name;
+            m_Document.m_JointParents[jointIndex] = parentIndex;
+            m_Document.m_JointOffsets[jointIndex] = offset;
+            m_Document.m_JointNumChannels[jointIndex] = numChannels;
+            m_Document.m_JointChannels[jointIndex] = channels;
+            return true;
+        }
+
+        bool OnMotion(size_t numFrames, double frameTime) override
+        {
+            m_Document.m_FrameTime = frameTime;
+            m_Document.m_FrameTransforms.resize(numFrames * m_Document.m_JointNames.size());
+            return true;
+        }
+
+        BVHTransform* GetFrameStorage(size_t /*numFrames*/) override
+        {
+            return m_Document.m_FrameTransforms.data();
+        }
+
+    private:
+        BVHDocument& m_Document;
+    };
+} // namespace
+
+//! The progress of `FindHeaderEnd` through contents that are appended to between calls
+struct HeaderSearch {
+    //! The offset from which to continue searching
+    size_t m_Offset = 0;
+    //! Whether the frame time label has been found, after which `m_Offset` follows the whitespace
+    //! that precedes its value
+    bool m_FoundFrameTime = false;
+};
+
+//! Find the end of the header of a BVH document (the HIERARCHY section and the MOTION
+//! section up to and including the frame time), returning `true` and its offset within
+//! the given contents if it has been found, or `false` if more contents are required.
+//! The search continues from where the last call on the same contents left off, so that
+//! contents are only searched once however many times more are appended to them.
+static bool FindHeaderEnd(char const* begin, char const* end, HeaderSearch& search, size_t& headerEnd)
+{
+    static char const c_FrameTime[] = "Frame Time:";
+    size_t constexpr c_FrameTimeLength = sizeof(c_FrameTime) - 1;
+    size_t const size = end - begin;
+    if (!search.m_FoundFrameTime) {
+        char const* found = std::search(begin + search.m_Offset, end, c_FrameTime, c_FrameTime + c_FrameTimeLength);
+        if (found == end) {
+            search.m_Offset = std::max(search.m_Offset, size - std::min(size, c_FrameTimeLength - 1));
+            return false;
+        }
+        search.m_Offset = found + c_FrameTimeLength - begin;
+        search.m_FoundFrameTime = true;
+    }
+
+    // The frame time value is complete once it is followed by a character that isn't part of it,
+    // or once it is too long to be a value at all
+    constexpr size_t c_MaxValueLength = 64;
+    Parse cursor = Parse { begin + search.m_Offset, end }.Skip(c_WS);
+    search.m_Offset = cursor.m_Begin - begin;
+    cursor = cursor.Skip(c_Double);
+    if (cursor.m_Begin == end && size - search.m_Offset < c_MaxValueLength) {
+        return false;
+    }
+    headerEnd = std::min(static_cast<size_t>(cursor.m_Begin - begin), search.m_Offset + c_MaxValueLength);
+    return true;
+}
+
+bool ParseBVHHeader(char const* contents, size_t size, BVHDocument& result, size_t& numFrames, size_t& headerSize)
+{
+    Parse cursor = ParseHierarchy(Parse { contents, contents + size }, result);
+    unsigned int numHeaderFrames = 0;
+    cursor = ParseMotionHeader(cursor, result, numHeaderFrames);
+    if (!cursor) {
+        return false;
+    }
+    numFrames = numHeaderFrames;
+    headerSize = cursor.m_Begin - contents;
+    return true;
+}
+
+//! Parse the frames `[firstFrame, firstFrame + maxNumFrames)` of a BVH file read from the given
+//! reader, as described by `ParseBVHFrameChunks`. Frames before `firstFrame` are skipped over
+//! without their values being converted, and the range is clamped to the frames of the file.
+//! If a header callback is given, it is called with the number of frames in the range once the
+//! header has been parsed, before any chunk is handed out.
+static bool ParseFrameChunks(BVHChunkReader& reader, BVHDocument& result, size_t firstFrame, size_t maxNumFrames, size_t maxFramesPerChunk,
+    BVHFrameChunkCallback const& callback, BVHJointSelection const& selection, std::function<bool(size_t numFrames)> const& headerCallback = {})
+{
+    size_t constexpr c_ChunkSize = 1 << 20;
+
+    // Contents are accumulated in a single buffer, from which values are consumed as soon
+    // as they are complete. Consumed contents are discarded once they make up at least half
+    // of the buffer, so the buffer only ever holds a small multiple of the chunk size. Values
+    // before `completeEnd` are known to be complete, which is found from each chunk as it is
+    // read, so that a value that spans many chunks is not searched again for each of them.
+    // Every byte of the buffer is read into before it is used, so it is never initialised
+    std::unique_ptr<char[]> buffer;
+    size_t bufferSize = 0;
+    size_t bufferCapacity = 0;
+    size_t totalRead = 0;
+    size_t consumed = 0;
+    size_t completeEnd = 0;
+    bool endOfInput = false;
+    auto readChunk = [&]() {
+        if (consumed > 0 && consumed * 2 >= bufferSize) {
+            std::memmove(buffer.get(), buffer.get() + consumed, bufferSize - consumed);
+            bufferSize -= consumed;
+            completeEnd = std::max(completeEnd, consumed) - consumed;
+            consumed = 0;
+        }
+        if (bufferSize + c_ChunkSize > bufferCapacity) {
+            bufferCapacity = std::max(2 * bufferCapacity, bufferSize + c_ChunkSize);
+            std::unique_ptr<char[]> grown(new char[bufferCapacity]);
+            if (bufferSize > 0) {
+                std::memcpy(grown.get(), buffer.get(), bufferSize);
+            }
+            buffer = std::move(grown);
+        }
+        size_t const size = bufferSize;
+        size_t const numRead = reader.Read(buffer.get() + size, c_ChunkSize);
+        bufferSize += numRead;
+        totalRead += numRead;
+        endOfInput = numRead == 0;
+        size_t const chunkCompleteEnd = FindLastWhitespaceEnd(buffer.get() + size, buffer.get() + bufferSize);
+        completeEnd = endOfInput ? bufferSize : chunkCompleteEnd > 0 ? size + chunkCompleteEnd : completeEnd;
+        return !reader.Failed();
+    };
+
+    // Accumulate the whole header before parsing it
+    HeaderSearch headerSearch;
+    size_t headerEnd = 0;
+    while (!FindHeaderEnd(buffer.get(), buffer.get() + bufferSize, headerSearch, headerEnd)) {
+        if (endOfInput) {
+            headerEnd = bufferSize;
+            break;
+        }
+        if (!readChunk()) {
+            return false;
+        }
+    }
+
+    Parse cursor = ParseHierarchy(Parse { buffer.get(), buffer.get() + headerEnd }, result);
+    std::vector<int> jointMap;
+    if (!cursor || !ResolveJointSelection(result, selection, jointMap)) {
+        return false;
+    }
+
+    unsigned int numFileFrames = 0;
+    size_t const numSelectedJoints = CountSelectedJoints(result, jointMap);
+    cursor = ParseMotionHeader(cursor, result, numFileFrames);
+    if (!cursor) {
+        return false;
+    }
+    consumed = cursor.m_Begin - buffer.get();
+    firstFrame = std::min<size_t>(firstFrame, numFileFrames);
+    size_t const numFrames = std::min<size_t>(maxNumFrames, numFileFrames - firstFrame);
+    size_t const endFrame = numFrames > 0 ? firstFrame + numFrames : 0;
+
+    // The frame storage only ever holds a single chunk of frames. If the size of the contents is
+    // known, the declared number of frames is checked against the remaining contents, and storage
+    // is sized once for a whole chunk. Otherwise, storage is only allocated for as many frames as
+    // the contents read so far could hold, and grows as more are read.
+    size_t const framesPerChunk = maxFramesPerChunk > 0 ? std::min(maxFramesPerChunk, numFrames) : numFrames;
+    size_t const contentsSize = reader.GetSize();
+    size_t storageFrames = framesPerChunk;
+    if (contentsSize != SIZE_MAX) {
+        size_t const remainingSize = contentsSize - std::min(contentsSize, totalRead) + (bufferSize - consumed);
+        if (numFileFrames > CountHoldableFrames(result, remainingSize)) {
+            return false;
+        }
+    } else {
+        storageFrames = std::min(framesPerChunk, CountHoldableFrames(result, bufferSize - consumed));
+    }
+    result.m_FrameTransforms.resize(storageFrames * numSelectedJoints);
+
+    // Frames are parsed against the layout of every joint in the file, so when chunks are
+    // handed out, a copy of the layout is kept before unselected joints are removed from
+    // the result
+    BVHDocument unselectedLayout;
+    BVHDocument const* layout = &result;
+    if (callback && !jointMap.empty()) {
+        unselectedLayout.m_JointOffsets.assign(result.m_JointOffsets.begin(), result.m_JointOffsets.end());
+        unselectedLayout.m_JointNumChannels.assign(result.m_JointNumChannels.begin(), result.m_JointNumChannels.end());
+        unselectedLayout.m_JointChannels.assign(result.m_JointChannels.begin(), result.m_JointChannels.end());
+        RemoveUnselectedJoints(result, jointMap);
+        layout = &unselectedLayout;
+    }
+    if (headerCallback && !headerCallback(numFrames)) {
+        return false;
+    }
+
+    // Parse frames from the values that are known to be complete, reading more contents
+    // whenever the next frame isn't yet available. Frames before the range are only indexed,
+    // to find where the range begins
+    int const* const jointMapData = jointMap.empty() ? nullptr : jointMap.data();
+    size_t frameIndex = 0;
+    size_t chunkBegin = firstFrame;
+    while (frameIndex < endFrame) {
+        char const* contents = buffer.get();
+        size_t const completeSize = std::max(consumed, completeEnd) - consumed;
+        bool const skipping = frameIndex < firstFrame;
+        size_t maxFrames = skipping ? firstFrame - frameIndex : std::min(endFrame - frameIndex, framesPerChunk - (frameIndex - chunkBegin));
+        if (!skipping) {
+            // Full storage (which is only ever the case for contents of unknown size) at least doubles,
+            // or grows to hold the frames the buffered contents could hold. Storage is reserved before
+            // it is resized, as resizing alone may grow its capacity beyond a chunk
+            size_t const chunkFrames = frameIndex - chunkBegin;
+            if (chunkFrames == storageFrames) {
+                size_t const holdableFrames = std::max<size_t>(CountHoldableFrames(*layout, completeSize), 1);
+                storageFrames = std::min(chunkFrames + maxFrames, std::max(2 * storageFrames, chunkFrames + holdableFrames));
+                result.m_FrameTransforms.reserve(storageFrames * numSelectedJoints);
+                result.m_FrameTransforms.resize(storageFrames * numSelectedJoints);
+            }
+            maxFrames = std::min(maxFrames, storageFrames - chunkFrames);
+        }
+        size_t numParsed = 0;
+        size_t numConsumed = 0;
+        BVHTransform* const frameTransforms = skipping ? nullptr : result.m_FrameTransforms.data() + (frameIndex - chunkBegin) * numSelectedJoints;
+        if (!ParseIndexedFrames(contents + consumed, completeSize, *layout, jointMapData, numSelectedJoints, frameTransforms, maxFrames, numParsed, numConsumed)) {
+            return false;
+        }
+        consumed += numConsumed;
+        frameIndex += numParsed;
+
+        // Hand out each chunk as soon as it is complete, and reuse its storage for the next.
+        // The last chunk may be shorter, in which case the storage is shrunk to fit it
+        if (callback && !skipping && numParsed > 0 && (frameIndex - chunkBegin == framesPerChunk || frameIndex == endFrame)) {
+            result.m_FrameTransforms.resize((frameIndex - chunkBegin) * numSelectedJoints);
+            if (!callback(result, chunkBegin, frameIndex - chunkBegin)) {
+                return false;
+            }
+            chunkBegin = frameIndex;
+        }
+
+        if (numParsed < maxFrames && (endOfInput || !readChunk())) {
+            return false;
+        }
+    }
+    if (!callback) {
+        RemoveUnselectedJoints(result, jointMap);
+    }
+    return true;
+}
+
+bool ParseBVHFrameChunks(BVHChunkReader& reader, BVHDocument& result, size_t maxFramesPerChunk, BVHFrameChunkCallback const& callback, BVHJointSelection const& selection)
+{
+    return ParseFrameChunks(reader, result, 0, SIZE_MAX, maxFramesPerChunk, callback, selection);
+}
+
+bool ParseBVHFrameRange(BVHChunkReader& reader, size_t firstFrame, size_t numFrames, BVHDocument& result, BVHJointSelection const& selection)
+{
+    return ParseFrameChunks(reader, result, firstFrame, numFrames, 0, {}, selection);
+}
+
+bool ParseBVH(BVHChunkReader& reader, BVHDocument& result, BVHJointSelection const& selection)
+{
+    return ParseFrameChunks(reader, result, 0, SIZE_MAX, 0, {}, selection);
 }
 
-bool ParseBVH(std::istream& stream, BVHDocument& result)
+bool ParseBVH(BVHChunkReader& reader, BVHVisitor& visitor, BVHJointSelection const& selection)
+{
+    // Frames are parsed a chunk at a time into a document that only ever holds a single chunk, whose
+    // hierarchy holds only the selected joints by the time the header callback is called
+    size_t constexpr c_FramesPerChunk = 256;
+    BVHDocument chunk;
+    auto visitHeader = [&](size_t numFrames) {
+        return VisitHierarchy(chunk, {}, visitor) && visitor.OnMotion(numFrames, chunk.m_FrameTime);
+    };
+    auto visitChunk = [&](BVHDocument const& document, size_t firstFrame, size_t numFrames) {
+        size_t const numJoints = document.m_JointNames.size();
+        for (size_t f = 0; f < numFrames; ++f) {
+            if (!visitor.OnFrame(firstFrame + f, document.m_FrameTransforms.data() + f * numJoints)) {
+                return false;
+            }
+        }
+        return true;
+    };
+    return ParseFrameChunks(reader, chunk, 0, SIZE_MAX, c_FramesPerChunk, visitChunk, selection, visitHeader);
+}
+
+bool ParseBVH(std::istream& stream, BVHDocument& result, BVHJointSelection const& selection)
 {
     CHECK_GOOD(stream);
 
@@ -223,48 +930,169 @@ bool ParseBVH(std::istream& stream, BVHDocument& result)
     stream.seekg(0, std::ios_base::beg);
     CHECK_GOOD(stream);
 
-    std::vector<char> contents;
+    // The file contents are read into a scratch buffer owned by the calling thread,
+    // so that repeated reads on the same thread reuse the same allocation
+    thread_local std::vector<char> t_Contents;
+    struct ScratchGuard {
+        ~ScratchGuard()
+        {
+            if (t_Contents.capacity() > c_MaxRetainedScratchBytes) {
+                std::vector<char>().swap(t_Contents);
+            }
+        }
+    } scratchGuard;
+
+    std::vector<char>& contents = t_Contents;
     contents.resize(totalSize);
     stream.read(contents.data(), totalSize);
     CHECK_GOOD(stream);
+    return ParseBVH(contents.data(), contents.size(), result, selection);
+}
 
-    result.m_JointNames.push_back({});
-    result.m_JointParents.push_back(BVHDocument::c_RootParentIndex);
-    result.m_JointOffsets.push_back({});
-    result.m_JointNumChannels.push_back(0);
-    result.m_JointChannels.push_back(0);
+bool ParseBVH(char const* contents, size_t size, BVHDocument& result, BVHJointSelection const& selection)
+{
+    // Compressed contents are decompressed on a separate thread while they are being parsed
+    if (IsCompressedBVHContents(contents, size)) {
+        std::unique_ptr<BVHChunkReader> reader = OpenBVHChunkReader(contents, size);
+        if (!reader) {
+            return false;
+        }
+        BVHPipelinedChunkReader pipelinedReader(*reader);
+        return ParseBVH(pipelinedReader, result, selection);
+    }
 
-    Parse cursor = Parse { contents.data(), contents.data() + contents.size() }
-                       .String("HIERARCHY")
-                       .Skip(c_WS)
-                       .String("ROOT")
-                       .Skip(c_WS)
-                       .Capture(result.m_JointNames[0], [=](Parse const& cursor) {
-                           return cursor.AtLeast(1, [=](Parse const& cursor) {
-                               return cursor.AnyOf(c_AlphaNumeric);
-                           });
-                       })
-                       .Skip(c_WS);
+    // The layout of every joint is scratch storage of the parser, so it is not allocated from the
+    // document's memory resource, while the document only holds the selected joints. It is instead
+    // allocated from an arena that grows geometrically, and is released once parsing ends.
+    std::pmr::monotonic_buffer_resource scratch;
+    BVHDocument layout(&scratch);
+    DocumentBuilder builder(result);
+    return VisitContents(contents, size, layout, selection, builder);
+}
 
-    if (!cursor) {
+bool ParseBVH(char const* contents, size_t size, BVHVisitor& visitor, BVHJointSelection const& selection)
+{
+    if (IsCompressedBVHContents(contents, size)) {
+        std::unique_ptr<BVHChunkReader> reader = OpenBVHChunkReader(contents, size);
+        if (!reader) {
+            return false;
+        }
+        BVHPipelinedChunkReader pipelinedReader(*reader);
+        return ParseBVH(pipelinedReader, visitor, selection);
+    }
+
+    std::pmr::monotonic_buffer_resource scratch;
+    BVHDocument layout(&scratch);
+    return VisitContents(contents, size, layout, selection, visitor);
+}
+
+bool ParseBVH(std::string const& filePath, BVHDocument& result, BVHJointSelection const& selection)
+{
+    // Files are read (and decompressed, if they are compressed) on a separate thread while
+    // they are being parsed, so that parsing starts as soon as the first chunk has been read,
+    // rather than once the whole file has been read
+    std::unique_ptr<BVHChunkReader> reader = OpenBVHChunkReader(filePath);
+    if (!reader) {
         return false;
     }
+    BVHPipelinedChunkReader pipelinedReader(*reader);
+    return ParseBVH(pipelinedReader, result, selection);
+}
 
-    cursor = ParseJointHierarchy(cursor, 0, result);
-    if (!cursor) {
+bool ParseBVH(std::string const& filePath, BVHVisitor& visitor, BVHJointSelection const& selection)
+{
+    std::unique_ptr<BVHChunkReader> reader = OpenBVHChunkReader(filePath);
+    if (!reader) {
         return false;
     }
+    BVHPipelinedChunkReader pipelinedReader(*reader);
+    return ParseBVH(pipelinedReader, visitor, selection);
+}
 
-    cursor = ParseMotion(cursor, result);
-    if (!cursor) {
+void ParseBVHFiles(std::vector<std::string> const& filePaths, BVHFileCallback const& callback, BVHJointSelection const& selection, size_t maxThreads)
+{
+    size_t const numThreads = std::min(filePaths.size(), maxThreads > 0 ? maxThreads : std::max<size_t>(1, std::thread::hardware_concurrency()));
+
+    // Each thread claims the next unparsed file until none remain, so that threads given
+    // shorter files go on to parse more of them
+    std::atomic<size_t> nextFile { 0 };
+    auto parseFiles = [&]() {
+        for (size_t i = nextFile++; i < filePaths.size(); i = nextFile++) {
+            BVHDocument document;
+            bool const parsed = ParseBVH(filePaths[i], document, selection);
+            callback(i, parsed, document);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; ++i) {
+        threads.emplace_back(parseFiles);
+    }
+    parseFiles();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+bool SelectBVHJoints(BVHDocument& document, BVHJointSelection const& selection)
+{
+    std::vector<int> jointMap;
+    if (!ResolveJointSelection(document, selection, jointMap)) {
         return false;
     }
+    if (jointMap.empty()) {
+        return true;
+    }
+
+    size_t const numJoints = jointMap.size();
+    size_t const numSelectedJoints = CountSelectedJoints(document, jointMap);
+    size_t const numFrames = numJoints > 0 ? document.m_FrameTransforms.size() / numJoints : 0;
+    std::pmr::vector<BVHTransform> frameTransforms(numFrames * numSelectedJoints, document.m_FrameTransforms.get_allocator());
+    for (size_t frame = 0; frame < numFrames; ++frame) {
+        for (size_t j = 0; j < numJoints; ++j) {
+            if (jointMap[j] >= 0) {
+                frameTransforms[frame * numSelectedJoints + jointMap[j]] = document.m_FrameTransforms[frame * numJoints + j];
+            }
+        }
+    }
+    document.m_FrameTransforms.swap(frameTransforms);
+    RemoveUnselectedJoints(document, jointMap);
     return true;
 }
 
-bool ParseBVH(std::string const& filePath, BVHDocument& result)
+void SelectBVHFrames(BVHDocument& document, size_t firstFrame, size_t numFrames)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    size_t const numFileFrames = numJoints > 0 ? document.m_FrameTransforms.size() / numJoints : 0;
+    firstFrame = std::min(firstFrame, numFileFrames);
+    numFrames = std::min(numFrames, numFileFrames - firstFrame);
+    std::pmr::vector<BVHTransform> frameTransforms(document.m_FrameTransforms.begin() + firstFrame * numJoints,
+        document.m_FrameTransforms.begin() + (firstFrame + numFrames) * numJoints, document.m_FrameTransforms.get_allocator());
+    document.m_FrameTransforms.swap(frameTransforms);
+}
+
+uint64_t HashBVHHierarchy(BVHDocument const& document)
 {
-    std::ifstream stream(filePath, std::ios::in | std::ios::binary);
-    return ParseBVH(stream, result);
+    auto mix = [](uint64_t hash, uint64_t value) {
+        hash = (hash ^ value) * 0x9e3779b97f4a7c15ull;
+        return hash ^ (hash >> 29);
+    };
+
+    // Names are hashed along with their length, so that adjacent names cannot run into each other
+    uint64_t hash = mix(0xcbf29ce484222325ull, document.m_JointNames.size());
+    for (size_t jointIndex = 0; jointIndex < document.m_JointNames.size(); ++jointIndex) {
+        std::pmr::string const& name = document.m_JointNames[jointIndex];
+        hash = mix(hash, name.size());
+        for (char c : name) {
+            hash = mix(hash, static_cast<unsigned char>(c));
+        }
+        hash = mix(hash, static_cast<uint64_t>(static_cast<int64_t>(document.m_JointParents[jointIndex])));
+        for (double component : document.m_JointOffsets[jointIndex].m_Translation) {
+            uint64_t bits;
+            std::memcpy(&bits, &component, sizeof(bits));
+            hash = mix(hash, bits);
+        }
+    }
+    return hash;
 }
-} // namespace usdBVHAnimPlugin
\ No newline at end of file
+} // namespace usdBVHAnimPlugin
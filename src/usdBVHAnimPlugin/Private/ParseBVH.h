@@ -1,6 +1,9 @@
 #pragma once
 #include <cstdint>
+#include <functional>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace usdBVHAnimPlugin {
@@ -48,26 +51,50 @@ struct BVHTransform {
 };
 
 //! A structure representing an entire BVH document
+//!
+//! All of the storage owned by a `BVHDocument`, including that of joint names too long for the
+//! small string optimisation, is allocated from a `std::pmr::memory_resource`, which defaults to
+//! `std::pmr::get_default_resource()`, but which can be given on construction (e.g. to parse into a
+//! `std::pmr::monotonic_buffer_resource` arena). When parsing, every array in the document is sized
+//! exactly once, so each array makes a single allocation from the resource. The only exception is
+//! the frame storage of contents read from a `BVHChunkReader` whose size is unknown (e.g. that of a
+//! compressed file), which grows geometrically as more contents are read.
 struct BVHDocument {
     //! A parent index value used for root-level bones, which do not have parents.
     static constexpr int c_RootParentIndex = -1;
+
+    //! Construct an empty document whose storage is allocated from the default memory resource.
+    BVHDocument() = default;
+
+    //! Construct an empty document whose storage is allocated from the given memory resource.
+    //! The memory resource must outlive the document.
+    explicit BVHDocument(std::pmr::memory_resource* resource)
+        : m_JointNames(resource)
+        , m_JointParents(resource)
+        , m_JointOffsets(resource)
+        , m_JointNumChannels(resource)
+        , m_JointChannels(resource)
+        , m_FrameTransforms(resource)
+    {
+    }
+
     //! Contains the joint names for each joint in the BVH skeleton
-    std::vector<std::string> m_JointNames;
+    std::pmr::vector<std::pmr::string> m_JointNames;
     //! Contains the joint parent indices for each joint in the BVH skeleton
-    std::vector<int> m_JointParents;
+    std::pmr::vector<int> m_JointParents;
     //! Contains the translational joint offsets for each joint the BVH skeleton
-    std::vector<BVHOffset> m_JointOffsets;
+    std::pmr::vector<BVHOffset> m_JointOffsets;
     //! Contains the number of animated channels for each joint in the animation
-    std::vector<unsigned int> m_JointNumChannels;
+    std::pmr::vector<unsigned int> m_JointNumChannels;
     //! Contains a bit-packed array of `BVHChannel` values for each joint in the
     //! animation.
     //!
     //! Each element contains 3-bits for each of the joint's channels (given by
     //! `m_JointNumChannels`), and the value of each 3-bits is one of the `BVHChannel`
     //! enumerated values.
-    std::vector<uint32_t> m_JointChannels;
+    std::pmr::vector<uint32_t> m_JointChannels;
     //! The amount of time in seconds between each frame of the animation.
-    double m_FrameTime;
+    double m_FrameTime = 0.0;
     //! The animated joint transforms packed into a single vector, ordered first by
     //! frame number, then by joint, then by joint channel (given by `m_JointChannels`).
     //!
@@ -79,15 +106,209 @@ struct BVHDocument {
     //! * Frame 1 - Joint 0 - Channel 1
     //! * Frame 1 - Joint 1 - Channel 0
     //! * ...
-    std::vector<BVHTransform> m_FrameTransforms;
+    std::pmr::vector<BVHTransform> m_FrameTransforms;
+};
+
+//! A selection of the joints of a BVH file. Selecting a joint also selects each of its
+//! ancestors, as they are required to place it, while the channels of every other joint
+//! are skipped over without being converted. An empty selection selects every joint.
+struct BVHJointSelection {
+    //! The names of individual joints to select
+    std::vector<std::string> m_Joints;
+    //! The names of joints to select along with all of their descendants
+    std::vector<std::string> m_SubtreeRoots;
+
+    //! Returns `true` if no joints have been selected, in which case every joint is selected.
+    bool IsEmpty() const
+    {
+        return m_Joints.empty() && m_SubtreeRoots.empty();
+    }
+};
+
+//! An interface for reading the contents of a BVH file incrementally, in chunks.
+class BVHChunkReader {
+public:
+    virtual ~BVHChunkReader() = default;
+
+    //! Read up to `capacity` bytes of contents into the given buffer, returning the number
+    //! of bytes that were read. Returns zero once the end of the contents has been reached,
+    //! or if an error has occurred.
+    virtual size_t Read(char* buffer, size_t capacity) = 0;
+
+    //! Returns `true` if an error has occurred while reading, or `false` otherwise.
+    virtual bool Failed() const = 0;
+
+    //! Returns the total number of bytes of contents that the reader produces, if it is known before
+    //! they are read (e.g. for an uncompressed file), or `SIZE_MAX` otherwise.
+    virtual size_t GetSize() const
+    {
+        return SIZE_MAX;
+    }
+};
+
+//! An interface for visiting the contents of a BVH file as it is parsed by the overloads of
+//! `ParseBVH` that are given a `BVHVisitor`, which never accumulate the frames of the file, so
+//! that memory use is independent of the length of the take.
+//!
+//! The selected joints of the hierarchy are reported first, in the order in which they are stored
+//! in a `BVHDocument` (so every parent is reported before its children), followed by the motion
+//! header, and then each frame in order. Returning `false` from any event stops parsing, in which
+//! case `ParseBVH` returns `false`.
+class BVHVisitor {
+public:
+    virtual ~BVHVisitor() = default;
+
+    //! Called before any joint is reported, with the number of joints that will be reported.
+    virtual bool OnHierarchy(size_t /*numJoints*/)
+    {
+        return true;
+    }
+
+    //! Called for each selected joint, with its index among the reported joints, its name (which is
+    //! only valid for the duration of the call), the index of its parent (or
+    //! `BVHDocument::c_RootParentIndex`), its offset, and its channels, as they are stored in a
+    //! `BVHDocument`.
+    virtual bool OnJoint(size_t /*jointIndex*/, std::string_view /*name*/, int /*parentIndex*/, BVHOffset const& /*offset*/, unsigned int /*numChannels*/, uint32_t /*channels*/)
+    {
+        return true;
+    }
+
+    //! Called once every joint has been reported, with the number of frames that will be reported
+    //! and the amount of time in seconds between each frame.
+    virtual bool OnMotion(size_t /*numFrames*/, double /*frameTime*/)
+    {
+        return true;
+    }
+
+    //! Called for each frame in order, with the transform of every reported joint in the frame.
+    //! The transforms are only valid for the duration of the call.
+    virtual bool OnFrame(size_t /*frameIndex*/, BVHTransform const* /*transforms*/)
+    {
+        return true;
+    }
+
+    //! Called after `OnMotion` by the overload of `ParseBVH` that parses uncompressed contents held
+    //! in memory, and returns storage for the transforms of every frame, into which frames are then
+    //! decoded directly (e.g. the frame transforms of a `BVHDocument`), or null to have frames
+    //! decoded a batch at a time into a buffer owned by the parser, which is the default.
+    virtual BVHTransform* GetFrameStorage(size_t /*numFrames*/)
+    {
+        return nullptr;
+    }
 };
 
 //! Parse a BVH file at the given file path, and store the result in the given
 //! `BVHDocument` structure. Returns `true` on success, or `false` on failure.
-bool ParseBVH(std::string const& filePath, BVHDocument& result);
+//!
+//! Each overload of `ParseBVH` is re-entrant, and shares no mutable state between threads,
+//! so any number of files may be parsed concurrently into distinct documents.
+//!
+//! If a non-empty joint selection is given, the document only contains the selected joints
+//! (see `BVHJointSelection`), and parsing fails if any selected joint does not exist.
+//!
+//! Files are read in large sequential chunks on a separate thread while they are being parsed
+//! (see `BVHPipelinedChunkReader`), so that on slow file systems (e.g. NFS) reading overlaps
+//! with parsing. Files compressed with gzip (`.bvh.gz`) or Zstandard (`.bvh.zst`) are also
+//! decompressed on that thread, when support for them has been compiled in (see
+//! `IsCompressedBVHPath`).
+bool ParseBVH(std::string const& filePath, BVHDocument& result, BVHJointSelection const& selection = {});
 
 //! Parse a BVH file whose contents is in the given stream, and store the result
-//! in the given `BVHDocument` structure. Returns `true` on success, or `false`
-//! on failure.
-bool ParseBVH(std::istream& stream, BVHDocument& result);
+//! in the given `BVHDocument` structure, containing only the selected joints.
+//! Returns `true` on success, or `false` on failure.
+bool ParseBVH(std::istream& stream, BVHDocument& result, BVHJointSelection const& selection = {});
+
+//! Parse a BVH file whose contents is held in memory, and store the result in the given
+//! `BVHDocument` structure, containing only the selected joints. The contents are parsed in
+//! place, without being copied, and need not be NUL-terminated. Contents compressed with gzip or
+//! Zstandard are decompressed while they are being parsed (see `IsCompressedBVHContents`). Parsing
+//! fails before any frame storage is allocated if the file declares more frames than the rest of
+//! its contents could hold. Returns `true` on success, or `false` on failure.
+bool ParseBVH(char const* contents, size_t size, BVHDocument& result, BVHJointSelection const& selection = {});
+
+//! Parse a BVH file whose contents is held in memory, reporting its selected joints and each of
+//! its frames to the given `BVHVisitor`, without accumulating the frames. The contents are parsed
+//! in place, and frames are decoded a batch at a time into a buffer of a fixed size, so memory use
+//! does not grow with the number of frames. Every overload of `ParseBVH` that builds a
+//! `BVHDocument` from contents held in memory is a client of this one. Returns `true` on success,
+//! or `false` on failure or if the visitor stops parsing.
+bool ParseBVH(char const* contents, size_t size, BVHVisitor& visitor, BVHJointSelection const& selection = {});
+
+//! Parse a BVH file whose contents is read incrementally from the given `BVHChunkReader`,
+//! reporting its selected joints and each of its frames to the given `BVHVisitor`, as with the
+//! overload of `ParseBVH` that is given contents held in memory.
+bool ParseBVH(BVHChunkReader& reader, BVHVisitor& visitor, BVHJointSelection const& selection = {});
+
+//! Parse a BVH file at the given file path, reporting its selected joints and each of its frames
+//! to the given `BVHVisitor`, reading (and decompressing) the file as the overload of `ParseBVH`
+//! that is given a file path does.
+bool ParseBVH(std::string const& filePath, BVHVisitor& visitor, BVHJointSelection const& selection = {});
+
+//! Parse a BVH file whose contents is read incrementally from the given `BVHChunkReader`,
+//! and store the result in the given `BVHDocument` structure. Frames are parsed as soon
+//! as they have been read, so the entire contents are never held in memory at once. If the
+//! reader knows the size of its contents, the number of frames the file declares is checked
+//! against it, and frame storage is sized once. Otherwise, frame storage grows with the frames
+//! the contents read so far could hold, rather than being sized for the declared frames.
+//! Only the selected joints are stored. Returns `true` on success, or `false` on failure.
+bool ParseBVH(BVHChunkReader& reader, BVHDocument& result, BVHJointSelection const& selection = {});
+
+//! A function that is given each chunk of frames parsed by `ParseBVHFrameChunks`, along with the
+//! index of the first frame in the chunk and the number of frames in the chunk. Returning `false`
+//! stops parsing.
+using BVHFrameChunkCallback = std::function<bool(BVHDocument const& document, size_t firstFrame, size_t numFrames)>;
+
+//! Parse a BVH file whose contents is read incrementally from the given `BVHChunkReader`,
+//! handing each consecutive chunk of at most `maxFramesPerChunk` frames to the given callback
+//! as soon as it has been parsed. The joint hierarchy of the given `BVHDocument` is complete
+//! (and contains only the selected joints) before the first chunk, while its frame transforms
+//! only ever hold the frames of the current chunk. Memory use is therefore proportional to the
+//! chunk size and the skeleton, rather than to the number of frames in the file. Returns `true`
+//! on success, or `false` on failure or if the callback returns `false`.
+bool ParseBVHFrameChunks(BVHChunkReader& reader, BVHDocument& result, size_t maxFramesPerChunk, BVHFrameChunkCallback const& callback, BVHJointSelection const& selection = {});
+
+//! Parse the frames `[firstFrame, firstFrame + numFrames)` of a BVH file whose contents is read
+//! incrementally from the given `BVHChunkReader`, and store them in the given `BVHDocument`
+//! structure, along with the whole joint hierarchy (containing only the selected joints). The
+//! values of frames before the range are skipped over without being converted, and reading stops
+//! once the last frame of the range has been parsed. A range that extends beyond the frames of
+//! the file is clamped to them. Returns `true` on success, or `false` on failure.
+//!
+//! The frames before the range must still be read. To seek straight to the range instead, see
+//! `BVHSeekIndex`.
+bool ParseBVHFrameRange(BVHChunkReader& reader, size_t firstFrame, size_t numFrames, BVHDocument& result, BVHJointSelection const& selection = {});
+
+//! Parse only the header of a BVH file whose contents is held in memory, i.e. its HIERARCHY
+//! section, and its MOTION section up to and including the frame time, storing every joint and
+//! the frame time in the given `BVHDocument` structure, without any frames. Stores the number of
+//! frames declared by the header in `numFrames`, and the offset of the first value of the first
+//! frame (just beyond the header and the whitespace that follows it) in `headerSize`. Returns
+//! `true` on success, or `false` on failure.
+bool ParseBVHHeader(char const* contents, size_t size, BVHDocument& result, size_t& numFrames, size_t& headerSize);
+
+//! A function that is given the result of parsing each file with `ParseBVHFiles`, along with
+//! the index of the file in the given list of file paths, and whether it was parsed successfully.
+using BVHFileCallback = std::function<void(size_t fileIndex, bool parsed, BVHDocument& document)>;
+
+//! Parse each of the given BVH files into its own document, on up to `maxThreads` threads
+//! (or one thread per hardware thread if `maxThreads` is zero), handing each document to the
+//! given callback as soon as it has been parsed. The callback is called on the parsing threads,
+//! and may be called concurrently for different files, but may take ownership of the document
+//! (e.g. by moving from it). Returns once every file has been handed to the callback.
+void ParseBVHFiles(std::vector<std::string> const& filePaths, BVHFileCallback const& callback, BVHJointSelection const& selection = {}, size_t maxThreads = 0);
+
+//! Remove every joint that is not selected by the given selection from an already parsed
+//! document, leaving it as if it had been parsed with the same selection. Returns `false`,
+//! leaving the document unchanged, if any selected joint does not exist.
+bool SelectBVHJoints(BVHDocument& document, BVHJointSelection const& selection);
+
+//! Remove every frame outside of `[firstFrame, firstFrame + numFrames)` from an already parsed
+//! document, leaving it as if only that range had been parsed with `ParseBVHFrameRange`. A range
+//! that extends beyond the frames of the document is clamped to them.
+void SelectBVHFrames(BVHDocument& document, size_t firstFrame, size_t numFrames);
+
+//! Returns a hash of the skeleton of the given document, i.e. the name, parent and offset of
+//! each joint. The channels and motion data are not hashed, so clips of the same skeleton hash
+//! to the same value regardless of their animation.
+uint64_t HashBVHHierarchy(BVHDocument const& document);
 } // namespace usdBVHAnimPlugin
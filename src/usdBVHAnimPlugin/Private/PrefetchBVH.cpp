@@ -0,0 +1,279 @@
+#include "PrefetchBVH.h"
+#include <pxr/base/work/dispatcher.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+namespace usdBVHAnimPlugin {
+namespace {
+    //! The state of a single file held in the document store
+    enum class EntryState {
+        //! The file is waiting to be parsed by a task
+        Queued,
+        //! The file is being parsed by a task, or by a thread that took it while it was queued
+        Parsing,
+        //! The file has been parsed, and its result is available
+        Done
+    };
+
+    //! The size and modification time of a file, with which a document parsed from the file is
+    //! found to be stale if the file has since been rewritten
+    struct FileStamp {
+        uintmax_t m_Size = 0;
+        std::filesystem::file_time_type m_WriteTime;
+
+        bool operator==(FileStamp const& other) const
+        {
+            return m_Size == other.m_Size && m_WriteTime == other.m_WriteTime;
+        }
+    };
+
+    //! Get the stamp of the file at the given path, returning `false` if it cannot be read
+    bool GetFileStamp(std::string const& filePath, FileStamp& stamp)
+    {
+        std::error_code error;
+        stamp.m_Size = std::filesystem::file_size(filePath, error);
+        if (error) {
+            return false;
+        }
+        stamp.m_WriteTime = std::filesystem::last_write_time(filePath, error);
+        return !error;
+    }
+
+    //! Returns the key of the given file path in the document store, which is its canonical path,
+    //! so that paths that differ only in normalisation or symbolic links share a single entry
+    std::string GetStoreKey(std::string const& filePath)
+    {
+        std::error_code error;
+        std::filesystem::path const canonicalPath = std::filesystem::weakly_canonical(filePath, error);
+        return error ? filePath : canonicalPath.string();
+    }
+
+    //! Returns the number of bytes held by the arrays of the given document
+    size_t GetDocumentSize(BVHDocument const& document)
+    {
+        size_t size = document.m_FrameTransforms.size() * sizeof(BVHTransform);
+        for (std::pmr::string const& name : document.m_JointNames) {
+            size += sizeof(name) + name.size();
+        }
+        return size + document.m_JointParents.size() * (sizeof(int) + sizeof(BVHOffset) + sizeof(unsigned int) + sizeof(uint32_t));
+    }
+
+    //! A single file held in the document store
+    struct Entry {
+        EntryState m_State = EntryState::Queued;
+        bool m_Success = false;
+        //! The stamp of the file when it began to be parsed
+        FileStamp m_Stamp;
+        //! The time at which the file finished being parsed
+        std::chrono::steady_clock::time_point m_DoneTime;
+        size_t m_NumBytes = 0;
+        BVHDocument m_Document;
+    };
+
+    //! The process-wide document store. Each queued file is parsed by a task of a work dispatcher,
+    //! which the store waits for when it is destroyed at exit, after which queued tasks that have
+    //! not yet started return without parsing their files.
+    class DocumentStore {
+    public:
+        std::mutex m_Mutex;
+        std::condition_variable m_EntryDone;
+        std::unordered_map<std::string, std::shared_ptr<Entry>> m_Entries;
+        BVHPrefetchOptions m_Options;
+
+        //! The number of entries in `m_Entries`, which may be read without holding the lock
+        std::atomic<size_t> m_NumEntries { 0 };
+
+        ~DocumentStore()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Exiting = true;
+            }
+            m_Dispatcher.Wait();
+        }
+
+        static DocumentStore& Get()
+        {
+            static DocumentStore s_Store;
+            return s_Store;
+        }
+
+        //! Queue the given entry to be parsed by a task. Must be called with the lock held.
+        void Queue(std::string const& key, std::shared_ptr<Entry> const& entry)
+        {
+            m_Dispatcher.Run([this, key, entry]() { ParseEntry(key, entry); });
+        }
+
+        //! Remove the given entry from the store. Must be called with the lock held.
+        void Erase(std::unordered_map<std::string, std::shared_ptr<Entry>>::iterator it)
+        {
+            m_NumDoneBytes -= it->second->m_NumBytes;
+            it->second->m_NumBytes = 0;
+            m_Entries.erase(it);
+            m_NumEntries = m_Entries.size();
+        }
+
+        //! Discard completed entries that are older than the maximum age, and then the oldest
+        //! completed entries until the store is within its maximum size. Must be called with the
+        //! lock held.
+        void Evict()
+        {
+            auto const expiryTime = std::chrono::steady_clock::now() - m_Options.m_MaxAge;
+            while (!m_DoneOrder.empty()) {
+                auto const& [key, entry] = m_DoneOrder.front();
+                auto const it = m_Entries.find(key);
+                bool const held = it != m_Entries.end() && it->second == entry;
+                if (held && entry->m_DoneTime > expiryTime && m_NumDoneBytes <= m_Options.m_MaxBytes) {
+                    break;
+                }
+                if (held) {
+                    Erase(it);
+                }
+                m_DoneOrder.pop_front();
+            }
+        }
+
+        //! Parse the given queued entry on the calling thread, given the held lock, which is
+        //! released while the file is parsed
+        void ParseQueuedEntry(std::string const& key, std::shared_ptr<Entry> const& entry, std::unique_lock<std::mutex>& lock)
+        {
+            entry->m_State = EntryState::Parsing;
+
+            // A file that changes while it is being parsed may have been read partially rewritten
+            lock.unlock();
+            FileStamp stamp;
+            bool success = GetFileStamp(key, stamp) && ParseBVH(key, entry->m_Document);
+            FileStamp parsedStamp;
+            success = success && GetFileStamp(key, parsedStamp) && parsedStamp == stamp;
+            lock.lock();
+
+            entry->m_Success = success;
+            entry->m_Stamp = stamp;
+            entry->m_DoneTime = std::chrono::steady_clock::now();
+            entry->m_State = EntryState::Done;
+            m_EntryDone.notify_all();
+
+            // Only entries that are still held by the store count towards its size
+            auto const it = m_Entries.find(key);
+            if (it != m_Entries.end() && it->second == entry) {
+                entry->m_NumBytes = GetDocumentSize(entry->m_Document);
+                m_NumDoneBytes += entry->m_NumBytes;
+                m_DoneOrder.emplace_back(key, entry);
+            }
+            Evict();
+        }
+
+    private:
+        void ParseEntry(std::string const& key, std::shared_ptr<Entry> const& entry)
+        {
+            // Entries that have since been taken or parsed by another thread are skipped
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            if (entry->m_State == EntryState::Queued && !m_Exiting) {
+                ParseQueuedEntry(key, entry, lock);
+            }
+        }
+
+        //! The completed entries, in the order in which they were completed, some of which may
+        //! since have been taken from the store
+        std::deque<std::pair<std::string, std::shared_ptr<Entry>>> m_DoneOrder;
+        //! The total size of the completed entries held in the store
+        size_t m_NumDoneBytes = 0;
+        bool m_Exiting = false;
+        pxr::WorkDispatcher m_Dispatcher;
+    };
+}
+
+void PrefetchBVH(std::vector<std::string> const& filePaths, BVHPrefetchOptions const& options)
+{
+    DocumentStore& store = DocumentStore::Get();
+    std::lock_guard<std::mutex> lock(store.m_Mutex);
+    store.m_Options = options;
+    store.Evict();
+    for (std::string const& filePath : filePaths) {
+        std::string key = GetStoreKey(filePath);
+        auto& entry = store.m_Entries[key];
+        if (!entry) {
+            entry = std::make_shared<Entry>();
+            store.Queue(key, entry);
+        }
+    }
+    store.m_NumEntries = store.m_Entries.size();
+}
+
+bool TakePrefetchedBVH(std::string const& filePath, BVHDocument& result)
+{
+    DocumentStore& store = DocumentStore::Get();
+    if (store.m_NumEntries == 0) {
+        return false;
+    }
+
+    std::string const key = GetStoreKey(filePath);
+    std::unique_lock<std::mutex> lock(store.m_Mutex);
+    store.Evict();
+    auto it = store.m_Entries.find(key);
+    if (it == store.m_Entries.end()) {
+        return false;
+    }
+
+    std::shared_ptr<Entry> entry = it->second;
+    store.Erase(it);
+
+    // If no task has started on this file yet, there is no benefit in waiting for one
+    if (entry->m_State == EntryState::Queued) {
+        entry->m_State = EntryState::Parsing;
+        lock.unlock();
+        return ParseBVH(key, result);
+    }
+
+    store.m_EntryDone.wait(lock, [&]() { return entry->m_State == EntryState::Done; });
+    lock.unlock();
+
+    // A file that has been rewritten since it was parsed is left to be parsed again
+    FileStamp stamp;
+    if (!entry->m_Success || !GetFileStamp(key, stamp) || !(stamp == entry->m_Stamp)) {
+        return false;
+    }
+    result = std::move(entry->m_Document);
+    return true;
+}
+
+void WaitForPrefetchedBVH()
+{
+    DocumentStore& store = DocumentStore::Get();
+    std::unique_lock<std::mutex> lock(store.m_Mutex);
+    for (;;) {
+        // Entries are looked up again after each parse, as the lock is released while parsing
+        auto const queued = std::find_if(store.m_Entries.begin(), store.m_Entries.end(), [](auto const& entry) { return entry.second->m_State == EntryState::Queued; });
+        if (queued == store.m_Entries.end()) {
+            break;
+        }
+        std::string const key = queued->first;
+        std::shared_ptr<Entry> const entry = queued->second;
+        store.ParseQueuedEntry(key, entry, lock);
+    }
+    store.m_EntryDone.wait(lock, [&]() {
+        return std::none_of(store.m_Entries.begin(), store.m_Entries.end(), [](auto const& entry) { return entry.second->m_State == EntryState::Parsing; });
+    });
+}
+
+void ClearPrefetchedBVH()
+{
+    DocumentStore& store = DocumentStore::Get();
+    std::lock_guard<std::mutex> lock(store.m_Mutex);
+    for (auto it = store.m_Entries.begin(); it != store.m_Entries.end();) {
+        if (it->second->m_State == EntryState::Done) {
+            store.Erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,49 @@
+#pragma once
+#include "ParseBVH.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! Options controlling how long prefetched documents are held in the process-wide document store
+struct BVHPrefetchOptions {
+    //! The maximum total size in bytes of the parsed documents held in the document store, beyond
+    //! which the documents that were parsed earliest are discarded.
+    size_t m_MaxBytes = size_t(1) << 30;
+    //! The time for which a parsed document is held in the document store without being taken,
+    //! after which it is discarded.
+    std::chrono::seconds m_MaxAge = std::chrono::seconds(300);
+};
+
+//! Begin parsing each of the given BVH files in the background, as tasks of the USD work
+//! dispatcher (so that they honour `WorkSetConcurrencyLimit`), storing the resulting documents
+//! in a process-wide document store. This function returns immediately. Files that are already
+//! in the document store are not parsed again. The given options replace those of earlier calls.
+//!
+//! Files are held in the document store by their canonical path (see `std::filesystem::weakly_canonical`),
+//! so that `TakePrefetchedBVH` finds them by any path that refers to the same file, such as the
+//! resolved path given to `BvhFileFormat::Read`.
+void PrefetchBVH(std::vector<std::string> const& filePaths, BVHPrefetchOptions const& options = {});
+
+//! Take the document for the given BVH file from the process-wide document store, storing it
+//! in `result`. If the file is still being parsed in the background, this function waits for
+//! it to finish. If the file has been queued but not yet started, it is parsed on the calling
+//! thread instead.
+//!
+//! Returns `true` if the file had been prefetched and was successfully parsed, or `false`
+//! otherwise, including when the size or modification time of the file has changed since it was
+//! parsed, as the document would then be stale. On return, the document store no longer holds the
+//! file. While the document store is empty, this returns `false` without taking any lock, so
+//! concurrent reads of files that were never prefetched do not contend with each other.
+bool TakePrefetchedBVH(std::string const& filePath, BVHDocument& result);
+
+//! Wait for every file held in the process-wide document store to finish being parsed. Files that
+//! no task has started on yet are parsed on the calling thread, so this does not depend on the
+//! work dispatcher having threads to spare (e.g. under a concurrency limit of one).
+void WaitForPrefetchedBVH();
+
+//! Discard every completed document held in the process-wide document store, such as those
+//! that were prefetched but never taken.
+void ClearPrefetchedBVH();
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,104 @@
+#include "ResampleBVH.h"
+#include <cmath>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+void InterpolateBVHTransforms(BVHTransform const* a, BVHTransform const* b, size_t count, double alpha, BVHTransform* result)
+{
+    // Above this cosine, the rotations are close enough that slerp degenerates to lerp
+    double constexpr c_SlerpThreshold = 0.9995;
+
+    // Joints are processed in fixed-size blocks. The first pass computes the blend
+    // weights of each joint's rotation, so that the second pass is a branch-free
+    // weighted sum over every joint in the block.
+    size_t constexpr c_BlockSize = 32;
+    double weightsA[c_BlockSize];
+    double weightsB[c_BlockSize];
+
+    for (size_t blockBegin = 0; blockBegin < count; blockBegin += c_BlockSize) {
+        size_t const blockSize = count - blockBegin < c_BlockSize ? count - blockBegin : c_BlockSize;
+        BVHTransform const* blockA = a + blockBegin;
+        BVHTransform const* blockB = b + blockBegin;
+        BVHTransform* blockResult = result + blockBegin;
+
+        for (size_t j = 0; j < blockSize; ++j) {
+            double const* qa = blockA[j].m_RotationQuat;
+            double const* qb = blockB[j].m_RotationQuat;
+            double cosTheta = qa[0] * qb[0] + qa[1] * qb[1] + qa[2] * qb[2] + qa[3] * qb[3];
+            double const sign = cosTheta < 0.0 ? -1.0 : 1.0;
+            cosTheta *= sign;
+
+            double weightA = 1.0 - alpha;
+            double weightB = alpha;
+            if (cosTheta < c_SlerpThreshold) {
+                double const theta = std::acos(cosTheta);
+                double const invSinTheta = 1.0 / std::sin(theta);
+                weightA = std::sin((1.0 - alpha) * theta) * invSinTheta;
+                weightB = std::sin(alpha * theta) * invSinTheta;
+            }
+            weightsA[j] = weightA;
+            weightsB[j] = weightB * sign;
+        }
+
+        for (size_t j = 0; j < blockSize; ++j) {
+            double quat[4];
+            for (size_t c = 0; c < 4; ++c) {
+                quat[c] = blockA[j].m_RotationQuat[c] * weightsA[j] + blockB[j].m_RotationQuat[c] * weightsB[j];
+            }
+            double const length = std::sqrt(quat[0] * quat[0] + quat[1] * quat[1] + quat[2] * quat[2] + quat[3] * quat[3]);
+            double const invLength = length > 0.0 ? 1.0 / length : 0.0;
+
+            double translation[3];
+            for (size_t c = 0; c < 3; ++c) {
+                translation[c] = blockA[j].m_Translation[c] + (blockB[j].m_Translation[c] - blockA[j].m_Translation[c]) * alpha;
+            }
+            for (size_t c = 0; c < 4; ++c) {
+                blockResult[j].m_RotationQuat[c] = quat[c] * invLength;
+            }
+            for (size_t c = 0; c < 3; ++c) {
+                blockResult[j].m_Translation[c] = translation[c];
+            }
+        }
+    }
+}
+
+bool ResampleBVH(BVHDocument& document, double framesPerSecond)
+{
+    if (!(framesPerSecond > 0.0) || !(document.m_FrameTime > 0.0)) {
+        return false;
+    }
+
+    size_t const numJoints = document.m_JointNames.size();
+    if (numJoints == 0 || document.m_FrameTransforms.empty()) {
+        document.m_FrameTime = 1.0 / framesPerSecond;
+        return true;
+    }
+
+    // Compute the number of destination frames that fit within the source animation,
+    // allowing for a small amount of rounding error in the source frame time
+    double constexpr c_Epsilon = 1e-6;
+    size_t const numSourceFrames = document.m_FrameTransforms.size() / numJoints;
+    double const duration = static_cast<double>(numSourceFrames - 1) * document.m_FrameTime;
+    size_t const numFrames = static_cast<size_t>(std::floor(duration * framesPerSecond + c_Epsilon)) + 1;
+
+    std::pmr::vector<BVHTransform> frameTransforms(numFrames * numJoints, document.m_FrameTransforms.get_allocator());
+    for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
+        double sourceFrame = static_cast<double>(frameIndex) / (framesPerSecond * document.m_FrameTime);
+        size_t sourceIndex = static_cast<size_t>(std::floor(sourceFrame + c_Epsilon));
+        double alpha = sourceFrame - static_cast<double>(sourceIndex);
+        if (sourceIndex + 1 >= numSourceFrames) {
+            sourceIndex = numSourceFrames - 1;
+            alpha = 0.0;
+        }
+        alpha = alpha < 0.0 ? 0.0 : alpha;
+
+        BVHTransform const* a = &document.m_FrameTransforms[sourceIndex * numJoints];
+        BVHTransform const* b = alpha > 0.0 ? a + numJoints : a;
+        InterpolateBVHTransforms(a, b, numJoints, alpha, &frameTransforms[frameIndex * numJoints]);
+    }
+
+    document.m_FrameTransforms.swap(frameTransforms);
+    document.m_FrameTime = 1.0 / framesPerSecond;
+    return true;
+}
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,26 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+
+namespace usdBVHAnimPlugin {
+
+//! Interpolate between two arrays of joint transforms, storing `count` interpolated
+//! transforms in `result`. Translations are linearly interpolated, and rotations are
+//! spherically interpolated along the shortest path (i.e. the second rotation is negated
+//! when it lies in the opposite hemisphere to the first) and then re-normalised.
+//!
+//! The given `alpha` value is expected to be in the range `[0, 1]`, where `0` results in
+//! the transforms of `a` and `1` results in the transforms of `b`. The `result` array
+//! may alias either `a` or `b`.
+void InterpolateBVHTransforms(BVHTransform const* a, BVHTransform const* b, size_t count, double alpha, BVHTransform* result);
+
+//! Resample the animation in the given `BVHDocument` in-place, such that its frames are
+//! spaced at the given number of frames per second. The first frame of the animation is
+//! preserved, and subsequent frames are interpolated from the source frames using
+//! `InterpolateBVHTransforms`. The resampled animation never extends beyond the last
+//! source frame.
+//!
+//! Returns `true` on success, or `false` if either the requested frame rate or the
+//! frame time of the document is not a positive value.
+bool ResampleBVH(BVHDocument& document, double framesPerSecond);
+} // namespace usdBVHAnimPlugin
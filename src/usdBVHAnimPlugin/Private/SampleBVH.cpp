@@ -0,0 +1,104 @@
+#include "SampleBVH.h"
+#include "ResampleBVH.h"
+#include <cmath>
+#include <vector>
+
+static void ComposeBVHTransform(double const parentQuat[4], double const parentTranslation[3], double quat[4], double translation[3])
+{
+    // Rotate the local translation into the parent's space (v' = v + 2w(q x v) + 2q x (q x v))
+    double const cross[3] = {
+        2.0 * (parentQuat[1] * translation[2] - parentQuat[2] * translation[1]),
+        2.0 * (parentQuat[2] * translation[0] - parentQuat[0] * translation[2]),
+        2.0 * (parentQuat[0] * translation[1] - parentQuat[1] * translation[0])
+    };
+    double const rotated[3] = {
+        translation[0] + parentQuat[3] * cross[0] + (parentQuat[1] * cross[2] - parentQuat[2] * cross[1]),
+        translation[1] + parentQuat[3] * cross[1] + (parentQuat[2] * cross[0] - parentQuat[0] * cross[2]),
+        translation[2] + parentQuat[3] * cross[2] + (parentQuat[0] * cross[1] - parentQuat[1] * cross[0])
+    };
+    translation[0] = parentTranslation[0] + rotated[0];
+    translation[1] = parentTranslation[1] + rotated[1];
+    translation[2] = parentTranslation[2] + rotated[2];
+
+    double const a[4] = { parentQuat[0], parentQuat[1], parentQuat[2], parentQuat[3] };
+    double const b[4] = { quat[0], quat[1], quat[2], quat[3] };
+    quat[0] = a[3] * b[0] + a[0] * b[3] + a[1] * b[2] - a[2] * b[1];
+    quat[1] = a[3] * b[1] - a[0] * b[2] + a[1] * b[3] + a[2] * b[0];
+    quat[2] = a[3] * b[2] + a[0] * b[1] - a[1] * b[0] + a[2] * b[3];
+    quat[3] = a[3] * b[3] - a[0] * b[0] - a[1] * b[1] - a[2] * b[2];
+}
+
+namespace usdBVHAnimPlugin {
+bool SampleBVHPose(BVHDocument const& document, double time, BVHPoseSpace space, BVHTransform* result)
+{
+    return SampleBVHPoses(document, &time, 1, space, result);
+}
+
+bool SampleBVHPoses(BVHDocument const& document, double const* times, size_t numTimes, BVHPoseSpace space, BVHTransform* result)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    if (numJoints == 0 || document.m_FrameTransforms.size() < numJoints) {
+        return false;
+    }
+
+    // Interpolate the local pose at each of the requested times
+    size_t const numFrames = document.m_FrameTransforms.size() / numJoints;
+    for (size_t timeIndex = 0; timeIndex < numTimes; ++timeIndex) {
+        double frame = document.m_FrameTime > 0.0 ? times[timeIndex] / document.m_FrameTime : 0.0;
+        frame = frame > 0.0 ? frame : 0.0;
+        size_t frameIndex = static_cast<size_t>(std::floor(frame));
+        double alpha = frame - static_cast<double>(frameIndex);
+        if (frameIndex + 1 >= numFrames) {
+            frameIndex = numFrames - 1;
+            alpha = 0.0;
+        }
+
+        BVHTransform const* a = &document.m_FrameTransforms[frameIndex * numJoints];
+        BVHTransform const* b = alpha > 0.0 ? a + numJoints : a;
+        InterpolateBVHTransforms(a, b, numJoints, alpha, result + timeIndex * numJoints);
+    }
+
+    if (space == BVHPoseSpace::World) {
+        ComputeBVHWorldPoses(document, result, numTimes);
+    }
+    return true;
+}
+
+void ComputeBVHWorldPoses(BVHDocument const& document, BVHTransform* poses, size_t numPoses)
+{
+    size_t const numJoints = document.m_JointNames.size();
+
+    // Order the joints by their depth in the hierarchy, so that every parent has been
+    // transformed into world space before any of its children
+    std::vector<size_t> depths(numJoints, 0);
+    size_t maxDepth = 0;
+    for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+        int const parentIndex = document.m_JointParents[jointIndex];
+        if (parentIndex != BVHDocument::c_RootParentIndex) {
+            depths[jointIndex] = depths[parentIndex] + 1;
+            maxDepth = depths[jointIndex] > maxDepth ? depths[jointIndex] : maxDepth;
+        }
+    }
+
+    std::vector<size_t> levelOrder;
+    levelOrder.reserve(numJoints);
+    for (size_t depth = 1; depth <= maxDepth; ++depth) {
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            if (depths[jointIndex] == depth) {
+                levelOrder.push_back(jointIndex);
+            }
+        }
+    }
+
+    // Root joints are already in world space, so only the remaining levels are composed.
+    // Each joint is evaluated for every pose before moving on to the next joint.
+    for (size_t jointIndex : levelOrder) {
+        size_t const parentIndex = static_cast<size_t>(document.m_JointParents[jointIndex]);
+        for (size_t poseIndex = 0; poseIndex < numPoses; ++poseIndex) {
+            BVHTransform const& parent = poses[poseIndex * numJoints + parentIndex];
+            BVHTransform& joint = poses[poseIndex * numJoints + jointIndex];
+            ComposeBVHTransform(parent.m_RotationQuat, parent.m_Translation, joint.m_RotationQuat, joint.m_Translation);
+        }
+    }
+}
+} // namespace usdBVHAnimPlugin
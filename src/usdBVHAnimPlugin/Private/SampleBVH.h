@@ -0,0 +1,40 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+
+namespace usdBVHAnimPlugin {
+
+//! Enumeration of the spaces in which a pose can be sampled from a `BVHDocument`.
+enum class BVHPoseSpace {
+    //! Joint transforms are relative to their parent joint (as stored in `BVHDocument`).
+    Local,
+    //! Joint transforms are relative to the root of the skeleton.
+    World
+};
+
+//! Sample a single pose from the given `BVHDocument` at the given time in seconds, where
+//! a time of zero corresponds to the first frame of the animation. Times that fall between
+//! frames are interpolated using `InterpolateBVHTransforms`, and times outside of the
+//! animation are clamped to its first or last frame.
+//!
+//! `result` must point to storage for one `BVHTransform` per joint in the document.
+//! Returns `true` on success, or `false` if the document contains no frames.
+bool SampleBVHPose(BVHDocument const& document, double time, BVHPoseSpace space, BVHTransform* result);
+
+//! Sample many poses from the given `BVHDocument` at once, one for each of the `numTimes`
+//! times given in `times`, storing `numTimes * numJoints` joint transforms in `result`,
+//! ordered first by time, then by joint.
+//!
+//! Local poses are interpolated first for every time, and world poses are then computed
+//! in a single forward kinematics pass that visits joints in order of their depth in the
+//! hierarchy, evaluating each joint for every requested time before moving on to the next.
+//!
+//! Returns `true` on success, or `false` if the document contains no frames.
+bool SampleBVHPoses(BVHDocument const& document, double const* times, size_t numTimes, BVHPoseSpace space, BVHTransform* result);
+
+//! Transform `numPoses` poses of the joints of the given `BVHDocument` from local space to world
+//! space in place, e.g. the frames of the document, or poses sampled with `BVHPoseSpace::Local`.
+//! `poses` holds `numPoses * numJoints` joint transforms, ordered first by pose, then by joint.
+//! Each joint is composed with its parent for every pose before moving on to the next joint.
+void ComputeBVHWorldPoses(BVHDocument const& document, BVHTransform* poses, size_t numPoses);
+} // namespace usdBVHAnimPlugin
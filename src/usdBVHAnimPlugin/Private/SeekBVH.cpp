@@ -0,0 +1,373 @@
+#include "SeekBVH.h"
+#include "BVHChunkReaders.h"
+#include "IndexBVH.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <system_error>
+
+//! The extension of seek index files
+static char const* const c_IndexExtension = ".bvhidx";
+
+//! The prefix of the name of every seek index file written to an index directory
+static char const* const c_IndexPrefix = "usdBVHAnim-";
+
+//! Identifies a seek index file
+static char const c_IndexMagic[8] = { 'B', 'V', 'H', 'S', 'E', 'E', 'K', '\0' };
+
+//! The version of the layout of seek index files, which is incremented whenever it changes
+static uint32_t constexpr c_IndexVersion = 1;
+
+//! The size of each read of a file while it is being indexed
+static size_t constexpr c_ChunkSize = 1 << 20;
+
+//! The largest header that is read while looking for the end of the header, beyond which the
+//! file is assumed not to be a BVH file, rather than reading the whole file into memory
+static size_t constexpr c_MaxHeaderSize = 64 << 20;
+
+namespace {
+//! The header at the start of each seek index file, which is followed by the frame offsets
+struct IndexHeader {
+    char m_Magic[8];
+    uint32_t m_Version;
+    uint32_t m_Reserved;
+    uint64_t m_FileSize;
+    int64_t m_ModificationTime;
+    uint64_t m_FrameInterval;
+    uint64_t m_NumFrames;
+    uint64_t m_NumOffsets;
+};
+
+//! A `BVHChunkReader` that reads the contents of one reader followed by those of another, with
+//! which the header of a file is followed directly by the frames that are sought
+class ConcatenatedChunkReader : public usdBVHAnimPlugin::BVHChunkReader {
+public:
+    ConcatenatedChunkReader(usdBVHAnimPlugin::BVHChunkReader& first, usdBVHAnimPlugin::BVHChunkReader& second)
+        : m_First(first)
+        , m_Second(second)
+    {
+    }
+
+    size_t Read(char* buffer, size_t capacity) override
+    {
+        if (!m_FirstEnded) {
+            if (size_t const numRead = m_First.Read(buffer, capacity)) {
+                return numRead;
+            }
+            m_FirstEnded = true;
+            if (m_First.Failed()) {
+                return 0;
+            }
+        }
+        return m_Second.Read(buffer, capacity);
+    }
+
+    bool Failed() const override { return m_First.Failed() || m_Second.Failed(); }
+
+private:
+    usdBVHAnimPlugin::BVHChunkReader& m_First;
+    usdBVHAnimPlugin::BVHChunkReader& m_Second;
+    bool m_FirstEnded = false;
+};
+}
+
+static size_t GetNumIndexedFrames(uint64_t numFrames, uint64_t frameInterval)
+{
+    return static_cast<size_t>(std::max<uint64_t>(1, (numFrames + frameInterval - 1) / frameInterval));
+}
+
+//! Returns `true` if the offsets of the given index are consistent with its frame count, and lie
+//! within contents of the given size
+static bool IsIndexValid(usdBVHAnimPlugin::BVHSeekIndex const& index, uint64_t size)
+{
+    return index.m_FrameInterval > 0 && index.m_FileSize == size && index.m_FrameOffsets.size() == GetNumIndexedFrames(index.m_NumFrames, index.m_FrameInterval)
+        && std::is_sorted(index.m_FrameOffsets.begin(), index.m_FrameOffsets.end()) && index.m_FrameOffsets.back() <= size;
+}
+
+static bool GetFileStamp(std::string const& filePath, uint64_t& size, int64_t& modificationTime)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(filePath, error);
+    if (error) {
+        return false;
+    }
+    auto const writeTime = std::filesystem::last_write_time(filePath, error);
+    if (error) {
+        return false;
+    }
+    modificationTime = std::chrono::duration_cast<std::chrono::nanoseconds>(writeTime.time_since_epoch()).count();
+    return true;
+}
+
+//! Find the region of the indexed contents that holds the given range of frames, which is clamped
+//! to the frames of the contents, from the indexed frame at or before the first frame of the range,
+//! up to the indexed frame after the range. Stores the number of frames at the start of the region
+//! that precede the range in `numSkippedFrames`.
+static void FindFrameRegion(usdBVHAnimPlugin::BVHSeekIndex const& index, size_t& firstFrame, size_t& numFrames, uint64_t& begin, uint64_t& end, size_t& numSkippedFrames)
+{
+    firstFrame = static_cast<size_t>(std::min<uint64_t>(firstFrame, index.m_NumFrames));
+    numFrames = static_cast<size_t>(std::min<uint64_t>(numFrames, index.m_NumFrames - firstFrame));
+    size_t const beginEntry = std::min<size_t>(firstFrame / index.m_FrameInterval, index.m_FrameOffsets.size() - 1);
+    size_t const endEntry = static_cast<size_t>((firstFrame + numFrames + index.m_FrameInterval - 1) / index.m_FrameInterval);
+    begin = index.m_FrameOffsets[beginEntry];
+    end = endEntry < index.m_FrameOffsets.size() ? index.m_FrameOffsets[endEntry] : index.m_FileSize;
+    numSkippedFrames = firstFrame - static_cast<size_t>(beginEntry * index.m_FrameInterval);
+}
+
+namespace usdBVHAnimPlugin {
+bool BuildBVHSeekIndex(BVHChunkReader& reader, BVHSeekIndex& index, size_t frameInterval)
+{
+    frameInterval = std::max<size_t>(frameInterval, 1);
+
+    // Contents are accumulated in a single buffer, from which values are indexed as soon as they
+    // are complete, after which they are discarded. `bufferOffset` is the offset of the buffer
+    // within the file
+    std::vector<char> buffer;
+    uint64_t bufferOffset = 0;
+    size_t consumed = 0;
+    bool endOfInput = false;
+    auto readChunk = [&]() {
+        buffer.erase(buffer.begin(), buffer.begin() + consumed);
+        bufferOffset += consumed;
+        consumed = 0;
+        size_t const size = buffer.size();
+        buffer.resize(size + c_ChunkSize);
+        size_t const numRead = reader.Read(buffer.data() + size, c_ChunkSize);
+        buffer.resize(size + numRead);
+        endOfInput = numRead == 0;
+        return !reader.Failed();
+    };
+
+    // The header is complete once it is followed by the first value of the first frame
+    BVHDocument header;
+    size_t numFrames = 0;
+    size_t headerSize = 0;
+    while (!ParseBVHHeader(buffer.data(), buffer.size(), header, numFrames, headerSize) || (headerSize == buffer.size() && !endOfInput)) {
+        if (endOfInput || buffer.size() > c_MaxHeaderSize || !readChunk()) {
+            return false;
+        }
+        header = BVHDocument();
+    }
+
+    BVHSeekIndex result;
+    result.m_FrameInterval = frameInterval;
+    result.m_NumFrames = numFrames;
+    result.m_FrameOffsets.reserve(GetNumIndexedFrames(numFrames, frameInterval));
+    result.m_FrameOffsets.push_back(headerSize);
+
+    uint64_t valuesPerFrame = 0;
+    for (unsigned int numChannels : header.m_JointNumChannels) {
+        valuesPerFrame += numChannels;
+    }
+    if (valuesPerFrame == 0) {
+        // Frames without values all start where the header ends
+        result.m_FrameOffsets.resize(GetNumIndexedFrames(numFrames, frameInterval), headerSize);
+        index = std::move(result);
+        return true;
+    }
+
+    // Find the value that starts each indexed frame, a block of complete values at a time
+    uint64_t const valuesPerInterval = valuesPerFrame * frameInterval;
+    uint64_t const numValues = valuesPerFrame * numFrames;
+    uint64_t numIndexed = 0;
+    consumed = headerSize;
+    BVHValueIndex valueIndex;
+    while (numIndexed < numValues) {
+        char const* contents = buffer.data();
+        size_t const completeEnd = endOfInput ? buffer.size() : consumed + usdBVHAnimPlugin::FindLastWhitespaceEnd(contents + consumed, contents + buffer.size());
+        if (completeEnd > consumed && completeEnd - consumed <= c_MaxBVHIndexSize) {
+            IndexBVHValues(contents + consumed, completeEnd - consumed, valueIndex);
+            uint64_t const numBlockValues = valueIndex.m_ValueStarts.size();
+            uint64_t value = std::max(valuesPerInterval, (numIndexed + valuesPerInterval - 1) / valuesPerInterval * valuesPerInterval);
+            for (; value < numIndexed + numBlockValues && value < numValues; value += valuesPerInterval) {
+                result.m_FrameOffsets.push_back(bufferOffset + consumed + valueIndex.m_ValueStarts[value - numIndexed]);
+            }
+            numIndexed += numBlockValues;
+            consumed = completeEnd;
+        }
+        if (numIndexed < numValues && (endOfInput || !readChunk())) {
+            return false;
+        }
+    }
+    index = std::move(result);
+    return true;
+}
+
+bool BuildBVHSeekIndex(char const* contents, size_t size, BVHSeekIndex& index, size_t frameInterval)
+{
+    BVHMemoryChunkReader reader(contents, size);
+    if (!BuildBVHSeekIndex(reader, index, frameInterval)) {
+        return false;
+    }
+    index.m_FileSize = size;
+    return true;
+}
+
+bool StampBVHSeekIndex(std::string const& filePath, BVHSeekIndex& index)
+{
+    return GetFileStamp(filePath, index.m_FileSize, index.m_ModificationTime);
+}
+
+bool IsBVHSeekIndexCurrent(std::string const& filePath, BVHSeekIndex const& index)
+{
+    uint64_t size = 0;
+    int64_t modificationTime = 0;
+    return GetFileStamp(filePath, size, modificationTime) && modificationTime == index.m_ModificationTime && IsIndexValid(index, size);
+}
+
+std::string GetBVHSeekIndexPath(std::string const& filePath, std::string const& directory)
+{
+    if (directory.empty()) {
+        return filePath + c_IndexExtension;
+    }
+
+    // FNV-1a of the absolute path of the file
+    std::error_code error;
+    std::string const absolutePath = std::filesystem::absolute(filePath, error).string();
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (char c : error ? filePath : absolutePath) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    }
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s%016llx%s", c_IndexPrefix, static_cast<unsigned long long>(hash), c_IndexExtension);
+    return (std::filesystem::path(directory) / name).string();
+}
+
+bool WriteBVHSeekIndex(std::string const& indexPath, BVHSeekIndex const& index)
+{
+    IndexHeader header = {};
+    std::memcpy(header.m_Magic, c_IndexMagic, sizeof(c_IndexMagic));
+    header.m_Version = c_IndexVersion;
+    header.m_FileSize = index.m_FileSize;
+    header.m_ModificationTime = index.m_ModificationTime;
+    header.m_FrameInterval = index.m_FrameInterval;
+    header.m_NumFrames = index.m_NumFrames;
+    header.m_NumOffsets = index.m_FrameOffsets.size();
+
+    // Each writer uses its own temporary file, so that concurrent writers never interleave
+    static std::atomic<uint64_t> s_NumTemporaryFiles { 0 };
+    std::string const temporaryPath = indexPath + "." + std::to_string(std::random_device()()) + "." + std::to_string(s_NumTemporaryFiles++) + ".tmp";
+    std::FILE* file = std::fopen(temporaryPath.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(index.m_FrameOffsets.data(), sizeof(uint64_t), index.m_FrameOffsets.size(), file) == index.m_FrameOffsets.size();
+    written = std::fclose(file) == 0 && written;
+
+    std::error_code error;
+    if (written) {
+        std::filesystem::rename(temporaryPath, indexPath, error);
+    }
+    if (!written || error) {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool ReadBVHSeekIndex(std::string const& indexPath, std::string const& filePath, BVHSeekIndex& index)
+{
+    std::FILE* file = std::fopen(indexPath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+
+    // The number of offsets is checked against the frame count before any are read, so that a
+    // corrupt index cannot make a large allocation
+    IndexHeader header;
+    BVHSeekIndex result;
+    bool read = std::fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.m_Magic, c_IndexMagic, sizeof(c_IndexMagic)) == 0
+        && header.m_Version == c_IndexVersion && header.m_FrameInterval > 0 && header.m_NumOffsets == GetNumIndexedFrames(header.m_NumFrames, header.m_FrameInterval)
+        && header.m_NumOffsets <= header.m_FileSize + 1;
+    if (read) {
+        result.m_FileSize = header.m_FileSize;
+        result.m_ModificationTime = header.m_ModificationTime;
+        result.m_FrameInterval = header.m_FrameInterval;
+        result.m_NumFrames = header.m_NumFrames;
+        result.m_FrameOffsets.resize(header.m_NumOffsets);
+        read = std::fread(result.m_FrameOffsets.data(), sizeof(uint64_t), result.m_FrameOffsets.size(), file) == result.m_FrameOffsets.size();
+    }
+    std::fclose(file);
+    if (!read || !IsBVHSeekIndexCurrent(filePath, result)) {
+        return false;
+    }
+    index = std::move(result);
+    return true;
+}
+
+bool FindOrBuildBVHSeekIndex(std::string const& filePath, std::string const& directory, BVHSeekIndex& index, size_t frameInterval)
+{
+    if (IsCompressedBVHPath(filePath)) {
+        return false;
+    }
+    std::string const indexPath = GetBVHSeekIndexPath(filePath, directory);
+    if (ReadBVHSeekIndex(indexPath, filePath, index)) {
+        return true;
+    }
+
+    // The file is stamped before it is read, so that if it changes while it is being indexed,
+    // the index is out of date rather than describing contents that it wasn't built from
+    uint64_t size = 0;
+    int64_t modificationTime = 0;
+    BVHSeekIndex result;
+    BVHFileChunkReader reader(filePath);
+    if (!GetFileStamp(filePath, size, modificationTime) || !BuildBVHSeekIndex(reader, result, frameInterval)) {
+        return false;
+    }
+    result.m_FileSize = size;
+    result.m_ModificationTime = modificationTime;
+    if (!IsIndexValid(result, size)) {
+        return false;
+    }
+    WriteBVHSeekIndex(indexPath, result);
+    index = std::move(result);
+    return true;
+}
+
+bool ParseBVHFrameRange(char const* contents, size_t size, BVHSeekIndex const& index, size_t firstFrame, size_t numFrames, BVHDocument& result, BVHJointSelection const& selection)
+{
+    if (!IsIndexValid(index, size)) {
+        return false;
+    }
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    size_t numSkippedFrames = 0;
+    FindFrameRegion(index, firstFrame, numFrames, begin, end, numSkippedFrames);
+
+    // The header is followed directly by the frames of the region, as if they were the first frames
+    BVHMemoryChunkReader headerReader(contents, index.m_FrameOffsets[0]);
+    BVHMemoryChunkReader framesReader(contents + begin, end - begin);
+    ConcatenatedChunkReader reader(headerReader, framesReader);
+    return ParseBVHFrameRange(reader, numSkippedFrames, numFrames, result, selection);
+}
+
+bool ParseBVHFrameRange(std::string const& filePath, BVHSeekIndex const& index, size_t firstFrame, size_t numFrames, BVHDocument& result, BVHJointSelection const& selection)
+{
+    if (!IsBVHSeekIndexCurrent(filePath, index)) {
+        return false;
+    }
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    size_t numSkippedFrames = 0;
+    FindFrameRegion(index, firstFrame, numFrames, begin, end, numSkippedFrames);
+
+    std::FILE* file = std::fopen(filePath.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    bool parsed = false;
+    {
+        BVHFileChunkReader headerReader(file, 0, index.m_FrameOffsets[0]);
+        BVHFileChunkReader framesReader(file, begin, end - begin);
+        ConcatenatedChunkReader reader(headerReader, framesReader);
+        parsed = ParseBVHFrameRange(reader, numSkippedFrames, numFrames, result, selection);
+    }
+    std::fclose(file);
+    return parsed;
+}
+} // namespace usdBVHAnimPlugin
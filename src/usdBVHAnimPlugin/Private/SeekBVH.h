@@ -0,0 +1,89 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! An index of the byte offsets of the frames of an uncompressed BVH file, with which a range of
+//! frames can be parsed by seeking straight to them (see `ParseBVHFrameRange`), in time proportional
+//! to the size of the range rather than to the size of the file.
+//!
+//! Only the offset of every `m_FrameInterval`-th frame is held, so the index is small enough to be
+//! stored alongside the file (see `WriteBVHSeekIndex`), while at most `m_FrameInterval - 1` frames
+//! are skipped over before the first frame of a range. The size and modification time of the file
+//! are held too, so that an index that no longer describes its file can be detected.
+struct BVHSeekIndex {
+    //! The default number of frames between each indexed frame.
+    static constexpr size_t c_DefaultFrameInterval = 256;
+
+    //! The size in bytes of the indexed file
+    uint64_t m_FileSize = 0;
+    //! The modification time of the indexed file, in nanoseconds since the epoch of the file system's clock
+    int64_t m_ModificationTime = 0;
+    //! The number of frames between each indexed frame
+    uint64_t m_FrameInterval = c_DefaultFrameInterval;
+    //! The number of frames declared by the file
+    uint64_t m_NumFrames = 0;
+    //! The offset of the first value of every `m_FrameInterval`-th frame, starting with the first
+    //! frame, whose offset is also the size of the file's header. Holds at least one offset, even
+    //! if the file has no frames.
+    std::vector<uint64_t> m_FrameOffsets;
+};
+
+//! Build a seek index of a BVH file whose contents is read incrementally from the given
+//! `BVHChunkReader`, indexing every `frameInterval`-th frame. The values of the frames are found
+//! with `IndexBVHValues`, without being converted. The size and modification time of the index
+//! are not set (see `StampBVHSeekIndex`). Returns `true` on success, or `false` on failure, such
+//! as if the file holds fewer values than its frames require.
+bool BuildBVHSeekIndex(BVHChunkReader& reader, BVHSeekIndex& index, size_t frameInterval = BVHSeekIndex::c_DefaultFrameInterval);
+
+//! Build a seek index of BVH file contents held in memory, as with the overload of
+//! `BuildBVHSeekIndex` that reads from a `BVHChunkReader`.
+bool BuildBVHSeekIndex(char const* contents, size_t size, BVHSeekIndex& index, size_t frameInterval = BVHSeekIndex::c_DefaultFrameInterval);
+
+//! Store the current size and modification time of the file at the given path in the given
+//! index. Returns `false` if the file does not exist.
+bool StampBVHSeekIndex(std::string const& filePath, BVHSeekIndex& index);
+
+//! Returns `true` if the given index was stamped with the current size and modification time
+//! of the file at the given path, and its offsets lie within that file.
+bool IsBVHSeekIndexCurrent(std::string const& filePath, BVHSeekIndex const& index);
+
+//! Returns the path of the seek index of the BVH file at the given path. If no directory is given,
+//! the index is a sidecar next to the file, named after the file with a `.bvhidx` extension
+//! appended. Otherwise, the index is in the given directory, named after a hash of the absolute
+//! path of the file, such that files of the same name in different directories do not collide.
+std::string GetBVHSeekIndexPath(std::string const& filePath, std::string const& directory = {});
+
+//! Write the given index to the given index path. The index is written to a temporary file which
+//! is then renamed into place, so that no reader ever sees a partially written index. Returns
+//! `false` on failure, such as if the index path is not writable.
+bool WriteBVHSeekIndex(std::string const& indexPath, BVHSeekIndex const& index);
+
+//! Read an index written by `WriteBVHSeekIndex` from the given index path, which must be current
+//! for the BVH file at the given path (see `IsBVHSeekIndexCurrent`). Returns `false`, leaving the
+//! index unchanged, if there is no index, if it is not valid, or if it is out of date.
+bool ReadBVHSeekIndex(std::string const& indexPath, std::string const& filePath, BVHSeekIndex& index);
+
+//! Read the seek index of the BVH file at the given path from `GetBVHSeekIndexPath(filePath, directory)`,
+//! or if there is no current index, build one from the file and write it there. Returns `true` if
+//! there is a current index for the file, even if a newly built index could not be written.
+//! Compressed BVH files cannot be indexed.
+bool FindOrBuildBVHSeekIndex(std::string const& filePath, std::string const& directory, BVHSeekIndex& index, size_t frameInterval = BVHSeekIndex::c_DefaultFrameInterval);
+
+//! Parse the frames `[firstFrame, firstFrame + numFrames)` of BVH file contents held in memory,
+//! seeking straight to them with the given index of the contents, as with the overload of
+//! `ParseBVHFrameRange` that reads from a `BVHChunkReader`. Only the header and the frames from
+//! the indexed frame at or before `firstFrame` to the indexed frame after the range are read.
+//! Returns `false` if the index does not describe contents of the given size.
+bool ParseBVHFrameRange(char const* contents, size_t size, BVHSeekIndex const& index, size_t firstFrame, size_t numFrames, BVHDocument& result, BVHJointSelection const& selection = {});
+
+//! Parse the frames `[firstFrame, firstFrame + numFrames)` of the BVH file at the given path,
+//! seeking straight to them with the given index of the file, as with the overload of
+//! `ParseBVHFrameRange` that parses contents held in memory. Returns `false` if the index is
+//! not current for the file (see `IsBVHSeekIndexCurrent`).
+bool ParseBVHFrameRange(std::string const& filePath, BVHSeekIndex const& index, size_t firstFrame, size_t numFrames, BVHDocument& result, BVHJointSelection const& selection = {});
+} // namespace usdBVHAnimPlugin
@@ -0,0 +1,261 @@
+#include "StatsBVH.h"
+#include "SampleBVH.h"
+#include <algorithm>
+#include <limits>
+
+namespace usdBVHAnimPlugin {
+namespace {
+    size_t constexpr c_BlocksPerGroup = BVHMotionStats::c_GroupSize / BVHMotionStats::c_BlockSize;
+    static_assert(BVHMotionStats::c_GroupSize % BVHMotionStats::c_BlockSize == 0, "Groups must hold whole blocks");
+
+    //! Returns a range that holds no values, which any value extends
+    BVHJointRange MakeEmptyRange()
+    {
+        BVHJointRange range;
+        std::fill(std::begin(range.m_MinTranslation), std::end(range.m_MinTranslation), std::numeric_limits<double>::infinity());
+        std::fill(std::begin(range.m_MaxTranslation), std::end(range.m_MaxTranslation), -std::numeric_limits<double>::infinity());
+        std::fill(std::begin(range.m_MinRotation), std::end(range.m_MinRotation), std::numeric_limits<double>::infinity());
+        std::fill(std::begin(range.m_MaxRotation), std::end(range.m_MaxRotation), -std::numeric_limits<double>::infinity());
+        std::fill(std::begin(range.m_MinPosition), std::end(range.m_MinPosition), std::numeric_limits<double>::infinity());
+        std::fill(std::begin(range.m_MaxPosition), std::end(range.m_MaxPosition), -std::numeric_limits<double>::infinity());
+        return range;
+    }
+
+    template <size_t N>
+    void Extend(double (&min)[N], double (&max)[N], double const* value)
+    {
+        for (size_t i = 0; i < N; ++i) {
+            min[i] = std::min(min[i], value[i]);
+            max[i] = std::max(max[i], value[i]);
+        }
+    }
+
+    //! Extend the given range by the given local and world transforms of the joint in a frame
+    void ExtendRange(BVHJointRange& range, BVHTransform const& local, BVHTransform const& world)
+    {
+        double const sign = local.m_RotationQuat[3] < 0.0 ? -1.0 : 1.0;
+        double const rotation[4] = { sign * local.m_RotationQuat[0], sign * local.m_RotationQuat[1], sign * local.m_RotationQuat[2], sign * local.m_RotationQuat[3] };
+        Extend(range.m_MinTranslation, range.m_MaxTranslation, local.m_Translation);
+        Extend(range.m_MinRotation, range.m_MaxRotation, rotation);
+        Extend(range.m_MinPosition, range.m_MaxPosition, world.m_Translation);
+    }
+
+    void MergeRange(BVHJointRange& range, BVHJointRange const& other)
+    {
+        Extend(range.m_MinTranslation, range.m_MaxTranslation, other.m_MinTranslation);
+        Extend(range.m_MinTranslation, range.m_MaxTranslation, other.m_MaxTranslation);
+        Extend(range.m_MinRotation, range.m_MaxRotation, other.m_MinRotation);
+        Extend(range.m_MinRotation, range.m_MaxRotation, other.m_MaxRotation);
+        Extend(range.m_MinPosition, range.m_MaxPosition, other.m_MinPosition);
+        Extend(range.m_MinPosition, range.m_MaxPosition, other.m_MaxPosition);
+    }
+
+    //! Merge the ranges of every joint over two adjacent runs of a level of the index into `ranges`,
+    //! or copy the first if it is the last run of its level
+    void MergeRuns(BVHJointRange* ranges, BVHJointRange const* first, BVHJointRange const* second, size_t numJoints)
+    {
+        std::copy(first, first + numJoints, ranges);
+        for (size_t jointIndex = 0; second && jointIndex < numJoints; ++jointIndex) {
+            MergeRange(ranges[jointIndex], second[jointIndex]);
+        }
+    }
+
+    //! Call the given function with the local and world transforms of every joint of each of the
+    //! frames `[beginFrame, endFrame)` of the given document, in order. World poses are computed
+    //! for at most a block of frames at a time, so that the frames are only ever copied in blocks.
+    template <typename Function>
+    void ForEachFrame(BVHDocument const& document, size_t beginFrame, size_t endFrame, Function&& function)
+    {
+        size_t const numJoints = document.m_JointNames.size();
+        std::vector<BVHTransform> worldPoses;
+        for (size_t blockFrame = beginFrame; blockFrame < endFrame; blockFrame += BVHMotionStats::c_BlockSize) {
+            size_t const numBlockFrames = std::min(BVHMotionStats::c_BlockSize, endFrame - blockFrame);
+            BVHTransform const* localPoses = &document.m_FrameTransforms[blockFrame * numJoints];
+            worldPoses.assign(localPoses, localPoses + numBlockFrames * numJoints);
+            ComputeBVHWorldPoses(document, worldPoses.data(), numBlockFrames);
+            for (size_t frame = 0; frame < numBlockFrames; ++frame) {
+                function(blockFrame + frame, localPoses + frame * numJoints, worldPoses.data() + frame * numJoints);
+            }
+        }
+    }
+} // namespace
+
+void BuildBVHMotionStats(BVHDocument const& document, BVHMotionStats& stats)
+{
+    stats = BVHMotionStats();
+    AppendBVHMotionStats(document, stats);
+}
+
+bool AppendBVHMotionStats(BVHDocument const& document, BVHMotionStats& stats)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    if (numJoints == 0 || (stats.m_NumFrames != 0 && stats.m_NumJoints != numJoints)) {
+        return false;
+    }
+    stats.m_NumJoints = numJoints;
+
+    // Frames extend the last block if it is not yet full, and then fill new blocks
+    size_t const firstFrame = stats.m_NumFrames;
+    size_t const numFrames = document.m_FrameTransforms.size() / numJoints;
+    size_t const numBlocks = (firstFrame + numFrames + BVHMotionStats::c_BlockSize - 1) / BVHMotionStats::c_BlockSize;
+    stats.m_Blocks.resize(numBlocks * numJoints, MakeEmptyRange());
+    ForEachFrame(document, 0, numFrames, [&](size_t frame, BVHTransform const* localPose, BVHTransform const* worldPose) {
+        BVHJointRange* blockRanges = &stats.m_Blocks[(firstFrame + frame) / BVHMotionStats::c_BlockSize * numJoints];
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            ExtendRange(blockRanges[jointIndex], localPose[jointIndex], worldPose[jointIndex]);
+        }
+    });
+    stats.m_NumFrames = firstFrame + numFrames;
+
+    // Groups are merged from their blocks, starting with the group that held the last block
+    size_t const firstGroup = firstFrame / BVHMotionStats::c_GroupSize;
+    size_t const numGroups = (numBlocks + c_BlocksPerGroup - 1) / c_BlocksPerGroup;
+    stats.m_Groups.resize(numGroups * numJoints);
+    for (size_t group = firstGroup; group < numGroups; ++group) {
+        BVHJointRange* groupRanges = &stats.m_Groups[group * numJoints];
+        std::fill(groupRanges, groupRanges + numJoints, MakeEmptyRange());
+        size_t const endBlock = std::min((group + 1) * c_BlocksPerGroup, numBlocks);
+        for (size_t block = group * c_BlocksPerGroup; block < endBlock; ++block) {
+            for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+                MergeRange(groupRanges[jointIndex], stats.m_Blocks[block * numJoints + jointIndex]);
+            }
+        }
+    }
+
+    // Each level of runs is merged from pairs of runs of the level below, starting with the run
+    // that held the first group that changed, until a level holds a single run
+    size_t numLevels = 0;
+    for (size_t numBelow = numGroups; numBelow > 1; numBelow = (numBelow + 1) / 2) {
+        ++numLevels;
+    }
+    stats.m_GroupRuns.resize(numLevels);
+    std::vector<BVHJointRange> const* below = &stats.m_Groups;
+    for (size_t level = 0, numBelow = numGroups; level < numLevels; ++level) {
+        std::vector<BVHJointRange>& runs = stats.m_GroupRuns[level];
+        size_t const numRuns = (numBelow + 1) / 2;
+        runs.resize(numRuns * numJoints);
+        for (size_t run = firstGroup >> (level + 1); run < numRuns; ++run) {
+            BVHJointRange const* second = 2 * run + 1 < numBelow ? &(*below)[(2 * run + 1) * numJoints] : nullptr;
+            MergeRuns(&runs[run * numJoints], &(*below)[2 * run * numJoints], second, numJoints);
+        }
+        below = &runs;
+        numBelow = numRuns;
+    }
+    return true;
+}
+
+bool QueryBVHJointRanges(BVHDocument const& document, BVHMotionStats const& stats, size_t firstFrame, size_t numFrames, std::vector<BVHJointRange>& ranges)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    if (numJoints == 0 || stats.m_NumJoints != numJoints || stats.m_NumFrames * numJoints != document.m_FrameTransforms.size()
+        || firstFrame >= stats.m_NumFrames || numFrames == 0) {
+        return false;
+    }
+    size_t const endFrame = firstFrame + std::min(numFrames, stats.m_NumFrames - firstFrame);
+    ranges.assign(numJoints, MakeEmptyRange());
+    auto extendFrames = [&](size_t beginFrame, size_t endFrame) {
+        ForEachFrame(document, beginFrame, endFrame, [&](size_t, BVHTransform const* localPose, BVHTransform const* worldPose) {
+            for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+                ExtendRange(ranges[jointIndex], localPose[jointIndex], worldPose[jointIndex]);
+            }
+        });
+    };
+    auto mergeRanges = [&](BVHJointRange const* other) {
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            MergeRange(ranges[jointIndex], other[jointIndex]);
+        }
+    };
+
+    // Find the blocks that lie entirely within the range, where the last block of the document ends
+    // with its last frame
+    size_t const numBlocks = stats.m_Blocks.size() / numJoints;
+    size_t const beginBlock = (firstFrame + BVHMotionStats::c_BlockSize - 1) / BVHMotionStats::c_BlockSize;
+    size_t const endBlock = endFrame == stats.m_NumFrames ? numBlocks : endFrame / BVHMotionStats::c_BlockSize;
+    if (beginBlock >= endBlock) {
+        extendFrames(firstFrame, endFrame);
+        return true;
+    }
+
+    // Frames before the first whole block and after the last are read from the document, and
+    // whole blocks from the statistics
+    extendFrames(firstFrame, beginBlock * BVHMotionStats::c_BlockSize);
+    extendFrames(std::min(endBlock * BVHMotionStats::c_BlockSize, endFrame), endFrame);
+
+    // Find the groups that lie entirely within the whole blocks, where the last group of the document
+    // ends with its last block, and merge the blocks outside of them
+    size_t const numGroups = stats.m_Groups.size() / numJoints;
+    size_t const beginGroup = (beginBlock + c_BlocksPerGroup - 1) / c_BlocksPerGroup;
+    size_t const endGroup = endBlock == numBlocks ? numGroups : endBlock / c_BlocksPerGroup;
+    if (beginGroup >= endGroup) {
+        for (size_t block = beginBlock; block < endBlock; ++block) {
+            mergeRanges(&stats.m_Blocks[block * numJoints]);
+        }
+        return true;
+    }
+    for (size_t block = beginBlock; block < beginGroup * c_BlocksPerGroup; ++block) {
+        mergeRanges(&stats.m_Blocks[block * numJoints]);
+    }
+    for (size_t block = std::min(endGroup * c_BlocksPerGroup, endBlock); block < endBlock; ++block) {
+        mergeRanges(&stats.m_Blocks[block * numJoints]);
+    }
+
+    // Whole groups are merged from the largest runs that lie within them, taking the run at either
+    // end of the groups that remain whenever it does not pair with its neighbour at the next level
+    std::vector<BVHJointRange> const* level = &stats.m_Groups;
+    for (size_t levelIndex = 0, beginRun = beginGroup, endRun = endGroup; beginRun < endRun; ++levelIndex) {
+        if (beginRun % 2 == 1) {
+            mergeRanges(&(*level)[beginRun * numJoints]);
+            ++beginRun;
+        }
+        if (endRun % 2 == 1) {
+            --endRun;
+            mergeRanges(&(*level)[endRun * numJoints]);
+        }
+        beginRun /= 2;
+        endRun /= 2;
+        if (beginRun < endRun) {
+            level = &stats.m_GroupRuns[levelIndex];
+        }
+    }
+    return true;
+}
+
+bool QueryBVHBounds(BVHDocument const& document, BVHMotionStats const& stats, size_t firstFrame, size_t numFrames, double min[3], double max[3])
+{
+    std::vector<BVHJointRange> ranges;
+    if (!QueryBVHJointRanges(document, stats, firstFrame, numFrames, ranges)) {
+        return false;
+    }
+    BVHJointRange bounds = MakeEmptyRange();
+    for (BVHJointRange const& range : ranges) {
+        Extend(bounds.m_MinPosition, bounds.m_MaxPosition, range.m_MinPosition);
+        Extend(bounds.m_MinPosition, bounds.m_MaxPosition, range.m_MaxPosition);
+    }
+    std::copy(std::begin(bounds.m_MinPosition), std::end(bounds.m_MinPosition), min);
+    std::copy(std::begin(bounds.m_MaxPosition), std::end(bounds.m_MaxPosition), max);
+    return true;
+}
+
+bool FindBVHMovingJoints(BVHDocument const& document, BVHMotionStats const& stats, size_t firstFrame, size_t numFrames, double tolerance, std::vector<size_t>& joints)
+{
+    std::vector<BVHJointRange> ranges;
+    if (!QueryBVHJointRanges(document, stats, firstFrame, numFrames, ranges)) {
+        return false;
+    }
+    joints.clear();
+    for (size_t jointIndex = 0; jointIndex < ranges.size(); ++jointIndex) {
+        BVHJointRange const& range = ranges[jointIndex];
+        bool moves = false;
+        for (size_t i = 0; i < 3; ++i) {
+            moves |= range.m_MaxTranslation[i] - range.m_MinTranslation[i] > tolerance;
+        }
+        for (size_t i = 0; i < 4; ++i) {
+            moves |= range.m_MaxRotation[i] - range.m_MinRotation[i] > tolerance;
+        }
+        if (moves) {
+            joints.push_back(jointIndex);
+        }
+    }
+    return true;
+}
+} // namespace usdBVHAnimPlugin
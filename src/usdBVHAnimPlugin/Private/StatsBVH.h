@@ -0,0 +1,84 @@
+#pragma once
+#include "ParseBVH.h"
+#include <cstddef>
+#include <vector>
+
+namespace usdBVHAnimPlugin {
+
+//! The range of the values of a single joint over a number of frames
+struct BVHJointRange {
+    //! The minimum X/Y/Z components of the joint's local translation
+    double m_MinTranslation[3];
+    //! The maximum X/Y/Z components of the joint's local translation
+    double m_MaxTranslation[3];
+    //! The minimum X/Y/Z/W components of the joint's local rotation quaternion, taken in the
+    //! hemisphere where W is positive, so that a quaternion and its negation have the same range
+    double m_MinRotation[4];
+    //! The maximum X/Y/Z/W components of the joint's local rotation quaternion, as `m_MinRotation`
+    double m_MaxRotation[4];
+    //! The minimum X/Y/Z components of the joint's position relative to the root of the skeleton
+    double m_MinPosition[3];
+    //! The maximum X/Y/Z components of the joint's position relative to the root of the skeleton
+    double m_MaxPosition[3];
+};
+
+//! A hierarchical index of the ranges of the values of every joint of a `BVHDocument`, held for
+//! each block of `c_BlockSize` frames, for each group of `c_GroupSize` frames, and for each run of
+//! a power of two groups. The range of a joint over any range of frames can be found from at most
+//! two runs of each size, at most `c_GroupSize / c_BlockSize - 1` blocks at either end of the
+//! groups the range covers, and at most `c_BlockSize - 1` frames at either end of it (see
+//! `QueryBVHJointRanges`), in time that grows with the logarithm of the length of the range.
+struct BVHMotionStats {
+    //! The number of frames of each block
+    static constexpr size_t c_BlockSize = 64;
+    //! The number of frames of each group, a whole number of blocks
+    static constexpr size_t c_GroupSize = 4096;
+
+    //! The number of joints of each frame
+    size_t m_NumJoints = 0;
+    //! The number of frames added to the index
+    size_t m_NumFrames = 0;
+    //! The range of each joint over each block, ordered first by block, then by joint. The last
+    //! block holds fewer frames if the number of frames is not a multiple of the block size.
+    std::vector<BVHJointRange> m_Blocks;
+    //! The range of each joint over each group, ordered first by group, then by joint
+    std::vector<BVHJointRange> m_Groups;
+    //! The range of each joint over each run of `2^(level + 1)` groups, starting at a multiple of
+    //! that many groups, for each level, ordered first by run, then by joint. Each level holds half
+    //! as many runs as the one before, rounded up, and the last level holds a single run. The last
+    //! run of each level holds fewer groups if the number of groups is not a multiple of its size.
+    std::vector<std::vector<BVHJointRange>> m_GroupRuns;
+};
+
+//! Build the statistics of every frame of the given `BVHDocument`, replacing any that were
+//! previously held by `stats`.
+void BuildBVHMotionStats(BVHDocument const& document, BVHMotionStats& stats);
+
+//! Add every frame of the given `BVHDocument` to `stats`, following any frames already added,
+//! such as the frames of each chunk given to the callback of `ParseBVHFrameChunks`, so that the
+//! statistics of a file can be built without ever holding all of its frames. The document must
+//! have the same number of joints as the frames already added.
+//!
+//! Returns `true` on success, or `false` if the document does not match the statistics.
+bool AppendBVHMotionStats(BVHDocument const& document, BVHMotionStats& stats);
+
+//! Find the range of every joint over the frames `[firstFrame, firstFrame + numFrames)` of the given
+//! `BVHDocument`, storing one `BVHJointRange` per joint in `ranges`, from the statistics built
+//! from the document. The range is clamped to the frames of the document. Only the frames of the
+//! range that do not fill a whole block are read from the document, and the time taken grows with
+//! the logarithm of the number of groups the range spans.
+//!
+//! Returns `true` on success, or `false` if the range holds no frames, or if the statistics were
+//! not built from the document.
+bool QueryBVHJointRanges(BVHDocument const& document, BVHMotionStats const& stats, size_t firstFrame, size_t numFrames, std::vector<BVHJointRange>& ranges);
+
+//! Find the bounds of the positions of every joint over the frames `[firstFrame, firstFrame + numFrames)`
+//! of the given `BVHDocument`, relative to the root of the skeleton, as with `QueryBVHJointRanges`.
+bool QueryBVHBounds(BVHDocument const& document, BVHMotionStats const& stats, size_t firstFrame, size_t numFrames, double min[3], double max[3]);
+
+//! Find the joints that move over the frames `[firstFrame, firstFrame + numFrames)` of the given
+//! `BVHDocument`, as with `QueryBVHJointRanges`, storing their indices in ascending order in
+//! `joints`. A joint moves if any component of its local translation or rotation varies by more
+//! than `tolerance`.
+bool FindBVHMovingJoints(BVHDocument const& document, BVHMotionStats const& stats, size_t firstFrame, size_t numFrames, double tolerance, std::vector<size_t>& joints);
+} // namespace usdBVHAnimPlugin
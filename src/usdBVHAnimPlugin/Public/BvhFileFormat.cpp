@@ -1,23 +1,50 @@
+#include <pxr/base/arch/fileSystem.h>
 #include <pxr/base/gf/matrix4f.h>
+#include <pxr/base/gf/range3d.h>
 #include <pxr/base/gf/rotation.h>
 #include <pxr/base/tf/declarePtrs.h>
 #include <pxr/base/tf/enum.h>
+#include <pxr/base/tf/envSetting.h>
+#include <pxr/base/tf/fileUtils.h>
+#include <pxr/base/tf/pathUtils.h>
 #include <pxr/base/tf/registryManager.h>
 #include <pxr/base/tf/staticTokens.h>
+#include <pxr/base/tf/stringUtils.h>
 #include <pxr/base/tf/token.h>
 #include <pxr/pxr.h>
+#include <pxr/usd/ar/asset.h>
+#include <pxr/usd/ar/resolvedPath.h>
+#include <pxr/usd/ar/resolver.h>
+#include <pxr/usd/sdf/changeBlock.h>
 #include <pxr/usd/sdf/data.h>
 #include <pxr/usd/sdf/fileFormat.h>
 #include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/sdf/types.h>
+#include <pxr/usd/usd/editContext.h>
+#include <pxr/usd/usd/references.h>
 #include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/variantSets.h>
 #include <pxr/usd/usdGeom/boundable.h>
 #include <pxr/usd/usdSkel/animation.h>
 #include <pxr/usd/usdSkel/bindingAPI.h>
 #include <pxr/usd/usdSkel/root.h>
 #include <pxr/usd/usdSkel/skeleton.h>
+#include <pxr/usd/usdSkel/topology.h>
+#include <pxr/usd/usdSkel/utils.h>
+#include <algorithm>
+#include <filesystem>
+#include <memory>
 #include <vector>
 
+#include "AuthorBVH.h"
+#include "BVHChunkReaders.h"
+#include "CacheBVH.h"
 #include "ParseBVH.h"
+#include "PrefetchBVH.h"
+#include "ResampleBVH.h"
+#include "SeekBVH.h"
+#include "StatsBVH.h"
 #include "Version.h"
 
 using namespace usdBVHAnimPlugin;
@@ -28,15 +55,24 @@ PXR_NAMESPACE_OPEN_SCOPE
 class BvhFileFormat : public SdfFileFormat {
 protected:
     BvhFileFormat();
+    BvhFileFormat(TfToken const& formatId, std::vector<std::string> const& extensions);
     virtual ~BvhFileFormat() = default;
 
 public:
     //! Returns `true` if the given file path can be read by this plug-in or `false` otherwise.
+    //! Compressed files are only readable if they are compressed BVH files (e.g. `.bvh.gz`).
     bool CanRead(std::string const& filePath) const override;
 
     //! Reads the given BVH file into the given SdfLayer. Returns `true` on success or `false` on failure.
+    //! This may be called concurrently from multiple threads to read distinct layers.
+    //! Files are read through `ArGetResolver().OpenAsset()`, so files inside packages (such as
+    //! `.usdz`) and files served by custom resolvers can be read as well as files on disk.
     bool Read(SdfLayer* layer, std::string const& resolvedPath, bool metadataOnly) const override;
 
+    //! Reads BVH file contents held in the given string into the given SdfLayer, applying the layer's
+    //! file format arguments in the same way as `Read`. Returns `true` on success or `false` on failure.
+    bool ReadFromString(SdfLayer* layer, std::string const& str) const override;
+
     //! This function always returns false. Only reading of BVH files is supported.
     bool WriteToString(SdfLayer const& layer, std::string* str, std::string const& comment) const override
     {
@@ -60,104 +96,389 @@ public:
     SDF_FILE_FORMAT_FACTORY_ACCESS;
 };
 
+//! An SdfFileFormat for compressed BVH animation data (`.bvh.gz` and `.bvh.zst`), which reads files
+//! in the same way as `BvhFileFormat`. USD finds file formats by the last extension of a path alone,
+//! so this format is registered for the bare `gz` and `zst` extensions, and is only listed in the
+//! plug-in's `plugInfo.json` when the plug-in is built with `USDBVHANIM_COMPRESSED_EXTENSIONS`. It is
+//! not marked as primary, so that any other format registered for those extensions takes precedence.
+class BvhCompressedFileFormat : public BvhFileFormat {
+protected:
+    BvhCompressedFileFormat();
+    virtual ~BvhCompressedFileFormat() = default;
+
+    SDF_FILE_FORMAT_FACTORY_ACCESS;
+};
+
 enum class BvhError {
     BVH_FAILED_TO_READ,
-    BVH_FAILED_TO_PARSE_SCALE_ARG
+    BVH_FAILED_TO_PARSE_SCALE_ARG,
+    BVH_FAILED_TO_PARSE_FPS_ARG,
+    BVH_FAILED_TO_PARSE_JOINTS_ARG,
+    BVH_FAILED_TO_PARSE_LOD_ARG,
+    BVH_FAILED_TO_PARSE_SKELETON_ARG,
+    BVH_FAILED_TO_PARSE_FRAMES_ARG,
+    BVH_FAILED_TO_PARSE_BLOCK_EXTENTS_ARG
 };
 
 TF_REGISTRY_FUNCTION(TfEnum)
 {
     TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_READ, "Failed to read BVH file");
     TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_SCALE_ARG, "Failed to parse scale argument");
+    TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_FPS_ARG, "Failed to parse fps argument");
+    TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_JOINTS_ARG, "Failed to parse joints argument");
+    TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_LOD_ARG, "Failed to parse lod argument");
+    TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_SKELETON_ARG, "Failed to parse skeleton argument");
+    TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_FRAMES_ARG, "Failed to parse frames argument");
+    TF_ADD_ENUM_NAME(BvhError::BVH_FAILED_TO_PARSE_BLOCK_EXTENTS_ARG, "Failed to parse blockExtents argument");
+};
+
+//! A level of detail of the animation, authored as a variant holding every `m_FrameStride`-th frame
+struct BvhLodVariant {
+    char const* m_Name;
+    size_t m_FrameStride;
+};
+
+//! The name of the variant set that holds each level of detail of the animation
+static char const* const c_LodVariantSet = "lod";
+
+static BvhLodVariant const c_LodVariants[] = {
+    { "full", 1 },
+    { "half", 2 },
+    { "quarter", 4 },
 };
 
+//! The names of the attributes authored on the skeleton root by the `blockExtents` file format argument
+static char const* const c_BlockSizeAttr = "usdBVHAnim:blockSize";
+static char const* const c_BlockExtentsAttr = "usdBVHAnim:blockExtents";
+static char const* const c_GroupSizeAttr = "usdBVHAnim:groupSize";
+static char const* const c_GroupExtentsAttr = "usdBVHAnim:groupExtents";
+
+//! Parse the value of the `joints` file format argument, a comma-separated list of joint
+//! names, where a name followed by `/*` selects that joint along with all of its descendants.
+//! Returns `false` if the list contains an empty entry.
+static bool ParseJointsArg(std::string const& value, BVHJointSelection& selection)
+{
+    for (std::string entry : TfStringSplit(value, ",")) {
+        entry = TfStringTrim(entry);
+        bool const subtree = TfStringEndsWith(entry, "/*");
+        if (subtree) {
+            entry = TfStringTrim(entry.substr(0, entry.size() - 2));
+        }
+        if (entry.empty()) {
+            return false;
+        }
+        (subtree ? selection.m_SubtreeRoots : selection.m_Joints).push_back(entry);
+    }
+    return true;
+}
+
+//! Parse the value of the `frames` file format argument, an inclusive range of zero-based frame
+//! indices such as `100-199`. Returns `false` if the value is not a range, or if it is empty.
+static bool ParseFramesArg(std::string const& value, size_t& firstFrame, size_t& numFrames)
+{
+    std::vector<std::string> const bounds = TfStringSplit(value, "-");
+    if (bounds.size() != 2) {
+        return false;
+    }
+    try {
+        size_t position = 0;
+        std::string const first = TfStringTrim(bounds[0]);
+        std::string const last = TfStringTrim(bounds[1]);
+        unsigned long long const firstValue = std::stoull(first, &position);
+        if (position != first.size()) {
+            return false;
+        }
+        unsigned long long const lastValue = std::stoull(last, &position);
+        if (position != last.size() || lastValue < firstValue) {
+            return false;
+        }
+        firstFrame = static_cast<size_t>(firstValue);
+        numFrames = static_cast<size_t>(lastValue - firstValue + 1);
+        return true;
+    } catch (std::exception const&) {
+        return false;
+    }
+}
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_PREFETCH_PATHS, "",
+    "A list of BVH file paths, separated by the platform's path list separator, that are "
+    "parsed in the background as soon as the BVH file format is loaded.");
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_PREFETCH_MAX_MB, 1024,
+    "The maximum total size in megabytes of the prefetched BVH documents held in memory until they are read, "
+    "beyond which the documents that were parsed earliest are discarded.");
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_SHARED_CACHE_DIR, "",
+    "A directory on a memory backed file system shared by every process on the machine, such as "
+    "/dev/shm, through which parsed BVH documents are shared between processes. Disabled when empty.");
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_SHARED_CACHE_MAX_MB, 1024,
+    "The maximum total size in megabytes of the parsed BVH documents in the shared cache directory.");
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_PIPELINED_READS, false,
+    "Read uncompressed BVH files on disk in large sequential reads on a separate thread while they are "
+    "parsed, rather than mapping them into memory. Faster on network file systems such as NFS.");
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_SEEK_INDEX, false,
+    "Build a seek index of each uncompressed BVH file on disk the first time it is read, with which later "
+    "reads of a range of its frames (see the frames file format argument) seek straight to them.");
+
+TF_DEFINE_ENV_SETTING(USDBVHANIM_SEEK_INDEX_DIR, "",
+    "The directory that seek indices are stored in. When empty, each index is stored next to its BVH file.");
+
 TF_DECLARE_PUBLIC_TOKENS(
     BvhFileFormatTokens,
-    ((Id, "bvhFileFormat"))((Version, c_ProjectVersion))((Target, "usd"))((Extension, "bvh")));
+    ((Id, "bvhFileFormat"))((CompressedId, "bvhCompressedFileFormat"))((Version, c_ProjectVersion))((Target, "usd"))((Extension, "bvh"))((GzipExtension, "gz"))((ZstdExtension, "zst")));
 
 TF_DEFINE_PUBLIC_TOKENS(
     BvhFileFormatTokens,
-    ((Id, "bvhFileFormat"))((Version, c_ProjectVersion))((Target, "usd"))((Extension, "bvh")));
+    ((Id, "bvhFileFormat"))((CompressedId, "bvhCompressedFileFormat"))((Version, c_ProjectVersion))((Target, "usd"))((Extension, "bvh"))((GzipExtension, "gz"))((ZstdExtension, "zst")));
+
+BvhFileFormat::BvhFileFormat(TfToken const& formatId, std::vector<std::string> const& extensions)
+    : SdfFileFormat(formatId, BvhFileFormatTokens->Version, BvhFileFormatTokens->Target, extensions)
+{
+}
 
 BvhFileFormat::BvhFileFormat()
-    : SdfFileFormat(
-          BvhFileFormatTokens->Id,
-          BvhFileFormatTokens->Version,
-          BvhFileFormatTokens->Target,
-          BvhFileFormatTokens->Extension)
+    : BvhFileFormat(BvhFileFormatTokens->Id, std::vector<std::string> { BvhFileFormatTokens->Extension.GetString() })
 {
+    // Start parsing any BVH files that the environment says will be needed shortly, so that
+    // their later reads can complete from memory. Paths are resolved in the same way as those
+    // given to `Read`, by which they are later taken from the document store.
+    std::string const prefetchPaths = TfGetEnvSetting(USDBVHANIM_PREFETCH_PATHS);
+    if (!prefetchPaths.empty()) {
+        std::vector<std::string> filePaths;
+        for (std::string const& path : TfStringSplit(prefetchPaths, ARCH_PATH_LIST_SEP)) {
+            if (!path.empty()) {
+                ArResolvedPath const resolvedPath = ArGetResolver().Resolve(path);
+                filePaths.push_back(resolvedPath ? resolvedPath.GetPathString() : TfAbsPath(path));
+            }
+        }
+        BVHPrefetchOptions prefetchOptions;
+        prefetchOptions.m_MaxBytes = static_cast<size_t>(std::max(TfGetEnvSetting(USDBVHANIM_PREFETCH_MAX_MB), 0)) << 20;
+        PrefetchBVH(filePaths, prefetchOptions);
+    }
 }
 
-bool BvhFileFormat::CanRead(std::string const& /*filePath*/) const
+BvhCompressedFileFormat::BvhCompressedFileFormat()
+    : BvhFileFormat(
+          BvhFileFormatTokens->CompressedId,
+          std::vector<std::string> {
+              BvhFileFormatTokens->GzipExtension.GetString(),
+              BvhFileFormatTokens->ZstdExtension.GetString() })
 {
-    return true;
 }
 
-bool BvhFileFormat::Read(SdfLayer* layer, std::string const& resolvedPath, bool /*metadataOnly*/) const
+bool BvhFileFormat::CanRead(std::string const& filePath) const
 {
-    if (!TF_VERIFY(layer)) {
-        return false;
+    // The compressed extensions are registered with `BvhCompressedFileFormat`, but files with
+    // those extensions are only BVH files if the extension is preceded by `.bvh`
+    std::string const extension = GetFileExtension(filePath);
+    if (BvhFileFormatTokens->GzipExtension == extension || BvhFileFormatTokens->ZstdExtension == extension) {
+        return IsCompressedBVHPath(filePath);
     }
+    return true;
+}
 
-    BVHDocument document;
-    if (!ParseBVH(resolvedPath, document)) {
-        TF_ERROR(BvhError::BVH_FAILED_TO_READ, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_READ));
-        return false;
+//! The file format arguments that control how a BVH file is translated
+struct BvhReadArguments {
+    float m_Scale = 1.0f;
+    double m_FramesPerSecond = 0.0;
+    BVHJointSelection m_JointSelection;
+    std::string m_Lod;
+    bool m_SharedSkeleton = false;
+    bool m_SkeletonOnly = false;
+    size_t m_FirstFrame = 0;
+    size_t m_NumFrames = SIZE_MAX;
+    bool m_BlockExtents = false;
+
+    //! Returns `true` if only a range of the frames of the file has been requested
+    bool HasFrameRange() const
+    {
+        return m_FirstFrame != 0 || m_NumFrames != SIZE_MAX;
     }
+};
 
-    float scale = 1.0f;
-    for (auto const& arg : layer->GetFileFormatArguments()) {
+//! Parse the file format arguments of the given layer, reporting an error and returning `false`
+//! if any argument is invalid
+static bool ParseReadArguments(SdfLayer const& layer, BvhReadArguments& arguments)
+{
+    for (auto const& arg : layer.GetFileFormatArguments()) {
         if (arg.first == "scale") {
             try {
-                scale = std::stof(arg.second.c_str());
+                arguments.m_Scale = std::stof(arg.second.c_str());
             } catch (std::exception const&) {
                 TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_SCALE_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_SCALE_ARG));
                 return false;
             }
+        } else if (arg.first == "fps") {
+            try {
+                arguments.m_FramesPerSecond = std::stod(arg.second.c_str());
+            } catch (std::exception const&) {
+                arguments.m_FramesPerSecond = 0.0;
+            }
+            if (!(arguments.m_FramesPerSecond > 0.0)) {
+                TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_FPS_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_FPS_ARG));
+                return false;
+            }
+        } else if (arg.first == "joints") {
+            if (!ParseJointsArg(arg.second, arguments.m_JointSelection)) {
+                TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_JOINTS_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_JOINTS_ARG));
+                return false;
+            }
+        } else if (arg.first == "lod") {
+            arguments.m_Lod = arg.second;
+            auto isLodVariant = [&](BvhLodVariant const& lod) { return arguments.m_Lod == lod.m_Name; };
+            if (std::none_of(std::begin(c_LodVariants), std::end(c_LodVariants), isLodVariant)) {
+                TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_LOD_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_LOD_ARG));
+                return false;
+            }
+        } else if (arg.first == "skeleton") {
+            if (arg.second != "shared" && arg.second != "local" && arg.second != "only") {
+                TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_SKELETON_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_SKELETON_ARG));
+                return false;
+            }
+            arguments.m_SharedSkeleton = arg.second == "shared";
+            arguments.m_SkeletonOnly = arg.second == "only";
+        } else if (arg.first == "frames") {
+            if (!ParseFramesArg(arg.second, arguments.m_FirstFrame, arguments.m_NumFrames)) {
+                TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_FRAMES_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_FRAMES_ARG));
+                return false;
+            }
+        } else if (arg.first == "blockExtents") {
+            if (arg.second != "true" && arg.second != "false") {
+                TF_ERROR(BvhError::BVH_FAILED_TO_PARSE_BLOCK_EXTENTS_ARG, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_PARSE_BLOCK_EXTENTS_ARG));
+                return false;
+            }
+            arguments.m_BlockExtents = arg.second == "true";
         }
     }
 
-    SdfLayerRefPtr skelLayer = SdfLayer::CreateAnonymous(".usda");
-    UsdStageRefPtr skelStage = UsdStage::Open(skelLayer);
-    UsdSkelRoot skelRoot = UsdSkelRoot::Define(skelStage, SdfPath("/Root"));
-    UsdSkelSkeleton skeleton = UsdSkelSkeleton::Define(skelStage, SdfPath("/Root/Skeleton"));
-    UsdAttribute jointsAttr = skeleton.CreateJointsAttr();
-    UsdAttribute bindTransformsAttr = skeleton.CreateBindTransformsAttr();
-    UsdAttribute restTransformsAttr = skeleton.CreateRestTransformsAttr();
+    // A skeleton needs no more than the first frame of the file to be parsed
+    if (arguments.m_SkeletonOnly) {
+        arguments.m_FirstFrame = 0;
+        arguments.m_NumFrames = 1;
+    }
+    return true;
+}
+
+//! Author the bounds of the joint positions of each block and each group of frames of the given
+//! document (see `BVHMotionStats`) on the given prim, as pairs of minimum and maximum points, so
+//! that the bounds of any range of frames can be found from the blocks and groups that it covers
+static void AuthorBVHBlockExtents(UsdPrim const& prim, BVHDocument const& document, float scale)
+{
+    BVHMotionStats stats;
+    BuildBVHMotionStats(document, stats);
+    if (stats.m_NumFrames == 0) {
+        return;
+    }
+    auto makeExtents = [&](std::vector<BVHJointRange> const& ranges) {
+        VtVec3fArray extents;
+        extents.reserve(ranges.size() / stats.m_NumJoints * 2);
+        for (size_t first = 0; first < ranges.size(); first += stats.m_NumJoints) {
+            GfRange3d bounds;
+            for (size_t jointIndex = 0; jointIndex < stats.m_NumJoints; ++jointIndex) {
+                BVHJointRange const& range = ranges[first + jointIndex];
+                bounds.UnionWith(GfVec3d(range.m_MinPosition[0], range.m_MinPosition[1], range.m_MinPosition[2]));
+                bounds.UnionWith(GfVec3d(range.m_MaxPosition[0], range.m_MaxPosition[1], range.m_MaxPosition[2]));
+            }
+            extents.push_back(GfVec3f(bounds.GetMin() * scale));
+            extents.push_back(GfVec3f(bounds.GetMax() * scale));
+        }
+        return extents;
+    };
+    prim.CreateAttribute(TfToken(c_BlockSizeAttr), SdfValueTypeNames->Int, true).Set(static_cast<int>(BVHMotionStats::c_BlockSize));
+    prim.CreateAttribute(TfToken(c_BlockExtentsAttr), SdfValueTypeNames->Float3Array, true).Set(makeExtents(stats.m_Blocks));
+    prim.CreateAttribute(TfToken(c_GroupSizeAttr), SdfValueTypeNames->Int, true).Set(static_cast<int>(BVHMotionStats::c_GroupSize));
+    prim.CreateAttribute(TfToken(c_GroupExtentsAttr), SdfValueTypeNames->Float3Array, true).Set(makeExtents(stats.m_Groups));
+}
 
-    // Walk the joint hierarchy from root to leaf to calculate model-space
-    // bind pose transforms from OFFSET data in the BVH
+//! Author the joints, bind transforms and rest transforms of the given document's skeleton on the
+//! given skeleton prim, with translations multiplied by the given scale
+static void AuthorBVHSkeleton(UsdSkelSkeleton const& skeleton, BVHDocument const& document, float scale, VtArray<TfToken>& jointPaths)
+{
     VtArray<GfMatrix4d> bindPoseLS;
     VtArray<GfMatrix4d> bindPoseMS;
-    for (size_t i = 0; i < document.m_JointNames.size(); ++i) {
-        GfMatrix4d parentMS;
-        parentMS.SetIdentity();
-        if (document.m_JointParents[i] >= 0) {
-            parentMS = bindPoseMS[document.m_JointParents[i]];
+    ComputeBVHBindTransforms(document, scale, bindPoseLS, bindPoseMS);
+    jointPaths = ComputeBVHJointPaths(document);
+    skeleton.CreateJointsAttr().Set(jointPaths);
+    skeleton.CreateBindTransformsAttr().Set(bindPoseMS);
+    skeleton.CreateRestTransformsAttr().Set(bindPoseLS);
+}
+
+//! Returns the asset path, relative to the BVH file at the given path, of the layer that holds the
+//! skeleton shared by every layer read with `skeleton=shared` from a file of the same skeleton (see
+//! `FindOrAddBVHSkeletonAsset`). That layer is the file of the first such layer that is still alive,
+//! read with `skeleton=only` and the same `scale` and `joints` arguments, so the path remains valid
+//! when the referencing layer is exported. Returns an empty path if the file is not on disk, such as
+//! when it is read from a string or from inside a package, in which case there is no path to refer to.
+static std::string FindSharedSkeletonAssetPath(SdfLayer* layer, std::string const& filePath, BVHDocument const& document, BvhReadArguments const& arguments, VtArray<TfToken>& jointPaths)
+{
+    if (filePath.empty() || !TfIsFile(filePath)) {
+        return std::string();
+    }
+    SdfLayer::FileFormatArguments skeletonArguments { { "skeleton", "only" } };
+    for (auto const& arg : layer->GetFileFormatArguments()) {
+        if (arg.first == "scale" || arg.first == "joints") {
+            skeletonArguments.insert(arg);
         }
+    }
+    std::string const assetPath = FindOrAddBVHSkeletonAsset(document, arguments.m_Scale, SdfLayerHandle(layer), SdfLayer::CreateIdentifier(TfAbsPath(filePath), skeletonArguments), jointPaths);
+
+    // The path is made relative to the directory of the file, unless it is on another drive
+    std::string sharedFilePath;
+    SdfLayer::SplitIdentifier(assetPath, &sharedFilePath, &skeletonArguments);
+    std::filesystem::path const relativePath = std::filesystem::path(sharedFilePath).lexically_relative(std::filesystem::path(TfAbsPath(filePath)).parent_path());
+    if (!relativePath.empty()) {
+        std::string const relativePathString = relativePath.generic_string();
+        sharedFilePath = TfStringStartsWith(relativePathString, "..") ? relativePathString : "./" + relativePathString;
+    }
+    return SdfLayer::CreateIdentifier(sharedFilePath, skeletonArguments);
+}
 
-        auto offset = document.m_JointOffsets[i];
-        auto matrix = GfMatrix4d();
-        matrix.SetTranslate(GfVec3d(offset.m_Translation[0], offset.m_Translation[1], offset.m_Translation[2]) * scale);
+//! Translate the given parsed document of the BVH file at the given path, which is empty if the
+//! document was not read from a file, into the given layer, as requested by the given arguments
+static bool AuthorBVHLayer(SdfLayer* layer, std::string const& filePath, BVHDocument& document, BvhReadArguments const& arguments)
+{
+    // A layer read with `skeleton=only` holds just the skeleton, as its default prim, for layers
+    // read with `skeleton=shared` to reference
+    if (arguments.m_SkeletonOnly) {
+        SdfLayerRefPtr skeletonLayer = SdfLayer::CreateAnonymous(".usda");
+        UsdStageRefPtr skeletonStage = UsdStage::Open(skeletonLayer);
+        UsdSkelSkeleton skeleton = UsdSkelSkeleton::Define(skeletonStage, SdfPath("/Skeleton"));
+        VtArray<TfToken> jointPaths;
+        AuthorBVHSkeleton(skeleton, document, arguments.m_Scale, jointPaths);
+        skeletonStage->SetDefaultPrim(skeleton.GetPrim());
+        layer->TransferContent(skeletonLayer);
+        return true;
+    }
 
-        bindPoseLS.push_back(matrix);
-        bindPoseMS.push_back(matrix * parentMS);
+    // A range of frames keeps the time codes that its frames have in the whole animation, at the
+    // requested frame rate, so that ranges of the same file line up with each other
+    double const fileFrameTime = document.m_FrameTime;
+
+    // Resample the animation to the requested frame rate before any samples are authored
+    if (arguments.m_FramesPerSecond > 0.0 && !ResampleBVH(document, arguments.m_FramesPerSecond)) {
+        TF_ERROR(BvhError::BVH_FAILED_TO_READ, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_READ));
+        return false;
     }
 
-    // Populate skeleton attributes
+    SdfLayerRefPtr skelLayer = SdfLayer::CreateAnonymous(".usda");
+    UsdStageRefPtr skelStage = UsdStage::Open(skelLayer);
+    UsdSkelRoot skelRoot = UsdSkelRoot::Define(skelStage, SdfPath("/Root"));
+    UsdSkelSkeleton skeleton = UsdSkelSkeleton::Define(skelStage, SdfPath("/Root/Skeleton"));
+
+    // Calculate bind pose transforms from OFFSET data in the BVH, and populate skeleton attributes.
+    // If the skeleton is shared, the attributes are instead held by a layer shared with every other
+    // clip of the same skeleton, which the skeleton prim references, so that each clip layer only
+    // holds its own animation.
     VtArray<TfToken> jointPaths;
-    for (size_t jointIndex = 0; jointIndex < document.m_JointNames.size(); ++jointIndex) {
-        std::string jointPath = document.m_JointNames[jointIndex];
-        int parentIndex = document.m_JointParents[jointIndex];
-        while (parentIndex != BVHDocument::c_RootParentIndex) {
-            jointPath = document.m_JointNames[parentIndex] + "/" + jointPath;
-            parentIndex = document.m_JointParents[parentIndex];
-        }
-        jointPaths.push_back(TfToken(jointPath));
+    std::string const sharedSkeletonPath = arguments.m_SharedSkeleton ? FindSharedSkeletonAssetPath(layer, filePath, document, arguments, jointPaths) : std::string();
+    if (!sharedSkeletonPath.empty()) {
+        skeleton.GetPrim().GetReferences().AddReference(sharedSkeletonPath);
+    } else {
+        AuthorBVHSkeleton(skeleton, document, arguments.m_Scale, jointPaths);
     }
-    jointsAttr.Set(jointPaths);
-    bindTransformsAttr.Set(bindPoseMS);
-    restTransformsAttr.Set(bindPoseLS);
 
     // Add animation data
     UsdSkelAnimation animation = UsdSkelAnimation::Define(skelStage, SdfPath("/Root/Animation"));
@@ -168,37 +489,59 @@ bool BvhFileFormat::Read(SdfLayer* layer, std::string const& resolvedPath, bool
 
     size_t numFrames = document.m_FrameTransforms.size() / document.m_JointNames.size();
     double framesPerSecond = 1.0 / document.m_FrameTime;
+    double const startTime = 1.0 + static_cast<double>(arguments.m_FirstFrame) * fileFrameTime / document.m_FrameTime;
     skelLayer->SetTimeCodesPerSecond(framesPerSecond);
-    skelLayer->SetStartTimeCode(1.0);
-    skelLayer->SetEndTimeCode(static_cast<double>(1 + numFrames));
+    skelLayer->SetStartTimeCode(startTime);
+    skelLayer->SetEndTimeCode(startTime + static_cast<double>(numFrames));
 
     UsdGeomBoundable boundable(skelRoot.GetPrim());
     UsdAttribute extents = boundable.CreateExtentAttr();
 
-    for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
-        VtArray<GfVec3f> animTranslations;
-        VtArray<GfQuatf> animRotations;
-
-        for (size_t jointIndex = 0; jointIndex < document.m_JointNames.size(); ++jointIndex) {
-            size_t transformIndex = frameIndex * document.m_JointNames.size() + jointIndex;
-
-            auto const& frame = document.m_FrameTransforms[transformIndex];
-            GfRotation frameRotation = GfQuatd(frame.m_RotationQuat[3], frame.m_RotationQuat[0], frame.m_RotationQuat[1], frame.m_RotationQuat[2]);
-            auto localTransform = GfMatrix4f();
-            localTransform.SetTransform(frameRotation, GfVec3f(static_cast<float>(frame.m_Translation[0]), static_cast<float>(frame.m_Translation[1]), static_cast<float>(frame.m_Translation[2])) * scale);
-            animTranslations.push_back(localTransform.ExtractTranslation());
-            animRotations.push_back(localTransform.ExtractRotationQuat());
+    // Convert every frame up front and in parallel, so that each level of detail can share the
+    // same sample arrays
+    std::vector<VtArray<GfVec3f>> frameTranslations;
+    std::vector<VtArray<GfQuatf>> frameRotations;
+    ComputeBVHAnimationSamples(document, arguments.m_Scale, frameTranslations, frameRotations);
+
+    // Author the samples directly on the animation, or if a level of detail was requested, author a
+    // variant for each level of detail that holds every frame, every second frame or every fourth
+    // frame. Samples of each variant refer to the same arrays, so each additional variant costs
+    // little more than its time sample entries, while selecting a lower level of detail reduces
+    // the samples held by the composed stage.
+    std::vector<std::pair<SdfPath, size_t>> sampleTargets;
+    if (arguments.m_Lod.empty()) {
+        sampleTargets.emplace_back(animation.GetPath(), 1);
+    } else {
+        UsdVariantSet lodVariantSet = animation.GetPrim().GetVariantSets().AddVariantSet(c_LodVariantSet);
+        for (BvhLodVariant const& lod : c_LodVariants) {
+            lodVariantSet.AddVariant(lod.m_Name);
+            lodVariantSet.SetVariantSelection(lod.m_Name);
+            {
+                UsdEditContext variantContext(lodVariantSet.GetVariantEditContext());
+                animation.CreateTranslationsAttr();
+                animation.CreateRotationsAttr();
+            }
+            sampleTargets.emplace_back(animation.GetPath().AppendVariantSelection(c_LodVariantSet, lod.m_Name), lod.m_FrameStride);
         }
+        lodVariantSet.SetVariantSelection(arguments.m_Lod);
+    }
 
-        skelLayer->SetTimeSample(animTranslationsAttr.GetPath(), 1.0 + frameIndex, animTranslations);
-        skelLayer->SetTimeSample(animRotationsAttr.GetPath(), 1.0 + frameIndex, animRotations);
+    // Author every time sample of each attribute with a single call, and batch their change
+    // notification into one. Notices are sent through process-wide registries, so sending one
+    // per sample would also serialise concurrent reads of other files.
+    {
+        SdfChangeBlock changeBlock;
+        for (auto const& [primPath, frameStride] : sampleTargets) {
+            skelLayer->SetField(primPath.AppendProperty(animTranslationsAttr.GetName()), SdfFieldKeys->TimeSamples, MakeBVHTimeSamples(frameTranslations, frameStride, startTime));
+            skelLayer->SetField(primPath.AppendProperty(animRotationsAttr.GetName()), SdfFieldKeys->TimeSamples, MakeBVHTimeSamples(frameRotations, frameStride, startTime));
+        }
     }
 
     VtArray<GfVec3h> animScales;
     for (size_t jointIndex = 0; jointIndex < document.m_JointNames.size(); ++jointIndex) {
         animScales.push_back(GfVec3h(1.0f, 1.0f, 1.0f));
     }
-    skelLayer->SetTimeSample(animScalesAttr.GetPath(), 1.0, animScales);
+    skelLayer->SetTimeSample(animScalesAttr.GetPath(), startTime, animScales);
 
     animJointsAttr.Set(jointPaths);
 
@@ -209,11 +552,23 @@ bool BvhFileFormat::Read(SdfLayer* layer, std::string const& resolvedPath, bool
     UsdSkelBindingAPI skelBinding(skeleton.GetPrim());
     skelBinding.CreateAnimationSourceRel().AddTarget(SdfPath("/Root/Animation"));
 
-    // Calculate extents
+    // Calculate extents from the samples of every frame of the authored joints, rather than from the
+    // composed stage, so that they do not depend on which level of detail is selected, or on the
+    // shared skeleton layer being resolved. Extents are authored only once every frame has been
+    // computed, so that their change notification can also be batched into one.
+    UsdSkelTopology const topology(jointPaths);
+    VtArray<GfVec3h> const jointScales(jointPaths.size(), GfVec3h(1.0f, 1.0f, 1.0f));
+    VtArray<GfMatrix4d> localTransforms(jointPaths.size());
+    VtArray<GfMatrix4d> skelTransforms(jointPaths.size());
+    std::vector<VtVec3fArray> frameExtents(numFrames);
     for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
-        VtVec3fArray extent;
-        UsdGeomBoundable::ComputeExtentFromPlugins(skelRoot, 1.0 + frameIndex, &extent);
-        skelLayer->SetTimeSample(extents.GetPath(), 1.0 + frameIndex, extent);
+        UsdSkelMakeTransforms(frameTranslations[frameIndex], frameRotations[frameIndex], jointScales, localTransforms);
+        UsdSkelConcatJointTransforms(topology, localTransforms, skelTransforms);
+        UsdSkelComputeJointsExtent(skelTransforms, &frameExtents[frameIndex]);
+    }
+    skelLayer->SetField(extents.GetPath(), SdfFieldKeys->TimeSamples, MakeBVHTimeSamples(frameExtents, 1, startTime));
+    if (arguments.m_BlockExtents) {
+        AuthorBVHBlockExtents(skelRoot.GetPrim(), document, arguments.m_Scale);
     }
 
     // Add skel root and transfer all data to stage
@@ -222,10 +577,126 @@ bool BvhFileFormat::Read(SdfLayer* layer, std::string const& resolvedPath, bool
     return true;
 }
 
+//! Parse the given contents of the BVH file at the given path with the file's seek index, which is
+//! read from the seek index directory, or built from the contents and written there if the file has
+//! no current index, such that later reads of a range of its frames can seek straight to them
+static bool ParseIndexedBVH(std::string const& filePath, char const* contents, size_t size, BvhReadArguments const& arguments, BVHDocument& document)
+{
+    std::string const indexPath = GetBVHSeekIndexPath(filePath, TfGetEnvSetting(USDBVHANIM_SEEK_INDEX_DIR));
+    BVHSeekIndex index;
+    if (!ReadBVHSeekIndex(indexPath, filePath, index)) {
+        // The file is stamped once it has been indexed, and if it has changed since its contents
+        // were opened, the index is not written
+        if (!BuildBVHSeekIndex(contents, size, index) || !StampBVHSeekIndex(filePath, index)) {
+            return false;
+        }
+        if (index.m_FileSize == size) {
+            WriteBVHSeekIndex(indexPath, index);
+        }
+    }
+
+    // Only the pages of the mapped contents that hold the header and the range are read
+    if (arguments.HasFrameRange()) {
+        return ParseBVHFrameRange(contents, size, index, arguments.m_FirstFrame, arguments.m_NumFrames, document, arguments.m_JointSelection);
+    }
+    return ParseBVH(contents, size, document, arguments.m_JointSelection);
+}
+
+bool BvhFileFormat::Read(SdfLayer* layer, std::string const& resolvedPath, bool /*metadataOnly*/) const
+{
+    BvhReadArguments arguments;
+    if (!TF_VERIFY(layer) || !ParseReadArguments(*layer, arguments)) {
+        return false;
+    }
+
+    // Use the result of an earlier prefetch of this file if there is one, otherwise read it from
+    // the shared cache or parse it now. Prefetched and cached files are always parsed in full, so
+    // the joint selection and frame range are applied afterwards, while parsing now skips over the
+    // channels of unselected joints, and stops after the last frame of the range.
+    //
+    // Files are read through the asset resolver, so that files inside packages (such as `.usdz`)
+    // or served by custom resolvers can be read. Files on disk are mapped into memory by the
+    // resolver, and are parsed in place without being copied, unless pipelined reads have been
+    // enabled, in which case they are read in chunks that are parsed as soon as they arrive.
+    // Files on disk that have a seek index are always mapped, so that a range of frames can be
+    // read without reading the frames before it.
+    std::string const sharedCacheDirectory = TfGetEnvSetting(USDBVHANIM_SHARED_CACHE_DIR);
+    bool const seekIndex = TfGetEnvSetting(USDBVHANIM_SEEK_INDEX) && sharedCacheDirectory.empty() && !IsCompressedBVHPath(resolvedPath) && TfIsFile(resolvedPath);
+    BVHDocument document;
+    bool parsed = TakePrefetchedBVH(resolvedPath, document);
+    if (parsed) {
+        parsed = SelectBVHJoints(document, arguments.m_JointSelection);
+        if (arguments.HasFrameRange()) {
+            SelectBVHFrames(document, arguments.m_FirstFrame, arguments.m_NumFrames);
+        }
+    } else {
+        document = BVHDocument();
+        std::shared_ptr<ArAsset> const asset = ArGetResolver().OpenAsset(ArResolvedPath(resolvedPath));
+
+        // On network file systems, page faults on a mapped file stall parsing on every page, so
+        // files can instead be read on a separate thread ahead of the parser
+        std::pair<FILE*, size_t> const file = asset && TfGetEnvSetting(USDBVHANIM_PIPELINED_READS) && sharedCacheDirectory.empty() && !seekIndex && !IsCompressedBVHPath(resolvedPath)
+            ? asset->GetFileUnsafe()
+            : std::pair<FILE*, size_t>(nullptr, 0);
+        std::shared_ptr<char const> const contents = asset && !file.first ? asset->GetBuffer() : nullptr;
+        if (file.first) {
+            BVHFileChunkReader fileReader(file.first, file.second, asset->GetSize());
+            BVHPipelinedChunkReader pipelinedReader(fileReader);
+            parsed = ParseBVHFrameRange(pipelinedReader, arguments.m_FirstFrame, arguments.m_NumFrames, document, arguments.m_JointSelection);
+        } else if (!contents) {
+            parsed = false;
+        } else if (!sharedCacheDirectory.empty()) {
+            BVHSharedCacheOptions sharedCacheOptions;
+            sharedCacheOptions.m_Directory = sharedCacheDirectory;
+            sharedCacheOptions.m_MaxBytes = static_cast<size_t>(std::max(TfGetEnvSetting(USDBVHANIM_SHARED_CACHE_MAX_MB), 0)) << 20;
+            parsed = ParseSharedBVH(contents.get(), asset->GetSize(), document, sharedCacheOptions) && SelectBVHJoints(document, arguments.m_JointSelection);
+            if (parsed && arguments.HasFrameRange()) {
+                SelectBVHFrames(document, arguments.m_FirstFrame, arguments.m_NumFrames);
+            }
+        } else if (seekIndex) {
+            parsed = ParseIndexedBVH(resolvedPath, contents.get(), asset->GetSize(), arguments, document);
+        } else if (arguments.HasFrameRange()) {
+            std::unique_ptr<BVHChunkReader> reader = OpenBVHChunkReader(contents.get(), asset->GetSize());
+            parsed = reader && ParseBVHFrameRange(*reader, arguments.m_FirstFrame, arguments.m_NumFrames, document, arguments.m_JointSelection);
+        } else {
+            parsed = ParseBVH(contents.get(), asset->GetSize(), document, arguments.m_JointSelection);
+        }
+    }
+    if (!parsed) {
+        TF_ERROR(BvhError::BVH_FAILED_TO_READ, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_READ));
+        return false;
+    }
+    return AuthorBVHLayer(layer, resolvedPath, document, arguments);
+}
+
+bool BvhFileFormat::ReadFromString(SdfLayer* layer, std::string const& str) const
+{
+    BvhReadArguments arguments;
+    if (!TF_VERIFY(layer) || !ParseReadArguments(*layer, arguments)) {
+        return false;
+    }
+
+    BVHDocument document;
+    bool parsed = false;
+    if (arguments.HasFrameRange()) {
+        std::unique_ptr<BVHChunkReader> reader = OpenBVHChunkReader(str.data(), str.size());
+        parsed = reader && ParseBVHFrameRange(*reader, arguments.m_FirstFrame, arguments.m_NumFrames, document, arguments.m_JointSelection);
+    } else {
+        parsed = ParseBVH(str.data(), str.size(), document, arguments.m_JointSelection);
+    }
+    if (!parsed) {
+        TF_ERROR(BvhError::BVH_FAILED_TO_READ, TfEnum::GetDisplayName(BvhError::BVH_FAILED_TO_READ));
+        return false;
+    }
+    return AuthorBVHLayer(layer, std::string(), document, arguments);
+}
+
 TF_DECLARE_WEAK_AND_REF_PTRS(BvhFileFormat);
+TF_DECLARE_WEAK_AND_REF_PTRS(BvhCompressedFileFormat);
 
 TF_REGISTRY_FUNCTION(TfType)
 {
     SDF_DEFINE_FILE_FORMAT(BvhFileFormat, SdfFileFormat);
+    SDF_DEFINE_FILE_FORMAT(BvhCompressedFileFormat, BvhFileFormat);
 }
 PXR_NAMESPACE_CLOSE_SCOPE
\ No newline at end of file
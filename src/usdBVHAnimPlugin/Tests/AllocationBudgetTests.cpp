@@ -0,0 +1,146 @@
+#include "AllocationCounter.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "Tests.h"
+#include <memory_resource>
+#include <sstream>
+#include <vector>
+
+using namespace usdBVHAnimPlugin;
+
+//! Parsing sizes each array of a document once, so the only allocation that scales with the
+//! size of the file is the single array of frame transforms
+static AllocationRates constexpr c_ParseBVHBudget = {
+    1.0, // Allocations per joint, for joint names too long for the small string optimisation
+    0.0, // Allocations per frame
+    0.0, // Allocations per joint per frame
+    sizeof(BVHTransform), // Bytes per joint per frame
+};
+
+//! Visiting a file never accumulates its frames, so no allocation scales with the number of frames
+static AllocationRates constexpr c_ParseBVHVisitorBudget = {
+    1.0, // Allocations per joint, for joint names too long for the small string optimisation
+    0.0, // Allocations per frame
+    0.0, // Allocations per joint per frame
+    0.0, // Bytes per joint per frame
+};
+
+//! Parsing into a document whose memory resource is given allocates all of its storage, including
+//! joint names too long for the small string optimisation, from that resource. Only the parser's
+//! scratch arena allocates globally, and as it grows geometrically, it does so once per doubling.
+static AllocationRates constexpr c_ParseBVHResourceBudget = {
+    0.05, // Allocations per joint, for the chunks of the parser's scratch arena
+    0.0, // Allocations per frame
+    0.0, // Allocations per joint per frame
+    0.0, // Bytes per joint per frame
+};
+
+static AllocationCounts CountParseBVHAllocations(size_t numJoints, size_t numFrames)
+{
+    std::istringstream stream(GenerateTestBVH(numJoints, numFrames), std::ios::in | std::ios::binary);
+    BVHDocument document;
+    bool success = false;
+    AllocationCounts const counts = CountAllocations([&]() { success = ParseBVH(stream, document); });
+    TEST_REQUIRE(success);
+    TEST_REQUIRE(document.m_FrameTransforms.size() == numJoints * numFrames);
+    return counts;
+}
+
+static AllocationCounts CountParseBVHResourceAllocations(size_t numJoints, size_t numFrames)
+{
+    // Every joint is given a name too long for the small string optimisation
+    std::string const generated = GenerateTestBVH(numJoints, numFrames);
+    std::string contents;
+    for (size_t i = 0; i < generated.size(); ++i) {
+        contents += generated[i];
+        if (generated.compare(i, 6, " Joint") == 0) {
+            contents += " JointWithANameTooLongForTheSmallStringOptimisation";
+            i += 5;
+        }
+    }
+
+    // The arena's buffer is allocated before counting begins, and it has no upstream resource, so
+    // any storage that the document does not allocate from it is counted
+    std::vector<char> buffer(2 * numJoints * numFrames * sizeof(BVHTransform) + 1024 * numJoints);
+    std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), std::pmr::null_memory_resource());
+    BVHDocument document(&arena);
+    bool success = false;
+    AllocationCounts const counts = CountAllocations([&]() { success = ParseBVH(contents.data(), contents.size(), document); });
+    TEST_REQUIRE(success);
+    TEST_REQUIRE(document.m_FrameTransforms.size() == numJoints * numFrames);
+    TEST_REQUIRE(document.m_JointNames.back().get_allocator().resource() == &arena);
+    return counts;
+}
+
+static AllocationCounts CountParseBVHVisitorAllocations(size_t numJoints, size_t numFrames)
+{
+    //! A visitor that only counts the frames it is given
+    struct CountingVisitor : BVHVisitor {
+        size_t m_NumFrames = 0;
+        bool OnFrame(size_t, BVHTransform const*) override
+        {
+            ++m_NumFrames;
+            return true;
+        }
+    };
+
+    std::string const contents = GenerateTestBVH(numJoints, numFrames);
+    CountingVisitor visitor;
+    bool success = false;
+    AllocationCounts const counts = CountAllocations([&]() { success = ParseBVH(contents.data(), contents.size(), visitor); });
+    TEST_REQUIRE(success);
+    TEST_REQUIRE(visitor.m_NumFrames == numFrames);
+    return counts;
+}
+
+BEGIN_TEST_FIXTURE(AllocationBudgetTests)
+
+TEST(CountAllocations_Counts_Operator_New)
+{
+    // The allocations escape through a volatile pointer, so that the compiler cannot elide them
+    static void* volatile s_Allocation = nullptr;
+    AllocationCounts const counts = CountAllocations([]() {
+        s_Allocation = new int(0);
+        delete static_cast<int*>(s_Allocation);
+        s_Allocation = new char[100];
+        delete[] static_cast<char*>(s_Allocation);
+    });
+    TEST_REQUIRE(counts.m_NumAllocations == 2);
+    TEST_REQUIRE(counts.m_NumBytes == sizeof(int) + 100);
+}
+
+TEST(MeasureAllocationRates_Fits_Known_Rates)
+{
+    AllocationRates const rates = MeasureAllocationRates([](size_t numJoints, size_t numFrames) {
+        AllocationCounts counts;
+        counts.m_NumAllocations = 5 + 2 * numJoints + 3 * numFrames + numJoints * numFrames;
+        counts.m_NumBytes = 64 + 8 * numJoints * numFrames;
+        return counts;
+    },
+        4, 10);
+    TEST_REQUIRE(rates.m_AllocationsPerJoint == 2.0);
+    TEST_REQUIRE(rates.m_AllocationsPerFrame == 3.0);
+    TEST_REQUIRE(rates.m_AllocationsPerJointFrame == 1.0);
+    TEST_REQUIRE(rates.m_BytesPerJointFrame == 8.0);
+}
+
+TEST(ParseBVH_Allocations_Within_Budget)
+{
+    AllocationRates const rates = MeasureAllocationRates(CountParseBVHAllocations, 32, 100);
+    TEST_REQUIRE(IsWithinAllocationBudget(rates, c_ParseBVHBudget));
+}
+
+TEST(ParseBVH_Resource_Allocations_Within_Budget)
+{
+    AllocationRates const rates = MeasureAllocationRates(CountParseBVHResourceAllocations, 32, 100);
+    TEST_REQUIRE(IsWithinAllocationBudget(rates, c_ParseBVHResourceBudget));
+}
+
+TEST(ParseBVH_Visitor_Allocations_Within_Budget)
+{
+    // Enough frames that every file is decoded in batches of the same size
+    AllocationRates const rates = MeasureAllocationRates(CountParseBVHVisitorAllocations, 4, 20000);
+    TEST_REQUIRE(IsWithinAllocationBudget(rates, c_ParseBVHVisitorBudget));
+}
+
+END_TEST_FIXTURE()
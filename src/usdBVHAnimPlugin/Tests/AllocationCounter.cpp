@@ -0,0 +1,218 @@
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+static std::atomic<bool> s_Counting { false };
+static std::atomic<size_t> s_NumAllocations { 0 };
+static std::atomic<size_t> s_NumBytes { 0 };
+
+static void* CountedAllocate(std::size_t size) noexcept
+{
+    if (s_Counting.load(std::memory_order_relaxed)) {
+        s_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+        s_NumBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* CountedAllocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+{
+    if (s_Counting.load(std::memory_order_relaxed)) {
+        s_NumAllocations.fetch_add(1, std::memory_order_relaxed);
+        s_NumBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    size_t const alignmentBytes = std::max(static_cast<size_t>(alignment), sizeof(void*));
+#if defined(_WIN32)
+    return _aligned_malloc(size == 0 ? 1 : size, alignmentBytes);
+#else
+    void* p = nullptr;
+    return posix_memalign(&p, alignmentBytes, size == 0 ? 1 : size) == 0 ? p : nullptr;
+#endif
+}
+
+static void FreeAligned(void* p) noexcept
+{
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+// Replacements of the global allocation functions, which count allocations while counting is enabled.
+// The aligned overloads must also be replaced, as some standard library facilities (e.g.
+// `std::pmr::new_delete_resource()`) always allocate through them.
+void* operator new(std::size_t size)
+{
+    if (void* p = CountedAllocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::nothrow_t const&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](std::size_t size, std::nothrow_t const&) noexcept
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::nothrow_t const&) noexcept
+{
+    std::free(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (void* p = CountedAllocateAligned(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+    return CountedAllocateAligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept
+{
+    return CountedAllocateAligned(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    FreeAligned(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    FreeAligned(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    FreeAligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, std::nothrow_t const&) noexcept
+{
+    FreeAligned(p);
+}
+
+AllocationCounts CountAllocations(std::function<void()> const& function)
+{
+    s_NumAllocations = 0;
+    s_NumBytes = 0;
+    s_Counting = true;
+    function();
+    s_Counting = false;
+
+    AllocationCounts result;
+    result.m_NumAllocations = s_NumAllocations;
+    result.m_NumBytes = s_NumBytes;
+    return result;
+}
+
+AllocationRates MeasureAllocationRates(std::function<AllocationCounts(size_t numJoints, size_t numFrames)> const& measure, size_t numJoints, size_t numFrames)
+{
+    measure(numJoints * 2, numFrames * 2);
+
+    AllocationCounts const c11 = measure(numJoints, numFrames);
+    AllocationCounts const c21 = measure(numJoints * 2, numFrames);
+    AllocationCounts const c12 = measure(numJoints, numFrames * 2);
+    AllocationCounts const c22 = measure(numJoints * 2, numFrames * 2);
+
+    double const joints = static_cast<double>(numJoints);
+    double const frames = static_cast<double>(numFrames);
+    auto jointFrameRate = [&](size_t AllocationCounts::*count) {
+        double const delta = static_cast<double>(c22.*count) - static_cast<double>(c21.*count) - static_cast<double>(c12.*count) + static_cast<double>(c11.*count);
+        return delta / (joints * frames);
+    };
+
+    AllocationRates result;
+    result.m_AllocationsPerJointFrame = jointFrameRate(&AllocationCounts::m_NumAllocations);
+    result.m_BytesPerJointFrame = jointFrameRate(&AllocationCounts::m_NumBytes);
+    result.m_AllocationsPerJoint = (static_cast<double>(c21.m_NumAllocations) - static_cast<double>(c11.m_NumAllocations)) / joints - result.m_AllocationsPerJointFrame * frames;
+    result.m_AllocationsPerFrame = (static_cast<double>(c12.m_NumAllocations) - static_cast<double>(c11.m_NumAllocations)) / frames - result.m_AllocationsPerJointFrame * joints;
+    return result;
+}
+
+bool IsWithinAllocationBudget(AllocationRates const& rates, AllocationRates const& budget)
+{
+    bool result = true;
+    auto check = [&](char const* name, double rate, double limit) {
+        if (rate > limit) {
+            printf("\t%s of %f exceeds budget of %f\n", name, rate, limit);
+            result = false;
+        }
+    };
+    check("Allocations per joint", rates.m_AllocationsPerJoint, budget.m_AllocationsPerJoint);
+    check("Allocations per frame", rates.m_AllocationsPerFrame, budget.m_AllocationsPerFrame);
+    check("Allocations per joint per frame", rates.m_AllocationsPerJointFrame, budget.m_AllocationsPerJointFrame);
+    check("Bytes per joint per frame", rates.m_BytesPerJointFrame, budget.m_BytesPerJointFrame);
+    return result;
+}
+
+void PrintAllocationRates(AllocationRates const& rates)
+{
+    printf("\tAllocations per joint: %f\n", rates.m_AllocationsPerJoint);
+    printf("\tAllocations per frame: %f\n", rates.m_AllocationsPerFrame);
+    printf("\tAllocations per joint per frame: %f\n", rates.m_AllocationsPerJointFrame);
+    printf("\tBytes per joint per frame: %f\n", rates.m_BytesPerJointFrame);
+}
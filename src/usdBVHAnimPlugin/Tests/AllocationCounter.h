@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+
+//! The number of allocations made through the global `operator new`, and their total size in bytes
+struct AllocationCounts {
+    size_t m_NumAllocations = 0;
+    size_t m_NumBytes = 0;
+};
+
+//! The rates at which allocations are made, relative to the size of a BVH document. These are used
+//! both to describe measured rates, and the budgets that measured rates must stay within.
+struct AllocationRates {
+    //! Allocations made per joint, independently of the number of frames
+    double m_AllocationsPerJoint = 0.0;
+    //! Allocations made per frame, independently of the number of joints
+    double m_AllocationsPerFrame = 0.0;
+    //! Allocations made per joint in each frame (i.e. per sample)
+    double m_AllocationsPerJointFrame = 0.0;
+    //! Bytes allocated per joint in each frame (i.e. per sample)
+    double m_BytesPerJointFrame = 0.0;
+};
+
+//! Call the given function, and return the allocations made through the global `operator new`
+//! while it runs, on any thread. The test executable replaces the global `operator new` in order
+//! to count allocations, so allocations made by other means (e.g. `malloc`, or on Windows, the
+//! `operator new` of other DLLs) are not counted.
+AllocationCounts CountAllocations(std::function<void()> const& function);
+
+//! Estimate the rates at which the given function allocates, by fitting the model
+//! `a + b * joints + c * frames + d * joints * frames` to its counts for the given number of
+//! joints and frames, and for double each. The function is called once beforehand for the largest
+//! size, so that one-off allocations (e.g. of retained scratch buffers) are not measured.
+AllocationRates MeasureAllocationRates(std::function<AllocationCounts(size_t numJoints, size_t numFrames)> const& measure, size_t numJoints, size_t numFrames);
+
+//! Returns `true` if all of the given rates are within the given budget, printing each rate that is not.
+bool IsWithinAllocationBudget(AllocationRates const& rates, AllocationRates const& budget);
+
+//! Print each of the given rates, in the order that `AllocationRates` declares them.
+void PrintAllocationRates(AllocationRates const& rates);
@@ -0,0 +1,290 @@
+#include "BVHChunkReaders.h"
+#include "CompareBVH.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "Tests.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace usdBVHAnimPlugin;
+
+//! A `BVHChunkReader` that reads in-memory contents, at most `m_MaxChunkSize` bytes at a time
+class MemoryChunkReader : public BVHChunkReader {
+public:
+    MemoryChunkReader(std::string contents, size_t maxChunkSize)
+        : m_Contents(std::move(contents))
+        , m_MaxChunkSize(maxChunkSize)
+    {
+    }
+
+    size_t Read(char* buffer, size_t capacity) override
+    {
+        size_t const numRead = std::min({ capacity, m_MaxChunkSize, m_Contents.size() - m_Offset });
+        std::memcpy(buffer, m_Contents.data() + m_Offset, numRead);
+        m_Offset += numRead;
+        return numRead;
+    }
+
+    bool Failed() const override { return false; }
+
+private:
+    std::string m_Contents;
+    size_t m_MaxChunkSize;
+    size_t m_Offset = 0;
+};
+
+static std::string ReadTestBVH()
+{
+    std::ifstream stream("data/test_bvh.bvh", std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+BEGIN_TEST_FIXTURE(BVHChunkReadersTests)
+
+TEST(ParseBVH_ChunkReader_Matches_Stream_For_Any_Chunk_Size)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+
+    std::string const contents = ReadTestBVH();
+    for (size_t chunkSize : { 1, 2, 3, 7, 64, 1000, 1 << 20 }) {
+        MemoryChunkReader reader(contents, chunkSize);
+        BVHDocument document;
+        TEST_REQUIRE(ParseBVH(reader, document));
+        TEST_REQUIRE(IsSameDocument(document, expected));
+    }
+}
+
+TEST(ParseBVH_Contents_Matches_Stream)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+
+    // Parsing must stop at the end of the given contents, which need not be terminated
+    std::string const contents = ReadTestBVH();
+    std::vector<char> unterminated(contents.begin(), contents.end());
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(unterminated.data(), unterminated.size(), document));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+
+    BVHDocument truncated;
+    TEST_REQUIRE(!ParseBVH(contents.data(), contents.size() / 2, truncated));
+}
+
+TEST(ParseBVH_ChunkReader_Matches_Stream_With_Joint_Selection)
+{
+    BVHJointSelection const selection { { "Root" }, {} };
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected, selection));
+    TEST_REQUIRE(expected.m_JointNames.size() == 1);
+
+    MemoryChunkReader reader(ReadTestBVH(), 5);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(reader, document, selection));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+}
+
+TEST(ParseBVHFrameChunks_Matches_ParseBVH)
+{
+    std::string const contents = GenerateTestBVH(21, 250);
+    BVHJointSelection const selection { {}, { "Joint2" } };
+    BVHDocument expected;
+    MemoryChunkReader expectedReader(contents, 1 << 20);
+    TEST_REQUIRE(ParseBVH(expectedReader, expected, selection));
+    size_t const numJoints = expected.m_JointNames.size();
+
+    // Chunks are handed out in order, with the selected hierarchy, and never more than a chunk is stored
+    MemoryChunkReader reader(contents, 1000);
+    BVHDocument document;
+    size_t nextFrame = 0;
+    bool matches = true;
+    TEST_REQUIRE(ParseBVHFrameChunks(reader, document, 64, [&](BVHDocument const& chunk, size_t firstFrame, size_t numFrames) {
+        matches = matches && firstFrame == nextFrame && numFrames == std::min<size_t>(64, 250 - firstFrame)
+            && chunk.m_JointNames == expected.m_JointNames && chunk.m_JointParents == expected.m_JointParents
+            && chunk.m_FrameTransforms.size() == numFrames * numJoints && chunk.m_FrameTransforms.capacity() <= 64 * numJoints
+            && std::memcmp(chunk.m_FrameTransforms.data(), expected.m_FrameTransforms.data() + firstFrame * numJoints, numFrames * numJoints * sizeof(BVHTransform)) == 0;
+        nextFrame = firstFrame + numFrames;
+        return true;
+    }, selection));
+    TEST_REQUIRE(matches);
+    TEST_REQUIRE(nextFrame == 250);
+}
+
+TEST(ParseBVHFrameChunks_Stops_When_Callback_Fails)
+{
+    MemoryChunkReader reader(GenerateTestBVH(4, 100), 1 << 20);
+    BVHDocument document;
+    size_t numChunks = 0;
+    TEST_REQUIRE(!ParseBVHFrameChunks(reader, document, 10, [&](BVHDocument const&, size_t, size_t) { return ++numChunks < 3; }));
+    TEST_REQUIRE(numChunks == 3);
+}
+
+TEST(ParseBVH_ChunkReader_Fails_On_Truncated_Contents)
+{
+    std::string const contents = ReadTestBVH();
+    MemoryChunkReader reader(contents.substr(0, contents.size() - 100), 7);
+    BVHDocument document;
+    TEST_REQUIRE(!ParseBVH(reader, document));
+}
+
+TEST(BVHPipelinedChunkReader_Matches_Source)
+{
+    std::string const contents = ReadTestBVH();
+    for (size_t chunkSize : { 1, 5, 64, 4096 }) {
+        MemoryChunkReader source(contents, 3);
+        BVHPipelinedChunkReader reader(source, chunkSize, 2);
+
+        std::string result;
+        char buffer[11];
+        while (size_t numRead = reader.Read(buffer, sizeof(buffer))) {
+            result.append(buffer, numRead);
+        }
+        TEST_REQUIRE(!reader.Failed());
+        TEST_REQUIRE(result == contents);
+    }
+}
+
+TEST(BVHPipelinedChunkReader_Can_Be_Destroyed_Before_End)
+{
+    MemoryChunkReader source(std::string(100000, ' '), 10);
+    BVHPipelinedChunkReader reader(source, 16, 2);
+    char buffer[4];
+    TEST_REQUIRE(reader.Read(buffer, sizeof(buffer)) == 4);
+}
+
+TEST(ParseBVH_File_Matches_Contents_Across_Many_Chunks)
+{
+    // Large enough to be read in several chunks, each ending part way through a value
+    std::string const contents = GenerateTestBVH(21, 5000);
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / "usdBVHAnim_pipelined.bvh";
+    {
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << contents;
+    }
+    TEST_REQUIRE(contents.size() > 2 * BVHPipelinedChunkReader::c_DefaultChunkSize);
+
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), expected));
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(filePath.string(), document));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+    std::filesystem::remove(filePath);
+}
+
+TEST(BVHFileChunkReader_Reads_File_Region)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+
+    // The contents are surrounded by other data, as they would be inside a package
+    std::string const contents = ReadTestBVH();
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / "usdBVHAnim_region.bin";
+    {
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << "prefix" << contents << "suffix";
+    }
+
+    // Regions of a shared file can be read by several readers, one after another
+    std::FILE* file = std::fopen(filePath.string().c_str(), "rb");
+    TEST_REQUIRE(file);
+    for (size_t chunkSize : { 7, 4096 }) {
+        BVHFileChunkReader reader(file, 6, contents.size());
+        BVHPipelinedChunkReader pipelinedReader(reader, chunkSize, 2);
+        BVHDocument document;
+        TEST_REQUIRE(ParseBVH(pipelinedReader, document));
+        TEST_REQUIRE(!reader.Failed());
+        TEST_REQUIRE(IsSameDocument(document, expected));
+    }
+
+    // A region that extends beyond the end of the file fails
+    BVHFileChunkReader reader(file, 6, contents.size() + 100);
+    std::vector<char> buffer(contents.size() + 100);
+    reader.Read(buffer.data(), buffer.size());
+    reader.Read(buffer.data(), buffer.size());
+    TEST_REQUIRE(reader.Failed());
+    std::fclose(file);
+    std::filesystem::remove(filePath);
+}
+
+TEST(IsCompressedBVHContents_Matches_Magic_Numbers)
+{
+    TEST_REQUIRE(IsCompressedBVHContents("\x1f\x8b\x08", 3));
+    TEST_REQUIRE(IsCompressedBVHContents("\x28\xb5\x2f\xfd\x00", 5));
+    TEST_REQUIRE(!IsCompressedBVHContents("\x1f", 1));
+    TEST_REQUIRE(!IsCompressedBVHContents("HIERARCHY", 9));
+    TEST_REQUIRE(!IsCompressedBVHContents("", 0));
+}
+
+TEST(IsCompressedBVHPath_Matches_Compressed_Extensions)
+{
+    TEST_REQUIRE(IsCompressedBVHPath("walk.bvh.gz"));
+    TEST_REQUIRE(IsCompressedBVHPath("walk.BVH.GZ"));
+    TEST_REQUIRE(IsCompressedBVHPath("/mocap/walk.bvh.zst"));
+    TEST_REQUIRE(!IsCompressedBVHPath("walk.bvh"));
+    TEST_REQUIRE(!IsCompressedBVHPath("walk.gz"));
+    TEST_REQUIRE(!IsCompressedBVHPath("walk.usd.zst"));
+}
+
+TEST(EndsWithIgnoringCase_Matches_Lower_Case_Suffix)
+{
+    TEST_REQUIRE(EndsWithIgnoringCase("usdBVHAnim-0123.bvhcache", ".bvhcache"));
+    TEST_REQUIRE(EndsWithIgnoringCase("WALK.BVH", ".bvh"));
+    TEST_REQUIRE(EndsWithIgnoringCase(".bvh", ".bvh"));
+    TEST_REQUIRE(!EndsWithIgnoringCase("bvh", ".bvh"));
+    TEST_REQUIRE(!EndsWithIgnoringCase("walk.bvh.tmp", ".bvh"));
+}
+
+#if defined(USDBVHANIM_WITH_ZLIB)
+TEST(ParseBVH_Reads_Gzip_Compressed_File)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh.gz", document));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+}
+
+TEST(ParseBVH_Reads_Gzip_Compressed_Contents)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+    std::ifstream stream("data/test_bvh.bvh.gz", std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    std::string const compressed = contents.str();
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(compressed.data(), compressed.size(), document));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+}
+#endif
+
+#if defined(USDBVHANIM_WITH_ZSTD)
+TEST(ParseBVH_Reads_Zstd_Compressed_File)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh.zst", document));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+}
+
+TEST(ParseBVH_Reads_Zstd_Compressed_Contents)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+    std::ifstream stream("data/test_bvh.bvh.zst", std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    std::string const compressed = contents.str();
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(compressed.data(), compressed.size(), document));
+    TEST_REQUIRE(IsSameDocument(document, expected));
+}
+#endif
+
+END_TEST_FIXTURE()
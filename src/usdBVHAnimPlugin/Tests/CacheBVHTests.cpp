@@ -0,0 +1,219 @@
+#include "CacheBVH.h"
+#include "CompareBVH.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "Tests.h"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace usdBVHAnimPlugin;
+
+//! Returns options for an empty cache in its own temporary directory
+static BVHSharedCacheOptions CreateTestCache()
+{
+    BVHSharedCacheOptions options;
+    options.m_Directory = (std::filesystem::temp_directory_path() / "usdBVHAnim_cache_tests").string();
+    std::filesystem::remove_all(options.m_Directory);
+    std::filesystem::create_directories(options.m_Directory);
+    return options;
+}
+
+static std::vector<std::filesystem::path> GetCachedFiles(BVHSharedCacheOptions const& options)
+{
+    std::vector<std::filesystem::path> cachedFiles;
+    for (auto const& entry : std::filesystem::directory_iterator(options.m_Directory)) {
+        if (entry.path().extension() == ".bvhcache") {
+            cachedFiles.push_back(entry.path());
+        }
+    }
+    return cachedFiles;
+}
+
+static std::string WriteTestBVH(BVHSharedCacheOptions const& options, char const* name, size_t numJoints, size_t numFrames)
+{
+    std::filesystem::path const filePath = std::filesystem::path(options.m_Directory).parent_path() / name;
+    std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+    stream << GenerateTestBVH(numJoints, numFrames);
+    return filePath.string();
+}
+#endif
+
+BEGIN_TEST_FIXTURE(CacheBVHTests)
+
+#if !defined(_WIN32)
+TEST(ParseSharedBVH_Reads_Cached_Document)
+{
+    BVHSharedCacheOptions const options = CreateTestCache();
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+
+    bool cacheHit = true;
+    BVHDocument parsed;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", parsed, options, &cacheHit));
+    TEST_REQUIRE(!cacheHit);
+    TEST_REQUIRE(IsSameDocument(parsed, expected));
+    TEST_REQUIRE(GetCachedFiles(options).size() == 1);
+
+    BVHDocument cached;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", cached, options, &cacheHit));
+    TEST_REQUIRE(cacheHit);
+    TEST_REQUIRE(IsSameDocument(cached, expected));
+
+    ClearSharedBVH(options);
+    TEST_REQUIRE(GetCachedFiles(options).empty());
+}
+
+TEST(ParseSharedBVH_Shares_Document_Between_Files_And_Contents)
+{
+    BVHSharedCacheOptions const options = CreateTestCache();
+    BVHDocument expected;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", expected, options));
+
+    std::ifstream stream("data/test_bvh.bvh", std::ios::in | std::ios::binary);
+    std::string const contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    bool cacheHit = false;
+    BVHDocument document;
+    TEST_REQUIRE(ParseSharedBVH(contents.data(), contents.size(), document, options, &cacheHit));
+    TEST_REQUIRE(cacheHit);
+    TEST_REQUIRE(IsSameDocument(document, expected));
+    TEST_REQUIRE(GetCachedFiles(options).size() == 1);
+}
+
+TEST(ParseSharedBVH_Parses_Again_When_Contents_Change)
+{
+    BVHSharedCacheOptions const options = CreateTestCache();
+    std::string const filePath = WriteTestBVH(options, "usdBVHAnim_cache_changes.bvh", 5, 10);
+    bool cacheHit = true;
+    BVHDocument document;
+    TEST_REQUIRE(ParseSharedBVH(filePath, document, options, &cacheHit));
+    TEST_REQUIRE(!cacheHit);
+
+    WriteTestBVH(options, "usdBVHAnim_cache_changes.bvh", 5, 11);
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH(filePath, expected));
+    BVHDocument changed;
+    TEST_REQUIRE(ParseSharedBVH(filePath, changed, options, &cacheHit));
+    TEST_REQUIRE(!cacheHit);
+    TEST_REQUIRE(IsSameDocument(changed, expected));
+    std::filesystem::remove(filePath);
+}
+
+TEST(ParseSharedBVH_Replaces_Corrupt_Cached_Document)
+{
+    BVHSharedCacheOptions const options = CreateTestCache();
+    BVHDocument expected;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", expected, options));
+    auto const cachedFiles = GetCachedFiles(options);
+    TEST_REQUIRE(cachedFiles.size() == 1);
+    std::filesystem::resize_file(cachedFiles[0], std::filesystem::file_size(cachedFiles[0]) - 1);
+
+    bool cacheHit = true;
+    BVHDocument document;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", document, options, &cacheHit));
+    TEST_REQUIRE(!cacheHit);
+    TEST_REQUIRE(IsSameDocument(document, expected));
+    BVHDocument cached;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", cached, options, &cacheHit));
+    TEST_REQUIRE(cacheHit);
+}
+
+TEST(ParseSharedBVH_Parses_Without_Cache_Directory)
+{
+    BVHSharedCacheOptions options;
+    options.m_Directory = (std::filesystem::temp_directory_path() / "usdBVHAnim_cache_tests_missing").string();
+    bool cacheHit = true;
+    BVHDocument document;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", document, options, &cacheHit));
+    TEST_REQUIRE(!cacheHit);
+    TEST_REQUIRE(document.m_JointNames.size() == 2);
+    BVHDocument missing;
+    TEST_REQUIRE(!ParseSharedBVH("data/does_not_exist.bvh", missing, options));
+}
+
+TEST(EvictSharedBVH_Keeps_Cache_Within_Max_Bytes)
+{
+    BVHSharedCacheOptions options = CreateTestCache();
+    std::vector<std::string> filePaths;
+    for (char const* name : { "usdBVHAnim_cache_evict0.bvh", "usdBVHAnim_cache_evict1.bvh", "usdBVHAnim_cache_evict2.bvh" }) {
+        filePaths.push_back(WriteTestBVH(options, name, 4, 100 + filePaths.size()));
+    }
+
+    // Each cached document is a little over 22KB, so only two fit in the cache
+    options.m_MaxBytes = 50000;
+    for (std::string const& filePath : filePaths) {
+        BVHDocument document;
+        TEST_REQUIRE(ParseSharedBVH(filePath, document, options));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    TEST_REQUIRE(GetCachedFiles(options).size() == 2);
+
+    // The least recently used document was evicted
+    bool cacheHit = true;
+    BVHDocument newest;
+    TEST_REQUIRE(ParseSharedBVH(filePaths[2], newest, options, &cacheHit));
+    TEST_REQUIRE(cacheHit);
+    BVHDocument oldest;
+    TEST_REQUIRE(ParseSharedBVH(filePaths[0], oldest, options, &cacheHit));
+    TEST_REQUIRE(!cacheHit);
+
+    for (std::string const& filePath : filePaths) {
+        std::filesystem::remove(filePath);
+    }
+}
+
+TEST(ParseSharedBVH_Parses_Once_When_Read_Concurrently)
+{
+    BVHSharedCacheOptions const options = CreateTestCache();
+    std::string const filePath = WriteTestBVH(options, "usdBVHAnim_cache_concurrent.bvh", 32, 200);
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH(filePath, expected));
+
+    // Only the first reader parses the file, while every other reader waits for it to be published
+    size_t constexpr c_NumThreads = 8;
+    std::vector<BVHDocument> documents(c_NumThreads);
+    bool parsed[c_NumThreads] = {};
+    bool cacheHits[c_NumThreads] = {};
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < c_NumThreads; ++i) {
+        threads.emplace_back([&, i]() { parsed[i] = ParseSharedBVH(filePath, documents[i], options, &cacheHits[i]); });
+    }
+    size_t numMisses = 0;
+    for (size_t i = 0; i < c_NumThreads; ++i) {
+        threads[i].join();
+        TEST_REQUIRE(parsed[i]);
+        TEST_REQUIRE(IsSameDocument(documents[i], expected));
+        numMisses += cacheHits[i] ? 0 : 1;
+    }
+    TEST_REQUIRE(numMisses == 1);
+    std::filesystem::remove(filePath);
+}
+
+TEST(ParseSharedBVH_Shares_Document_With_Other_Processes)
+{
+    BVHSharedCacheOptions const options = CreateTestCache();
+    BVHDocument expected;
+    TEST_REQUIRE(ParseSharedBVH("data/test_bvh.bvh", expected, options));
+
+    pid_t const child = fork();
+    if (child == 0) {
+        bool cacheHit = false;
+        BVHDocument document;
+        bool const shared = ParseSharedBVH("data/test_bvh.bvh", document, options, &cacheHit) && cacheHit && IsSameDocument(document, expected);
+        _exit(shared ? 0 : 1);
+    }
+    TEST_REQUIRE(child > 0);
+    int status = 0;
+    TEST_REQUIRE(waitpid(child, &status, 0) == child);
+    TEST_REQUIRE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::filesystem::remove_all(options.m_Directory);
+}
+#endif
+
+END_TEST_FIXTURE()
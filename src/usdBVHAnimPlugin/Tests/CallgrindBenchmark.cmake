@@ -0,0 +1,71 @@
+# Runs a single benchmark of the test executable under Callgrind, and compares its instruction count
+# and last-level cache misses against the baseline recorded in a JSON file. Run in script mode with:
+#
+#   cmake -DVALGRIND_PATH=<valgrind> -DVALGRIND_ARGS=<args> -DTEST_EXECUTABLE=<executable> -DBENCHMARK=<name>
+#         -DBASELINE_FILE=<baseline.json> -DOUTPUT_DIR=<dir> -DTOOLCHAIN=<compiler> [-DUPDATE_BASELINE=ON] -P CallgrindBenchmark.cmake
+#
+# Instruction counts depend on the compiler, so only baselines recorded with the same toolchain are compared.
+# Benchmarks without such a baseline only report their counts, until one is recorded with the update target.
+cmake_minimum_required(VERSION 3.28)
+
+set(OUTPUT_FILE ${OUTPUT_DIR}/callgrind.out.${BENCHMARK})
+execute_process(
+    COMMAND ${VALGRIND_PATH} --tool=callgrind --instr-atstart=no --cache-sim=yes --callgrind-out-file=${OUTPUT_FILE} ${VALGRIND_ARGS}
+            ${TEST_EXECUTABLE} --callgrind ${BENCHMARK}
+    RESULT_VARIABLE RESULT
+)
+if(NOT RESULT EQUAL 0)
+    message(FATAL_ERROR "Benchmark '${BENCHMARK}' failed with exit code ${RESULT}")
+endif()
+
+# Pair up the event names with the totals written at the end of the Callgrind output
+file(STRINGS ${OUTPUT_FILE} EVENTS REGEX "^events: ")
+file(STRINGS ${OUTPUT_FILE} TOTALS REGEX "^(summary|totals): ")
+list(GET TOTALS -1 TOTALS)
+string(REGEX REPLACE "^events: " "" EVENTS "${EVENTS}")
+string(REGEX REPLACE "^(summary|totals): " "" TOTALS "${TOTALS}")
+separate_arguments(EVENTS)
+separate_arguments(TOTALS)
+foreach(EVENT IN ZIP_LISTS EVENTS TOTALS)
+    set(EVENT_${EVENT_0} ${EVENT_1})
+endforeach()
+
+# Last-level cache misses are the sum of instruction, data read and data write misses
+math(EXPR EVENT_LLmiss "${EVENT_ILmr} + ${EVENT_DLmr} + ${EVENT_DLmw}")
+message(STATUS "${BENCHMARK}: ${EVENT_Ir} instructions, ${EVENT_LLmiss} last-level cache misses")
+
+file(READ ${BASELINE_FILE} BASELINE)
+if(UPDATE_BASELINE)
+    string(JSON BASELINE SET "${BASELINE}" benchmarks ${BENCHMARK} "{ \"Ir\": ${EVENT_Ir}, \"LLmiss\": ${EVENT_LLmiss} }")
+    string(JSON BASELINE SET "${BASELINE}" toolchain "\"${TOOLCHAIN}\"")
+    file(WRITE ${BASELINE_FILE} "${BASELINE}\n")
+    message(STATUS "Updated baseline for '${BENCHMARK}' in ${BASELINE_FILE}")
+    return()
+endif()
+
+string(JSON BASELINE_BENCHMARK ERROR_VARIABLE MISSING GET "${BASELINE}" benchmarks ${BENCHMARK})
+if(MISSING)
+    message(STATUS "No baseline recorded for '${BENCHMARK}' in ${BASELINE_FILE}, record one with the "
+                   "usdBVHAnimPlugin_Callgrind_Update_Baseline target")
+    return()
+endif()
+
+string(JSON BASELINE_TOOLCHAIN ERROR_VARIABLE MISSING GET "${BASELINE}" toolchain)
+if(MISSING OR NOT BASELINE_TOOLCHAIN STREQUAL TOOLCHAIN)
+    message(STATUS "Baseline was recorded with '${BASELINE_TOOLCHAIN}' rather than '${TOOLCHAIN}', so it is not compared")
+    return()
+endif()
+
+foreach(EVENT Ir LLmiss)
+    string(JSON EXPECTED ERROR_VARIABLE MISSING GET "${BASELINE_BENCHMARK}" ${EVENT})
+    if(MISSING)
+        message(FATAL_ERROR "No ${EVENT} baseline recorded for '${BENCHMARK}' in ${BASELINE_FILE}")
+    endif()
+    string(JSON TOLERANCE GET "${BASELINE}" tolerance_percent ${EVENT})
+    math(EXPR LIMIT "${EXPECTED} + ${EXPECTED} * ${TOLERANCE} / 100")
+    if(EVENT_${EVENT} GREATER LIMIT)
+        message(SEND_ERROR "${BENCHMARK}: ${EVENT} of ${EVENT_${EVENT}} exceeds baseline of ${EXPECTED} by more than ${TOLERANCE}%")
+    else()
+        message(STATUS "${BENCHMARK}: ${EVENT} of ${EVENT_${EVENT}} is within ${TOLERANCE}% of baseline of ${EXPECTED}")
+    endif()
+endforeach()
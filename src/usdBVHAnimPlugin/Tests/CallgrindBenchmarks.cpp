@@ -0,0 +1,80 @@
+#include "CallgrindBenchmarks.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <pxr/usd/sdf/layer.h>
+#include <sstream>
+
+#if defined(USDBVHANIM_WITH_CALLGRIND)
+#include <valgrind/callgrind.h>
+#else
+#define CALLGRIND_START_INSTRUMENTATION
+#define CALLGRIND_STOP_INSTRUMENTATION
+#endif
+
+using namespace usdBVHAnimPlugin;
+
+//! Parse the given contents twice, only measuring the second parse, so that one-off costs (e.g.
+//! growing the retained scratch buffer) are not measured
+static bool MeasureParseBVH(std::string const& contents)
+{
+    {
+        std::istringstream stream(contents, std::ios::in | std::ios::binary);
+        BVHDocument document;
+        if (!ParseBVH(stream, document)) {
+            return false;
+        }
+    }
+
+    std::istringstream stream(contents, std::ios::in | std::ios::binary);
+    BVHDocument document;
+    CALLGRIND_START_INSTRUMENTATION;
+    bool const success = ParseBVH(stream, document);
+    CALLGRIND_STOP_INSTRUMENTATION;
+    return success;
+}
+
+//! Read the given contents as a layer twice, only measuring the second read, so that one-off
+//! costs (e.g. loading plug-ins and registering schemas) are not measured
+static bool MeasureBvhFileFormatRead(std::string const& contents)
+{
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / "usdBVHAnim_callgrind.bvh";
+    {
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << contents;
+    }
+
+    bool success = bool(pxr::SdfLayer::OpenAsAnonymous(filePath.string()));
+    if (success) {
+        CALLGRIND_START_INSTRUMENTATION;
+        success = bool(pxr::SdfLayer::OpenAsAnonymous(filePath.string()));
+        CALLGRIND_STOP_INSTRUMENTATION;
+    }
+    std::filesystem::remove(filePath);
+    return success;
+}
+
+int RunCallgrindBenchmark(std::string const& name)
+{
+    bool success = false;
+    if (name == "ParseHierarchy") {
+        // A file without any frames, such that only the hierarchy is parsed
+        success = MeasureParseBVH(GenerateTestBVH(1024, 0));
+    } else if (name == "ParseMotion") {
+        // A file with few enough joints that parsing is dominated by decoding the motion
+        success = MeasureParseBVH(GenerateTestBVH(64, 2000));
+    } else if (name == "BvhFileFormat_Read") {
+        success = MeasureBvhFileFormatRead(GenerateTestBVH(64, 100));
+    } else {
+        printf("\tUnknown benchmark '%s'\n", name.c_str());
+        return 1;
+    }
+
+    if (!success) {
+        printf("\tBenchmark '%s' failed\n", name.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+
+//! Run the named benchmark with Callgrind instrumentation enabled only around the code being
+//! measured, such that running this under `valgrind --tool=callgrind --instr-atstart=no` counts the
+//! instructions (and simulated cache misses) of that code alone. Returns a non-zero exit code if
+//! the benchmark does not exist or fails.
+int RunCallgrindBenchmark(std::string const& name);
@@ -0,0 +1,15 @@
+#include "CompareBVH.h"
+#include <cstring>
+
+using namespace usdBVHAnimPlugin;
+
+bool IsSameDocument(BVHDocument const& a, BVHDocument const& b)
+{
+    if (a.m_JointNames != b.m_JointNames || a.m_JointParents != b.m_JointParents || a.m_JointNumChannels != b.m_JointNumChannels
+        || a.m_JointChannels != b.m_JointChannels || a.m_FrameTime != b.m_FrameTime
+        || a.m_JointOffsets.size() != b.m_JointOffsets.size() || a.m_FrameTransforms.size() != b.m_FrameTransforms.size()) {
+        return false;
+    }
+    return (a.m_JointOffsets.empty() || std::memcmp(a.m_JointOffsets.data(), b.m_JointOffsets.data(), a.m_JointOffsets.size() * sizeof(BVHOffset)) == 0)
+        && (a.m_FrameTransforms.empty() || std::memcmp(a.m_FrameTransforms.data(), b.m_FrameTransforms.data(), a.m_FrameTransforms.size() * sizeof(BVHTransform)) == 0);
+}
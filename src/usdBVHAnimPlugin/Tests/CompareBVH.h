@@ -0,0 +1,7 @@
+#pragma once
+#include "ParseBVH.h"
+
+//! Returns `true` if the given documents hold the same joints and frames, comparing their offsets
+//! and frame transforms bit for bit, such that parsing the same contents along different paths
+//! (e.g. in chunks, through a cache or from a seek index) can be checked to give the same result.
+bool IsSameDocument(usdBVHAnimPlugin::BVHDocument const& a, usdBVHAnimPlugin::BVHDocument const& b);
@@ -0,0 +1,130 @@
+#include "CompressBVH.h"
+#include "ParseBVH.h"
+#include "Tests.h"
+#include <cmath>
+
+using namespace usdBVHAnimPlugin;
+
+//! Build a synthetic take resembling a motion capture skeleton, in which the root
+//! translates, most joints rotate, and a handful of joints are never animated
+static BVHDocument MakeSyntheticTake(size_t numJoints, size_t numFrames)
+{
+    BVHDocument document;
+    document.m_FrameTime = 1.0 / 120.0;
+    for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+        document.m_JointNames.emplace_back("Joint" + std::to_string(jointIndex));
+        document.m_JointParents.push_back(jointIndex == 0 ? BVHDocument::c_RootParentIndex : static_cast<int>(jointIndex - 1));
+        document.m_JointOffsets.push_back({ { 0.0, 10.0, 0.0 } });
+        document.m_JointNumChannels.push_back(jointIndex == 0 ? 6 : 3);
+        document.m_JointChannels.push_back(0);
+    }
+
+    for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
+        double const t = static_cast<double>(frameIndex) * document.m_FrameTime;
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            BVHTransform transform = { { 0.0, 0.0, 0.0, 1.0 }, { 0.0, 10.0, 0.0 } };
+            if (jointIndex == 0) {
+                transform.m_Translation[0] = 150.0 * t;
+                transform.m_Translation[1] = 90.0 + 3.0 * std::sin(t * 6.0);
+                transform.m_Translation[2] = 20.0 * std::cos(t * 0.5);
+            }
+            if (jointIndex % 8 != 7) {
+                double const angle = 0.8 * std::sin(t * (1.0 + 0.1 * static_cast<double>(jointIndex)));
+                double axis[3] = { std::sin(static_cast<double>(jointIndex)), std::cos(static_cast<double>(jointIndex)), 0.5 };
+                double const axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+                for (size_t c = 0; c < 3; ++c) {
+                    transform.m_RotationQuat[c] = axis[c] / axisLength * std::sin(angle * 0.5);
+                }
+                transform.m_RotationQuat[3] = std::cos(angle * 0.5);
+            }
+            document.m_FrameTransforms.push_back(transform);
+        }
+    }
+    return document;
+}
+
+static void PrintCompressionReport(char const* name, BVHCompressionReport const& report)
+{
+    printf("\t%s: %zu -> %zu bytes (%.2fx), max rotation error %.3g rad, max translation error %.3g\n",
+        name,
+        report.m_UncompressedBytes,
+        report.m_CompressedBytes,
+        report.m_CompressionRatio,
+        report.m_MaxRotationError,
+        report.m_MaxTranslationError);
+}
+
+BEGIN_TEST_FIXTURE(CompressBVHTests)
+
+TEST(CompressBVH_TestData_Within_Error_Bounds)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+
+    BVHCompressedAnimation animation;
+    TEST_REQUIRE(CompressBVH(document, BVHCompressionSettings {}, animation));
+    TEST_REQUIRE(animation.m_NumJoints == 2);
+    TEST_REQUIRE(animation.m_NumFrames == 20);
+
+    // The 'Foo' joint has a constant translation, which should have been elided
+    TEST_REQUIRE(animation.m_TranslationTracks[1] == BVHCompressedAnimation::c_ConstantTrack);
+    TEST_REQUIRE(animation.m_RotationTracks[0] != BVHCompressedAnimation::c_ConstantTrack);
+    TEST_REQUIRE(animation.m_RotationTracks[1] != BVHCompressedAnimation::c_ConstantTrack);
+
+    BVHCompressionReport report = MeasureBVHCompression(document, animation);
+    PrintCompressionReport("data/test_bvh.bvh", report);
+    TEST_REQUIRE(report.m_CompressionRatio > 1.5);
+    TEST_REQUIRE(report.m_MaxRotationError < 1e-3);
+    TEST_REQUIRE(report.m_MaxTranslationError < 1e-4);
+}
+
+TEST(CompressBVH_SyntheticTake_Within_Error_Bounds)
+{
+    // The root travels 3000 units over this take, so 16-bit quantization of its
+    // translation is accurate to within 3000 / 65535 / 2 units
+    BVHDocument document = MakeSyntheticTake(64, 2400);
+    double const c_MaxTranslationError = 3000.0 / 65535.0 / 2.0 + 1e-3;
+
+    BVHCompressedAnimation animation;
+    TEST_REQUIRE(CompressBVH(document, BVHCompressionSettings {}, animation));
+    BVHCompressionReport report = MeasureBVHCompression(document, animation);
+    PrintCompressionReport("synthetic take with constant track elision", report);
+    TEST_REQUIRE(report.m_CompressionRatio > 3.0);
+    TEST_REQUIRE(report.m_MaxRotationError < 1e-3);
+    TEST_REQUIRE(report.m_MaxTranslationError < c_MaxTranslationError);
+
+    BVHCompressionSettings settings;
+    settings.m_ElideConstantTracks = false;
+    TEST_REQUIRE(CompressBVH(document, settings, animation));
+    report = MeasureBVHCompression(document, animation);
+    PrintCompressionReport("synthetic take without constant track elision", report);
+    TEST_REQUIRE(report.m_CompressionRatio > 2.0);
+    TEST_REQUIRE(report.m_MaxRotationError < 1e-3);
+    TEST_REQUIRE(report.m_MaxTranslationError < c_MaxTranslationError);
+}
+
+TEST(DecompressBVHFrames_Range_Matches_Full_Decompression)
+{
+    BVHDocument document = MakeSyntheticTake(19, 100);
+    BVHCompressedAnimation animation;
+    TEST_REQUIRE(CompressBVH(document, BVHCompressionSettings {}, animation));
+
+    std::vector<BVHTransform> all(100 * 19);
+    std::vector<BVHTransform> range(10 * 19);
+    TEST_REQUIRE(DecompressBVHFrames(animation, 0, 100, all.data()));
+    TEST_REQUIRE(DecompressBVHFrames(animation, 45, 10, range.data()));
+    for (size_t i = 0; i < range.size(); ++i) {
+        auto const& expected = all[45 * 19 + i];
+        for (size_t c = 0; c < 4; ++c) {
+            TEST_REQUIRE(range[i].m_RotationQuat[c] == expected.m_RotationQuat[c]);
+        }
+        for (size_t c = 0; c < 3; ++c) {
+            TEST_REQUIRE(range[i].m_Translation[c] == expected.m_Translation[c]);
+        }
+    }
+
+    TEST_REQUIRE(!DecompressBVHFrames(animation, 95, 10, range.data()));
+    TEST_REQUIRE(!DecompressBVHFrames(animation, 101, 0, range.data()));
+}
+
+END_TEST_FIXTURE()
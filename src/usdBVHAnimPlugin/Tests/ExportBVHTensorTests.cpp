@@ -0,0 +1,167 @@
+#include "ExportBVHTensor.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "Tests.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+using namespace usdBVHAnimPlugin;
+
+static std::string ReadFile(std::filesystem::path const& filePath)
+{
+    std::ifstream stream(filePath, std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    return contents.str();
+}
+
+//! Returns the offset of the tensor in the given `.npy` file contents, or zero if its header does not match the given one
+static size_t FindNpyData(std::string const& contents, std::string const& expectedHeader)
+{
+    if (contents.size() < 10 || contents.compare(0, 8, "\x93NUMPY\x01\x00", 8) != 0) {
+        return 0;
+    }
+    size_t const headerLength = static_cast<unsigned char>(contents[8]) | (static_cast<unsigned char>(contents[9]) << 8);
+    size_t const dataOffset = 10 + headerLength;
+    if (dataOffset % 64 != 0 || contents.size() < dataOffset || contents[dataOffset - 1] != '\n'
+        || contents.compare(10, expectedHeader.size(), expectedHeader) != 0) {
+        return 0;
+    }
+    return dataOffset;
+}
+
+BEGIN_TEST_FIXTURE(ExportBVHTensorTests)
+
+TEST(ExportBVHTensor_Writes_Frame_Transforms)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+    std::filesystem::path const npyPath = std::filesystem::temp_directory_path() / "usdBVHAnim_export_test.npy";
+    std::filesystem::path const jsonPath = std::filesystem::temp_directory_path() / "usdBVHAnim_export_test.json";
+    TEST_REQUIRE(ExportBVHTensor(document, npyPath.string(), jsonPath.string()));
+
+    std::string const npy = ReadFile(npyPath);
+    size_t const dataOffset = FindNpyData(npy, "{'descr': '<f8', 'fortran_order': False, 'shape': (20, 2, 7), }");
+    TEST_REQUIRE(dataOffset != 0);
+    TEST_REQUIRE(npy.size() - dataOffset == document.m_FrameTransforms.size() * sizeof(BVHTransform));
+    TEST_REQUIRE(std::memcmp(npy.data() + dataOffset, document.m_FrameTransforms.data(), npy.size() - dataOffset) == 0);
+
+    std::string const json = ReadFile(jsonPath);
+    TEST_REQUIRE(json.find("\"joint_names\": [\"Root\", \"Foo\"]") != std::string::npos);
+    TEST_REQUIRE(json.find("\"joint_parents\": [-1, 0]") != std::string::npos);
+    TEST_REQUIRE(json.find("\"joint_offsets\": [[0, 0, 0], [0, 0, 1]]") != std::string::npos);
+    TEST_REQUIRE(json.find("\"shape\": [20, 2, 7]") != std::string::npos);
+    TEST_REQUIRE(json.find("\"dtype\": \"<f8\"") != std::string::npos);
+
+    std::filesystem::remove(npyPath);
+    std::filesystem::remove(jsonPath);
+}
+
+TEST(ExportBVHTensor_Writes_Single_Precision)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+    std::filesystem::path const npyPath = std::filesystem::temp_directory_path() / "usdBVHAnim_export_test_f4.npy";
+    std::filesystem::path const jsonPath = std::filesystem::temp_directory_path() / "usdBVHAnim_export_test_f4.json";
+    BVHTensorOptions options;
+    options.m_SinglePrecision = true;
+    TEST_REQUIRE(ExportBVHTensor(document, npyPath.string(), jsonPath.string(), options));
+
+    std::string const npy = ReadFile(npyPath);
+    size_t const dataOffset = FindNpyData(npy, "{'descr': '<f4', 'fortran_order': False, 'shape': (20, 2, 7), }");
+    TEST_REQUIRE(dataOffset != 0);
+    size_t const numValues = document.m_FrameTransforms.size() * 7;
+    TEST_REQUIRE(npy.size() - dataOffset == numValues * sizeof(float));
+    double const* values = document.m_FrameTransforms.data()->m_RotationQuat;
+    for (size_t i = 0; i < numValues; ++i) {
+        float value;
+        std::memcpy(&value, npy.data() + dataOffset + i * sizeof(float), sizeof(float));
+        TEST_REQUIRE(value == static_cast<float>(values[i]));
+    }
+    TEST_REQUIRE(ReadFile(jsonPath).find("\"dtype\": \"<f4\"") != std::string::npos);
+
+    std::filesystem::remove(npyPath);
+    std::filesystem::remove(jsonPath);
+}
+
+TEST(ExportBVHTensors_Exports_Every_File)
+{
+    std::filesystem::path const directory = std::filesystem::temp_directory_path() / "usdBVHAnim_export_tensors";
+    std::filesystem::create_directories(directory);
+    std::vector<std::string> bvhPaths;
+    for (size_t i = 0; i < 6; ++i) {
+        std::filesystem::path const bvhPath = directory / ("clip" + std::to_string(i) + ".bvh");
+        std::ofstream stream(bvhPath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(i + 1, 10 * (i + 1));
+        bvhPaths.push_back(bvhPath.string());
+    }
+    bvhPaths.push_back((directory / "missing.bvh").string());
+
+    std::vector<std::string> failedPaths;
+    TEST_REQUIRE(!ExportBVHTensors(bvhPaths, directory.string(), {}, 3, &failedPaths));
+    TEST_REQUIRE(failedPaths.size() == 1 && failedPaths[0] == bvhPaths.back());
+    for (size_t i = 0; i < 6; ++i) {
+        std::string const stem = "clip" + std::to_string(i);
+        std::string const header = "{'descr': '<f8', 'fortran_order': False, 'shape': (" + std::to_string(10 * (i + 1)) + ", " + std::to_string(i + 1) + ", 7), }";
+        TEST_REQUIRE(FindNpyData(ReadFile(directory / (stem + ".npy")), header) != 0);
+        TEST_REQUIRE(std::filesystem::exists(directory / (stem + ".json")));
+    }
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST(ExportBVHTensors_Mirrors_Directories_Of_Same_Named_Files)
+{
+    std::filesystem::path const directory = std::filesystem::temp_directory_path() / "usdBVHAnim_export_same_named";
+    std::filesystem::path const outputDirectory = directory / "tensors";
+    std::filesystem::create_directories(directory / "s01");
+    std::filesystem::create_directories(directory / "s02");
+    std::vector<std::string> bvhPaths;
+    for (size_t i = 0; i < 2; ++i) {
+        std::filesystem::path const bvhPath = directory / ("s0" + std::to_string(i + 1)) / "walk.bvh";
+        std::ofstream stream(bvhPath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(i + 1, 10 * (i + 1));
+        bvhPaths.push_back(bvhPath.string());
+    }
+    {
+        std::filesystem::path const bvhPath = directory / "s01" / "run.bvh";
+        std::ofstream stream(bvhPath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(3, 5);
+        bvhPaths.push_back(bvhPath.string());
+    }
+    // The same file given twice can only be exported once
+    bvhPaths.push_back(bvhPaths[0]);
+
+    std::vector<std::string> failedPaths;
+    TEST_REQUIRE(!ExportBVHTensors(bvhPaths, outputDirectory.string(), {}, 4, &failedPaths));
+    TEST_REQUIRE(failedPaths.size() == 1 && failedPaths[0] == bvhPaths.back());
+    for (size_t i = 0; i < 2; ++i) {
+        std::filesystem::path const stem = outputDirectory / ("s0" + std::to_string(i + 1)) / "walk";
+        std::string const header = "{'descr': '<f8', 'fortran_order': False, 'shape': (" + std::to_string(10 * (i + 1)) + ", " + std::to_string(i + 1) + ", 7), }";
+        TEST_REQUIRE(FindNpyData(ReadFile(stem.string() + ".npy"), header) != 0);
+        TEST_REQUIRE(std::filesystem::exists(stem.string() + ".json"));
+    }
+    TEST_REQUIRE(!std::filesystem::exists(outputDirectory / "walk.npy"));
+    TEST_REQUIRE(std::filesystem::exists(outputDirectory / "run.npy"));
+
+    std::filesystem::remove_all(directory);
+}
+
+#if defined(USDBVHANIM_WITH_ZLIB)
+TEST(ExportBVHTensors_Names_Compressed_Files_Without_Extensions)
+{
+    std::filesystem::path const directory = std::filesystem::temp_directory_path() / "usdBVHAnim_export_compressed";
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::string> failedPaths;
+    TEST_REQUIRE(ExportBVHTensors({ "data/test_bvh.bvh.gz" }, directory.string(), {}, 1, &failedPaths));
+    TEST_REQUIRE(std::filesystem::exists(directory / "test_bvh.npy"));
+    TEST_REQUIRE(std::filesystem::exists(directory / "test_bvh.json"));
+
+    std::filesystem::remove_all(directory);
+}
+#endif
+
+END_TEST_FIXTURE()
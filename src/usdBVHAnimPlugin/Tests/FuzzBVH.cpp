@@ -0,0 +1,310 @@
+#include "FuzzBVH.h"
+#include "BVHChunkReaders.h"
+#include "ParseBVH.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace usdBVHAnimPlugin;
+
+namespace {
+    //! A copy of some contents that ends where an inaccessible page of memory begins, so that
+    //! reading past their end faults. If no such page can be mapped, the contents are copied into
+    //! an allocation of exactly their size, past which reads are caught by AddressSanitizer.
+    class GuardedContents {
+    public:
+        GuardedContents(uint8_t const* data, size_t size)
+            : m_Size(size)
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            size_t const pageSize = info.dwPageSize;
+#else
+            size_t const pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+            size_t const dataSize = (size + pageSize - 1) / pageSize * pageSize;
+            m_MappingSize = dataSize + pageSize;
+#if defined(_WIN32)
+            void* mapping = VirtualAlloc(nullptr, m_MappingSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            DWORD oldProtection;
+            if (mapping && !VirtualProtect(static_cast<char*>(mapping) + dataSize, pageSize, PAGE_NOACCESS, &oldProtection)) {
+                VirtualFree(mapping, 0, MEM_RELEASE);
+                mapping = nullptr;
+            }
+#else
+            void* mapping = mmap(nullptr, m_MappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (mapping == MAP_FAILED) {
+                mapping = nullptr;
+            } else if (mprotect(static_cast<char*>(mapping) + dataSize, pageSize, PROT_NONE) != 0) {
+                munmap(mapping, m_MappingSize);
+                mapping = nullptr;
+            }
+#endif
+            if (mapping) {
+                m_Mapping = static_cast<char*>(mapping);
+                m_Data = m_Mapping + dataSize - size;
+            } else {
+                m_Allocation.reset(new char[size]);
+                m_Data = m_Allocation.get();
+            }
+            if (size > 0) {
+                std::memcpy(m_Data, data, size);
+            }
+        }
+
+        ~GuardedContents()
+        {
+            if (m_Mapping) {
+#if defined(_WIN32)
+                VirtualFree(m_Mapping, 0, MEM_RELEASE);
+#else
+                munmap(m_Mapping, m_MappingSize);
+#endif
+            }
+        }
+
+        GuardedContents(GuardedContents const&) = delete;
+        GuardedContents& operator=(GuardedContents const&) = delete;
+
+        char const* Data() const { return m_Data; }
+        size_t Size() const { return m_Size; }
+
+    private:
+        char* m_Mapping = nullptr;
+        size_t m_MappingSize = 0;
+        std::unique_ptr<char[]> m_Allocation;
+        char* m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+
+    //! Each entry point of the parser that is fuzzed, given contents held in memory
+    struct FuzzEntryPoint {
+        char const* m_Name;
+        void (*m_Parse)(char const* contents, size_t size);
+    };
+
+    FuzzEntryPoint const c_FuzzEntryPoints[] = {
+        { "ParseBVH(contents, document)", [](char const* contents, size_t size) {
+             BVHDocument document;
+             ParseBVH(contents, size, document);
+         } },
+        { "ParseBVH(contents, visitor)", [](char const* contents, size_t size) {
+             BVHVisitor visitor;
+             ParseBVH(contents, size, visitor);
+         } },
+        { "ParseBVH(reader, document)", [](char const* contents, size_t size) {
+             BVHMemoryChunkReader reader(contents, size);
+             BVHDocument document;
+             ParseBVH(reader, document);
+         } },
+        { "ParseBVHHeader", [](char const* contents, size_t size) {
+             BVHDocument document;
+             size_t numFrames = 0;
+             size_t headerSize = 0;
+             ParseBVHHeader(contents, size, document, numFrames, headerSize);
+         } },
+    };
+
+    //! Returns the least time taken, in seconds, by the given entry point to parse the given contents
+    //! over the given number of runs
+    double MeasureParse(FuzzEntryPoint const& entryPoint, GuardedContents const& contents, size_t numRuns)
+    {
+        double leastSeconds = 0.0;
+        for (size_t run = 0; run < numRuns; ++run) {
+            auto const start = std::chrono::steady_clock::now();
+            entryPoint.m_Parse(contents.Data(), contents.Size());
+            double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            leastSeconds = run == 0 ? seconds : std::min(leastSeconds, seconds);
+        }
+        return leastSeconds;
+    }
+
+    //! Check that the parse time of the given contents, pumped to at least `pumpSize` bytes, grows
+    //! linearly, measuring it again over more runs before reporting it as super-linear, so that a
+    //! single disturbed measurement is not reported
+    bool CheckLinear(uint8_t const* data, size_t size, char const* name, size_t pumpSize = c_FuzzPumpSize)
+    {
+        std::vector<FuzzTiming> timings = MeasureFuzzedBVH(data, size, pumpSize, 3);
+        if (!std::all_of(timings.begin(), timings.end(), [](FuzzTiming const& timing) { return timing.IsLinear(); })) {
+            timings = MeasureFuzzedBVH(data, size, pumpSize, 10);
+        }
+        return IsLinearFuzzedBVH(timings, name);
+    }
+
+    //! Returns the given prefix and suffix around a run of the given unit, where the run makes up the
+    //! middle third of the contents, so that pumping the contents lengthens the run
+    std::string MakePumpableBVH(std::string const& prefix, std::string const& unit, std::string const& suffix)
+    {
+        std::string run;
+        while (run.size() < 3 * std::max(prefix.size(), suffix.size())) {
+            run += unit;
+        }
+        return prefix + run + suffix;
+    }
+} // namespace
+
+bool FuzzTiming::IsLinear() const
+{
+    double const sizeGrowth = m_SmallSize > 0 ? static_cast<double>(m_LargeSize) / m_SmallSize : 1.0;
+    return m_LargeSeconds <= c_FuzzMaxTimeGrowth * sizeGrowth * m_SmallSeconds + c_FuzzTimeAllowance;
+}
+
+void ParseFuzzedBVH(uint8_t const* data, size_t size)
+{
+    GuardedContents const contents(data, size);
+    for (FuzzEntryPoint const& entryPoint : c_FuzzEntryPoints) {
+        entryPoint.m_Parse(contents.Data(), contents.Size());
+    }
+}
+
+std::string PumpFuzzedBVH(uint8_t const* data, size_t dataSize, size_t size)
+{
+    char const* const contents = reinterpret_cast<char const*>(data);
+    size_t const middleBegin = dataSize / 3;
+    size_t const middleEnd = std::min(dataSize, std::max(middleBegin + 1, 2 * dataSize / 3));
+    if (middleBegin >= middleEnd) {
+        return std::string(contents, dataSize);
+    }
+
+    std::string pumped(contents, middleEnd);
+    while (pumped.size() + (dataSize - middleEnd) < size) {
+        pumped.append(contents + middleBegin, middleEnd - middleBegin);
+    }
+    pumped.append(contents + middleEnd, dataSize - middleEnd);
+    return pumped;
+}
+
+std::vector<FuzzTiming> MeasureFuzzedBVH(uint8_t const* data, size_t dataSize, size_t size, size_t numRuns)
+{
+    std::string const smallContents = PumpFuzzedBVH(data, dataSize, size);
+    std::string const largeContents = PumpFuzzedBVH(data, dataSize, smallContents.size() * c_FuzzPumpFactor);
+    GuardedContents const small(reinterpret_cast<uint8_t const*>(smallContents.data()), smallContents.size());
+    GuardedContents const large(reinterpret_cast<uint8_t const*>(largeContents.data()), largeContents.size());
+
+    std::vector<FuzzTiming> timings;
+    for (FuzzEntryPoint const& entryPoint : c_FuzzEntryPoints) {
+        FuzzTiming timing;
+        timing.m_EntryPoint = entryPoint.m_Name;
+        timing.m_SmallSize = small.Size();
+        timing.m_SmallSeconds = MeasureParse(entryPoint, small, numRuns);
+        timing.m_LargeSize = large.Size();
+        timing.m_LargeSeconds = MeasureParse(entryPoint, large, numRuns);
+        timings.push_back(timing);
+    }
+    return timings;
+}
+
+bool IsLinearFuzzedBVH(std::vector<FuzzTiming> const& timings, char const* name)
+{
+    bool linear = true;
+    for (FuzzTiming const& timing : timings) {
+        if (!timing.IsLinear()) {
+            std::fprintf(stderr, "%s: parse time of %s grows super-linearly, from %.3f ms at %zu bytes to %.3f ms at %zu bytes\n", name,
+                timing.m_EntryPoint, timing.m_SmallSeconds * 1e3, timing.m_SmallSize, timing.m_LargeSeconds * 1e3, timing.m_LargeSize);
+            linear = false;
+        }
+    }
+    return linear;
+}
+
+int RunFuzzCorpus(std::vector<std::string> const& paths)
+{
+    std::vector<std::filesystem::path> filePaths;
+    for (std::string const& path : paths) {
+        if (std::filesystem::is_directory(path)) {
+            for (std::filesystem::directory_entry const& entry : std::filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file()) {
+                    filePaths.push_back(entry.path());
+                }
+            }
+        } else {
+            filePaths.push_back(path);
+        }
+    }
+    std::sort(filePaths.begin(), filePaths.end());
+
+    size_t numFailed = 0;
+    for (std::filesystem::path const& filePath : filePaths) {
+        std::ifstream stream(filePath, std::ios::in | std::ios::binary);
+        std::string const contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        if (!stream.good() && !stream.eof()) {
+            std::fprintf(stderr, "%s: failed to read file\n", filePath.string().c_str());
+            ++numFailed;
+            continue;
+        }
+        uint8_t const* const data = reinterpret_cast<uint8_t const*>(contents.data());
+        ParseFuzzedBVH(data, contents.size());
+        if (!CheckLinear(data, contents.size(), filePath.string().c_str())) {
+            ++numFailed;
+        }
+    }
+    std::printf("Fuzzed %zu files, of which %zu failed\n", filePaths.size(), numFailed);
+    return numFailed > 0 ? 1 : 0;
+}
+
+int RunFuzzPathologicalInputs()
+{
+    std::string const hierarchy = "HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 3 Xposition Yposition Zposition\n"
+                                  "  End Site\n  {\n    OFFSET 0 1 0\n  }\n}\n";
+    std::string const seeds[] = {
+        // Unbroken runs of digits in a count and a value, and of whitespace before a value
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: ", "0", "1\nFrame Time: 0.1\n1 2 3\n"),
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: 1\nFrame Time: 0.1\n", "1", " 2 3\n"),
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: 1\nFrame Time:", " ", "0.1\n1 2 3\n"),
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: 1\nFrame Time: ", "1", "\n1 2 3\n"),
+        // Contents without the end of the header
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: 1\n", "Frame Tim", ""),
+        // Deeply nested joints, many sibling joints, and a long joint name
+        MakePumpableBVH("HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n", "JOINT Joint\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n", "}\nMOTION\nFrames: 0\nFrame Time: 0.1\n"),
+        MakePumpableBVH("HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n",
+            "JOINT Joint\n{\n  OFFSET 0 0 0\n  CHANNELS 3 Zrotation Xrotation Yrotation\n  End Site\n  {\n    OFFSET 0 1 0\n  }\n}\n",
+            "}\nMOTION\nFrames: 0\nFrame Time: 0.1\n"),
+        MakePumpableBVH("HIERARCHY\nROOT ", "Root", "\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n}\nMOTION\nFrames: 0\nFrame Time: 0.1\n"),
+        // Far more frames declared than the contents hold, and more contents than frames declared
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: 4294967295\nFrame Time: 0.1\n", "1 2 3\n", ""),
+        MakePumpableBVH(hierarchy + "MOTION\nFrames: 1\nFrame Time: 0.1\n", "1 2 3\n", ""),
+    };
+
+    // Contents are pumped beyond the size of the chunks that readers read, so that parsing that
+    // revisits earlier contents for each chunk grows super-linearly
+    size_t constexpr c_Size = 1024 * 1024;
+    size_t numFailed = 0;
+    for (size_t seedIndex = 0; seedIndex < std::size(seeds); ++seedIndex) {
+        std::string const name = "seed " + std::to_string(seedIndex);
+        if (!CheckLinear(reinterpret_cast<uint8_t const*>(seeds[seedIndex].data()), seeds[seedIndex].size(), name.c_str(), c_Size)) {
+            ++numFailed;
+        }
+    }
+    std::printf("Pumped %zu pathological inputs, of which %zu failed\n", std::size(seeds), numFailed);
+    return numFailed > 0 ? 1 : 0;
+}
+
+#if defined(USDBVHANIM_FUZZER)
+//! The entry point of the libFuzzer target, which parses each input, and aborts if its parse time
+//! grows super-linearly when it is pumped. Reads past the end of the input are reported by
+//! AddressSanitizer, or fault on the page that follows the copy that is parsed.
+extern "C" int LLVMFuzzerTestOneInput(uint8_t const* data, size_t size)
+{
+    ParseFuzzedBVH(data, size);
+    if (!CheckLinear(data, size, "input")) {
+        std::abort();
+    }
+    return 0;
+}
+#endif
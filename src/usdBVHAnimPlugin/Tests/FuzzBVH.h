@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//! The size to which fuzzed contents are pumped (see `PumpFuzzedBVH`) before their parse time is
+//! measured, and the factor by which they are then pumped again to see how their parse time grows.
+static constexpr size_t c_FuzzPumpSize = 16 * 1024;
+static constexpr size_t c_FuzzPumpFactor = 8;
+
+//! The time taken to parse pumped contents may grow by at most this many times their growth in size,
+//! plus `c_FuzzTimeAllowance` seconds, before it is treated as super-linear. Linear parsing grows by
+//! about one times, while quadratic parsing grows by `c_FuzzPumpFactor` times.
+static constexpr double c_FuzzMaxTimeGrowth = 3.0;
+static constexpr double c_FuzzTimeAllowance = 0.005;
+
+//! The time taken by one entry point of the parser to parse contents pumped to two sizes
+struct FuzzTiming {
+    char const* m_EntryPoint = nullptr;
+    size_t m_SmallSize = 0;
+    double m_SmallSeconds = 0.0;
+    size_t m_LargeSize = 0;
+    double m_LargeSeconds = 0.0;
+
+    //! Returns `true` if the parse time grows no faster than linearly with the size of the contents.
+    bool IsLinear() const;
+};
+
+//! Parse the given contents with each in-memory entry point of the parser (into a `BVHDocument`,
+//! with a `BVHVisitor`, through a `BVHChunkReader`, and the header alone), from a copy of them
+//! that is immediately followed by an inaccessible page of memory where the platform supports it,
+//! so that any read past the end of the contents faults, even without a sanitizer.
+void ParseFuzzedBVH(uint8_t const* data, size_t size);
+
+//! Returns the contents given by repeating the middle third of the given contents until they are
+//! at least `size` bytes long. Repeating part of an input "pumps" whatever it holds there (e.g. a
+//! run of digits or whitespace, nested joints, or frames), so that the time taken to parse it can
+//! be compared between sizes.
+std::string PumpFuzzedBVH(uint8_t const* data, size_t dataSize, size_t size);
+
+//! Measure the least time taken by each entry point of `ParseFuzzedBVH` over the given number of
+//! runs, for the given contents pumped to at least `size` bytes, and to `c_FuzzPumpFactor` times that.
+//! Entry points are timed separately, so that one that grows super-linearly is not hidden by the others.
+std::vector<FuzzTiming> MeasureFuzzedBVH(uint8_t const* data, size_t dataSize, size_t size, size_t numRuns);
+
+//! Returns `true` if every given timing grows no faster than linearly, printing each that does not.
+bool IsLinearFuzzedBVH(std::vector<FuzzTiming> const& timings, char const* name);
+
+//! Run the fuzz checks over every file at the given paths without libFuzzer, searching directories
+//! (e.g. a libFuzzer corpus) for files, so that crashes and slow inputs found by the fuzzer can be
+//! reproduced. Each file is parsed as it is, and pumped to check that its parse time grows linearly.
+//! Returns a non-zero exit code if any file's parse time does not.
+int RunFuzzCorpus(std::vector<std::string> const& paths);
+
+//! Pump each of a fixed set of pathological inputs (e.g. unbroken runs of digits or whitespace,
+//! deeply nested joints, and far more frames declared than the contents hold) to 1 MiB, beyond the
+//! size of the chunks that readers read, and check that their parse time grows linearly. These
+//! are timing checks, so they are run separately from the unit tests. Returns a non-zero exit code
+//! if any input's parse time does not grow linearly.
+int RunFuzzPathologicalInputs();
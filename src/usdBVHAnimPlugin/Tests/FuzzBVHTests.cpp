@@ -0,0 +1,31 @@
+#include "FuzzBVH.h"
+#include "Tests.h"
+#include <fstream>
+#include <iterator>
+#include <string>
+
+BEGIN_TEST_FIXTURE(FuzzBVHTests)
+
+TEST(PumpFuzzedBVH_Repeats_Middle_Third)
+{
+    std::string const seed = "aaabbbccc";
+    uint8_t const* const data = reinterpret_cast<uint8_t const*>(seed.data());
+    TEST_REQUIRE(PumpFuzzedBVH(data, seed.size(), 0) == seed);
+    TEST_REQUIRE(PumpFuzzedBVH(data, seed.size(), 12) == "aaabbbbbbccc");
+    TEST_REQUIRE(PumpFuzzedBVH(data, seed.size(), 13) == "aaabbbbbbbbbccc");
+    TEST_REQUIRE(PumpFuzzedBVH(data, 1, 4) == "aaaa");
+    TEST_REQUIRE(PumpFuzzedBVH(data, 0, 4).empty());
+}
+
+TEST(ParseFuzzedBVH_Reads_Within_Every_Truncation)
+{
+    // Every prefix of a valid file ends at an inaccessible page, so reading past any of them faults
+    std::ifstream stream("data/test_bvh.bvh", std::ios::in | std::ios::binary);
+    std::string const contents((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+    TEST_REQUIRE(!contents.empty());
+    for (size_t size = 0; size <= contents.size(); ++size) {
+        ParseFuzzedBVH(reinterpret_cast<uint8_t const*>(contents.data()), size);
+    }
+}
+
+END_TEST_FIXTURE()
@@ -0,0 +1,57 @@
+#include "GenerateTestBVH.h"
+#include <cmath>
+#include <cstdio>
+
+static size_t constexpr c_MaxChildren = 4;
+
+static void GenerateJoint(std::string& result, size_t jointIndex, size_t numJoints, size_t depth)
+{
+    std::string const indent(depth, '\t');
+    char line[128];
+    if (jointIndex == 0) {
+        result += "ROOT Joint0\n{\n";
+        result += "\tOFFSET 0.000000 0.000000 0.000000\n";
+        result += "\tCHANNELS 6 Xposition Yposition Zposition Zrotation Xrotation Yrotation\n";
+    } else {
+        std::snprintf(line, sizeof(line), "%sJOINT Joint%zu\n%s{\n", indent.c_str(), jointIndex, indent.c_str());
+        result += line;
+        std::snprintf(line, sizeof(line), "%s\tOFFSET 0.000000 %f 0.000000\n", indent.c_str(), 1.0 + 0.01 * static_cast<double>(jointIndex));
+        result += line;
+        result += indent + "\tCHANNELS 3 Zrotation Xrotation Yrotation\n";
+    }
+
+    size_t const firstChild = jointIndex * c_MaxChildren + 1;
+    if (firstChild >= numJoints) {
+        result += indent + "\tEnd Site\n";
+        result += indent + "\t{\n";
+        result += indent + "\t\tOFFSET 0.000000 1.000000 0.000000\n";
+        result += indent + "\t}\n";
+    }
+    for (size_t child = firstChild; child < firstChild + c_MaxChildren && child < numJoints; ++child) {
+        GenerateJoint(result, child, numJoints, depth + 1);
+    }
+    result += indent + "}\n";
+}
+
+std::string GenerateTestBVH(size_t numJoints, size_t numFrames)
+{
+    std::string result = "HIERARCHY\n";
+    GenerateJoint(result, 0, numJoints, 0);
+
+    char line[128];
+    std::snprintf(line, sizeof(line), "MOTION\nFrames: %zu\nFrame Time: 0.033333\n", numFrames);
+    result += line;
+
+    for (size_t frameIndex = 0; frameIndex < numFrames; ++frameIndex) {
+        double const time = static_cast<double>(frameIndex) * 0.033333;
+        std::snprintf(line, sizeof(line), "%f %f %f", std::sin(time), 90.0 + std::cos(time), 0.5 * time);
+        result += line;
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            double const phase = time + 0.1 * static_cast<double>(jointIndex);
+            std::snprintf(line, sizeof(line), " %f %f %f", 30.0 * std::sin(phase), 20.0 * std::cos(phase), 10.0 * std::sin(2.0 * phase));
+            result += line;
+        }
+        result += "\n";
+    }
+    return result;
+}
@@ -0,0 +1,7 @@
+#pragma once
+#include <string>
+
+//! Generate the contents of a BVH file with the given number of joints (of which there must be at
+//! least one) and frames. Joints form a tree in which each joint has up to four children, and the
+//! generated contents are deterministic, such that the same arguments always produce the same contents.
+std::string GenerateTestBVH(size_t numJoints, size_t numFrames);
@@ -0,0 +1,124 @@
+#include "GenerateTestBVH.h"
+#include "IndexBVH.h"
+#include "ParseBVH.h"
+#include "Tests.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace usdBVHAnimPlugin;
+
+static BVHIndexKernel const c_Kernels[] = { BVHIndexKernel::Scalar, BVHIndexKernel::SSE2, BVHIndexKernel::AVX2 };
+
+//! Index the given contents one character at a time, as a reference for the kernels
+static BVHValueIndex IndexReference(std::string const& contents)
+{
+    BVHValueIndex index;
+    bool previousWhitespace = true;
+    for (size_t i = 0; i < contents.size(); ++i) {
+        char const c = contents[i];
+        bool const whitespace = c == ' ' || c == '\t' || c == '\r' || c == '\n';
+        if (!whitespace && previousWhitespace) {
+            index.m_ValueStarts.push_back(static_cast<uint32_t>(i));
+        }
+        if (c == '\n') {
+            index.m_LineStarts.push_back(static_cast<uint32_t>(i + 1));
+        }
+        previousWhitespace = whitespace;
+    }
+    return index;
+}
+
+BEGIN_TEST_FIXTURE(IndexBVHTests)
+
+TEST(IndexBVHValues_Matches_Reference_For_Every_Kernel)
+{
+    // Contents of every length around the block size, including values that span blocks
+    std::mt19937 random(7);
+    char const c_Alphabet[] = "  \t\r\n\n0123456789.-eE+x";
+    for (size_t size = 0; size < 300; ++size) {
+        std::string contents(size, ' ');
+        for (char& c : contents) {
+            c = c_Alphabet[random() % (sizeof(c_Alphabet) - 1)];
+        }
+        BVHValueIndex const expected = IndexReference(contents);
+
+        // The contents are copied to their own allocation, so that reading beyond them can be detected
+        std::vector<char> const unterminated(contents.begin(), contents.end());
+        for (BVHIndexKernel kernel : c_Kernels) {
+            if (!IsBVHIndexKernelSupported(kernel)) {
+                continue;
+            }
+            BVHValueIndex index;
+            IndexBVHValues(unterminated.data(), unterminated.size(), index, kernel);
+            TEST_REQUIRE(index.m_ValueStarts == expected.m_ValueStarts);
+            TEST_REQUIRE(index.m_LineStarts == expected.m_LineStarts);
+        }
+    }
+}
+
+TEST(IndexBVHValues_Reuses_Index)
+{
+    BVHValueIndex index;
+    IndexBVHValues("1 2 3\n4 5 6\n", 12, index);
+    TEST_REQUIRE((index.m_ValueStarts == std::vector<uint32_t> { 0, 2, 4, 6, 8, 10 }));
+    TEST_REQUIRE((index.m_LineStarts == std::vector<uint32_t> { 6, 12 }));
+    IndexBVHValues(" 7", 2, index);
+    TEST_REQUIRE((index.m_ValueStarts == std::vector<uint32_t> { 1 }));
+    TEST_REQUIRE(index.m_LineStarts.empty());
+}
+
+TEST(GetBVHIndexKernel_Is_Supported)
+{
+    TEST_REQUIRE(IsBVHIndexKernelSupported(BVHIndexKernel::Scalar));
+    TEST_REQUIRE(IsBVHIndexKernelSupported(GetBVHIndexKernel()));
+}
+
+TEST(ParseBVH_Parses_Frames_Larger_Than_Index_Slice)
+{
+    // Each frame of this many joints spans several slices of the index
+    std::string const contents = GenerateTestBVH(4000, 3);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), document));
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 3 * 4000);
+
+    // Selecting the last joint of each frame skips over values in every slice before converting its own
+    BVHJointSelection const selection { { "Joint3999" }, {} };
+    BVHDocument selected;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), selected, selection));
+    TEST_REQUIRE(selected.m_JointNames.back() == "Joint3999");
+    size_t const jointIndex = std::find(document.m_JointNames.begin(), document.m_JointNames.end(), "Joint3999") - document.m_JointNames.begin();
+    size_t const numSelectedJoints = selected.m_JointNames.size();
+    for (size_t frame = 0; frame < 3; ++frame) {
+        TEST_REQUIRE(std::memcmp(&selected.m_FrameTransforms[frame * numSelectedJoints + numSelectedJoints - 1], &document.m_FrameTransforms[frame * 4000 + jointIndex], sizeof(BVHTransform)) == 0);
+    }
+}
+
+TEST(ParseBVH_Fails_On_Invalid_Motion_Values)
+{
+    std::string const contents = GenerateTestBVH(2, 2);
+    size_t const lastValue = contents.find_last_of(' ') + 1;
+
+    // A value that isn't a number, or that is too long to be one, fails to parse
+    std::string invalid = contents;
+    invalid.insert(lastValue, "x");
+    BVHDocument document;
+    TEST_REQUIRE(!ParseBVH(invalid.data(), invalid.size(), document));
+
+    std::string tooLong = contents;
+    tooLong.insert(lastValue, std::string(100, '0'));
+    BVHDocument tooLongDocument;
+    TEST_REQUIRE(!ParseBVH(tooLong.data(), tooLong.size(), tooLongDocument));
+
+    // Missing values fail to parse, whereas trailing whitespace is ignored
+    std::string const truncated = contents.substr(0, lastValue);
+    BVHDocument truncatedDocument;
+    TEST_REQUIRE(!ParseBVH(truncated.data(), truncated.size(), truncatedDocument));
+    std::string const padded = contents + " \r\n\t\n";
+    BVHDocument paddedDocument;
+    TEST_REQUIRE(ParseBVH(padded.data(), padded.size(), paddedDocument));
+}
+
+END_TEST_FIXTURE()
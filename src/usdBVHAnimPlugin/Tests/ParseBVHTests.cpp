@@ -1,7 +1,18 @@
+#include "AllocationCounter.h"
+#include "BVHChunkReaders.h"
+#include "CompareBVH.h"
+#include "GenerateTestBVH.h"
 #include "ParseBVH.h"
 #include "Tests.h"
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory_resource>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 using namespace usdBVHAnimPlugin;
 
@@ -46,6 +57,106 @@ Frame Time: 0.041667
 0.000000 0.991981 0.000000 89.278345 0.000000 -0.000000 -0.000000 89.278345 -0.000000 
 0.000000 1.000000 0.000000 90.000003 0.000000 -0.000000 -0.000000 89.999996 0.000000)";
 
+//! A memory resource that counts the allocations made through it
+class CountingMemoryResource : public std::pmr::memory_resource {
+public:
+    size_t m_NumAllocations = 0;
+    size_t m_NumBytes = 0;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override
+    {
+        ++m_NumAllocations;
+        m_NumBytes += bytes;
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+//! Returns `true` if each joint of the given subset has the same name, parent name, channels
+//! and transforms as the joint of the same name in the given full document.
+static bool IsJointSubset(BVHDocument const& subset, BVHDocument const& full)
+{
+    size_t const numSubsetJoints = subset.m_JointNames.size();
+    size_t const numFullJoints = full.m_JointNames.size();
+    size_t const numFrames = full.m_FrameTransforms.size() / numFullJoints;
+    if (subset.m_FrameTransforms.size() != numFrames * numSubsetJoints || subset.m_FrameTime != full.m_FrameTime) {
+        return false;
+    }
+    for (size_t j = 0; j < numSubsetJoints; ++j) {
+        size_t const f = std::find(full.m_JointNames.begin(), full.m_JointNames.end(), subset.m_JointNames[j]) - full.m_JointNames.begin();
+        if (f == numFullJoints || subset.m_JointChannels[j] != full.m_JointChannels[f]) {
+            return false;
+        }
+        int const parent = subset.m_JointParents[j];
+        int const fullParent = full.m_JointParents[f];
+        if ((parent == BVHDocument::c_RootParentIndex) != (fullParent == BVHDocument::c_RootParentIndex)
+            || (parent != BVHDocument::c_RootParentIndex && subset.m_JointNames[parent] != full.m_JointNames[fullParent])) {
+            return false;
+        }
+        for (size_t frame = 0; frame < numFrames; ++frame) {
+            if (std::memcmp(&subset.m_FrameTransforms[frame * numSubsetJoints + j], &full.m_FrameTransforms[frame * numFullJoints + f], sizeof(BVHTransform)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//! A visitor that records every event into a document, checking that events arrive in order
+class RecordingVisitor : public BVHVisitor {
+public:
+    BVHDocument m_Document;
+    size_t m_NumFrames = 0;
+    size_t m_NumVisitedFrames = 0;
+    size_t m_StopAtFrame = SIZE_MAX;
+    bool m_InOrder = true;
+
+    bool OnHierarchy(size_t numJoints) override
+    {
+        m_NumJoints = numJoints;
+        return true;
+    }
+
+    bool OnJoint(size_t jointIndex, std::string_view name, int parentIndex, BVHOffset const& offset, unsigned int numChannels, uint32_t channels) override
+    {
+        m_InOrder = m_InOrder && jointIndex == m_Document.m_JointNames.size() && parentIndex < static_cast<int>(jointIndex);
+        m_Document.m_JointNames.emplace_back(name);
+        m_Document.m_JointParents.push_back(parentIndex);
+        m_Document.m_JointOffsets.push_back(offset);
+        m_Document.m_JointNumChannels.push_back(numChannels);
+        m_Document.m_JointChannels.push_back(channels);
+        return true;
+    }
+
+    bool OnMotion(size_t numFrames, double frameTime) override
+    {
+        m_InOrder = m_InOrder && m_Document.m_JointNames.size() == m_NumJoints;
+        m_NumFrames = numFrames;
+        m_Document.m_FrameTime = frameTime;
+        return true;
+    }
+
+    bool OnFrame(size_t frameIndex, BVHTransform const* transforms) override
+    {
+        m_InOrder = m_InOrder && frameIndex == m_NumVisitedFrames++;
+        m_Document.m_FrameTransforms.insert(m_Document.m_FrameTransforms.end(), transforms, transforms + m_NumJoints);
+        return frameIndex != m_StopAtFrame;
+    }
+
+private:
+    size_t m_NumJoints = 0;
+};
+
 BEGIN_TEST_FIXTURE(ParseBVHTests)
 
 TEST(ParseBVH_ParseTest)
@@ -125,4 +236,360 @@ TEST(ParseBVH_ParseTest)
     TEST_REQUIRE(std::fabs(document.m_FrameTransforms[19 * 2 + 1].m_RotationQuat[3] - std::cos(M_PI * 0.25f)) < c_Tolerance);
 }
 
-END_TEST_FIXTURE()
\ No newline at end of file
+TEST(ParseBVH_Allocates_Each_Array_Once)
+{
+    CountingMemoryResource resource;
+    {
+        std::istringstream stream(s_TestBVH, std::ios::in | std::ios::binary);
+        usdBVHAnimPlugin::BVHDocument document(&resource);
+        TEST_REQUIRE(usdBVHAnimPlugin::ParseBVH(stream, document));
+        TEST_REQUIRE(document.m_FrameTransforms.size() == 20 * 2);
+        TEST_REQUIRE(document.m_FrameTransforms.capacity() == 20 * 2);
+        TEST_REQUIRE(document.m_JointNames.capacity() == 2);
+    }
+
+    // Five joint arrays and one array of frame transforms, each sized exactly once
+    TEST_REQUIRE(resource.m_NumAllocations == 6);
+    TEST_REQUIRE(resource.m_NumBytes == 2 * (sizeof(std::pmr::string) + sizeof(int) + sizeof(BVHOffset) + sizeof(unsigned int) + sizeof(uint32_t)) + 20 * 2 * sizeof(BVHTransform));
+}
+
+TEST(ParseBVH_Reader_Of_Known_Size_Allocates_Each_Array_Once)
+{
+    // Enough frames to span many chunks of the reader
+    std::string const contents = GenerateTestBVH(8, 20000);
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / "usdBVHAnim_known_size.bvh";
+    {
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << contents;
+    }
+
+    BVHMemoryChunkReader memoryReader(contents.data(), contents.size());
+    TEST_REQUIRE(memoryReader.GetSize() == contents.size());
+    for (bool fromFile : { false, true }) {
+        CountingMemoryResource resource;
+        {
+            BVHDocument document(&resource);
+            TEST_REQUIRE(fromFile ? ParseBVH(filePath.string(), document) : ParseBVH(memoryReader, document));
+            TEST_REQUIRE(document.m_FrameTransforms.size() == 8 * 20000);
+            TEST_REQUIRE(document.m_FrameTransforms.capacity() == 8 * 20000);
+        }
+        TEST_REQUIRE(resource.m_NumAllocations == 6);
+    }
+    std::filesystem::remove(filePath);
+}
+
+TEST(ParseBVH_Into_Monotonic_Arena)
+{
+    std::pmr::monotonic_buffer_resource arena;
+    std::istringstream stream(s_TestBVH, std::ios::in | std::ios::binary);
+    usdBVHAnimPlugin::BVHDocument document(&arena);
+    TEST_REQUIRE(usdBVHAnimPlugin::ParseBVH(stream, document));
+    TEST_REQUIRE(document.m_FrameTransforms.get_allocator().resource() == &arena);
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 20 * 2);
+}
+
+TEST(ParseBVH_Selects_Joints_And_Ancestors)
+{
+    std::string const contents = GenerateTestBVH(21, 10);
+    BVHDocument full;
+    {
+        std::istringstream stream(contents, std::ios::in | std::ios::binary);
+        TEST_REQUIRE(ParseBVH(stream, full));
+    }
+
+    std::istringstream stream(contents, std::ios::in | std::ios::binary);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(stream, document, BVHJointSelection { { "Joint5" }, {} }));
+    TEST_REQUIRE((document.m_JointNames == std::pmr::vector<std::pmr::string> { "Joint0", "Joint1", "Joint5" }));
+    TEST_REQUIRE((document.m_JointParents == std::pmr::vector<int> { BVHDocument::c_RootParentIndex, 0, 1 }));
+    TEST_REQUIRE(IsJointSubset(document, full));
+}
+
+TEST(ParseBVH_Selects_Joint_Subtrees)
+{
+    std::string const contents = GenerateTestBVH(21, 10);
+    BVHDocument full;
+    {
+        std::istringstream stream(contents, std::ios::in | std::ios::binary);
+        TEST_REQUIRE(ParseBVH(stream, full));
+    }
+
+    std::istringstream stream(contents, std::ios::in | std::ios::binary);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(stream, document, BVHJointSelection { { "Joint17" }, { "Joint1" } }));
+    TEST_REQUIRE((document.m_JointNames == std::pmr::vector<std::pmr::string> { "Joint0", "Joint1", "Joint5", "Joint6", "Joint7", "Joint8", "Joint4", "Joint17" }));
+    TEST_REQUIRE(IsJointSubset(document, full));
+}
+
+TEST(ParseBVH_Fails_To_Select_Missing_Joint)
+{
+    std::istringstream stream(s_TestBVH, std::ios::in | std::ios::binary);
+    BVHDocument document;
+    TEST_REQUIRE(!ParseBVH(stream, document, BVHJointSelection { { "Bar" }, {} }));
+}
+
+TEST(SelectBVHJoints_Matches_ParseBVH_With_Selection)
+{
+    std::string const contents = GenerateTestBVH(21, 10);
+    BVHJointSelection const selection { { "Joint11", "Joint14" }, { "Joint4" } };
+    BVHDocument expected;
+    {
+        std::istringstream stream(contents, std::ios::in | std::ios::binary);
+        TEST_REQUIRE(ParseBVH(stream, expected, selection));
+    }
+
+    std::istringstream stream(contents, std::ios::in | std::ios::binary);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(stream, document));
+    TEST_REQUIRE(!SelectBVHJoints(document, BVHJointSelection { { "Missing" }, {} }));
+    TEST_REQUIRE(document.m_JointNames.size() == 21);
+    TEST_REQUIRE(SelectBVHJoints(document, selection));
+    TEST_REQUIRE(document.m_JointNames == expected.m_JointNames);
+    TEST_REQUIRE(document.m_JointParents == expected.m_JointParents);
+    TEST_REQUIRE(document.m_FrameTransforms.size() == expected.m_FrameTransforms.size());
+    TEST_REQUIRE(std::memcmp(document.m_FrameTransforms.data(), expected.m_FrameTransforms.data(), expected.m_FrameTransforms.size() * sizeof(BVHTransform)) == 0);
+}
+
+TEST(HashBVHHierarchy_Ignores_Motion_Data)
+{
+    auto parse = [](std::string const& contents, BVHDocument& document) {
+        std::istringstream stream(contents, std::ios::in | std::ios::binary);
+        return ParseBVH(stream, document);
+    };
+
+    // Clips of the same skeleton hash to the same value, however long they are
+    BVHDocument shortClip, longClip, otherSkeleton;
+    TEST_REQUIRE(parse(GenerateTestBVH(8, 10), shortClip));
+    TEST_REQUIRE(parse(GenerateTestBVH(8, 50), longClip));
+    TEST_REQUIRE(parse(GenerateTestBVH(9, 10), otherSkeleton));
+    TEST_REQUIRE(HashBVHHierarchy(shortClip) == HashBVHHierarchy(longClip));
+    TEST_REQUIRE(HashBVHHierarchy(shortClip) != HashBVHHierarchy(otherSkeleton));
+
+    // Any change to a joint's name, parent or offset changes the hash
+    uint64_t const hash = HashBVHHierarchy(shortClip);
+    longClip.m_JointOffsets[3].m_Translation[1] += 0.5;
+    TEST_REQUIRE(HashBVHHierarchy(longClip) != hash);
+    longClip.m_JointOffsets[3].m_Translation[1] -= 0.5;
+    longClip.m_JointNames[3] = "Renamed";
+    TEST_REQUIRE(HashBVHHierarchy(longClip) != hash);
+    longClip.m_JointNames[3] = shortClip.m_JointNames[3];
+    longClip.m_JointParents[5] = longClip.m_JointParents[5] == 0 ? 1 : 0;
+    TEST_REQUIRE(HashBVHHierarchy(longClip) != hash);
+    longClip.m_JointParents[5] = shortClip.m_JointParents[5];
+    TEST_REQUIRE(HashBVHHierarchy(longClip) == hash);
+}
+
+TEST(ParseBVHFiles_Parses_Every_File)
+{
+    // The same file is listed several times, along with one that does not exist
+    std::vector<std::string> const filePaths = { "data/test_bvh.bvh", "data/missing.bvh", "data/test_bvh.bvh", "data/test_bvh.bvh", "data/test_bvh.bvh" };
+    for (size_t maxThreads : { 0, 1, 3 }) {
+        std::vector<size_t> numFrameTransforms(filePaths.size(), 0);
+        std::vector<int> numCalls(filePaths.size(), 0);
+        std::vector<char> parsed(filePaths.size(), 0);
+        ParseBVHFiles(filePaths, [&](size_t fileIndex, bool success, BVHDocument& document) {
+            ++numCalls[fileIndex];
+            parsed[fileIndex] = success;
+            numFrameTransforms[fileIndex] = document.m_FrameTransforms.size();
+        }, {}, maxThreads);
+
+        for (size_t i = 0; i < filePaths.size(); ++i) {
+            TEST_REQUIRE(numCalls[i] == 1);
+            TEST_REQUIRE(bool(parsed[i]) == (i != 1));
+            TEST_REQUIRE(i == 1 || numFrameTransforms[i] == 20 * 2);
+        }
+    }
+}
+
+TEST(ParseBVH_Visitor_Matches_Document)
+{
+    // Enough frames for contents held in memory to be decoded in several batches
+    std::string const contents = GenerateTestBVH(5, 5000);
+    for (BVHJointSelection const& selection : { BVHJointSelection {}, BVHJointSelection { { "Joint3" }, {} } }) {
+        BVHDocument expected;
+        TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), expected, selection));
+
+        RecordingVisitor visitor;
+        TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), visitor, selection));
+        TEST_REQUIRE(visitor.m_InOrder && visitor.m_NumFrames == 5000 && visitor.m_NumVisitedFrames == 5000);
+        TEST_REQUIRE(IsSameDocument(visitor.m_Document, expected));
+
+        BVHMemoryChunkReader reader(contents.data(), contents.size());
+        RecordingVisitor readerVisitor;
+        TEST_REQUIRE(ParseBVH(reader, readerVisitor, selection));
+        TEST_REQUIRE(readerVisitor.m_InOrder && readerVisitor.m_NumFrames == 5000);
+        TEST_REQUIRE(IsSameDocument(readerVisitor.m_Document, expected));
+    }
+
+    RecordingVisitor fileVisitor;
+    BVHDocument fileDocument;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", fileVisitor));
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", fileDocument));
+    TEST_REQUIRE(IsSameDocument(fileVisitor.m_Document, fileDocument));
+}
+
+TEST(ParseBVH_Visitor_Stops_Parsing)
+{
+    std::string const contents = GenerateTestBVH(3, 100);
+    RecordingVisitor visitor;
+    visitor.m_StopAtFrame = 10;
+    TEST_REQUIRE(!ParseBVH(contents.data(), contents.size(), visitor));
+    TEST_REQUIRE(visitor.m_NumVisitedFrames == 11);
+
+    BVHMemoryChunkReader reader(contents.data(), contents.size());
+    RecordingVisitor readerVisitor;
+    readerVisitor.m_StopAtFrame = 10;
+    TEST_REQUIRE(!ParseBVH(reader, readerVisitor));
+    TEST_REQUIRE(readerVisitor.m_NumVisitedFrames == 11);
+
+    // Missing frames are reported as a failure once every frame before them has been visited
+    std::string const truncated = contents.substr(0, contents.size() / 2);
+    RecordingVisitor truncatedVisitor;
+    TEST_REQUIRE(!ParseBVH(truncated.data(), truncated.size(), truncatedVisitor));
+    TEST_REQUIRE(truncatedVisitor.m_NumFrames == 100);
+}
+
+TEST(ParseBVH_Concurrently_Matches_Serial)
+{
+    std::string const contents = GenerateTestBVH(16, 200);
+    usdBVHAnimPlugin::BVHDocument expected;
+    {
+        std::istringstream stream(contents, std::ios::in | std::ios::binary);
+        TEST_REQUIRE(usdBVHAnimPlugin::ParseBVH(stream, expected));
+    }
+
+    // Each thread alternates between parsing from memory and from a file, many times over
+    size_t constexpr c_NumThreads = 8;
+    std::vector<char> matches(c_NumThreads, 0);
+    std::vector<std::thread> threads;
+    for (size_t threadIndex = 0; threadIndex < c_NumThreads; ++threadIndex) {
+        threads.emplace_back([&, threadIndex]() {
+            bool match = true;
+            for (size_t i = 0; i < 16; ++i) {
+                std::istringstream stream(contents, std::ios::in | std::ios::binary);
+                usdBVHAnimPlugin::BVHDocument document;
+                match = match && usdBVHAnimPlugin::ParseBVH(stream, document)
+                    && document.m_JointNames == expected.m_JointNames
+                    && std::memcmp(document.m_FrameTransforms.data(), expected.m_FrameTransforms.data(), expected.m_FrameTransforms.size() * sizeof(BVHTransform)) == 0;
+
+                usdBVHAnimPlugin::BVHDocument fileDocument;
+                match = match && usdBVHAnimPlugin::ParseBVH("data/test_bvh.bvh", fileDocument) && fileDocument.m_FrameTransforms.size() == 20 * 2;
+            }
+            matches[threadIndex] = match;
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (char match : matches) {
+        TEST_REQUIRE(match);
+    }
+}
+
+TEST(ParseBVH_Fails_On_Malformed_Counts)
+{
+    auto makeContents = [](std::string const& channels, std::string const& frames, std::string const& values) {
+        return "HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS " + channels + "\n  End Site\n  {\n    OFFSET 0 1 0\n  }\n}\n"
+            + "MOTION\nFrames: " + frames + "\nFrame Time: 0.1\n" + values;
+    };
+    auto parses = [](std::string const& contents) {
+        // Contents are parsed from an allocation of exactly their size, as they need not be NUL-terminated
+        std::vector<char> const exact(contents.begin(), contents.end());
+        BVHDocument document;
+        BVHMemoryChunkReader reader(exact.data(), exact.size());
+        BVHDocument readerDocument;
+        bool const parsed = ParseBVH(exact.data(), exact.size(), document);
+        TEST_REQUIRE(ParseBVH(reader, readerDocument) == parsed);
+        return parsed;
+    };
+
+    TEST_REQUIRE(parses(makeContents("3 Xposition Yposition Zposition", "1", "1 2 3\n")));
+    TEST_REQUIRE(parses(makeContents("10 Xposition Yposition Zposition Xrotation Yrotation Zrotation Xposition Yposition Zposition Xrotation", "1", "1 2 3 4 5 6 7 8 9 10\n")));
+
+    // Counts without digits, with a sign, that do not fit, or with more channels than a joint can hold
+    TEST_REQUIRE(!parses(makeContents("3 Xposition Yposition Zposition", "x", "1 2 3\n")));
+    TEST_REQUIRE(!parses(makeContents("3 Xposition Yposition Zposition", "-1", "1 2 3\n")));
+    TEST_REQUIRE(!parses(makeContents("3 Xposition Yposition Zposition", "4294967296", "1 2 3\n")));
+    TEST_REQUIRE(!parses(makeContents("3 Xposition Yposition Zposition", "99999999999999999999999", "1 2 3\n")));
+    TEST_REQUIRE(!parses(makeContents("11 Xposition Yposition Zposition Xrotation Yrotation Zrotation Xposition Yposition Zposition Xrotation Yrotation", "1", "1 2 3 4 5 6 7 8 9 10 11\n")));
+
+    // Counts that end the contents
+    TEST_REQUIRE(!parses("HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 3"));
+    std::string const unterminated = makeContents("3 Xposition Yposition Zposition", "1", "");
+    TEST_REQUIRE(!parses(unterminated.substr(0, unterminated.find("\nFrame Time"))));
+
+    // Joints may be nested up to a fixed depth
+    auto makeNestedContents = [](size_t depth) {
+        std::string contents = "HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n";
+        for (size_t i = 0; i < depth; ++i) {
+            contents += "JOINT Joint" + std::to_string(i) + "\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n";
+        }
+        contents += "End Site\n{\n  OFFSET 0 0 0\n}\n";
+        for (size_t i = 0; i <= depth; ++i) {
+            contents += "}\n";
+        }
+        return contents + "MOTION\nFrames: 0\nFrame Time: 0.1\n";
+    };
+    TEST_REQUIRE(parses(makeNestedContents(200)));
+    TEST_REQUIRE(!parses(makeNestedContents(100000)));
+}
+
+TEST(ParseBVH_Fails_On_Frames_Beyond_Contents)
+{
+    std::string const contents = GenerateTestBVH(20, 10);
+    std::string const frames = "Frames: 10\n";
+    std::string const declared = "Frames: 4000000000\n";
+    std::string overstated = contents;
+    overstated.replace(overstated.find(frames), frames.size(), declared);
+
+    // The declared number of frames is checked against the contents before any storage is
+    // allocated for them, or the visitor is told about them
+    BVHDocument document;
+    AllocationCounts const counts = CountAllocations([&]() { TEST_REQUIRE(!ParseBVH(overstated.data(), overstated.size(), document)); });
+    TEST_REQUIRE(counts.m_NumBytes < 1024 * 1024);
+    RecordingVisitor visitor;
+    TEST_REQUIRE(!ParseBVH(overstated.data(), overstated.size(), visitor));
+    TEST_REQUIRE(visitor.m_NumFrames == 0);
+
+    // A reader that knows the size of its contents is checked against them in the same way
+    BVHMemoryChunkReader reader(overstated.data(), overstated.size());
+    BVHDocument readerDocument;
+    AllocationCounts const readerCounts = CountAllocations([&]() { TEST_REQUIRE(!ParseBVH(reader, readerDocument)); });
+    TEST_REQUIRE(readerCounts.m_NumBytes < 4 * 1024 * 1024);
+    TEST_REQUIRE(readerDocument.m_FrameTransforms.capacity() == 0);
+
+    // Otherwise, its frame storage grows with the contents read
+    struct UnsizedChunkReader : BVHChunkReader {
+        BVHMemoryChunkReader m_Source;
+        UnsizedChunkReader(char const* contents, size_t size)
+            : m_Source(contents, size)
+        {
+        }
+        size_t Read(char* buffer, size_t capacity) override { return m_Source.Read(buffer, capacity); }
+        bool Failed() const override { return m_Source.Failed(); }
+    };
+    UnsizedChunkReader unsizedReader(overstated.data(), overstated.size());
+    BVHDocument unsizedDocument;
+    AllocationCounts const unsizedCounts = CountAllocations([&]() { TEST_REQUIRE(!ParseBVH(unsizedReader, unsizedDocument)); });
+    TEST_REQUIRE(unsizedCounts.m_NumBytes < 8 * 1024 * 1024);
+
+    // Exactly as many frames as the contents hold are parsed
+    std::string const minimal = "HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 2 Xposition Yposition\n  End Site\n  {\n    OFFSET 0 1 0\n  }\n}\n"
+                                "MOTION\nFrames: 3\nFrame Time: 0.1\n1 2 3 4 5 6";
+    BVHDocument minimalDocument;
+    TEST_REQUIRE(ParseBVH(minimal.data(), minimal.size(), minimalDocument));
+    TEST_REQUIRE(minimalDocument.m_FrameTransforms.size() == 3);
+
+    // Frames without values take no contents, so any number of them can be declared
+    std::string const valueless = "HIERARCHY\nROOT Root\n{\n  OFFSET 0 0 0\n  CHANNELS 0\n  End Site\n  {\n    OFFSET 0 1 0\n  }\n}\n"
+                                  "MOTION\nFrames: 100000\nFrame Time: 0.1\n";
+    BVHDocument valuelessDocument;
+    TEST_REQUIRE(ParseBVH(valueless.data(), valueless.size(), valuelessDocument));
+    TEST_REQUIRE(valuelessDocument.m_FrameTransforms.size() == 100000);
+    BVHMemoryChunkReader valuelessReader(valueless.data(), valueless.size());
+    BVHDocument valuelessReaderDocument;
+    TEST_REQUIRE(ParseBVH(valuelessReader, valuelessReaderDocument));
+    TEST_REQUIRE(valuelessReaderDocument.m_FrameTransforms.size() == 100000);
+}
+
+END_TEST_FIXTURE()
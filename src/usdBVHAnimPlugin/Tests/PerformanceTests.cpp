@@ -0,0 +1,395 @@
+#include "AuthorBVH.h"
+#include "GenerateTestBVH.h"
+#include "IndexBVH.h"
+#include "ParseBVH.h"
+#include "PerformanceTests.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <pxr/base/js/json.h>
+#include <pxr/base/work/threadLimits.h>
+#include <pxr/usd/sdf/attributeSpec.h>
+#include <pxr/usd/sdf/layer.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/schema.h>
+#include <pxr/usd/usd/stage.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace usdBVHAnimPlugin;
+
+//! A single performance benchmark, run over a generated BVH file of the given size
+struct Benchmark {
+    char const* m_Name;
+    size_t m_NumJoints;
+    size_t m_NumFrames;
+    bool (*m_Function)(std::string const& filePath);
+};
+
+//! The number of times each benchmark is run, of which the fastest run is reported
+static int constexpr c_NumRepetitions = 5;
+
+//! The fraction by which throughput may fall below its baseline, if the baseline does not give one
+static double constexpr c_DefaultTolerance = 0.15;
+
+//! The name of the platform that baselines are recorded against
+#if defined(_WIN32)
+static char const* const c_Platform = "Windows";
+#elif defined(__APPLE__)
+static char const* const c_Platform = "macOS";
+#else
+static char const* const c_Platform = "Linux";
+#endif
+
+static bool BenchmarkParseBVH(std::string const& filePath)
+{
+    BVHDocument document;
+    return ParseBVH(filePath, document);
+}
+
+static bool BenchmarkBvhFileFormatRead(std::string const& filePath)
+{
+    // Anonymous layers are never shared through the layer registry, so the file is read every time
+    return bool(pxr::SdfLayer::OpenAsAnonymous(filePath));
+}
+
+static bool BenchmarkUsdCatFlatten(std::string const& filePath)
+{
+    // Equivalent to `usdcat --flatten`, without the cost of writing the result to a file
+    pxr::SdfLayerRefPtr layer = pxr::SdfLayer::OpenAsAnonymous(filePath);
+    if (!layer) {
+        return false;
+    }
+    pxr::UsdStageRefPtr stage = pxr::UsdStage::Open(layer);
+    std::string result;
+    return stage && stage->ExportToString(&result, false);
+}
+
+static Benchmark const c_Benchmarks[] = {
+    { "ParseBVH", 64, 5000, BenchmarkParseBVH },
+    { "BvhFileFormat_Read", 64, 500, BenchmarkBvhFileFormatRead },
+    { "UsdCat_Flatten", 64, 500, BenchmarkUsdCatFlatten },
+};
+
+//! Returns the baseline throughput of the given benchmark on this platform, or zero if none has been recorded
+static double GetBaseline(pxr::JsObject const& baseline, char const* name)
+{
+    auto baselines = baseline.find("baselines");
+    if (baselines == baseline.end() || !baselines->second.IsObject()) {
+        return 0.0;
+    }
+    auto const& platforms = baselines->second.GetJsObject();
+    auto benchmarks = platforms.find(c_Platform);
+    if (benchmarks == platforms.end() || !benchmarks->second.IsObject()) {
+        return 0.0;
+    }
+    auto value = benchmarks->second.GetJsObject().find(name);
+    if (value == benchmarks->second.GetJsObject().end() || !(value->second.IsReal() || value->second.IsInt())) {
+        return 0.0;
+    }
+    return value->second.GetReal();
+}
+
+int RunPerformanceTests(std::string const& baselinePath, std::string const& resultsPath, bool updateBaseline)
+{
+    pxr::JsObject baseline;
+    {
+        std::ifstream stream(baselinePath);
+        pxr::JsValue value = pxr::JsParseStream(stream);
+        if (value.IsObject()) {
+            baseline = value.GetJsObject();
+        } else if (!updateBaseline) {
+            printf("\tFailed to read performance baseline '%s'\n", baselinePath.c_str());
+            return 1;
+        }
+    }
+    double const tolerance = baseline.count("tolerance") && baseline["tolerance"].IsReal() ? baseline["tolerance"].GetReal() : c_DefaultTolerance;
+
+    // Timings of unoptimised builds are not representative, so they are reported but never compared
+#if defined(NDEBUG)
+    bool const compare = !updateBaseline;
+#else
+    bool const compare = false;
+#endif
+
+    bool passed = true;
+    pxr::JsArray results;
+    pxr::JsObject measured;
+    for (Benchmark const& benchmark : c_Benchmarks) {
+        printf("Running performance test '%s'...\n", benchmark.m_Name);
+
+        std::filesystem::path const filePath = std::filesystem::temp_directory_path() / (std::string("usdBVHAnim_performance_") + benchmark.m_Name + ".bvh");
+        std::string const contents = GenerateTestBVH(benchmark.m_NumJoints, benchmark.m_NumFrames);
+        {
+            std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+            stream << contents;
+        }
+
+        bool succeeded = true;
+        double bestSeconds = 0.0;
+        for (int repetition = 0; repetition < c_NumRepetitions && succeeded; ++repetition) {
+            auto const start = std::chrono::steady_clock::now();
+            succeeded = benchmark.m_Function(filePath.string());
+            double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            bestSeconds = repetition == 0 ? seconds : std::min(bestSeconds, seconds);
+        }
+        std::filesystem::remove(filePath);
+
+        double const throughput = static_cast<double>(contents.size()) / (1024.0 * 1024.0) / std::max(bestSeconds, 1e-9);
+
+        // A benchmark without a baseline for this platform is only reported, until one is recorded from its CI runs
+        double const baselineThroughput = GetBaseline(baseline, benchmark.m_Name);
+        bool const hasBaseline = baselineThroughput > 0.0;
+        bool const withinTolerance = !compare || !hasBaseline || throughput >= baselineThroughput * (1.0 - tolerance);
+        passed = passed && succeeded && withinTolerance;
+
+        printf("\t%.3fs, %.2f MB/s (baseline %.2f MB/s)%s\n", bestSeconds, throughput, baselineThroughput, !succeeded ? " - failed" : !withinTolerance ? " - slower than baseline" : !hasBaseline ? " - no baseline recorded" : "");
+
+        pxr::JsObject result;
+        result["name"] = pxr::JsValue(std::string(benchmark.m_Name));
+        result["joints"] = pxr::JsValue(static_cast<uint64_t>(benchmark.m_NumJoints));
+        result["frames"] = pxr::JsValue(static_cast<uint64_t>(benchmark.m_NumFrames));
+        result["bytes"] = pxr::JsValue(static_cast<uint64_t>(contents.size()));
+        result["wall_time_seconds"] = pxr::JsValue(bestSeconds);
+        result["throughput_mb_per_second"] = pxr::JsValue(throughput);
+        result["baseline_mb_per_second"] = pxr::JsValue(baselineThroughput);
+        result["passed"] = pxr::JsValue(succeeded && withinTolerance);
+        results.push_back(pxr::JsValue(result));
+        measured[benchmark.m_Name] = pxr::JsValue(throughput);
+    }
+
+    pxr::JsObject report;
+    report["platform"] = pxr::JsValue(std::string(c_Platform));
+    report["tolerance"] = pxr::JsValue(tolerance);
+    report["compared"] = pxr::JsValue(compare);
+    report["results"] = pxr::JsValue(results);
+    {
+        std::ofstream stream(resultsPath);
+        pxr::JsWriteToStream(pxr::JsValue(report), stream);
+    }
+
+    if (updateBaseline) {
+        pxr::JsObject baselines = baseline.count("baselines") && baseline["baselines"].IsObject() ? baseline["baselines"].GetJsObject() : pxr::JsObject();
+        baselines[c_Platform] = pxr::JsValue(measured);
+        baseline["tolerance"] = pxr::JsValue(tolerance);
+        baseline["baselines"] = pxr::JsValue(baselines);
+        std::ofstream stream(baselinePath);
+        pxr::JsWriteToStream(pxr::JsValue(baseline), stream);
+        printf("Updated '%s' baseline in '%s'\n", c_Platform, baselinePath.c_str());
+    }
+    return passed ? 0 : 1;
+}
+
+int RunScalingBenchmark(size_t numLayers, size_t maxThreads, std::string const& resultsPath)
+{
+    if (numLayers == 0) {
+        printf("\tAt least one layer must be read\n");
+        return 1;
+    }
+
+    // Distinct files with the same contents, such that each is read into its own layer
+    std::string const contents = GenerateTestBVH(32, 100);
+    std::vector<std::string> filePaths;
+    for (size_t i = 0; i < numLayers; ++i) {
+        std::filesystem::path const filePath = std::filesystem::temp_directory_path() / ("usdBVHAnim_scaling_" + std::to_string(i) + ".bvh");
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << contents;
+        filePaths.push_back(filePath.string());
+    }
+
+    // Read one layer up front, so that loading plug-ins and registering schemas is not measured
+    bool succeeded = bool(pxr::SdfLayer::OpenAsAnonymous(filePaths[0]));
+
+    pxr::JsArray results;
+    double singleThreadedLayersPerSecond = 0.0;
+    for (size_t numThreads = 1; numThreads <= maxThreads && succeeded; numThreads *= 2) {
+        // Each layer is held open until every layer has been read, as USD would for a scene
+        std::vector<pxr::SdfLayerRefPtr> layers(numLayers);
+        std::atomic<size_t> nextLayer { 0 };
+        std::vector<std::thread> threads;
+
+        auto const start = std::chrono::steady_clock::now();
+        for (size_t threadIndex = 0; threadIndex < numThreads; ++threadIndex) {
+            threads.emplace_back([&]() {
+                for (size_t i = nextLayer++; i < numLayers; i = nextLayer++) {
+                    layers[i] = pxr::SdfLayer::FindOrOpen(filePaths[i]);
+                }
+            });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        for (pxr::SdfLayerRefPtr const& layer : layers) {
+            succeeded = succeeded && layer;
+        }
+
+        double const layersPerSecond = static_cast<double>(numLayers) / std::max(seconds, 1e-9);
+        if (numThreads == 1) {
+            singleThreadedLayersPerSecond = layersPerSecond;
+        }
+        double const speedup = layersPerSecond / singleThreadedLayersPerSecond;
+        printf("\t%zu threads: %.3fs, %.1f layers/s, %.2fx speedup, %.0f%% efficiency\n", numThreads, seconds, layersPerSecond, speedup, 100.0 * speedup / static_cast<double>(numThreads));
+
+        pxr::JsObject result;
+        result["threads"] = pxr::JsValue(static_cast<uint64_t>(numThreads));
+        result["wall_time_seconds"] = pxr::JsValue(seconds);
+        result["layers_per_second"] = pxr::JsValue(layersPerSecond);
+        result["speedup"] = pxr::JsValue(speedup);
+        results.push_back(pxr::JsValue(result));
+    }
+
+    for (std::string const& filePath : filePaths) {
+        std::filesystem::remove(filePath);
+    }
+
+    pxr::JsObject report;
+    report["platform"] = pxr::JsValue(std::string(c_Platform));
+    report["layers"] = pxr::JsValue(static_cast<uint64_t>(numLayers));
+    report["results"] = pxr::JsValue(results);
+    {
+        std::ofstream stream(resultsPath);
+        pxr::JsWriteToStream(pxr::JsValue(report), stream);
+    }
+
+    if (!succeeded) {
+        printf("\tFailed to read every layer\n");
+        return 1;
+    }
+    return 0;
+}
+
+int RunAuthoringBenchmark(size_t numFrames, size_t maxThreads, std::string const& resultsPath)
+{
+    BVHDocument document;
+    std::istringstream stream(GenerateTestBVH(64, numFrames));
+    if (!ParseBVH(stream, document)) {
+        printf("\tFailed to parse generated BVH file\n");
+        return 1;
+    }
+
+    // Samples are authored to a single attribute, as the plug-in authors each animation attribute
+    pxr::SdfLayerRefPtr layer = pxr::SdfLayer::CreateAnonymous(".usda");
+    pxr::SdfPrimSpecHandle prim = pxr::SdfPrimSpec::New(layer, "Animation", pxr::SdfSpecifierDef);
+    pxr::SdfAttributeSpecHandle attribute = pxr::SdfAttributeSpec::New(prim, "translations", pxr::SdfValueTypeNames->Float3Array);
+    pxr::SdfPath const attributePath = attribute->GetPath();
+
+    pxr::JsArray results;
+    double singleThreadedSeconds = 0.0;
+    std::vector<pxr::VtArray<pxr::GfVec3f>> frameTranslations;
+    std::vector<pxr::VtArray<pxr::GfQuatf>> frameRotations;
+    for (size_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        pxr::WorkSetConcurrencyLimit(static_cast<unsigned>(numThreads));
+        auto const start = std::chrono::steady_clock::now();
+        ComputeBVHAnimationSamples(document, 1.0f, frameTranslations, frameRotations);
+        double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (numThreads == 1) {
+            singleThreadedSeconds = seconds;
+        }
+        double const speedup = singleThreadedSeconds / std::max(seconds, 1e-9);
+        printf("\t%zu threads: %.3fs, %.2fx speedup, %.0f%% efficiency\n", numThreads, seconds, speedup, 100.0 * speedup / static_cast<double>(numThreads));
+
+        pxr::JsObject result;
+        result["threads"] = pxr::JsValue(static_cast<uint64_t>(numThreads));
+        result["wall_time_seconds"] = pxr::JsValue(seconds);
+        result["speedup"] = pxr::JsValue(speedup);
+        results.push_back(pxr::JsValue(result));
+    }
+    pxr::WorkSetMaximumConcurrencyLimit();
+
+    // Compare inserting every sample at once with inserting one sample at a time
+    auto const bulkStart = std::chrono::steady_clock::now();
+    layer->SetField(attributePath, pxr::SdfFieldKeys->TimeSamples, MakeBVHTimeSamples(frameTranslations));
+    double const bulkSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - bulkStart).count();
+    layer->EraseField(attributePath, pxr::SdfFieldKeys->TimeSamples);
+
+    auto const perSampleStart = std::chrono::steady_clock::now();
+    for (size_t frameIndex = 0; frameIndex < frameTranslations.size(); ++frameIndex) {
+        layer->SetTimeSample(attributePath, 1.0 + frameIndex, frameTranslations[frameIndex]);
+    }
+    double const perSampleSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - perSampleStart).count();
+    printf("\tInserting %zu samples: %.3fs in bulk, %.3fs one at a time\n", frameTranslations.size(), bulkSeconds, perSampleSeconds);
+
+    pxr::JsObject report;
+    report["platform"] = pxr::JsValue(std::string(c_Platform));
+    report["frames"] = pxr::JsValue(static_cast<uint64_t>(numFrames));
+    report["results"] = pxr::JsValue(results);
+    report["bulk_insert_seconds"] = pxr::JsValue(bulkSeconds);
+    report["per_sample_insert_seconds"] = pxr::JsValue(perSampleSeconds);
+    {
+        std::ofstream resultsStream(resultsPath);
+        pxr::JsWriteToStream(pxr::JsValue(report), resultsStream);
+    }
+    return 0;
+}
+
+int RunIndexingBenchmark(size_t numFrames, std::string const& resultsPath)
+{
+    std::string const contents = GenerateTestBVH(64, numFrames);
+    size_t const motionOffset = contents.find("MOTION");
+    char const* const motion = contents.data() + motionOffset;
+    size_t const motionSize = std::min(contents.size() - motionOffset, c_MaxBVHIndexSize);
+    double const gigabytes = static_cast<double>(motionSize) / 1e9;
+
+    pxr::JsArray results;
+    BVHValueIndex expected;
+    IndexBVHValues(motion, motionSize, expected, BVHIndexKernel::Scalar);
+    for (auto const& [kernel, name] : { std::pair(BVHIndexKernel::Scalar, "Scalar"), std::pair(BVHIndexKernel::SSE2, "SSE2"), std::pair(BVHIndexKernel::AVX2, "AVX2") }) {
+        if (!IsBVHIndexKernelSupported(kernel)) {
+            printf("\t%s: not supported\n", name);
+            continue;
+        }
+
+        BVHValueIndex index;
+        double seconds = 0.0;
+        for (int repetition = 0; repetition < c_NumRepetitions; ++repetition) {
+            auto const start = std::chrono::steady_clock::now();
+            IndexBVHValues(motion, motionSize, index, kernel);
+            double const repetitionSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            seconds = repetition == 0 ? repetitionSeconds : std::min(seconds, repetitionSeconds);
+        }
+        if (index.m_ValueStarts != expected.m_ValueStarts || index.m_LineStarts != expected.m_LineStarts) {
+            printf("\t%s: index differs from the scalar kernel\n", name);
+            return 1;
+        }
+        double const throughput = gigabytes / std::max(seconds, 1e-9);
+        printf("\t%s: indexed %zu values and %zu lines in %.3fs, %.2f GB/s\n", name, index.m_ValueStarts.size(), index.m_LineStarts.size(), seconds, throughput);
+
+        pxr::JsObject result;
+        result["kernel"] = pxr::JsValue(std::string(name));
+        result["wall_time_seconds"] = pxr::JsValue(seconds);
+        result["gigabytes_per_second"] = pxr::JsValue(throughput);
+        results.push_back(pxr::JsValue(result));
+    }
+
+    // Parsing also converts every value, with the fastest supported kernel
+    auto const parseStart = std::chrono::steady_clock::now();
+    BVHDocument document;
+    if (!ParseBVH(contents.data(), contents.size(), document)) {
+        printf("\tFailed to parse generated BVH file\n");
+        return 1;
+    }
+    double const parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parseStart).count();
+    double const parseThroughput = static_cast<double>(contents.size()) / 1e9 / std::max(parseSeconds, 1e-9);
+    printf("\tParsing: %.3fs, %.2f GB/s\n", parseSeconds, parseThroughput);
+
+    pxr::JsObject report;
+    report["platform"] = pxr::JsValue(std::string(c_Platform));
+    report["frames"] = pxr::JsValue(static_cast<uint64_t>(numFrames));
+    report["motion_bytes"] = pxr::JsValue(static_cast<uint64_t>(motionSize));
+    report["results"] = pxr::JsValue(results);
+    report["parse_seconds"] = pxr::JsValue(parseSeconds);
+    report["parse_gigabytes_per_second"] = pxr::JsValue(parseThroughput);
+    {
+        std::ofstream resultsStream(resultsPath);
+        pxr::JsWriteToStream(pxr::JsValue(report), resultsStream);
+    }
+    return 0;
+}
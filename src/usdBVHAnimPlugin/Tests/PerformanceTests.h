@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+
+//! Run each performance test over a generated BVH file, and write the wall time and throughput of
+//! each to a JSON results file. Returns a non-zero exit code if any test fails, or is slower than
+//! the throughput recorded for this platform in the given baseline file, less its tolerance. If
+//! `updateBaseline` is `true`, the measured throughputs are instead recorded in the baseline file.
+int RunPerformanceTests(std::string const& baselinePath, std::string const& resultsPath, bool updateBaseline);
+
+//! Read the given number of distinct BVH layers from 1, 2, 4 and so on up to the given maximum number
+//! of threads, reporting the throughput and speedup over a single thread for each, so that contention
+//! between concurrent reads can be seen. Results are also written to a JSON results file. Returns a
+//! non-zero exit code if any layer fails to be read.
+int RunScalingBenchmark(size_t numLayers, size_t maxThreads, std::string const& resultsPath);
+
+//! Compute the samples of every frame of a generated BVH file with the given number of frames, on 1, 2,
+//! 4 and so on up to the given maximum number of threads, reporting the time taken and speedup over a
+//! single thread for each, along with the time taken to insert the samples into a layer in bulk and one
+//! sample at a time. Results are also written to a JSON results file. Returns a non-zero exit code if
+//! the file fails to be parsed.
+int RunAuthoringBenchmark(size_t numFrames, size_t maxThreads, std::string const& resultsPath);
+
+//! Index the values of a generated BVH file with the given number of frames with each `BVHIndexKernel`
+//! supported by this processor, reporting the throughput of the indexing stage alone in GB/s, along with
+//! the throughput of parsing the whole file, which includes converting every value. Results are also
+//! written to a JSON results file. Returns a non-zero exit code if any kernel's index differs from that
+//! of the scalar kernel, or if the file fails to be parsed.
+int RunIndexingBenchmark(size_t numFrames, std::string const& resultsPath);
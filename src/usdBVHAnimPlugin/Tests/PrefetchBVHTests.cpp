@@ -0,0 +1,122 @@
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "PrefetchBVH.h"
+#include "Tests.h"
+#include <filesystem>
+#include <fstream>
+
+using namespace usdBVHAnimPlugin;
+
+//! Write the given contents to a file of the given name in the temporary directory, returning its path
+static std::string WriteTemporaryBVH(std::string const& fileName, std::string const& contents)
+{
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / fileName;
+    std::ofstream stream(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream << contents;
+    return filePath.string();
+}
+
+BEGIN_TEST_FIXTURE(PrefetchBVHTests)
+
+TEST(TakePrefetchedBVH_Fails_When_Not_Prefetched)
+{
+    BVHDocument document;
+    TEST_REQUIRE(!TakePrefetchedBVH("data/test_bvh.bvh", document));
+    TEST_REQUIRE(document.m_JointNames.empty());
+}
+
+TEST(TakePrefetchedBVH_Returns_Prefetched_Document_Once)
+{
+    BVHDocument expected;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", expected));
+
+    PrefetchBVH({ "data/test_bvh.bvh", "data/test_bvh.bvh" });
+
+    BVHDocument document;
+    TEST_REQUIRE(TakePrefetchedBVH("data/test_bvh.bvh", document));
+    TEST_REQUIRE(document.m_JointNames == expected.m_JointNames);
+    TEST_REQUIRE(document.m_FrameTransforms.size() == expected.m_FrameTransforms.size());
+    TEST_REQUIRE(document.m_FrameTime == expected.m_FrameTime);
+
+    // The document store no longer holds the file once it has been taken
+    BVHDocument again;
+    TEST_REQUIRE(!TakePrefetchedBVH("data/test_bvh.bvh", again));
+}
+
+TEST(TakePrefetchedBVH_Fails_When_Parse_Fails)
+{
+    PrefetchBVH({ "data/does_not_exist.bvh" });
+    BVHDocument document;
+    TEST_REQUIRE(!TakePrefetchedBVH("data/does_not_exist.bvh", document));
+}
+
+TEST(TakePrefetchedBVH_Many_Files_Concurrently)
+{
+    std::vector<std::string> filePaths;
+    for (size_t i = 0; i < 32; ++i) {
+        filePaths.push_back(WriteTemporaryBVH("usdBVHAnim_prefetch_" + std::to_string(i) + ".bvh", GenerateTestBVH(2, 20 + i)));
+    }
+    PrefetchBVH(filePaths);
+
+    for (size_t i = 0; i < filePaths.size(); ++i) {
+        BVHDocument document;
+        TEST_REQUIRE(TakePrefetchedBVH(filePaths[i], document));
+        TEST_REQUIRE(document.m_FrameTransforms.size() == (20 + i) * 2);
+        std::filesystem::remove(filePaths[i]);
+    }
+}
+
+TEST(TakePrefetchedBVH_Finds_Files_By_Canonical_Path)
+{
+    // Paths that refer to the same file share a single entry
+    PrefetchBVH({ "data/./test_bvh.bvh", "data/../data/test_bvh.bvh" });
+
+    BVHDocument document;
+    TEST_REQUIRE(TakePrefetchedBVH(std::filesystem::absolute("data/test_bvh.bvh").string(), document));
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 20 * 2);
+
+    BVHDocument again;
+    TEST_REQUIRE(!TakePrefetchedBVH("data/test_bvh.bvh", again));
+}
+
+TEST(TakePrefetchedBVH_Fails_When_File_Rewritten)
+{
+    std::string const filePath = WriteTemporaryBVH("usdBVHAnim_prefetch_rewritten.bvh", GenerateTestBVH(2, 20));
+    PrefetchBVH({ filePath });
+    WaitForPrefetchedBVH();
+
+    // The prefetched document is stale, so the file is left to be parsed again
+    WriteTemporaryBVH("usdBVHAnim_prefetch_rewritten.bvh", GenerateTestBVH(2, 30));
+    BVHDocument document;
+    TEST_REQUIRE(!TakePrefetchedBVH(filePath, document));
+    TEST_REQUIRE(document.m_FrameTransforms.empty());
+    TEST_REQUIRE(ParseBVH(filePath, document));
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 30 * 2);
+    std::filesystem::remove(filePath);
+}
+
+TEST(TakePrefetchedBVH_Fails_Once_Evicted)
+{
+    // Documents beyond the maximum size of the store are discarded as soon as they are parsed
+    BVHPrefetchOptions sizeOptions;
+    sizeOptions.m_MaxBytes = 0;
+    PrefetchBVH({ "data/test_bvh.bvh" }, sizeOptions);
+    WaitForPrefetchedBVH();
+    BVHDocument document;
+    TEST_REQUIRE(!TakePrefetchedBVH("data/test_bvh.bvh", document));
+
+    // Documents older than the maximum age are discarded by later calls
+    BVHPrefetchOptions ageOptions;
+    ageOptions.m_MaxAge = std::chrono::seconds(0);
+    PrefetchBVH({ "data/test_bvh.bvh" }, ageOptions);
+    WaitForPrefetchedBVH();
+    TEST_REQUIRE(!TakePrefetchedBVH("data/test_bvh.bvh", document));
+
+    // Documents within both limits are held until they are taken
+    PrefetchBVH({ "data/test_bvh.bvh" });
+    WaitForPrefetchedBVH();
+    TEST_REQUIRE(TakePrefetchedBVH("data/test_bvh.bvh", document));
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 20 * 2);
+}
+
+END_TEST_FIXTURE()
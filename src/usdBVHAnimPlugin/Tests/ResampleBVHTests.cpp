@@ -0,0 +1,116 @@
+#include "ParseBVH.h"
+#include "ResampleBVH.h"
+#include "Tests.h"
+#include <cmath>
+
+using namespace usdBVHAnimPlugin;
+
+static double QuatLength(BVHTransform const& transform)
+{
+    double const* q = transform.m_RotationQuat;
+    return std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+}
+
+BEGIN_TEST_FIXTURE(ResampleBVHTests)
+
+TEST(InterpolateBVHTransforms_Endpoints_Match_Inputs)
+{
+    double constexpr c_Tolerance = 1e-9;
+    BVHTransform a = { { 0.0, 0.0, 0.0, 1.0 }, { 1.0, 2.0, 3.0 } };
+    BVHTransform b = { { std::sin(M_PI * 0.25), 0.0, 0.0, std::cos(M_PI * 0.25) }, { 3.0, 2.0, 1.0 } };
+
+    BVHTransform result;
+    InterpolateBVHTransforms(&a, &b, 1, 0.0, &result);
+    for (size_t c = 0; c < 4; ++c) {
+        TEST_REQUIRE(std::fabs(result.m_RotationQuat[c] - a.m_RotationQuat[c]) < c_Tolerance);
+    }
+    for (size_t c = 0; c < 3; ++c) {
+        TEST_REQUIRE(std::fabs(result.m_Translation[c] - a.m_Translation[c]) < c_Tolerance);
+    }
+
+    InterpolateBVHTransforms(&a, &b, 1, 1.0, &result);
+    for (size_t c = 0; c < 4; ++c) {
+        TEST_REQUIRE(std::fabs(result.m_RotationQuat[c] - b.m_RotationQuat[c]) < c_Tolerance);
+    }
+    for (size_t c = 0; c < 3; ++c) {
+        TEST_REQUIRE(std::fabs(result.m_Translation[c] - b.m_Translation[c]) < c_Tolerance);
+    }
+}
+
+TEST(InterpolateBVHTransforms_Midpoint_Is_Halfway_Rotation)
+{
+    double constexpr c_Tolerance = 1e-9;
+    BVHTransform a = { { 0.0, 0.0, 0.0, 1.0 }, { 0.0, 0.0, 0.0 } };
+    BVHTransform b = { { std::sin(M_PI * 0.25), 0.0, 0.0, std::cos(M_PI * 0.25) }, { 2.0, 4.0, 6.0 } };
+
+    BVHTransform result;
+    InterpolateBVHTransforms(&a, &b, 1, 0.5, &result);
+    TEST_REQUIRE(std::fabs(result.m_RotationQuat[0] - std::sin(M_PI * 0.125)) < c_Tolerance);
+    TEST_REQUIRE(std::fabs(result.m_RotationQuat[3] - std::cos(M_PI * 0.125)) < c_Tolerance);
+    TEST_REQUIRE(std::fabs(result.m_Translation[0] - 1.0) < c_Tolerance);
+    TEST_REQUIRE(std::fabs(result.m_Translation[1] - 2.0) < c_Tolerance);
+    TEST_REQUIRE(std::fabs(result.m_Translation[2] - 3.0) < c_Tolerance);
+}
+
+TEST(InterpolateBVHTransforms_Takes_Shortest_Path_Across_Hemispheres)
+{
+    double constexpr c_Tolerance = 1e-9;
+    BVHTransform a = { { 0.0, 0.0, 0.0, 1.0 }, { 0.0, 0.0, 0.0 } };
+    BVHTransform b = { { 0.0, 0.0, 0.0, -1.0 }, { 0.0, 0.0, 0.0 } };
+
+    // Both quaternions represent the identity rotation, so the result must do so too
+    BVHTransform result;
+    InterpolateBVHTransforms(&a, &b, 1, 0.5, &result);
+    TEST_REQUIRE(std::fabs(QuatLength(result) - 1.0) < c_Tolerance);
+    TEST_REQUIRE(std::fabs(std::fabs(result.m_RotationQuat[3]) - 1.0) < c_Tolerance);
+}
+
+TEST(ResampleBVH_Fails_On_Invalid_FrameRate)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+    TEST_REQUIRE(!ResampleBVH(document, 0.0));
+    TEST_REQUIRE(!ResampleBVH(document, -24.0));
+}
+
+TEST(ResampleBVH_Downsample_Matches_Source_Frames)
+{
+    double constexpr c_Tolerance = 1e-3;
+    BVHDocument source;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", source));
+
+    // The test data is 20 frames at 24fps, so resampling to 12fps keeps every other frame
+    BVHDocument document = source;
+    TEST_REQUIRE(ResampleBVH(document, 12.0));
+    size_t const numJoints = document.m_JointNames.size();
+    TEST_REQUIRE(std::fabs(document.m_FrameTime - 1.0 / 12.0) < 1e-9);
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 10 * numJoints);
+
+    for (size_t frameIndex = 0; frameIndex < 10; ++frameIndex) {
+        for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+            auto const& expected = source.m_FrameTransforms[frameIndex * 2 * numJoints + jointIndex];
+            auto const& actual = document.m_FrameTransforms[frameIndex * numJoints + jointIndex];
+            for (size_t c = 0; c < 4; ++c) {
+                TEST_REQUIRE(std::fabs(actual.m_RotationQuat[c] - expected.m_RotationQuat[c]) < c_Tolerance);
+            }
+            for (size_t c = 0; c < 3; ++c) {
+                TEST_REQUIRE(std::fabs(actual.m_Translation[c] - expected.m_Translation[c]) < c_Tolerance);
+            }
+        }
+    }
+}
+
+TEST(ResampleBVH_Upsample_Produces_Normalised_Rotations)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+    size_t const numJoints = document.m_JointNames.size();
+
+    TEST_REQUIRE(ResampleBVH(document, 48.0));
+    TEST_REQUIRE(document.m_FrameTransforms.size() == 39 * numJoints);
+    for (auto const& transform : document.m_FrameTransforms) {
+        TEST_REQUIRE(std::fabs(QuatLength(transform) - 1.0) < 1e-9);
+    }
+}
+
+END_TEST_FIXTURE()
@@ -0,0 +1,114 @@
+#include "ParseBVH.h"
+#include "SampleBVH.h"
+#include "Tests.h"
+#include <cmath>
+#include <vector>
+
+using namespace usdBVHAnimPlugin;
+
+static bool IsCloseTransform(BVHTransform const& a, BVHTransform const& b, double tolerance)
+{
+    // Quaternions q and -q represent the same rotation
+    double dot = 0.0;
+    for (size_t c = 0; c < 4; ++c) {
+        dot += a.m_RotationQuat[c] * b.m_RotationQuat[c];
+    }
+    double const sign = dot < 0.0 ? -1.0 : 1.0;
+    for (size_t c = 0; c < 4; ++c) {
+        if (std::fabs(a.m_RotationQuat[c] - b.m_RotationQuat[c] * sign) > tolerance) {
+            return false;
+        }
+    }
+    for (size_t c = 0; c < 3; ++c) {
+        if (std::fabs(a.m_Translation[c] - b.m_Translation[c]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BEGIN_TEST_FIXTURE(SampleBVHTests)
+
+TEST(SampleBVHPose_Local_At_Frame_Matches_Document)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+
+    BVHTransform pose[2];
+    TEST_REQUIRE(SampleBVHPose(document, 5.0 * document.m_FrameTime, BVHPoseSpace::Local, pose));
+    TEST_REQUIRE(IsCloseTransform(pose[0], document.m_FrameTransforms[5 * 2 + 0], 1e-9));
+    TEST_REQUIRE(IsCloseTransform(pose[1], document.m_FrameTransforms[5 * 2 + 1], 1e-9));
+}
+
+TEST(SampleBVHPose_Local_Between_Frames_Interpolates)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+
+    BVHTransform pose[2];
+    TEST_REQUIRE(SampleBVHPose(document, 2.5 * document.m_FrameTime, BVHPoseSpace::Local, pose));
+    double const expectedY = 0.5 * (document.m_FrameTransforms[2 * 2].m_Translation[1] + document.m_FrameTransforms[3 * 2].m_Translation[1]);
+    TEST_REQUIRE(std::fabs(pose[0].m_Translation[1] - expectedY) < 1e-9);
+}
+
+TEST(SampleBVHPose_Clamps_Outside_Animation)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+
+    BVHTransform pose[2];
+    TEST_REQUIRE(SampleBVHPose(document, -1.0, BVHPoseSpace::Local, pose));
+    TEST_REQUIRE(IsCloseTransform(pose[0], document.m_FrameTransforms[0], 1e-9));
+    TEST_REQUIRE(SampleBVHPose(document, 100.0, BVHPoseSpace::Local, pose));
+    TEST_REQUIRE(IsCloseTransform(pose[0], document.m_FrameTransforms[19 * 2], 1e-9));
+}
+
+TEST(SampleBVHPose_World_Composes_Parent_Transforms)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+
+    // On the last frame, the root is raised by 1 and rotated 90 degrees about X, which
+    // swings the child's offset of (0, 0, 1) onto (0, -1, 0), placing the child at the origin
+    BVHTransform pose[2];
+    TEST_REQUIRE(SampleBVHPose(document, 19.0 * document.m_FrameTime, BVHPoseSpace::World, pose));
+    TEST_REQUIRE(IsCloseTransform(pose[0], document.m_FrameTransforms[19 * 2], 1e-9));
+    TEST_REQUIRE(std::fabs(pose[1].m_Translation[0]) < 1e-5);
+    TEST_REQUIRE(std::fabs(pose[1].m_Translation[1]) < 1e-5);
+    TEST_REQUIRE(std::fabs(pose[1].m_Translation[2]) < 1e-5);
+
+    // The child's world rotation is the root's X rotation followed by its own Y rotation
+    double const s = std::sin(M_PI * 0.25);
+    double const c = std::cos(M_PI * 0.25);
+    BVHTransform expected = { { s * c, c * s, s * s, c * c }, { 0.0, 0.0, 0.0 } };
+    TEST_REQUIRE(IsCloseTransform(pose[1], expected, 1e-5));
+}
+
+TEST(SampleBVHPoses_Batch_Matches_Individual_Samples)
+{
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH("data/test_bvh.bvh", document));
+
+    std::vector<double> times;
+    for (size_t i = 0; i < 50; ++i) {
+        times.push_back(static_cast<double>(i) * 0.0173);
+    }
+
+    std::vector<BVHTransform> batch(times.size() * 2);
+    TEST_REQUIRE(SampleBVHPoses(document, times.data(), times.size(), BVHPoseSpace::World, batch.data()));
+    for (size_t i = 0; i < times.size(); ++i) {
+        BVHTransform pose[2];
+        TEST_REQUIRE(SampleBVHPose(document, times[i], BVHPoseSpace::World, pose));
+        TEST_REQUIRE(IsCloseTransform(pose[0], batch[i * 2 + 0], 1e-12));
+        TEST_REQUIRE(IsCloseTransform(pose[1], batch[i * 2 + 1], 1e-12));
+    }
+}
+
+TEST(SampleBVHPose_Fails_Without_Frames)
+{
+    BVHDocument document;
+    BVHTransform pose;
+    TEST_REQUIRE(!SampleBVHPose(document, 0.0, BVHPoseSpace::Local, &pose));
+}
+
+END_TEST_FIXTURE()
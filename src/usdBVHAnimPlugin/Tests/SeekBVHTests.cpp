@@ -0,0 +1,175 @@
+#include "BVHChunkReaders.h"
+#include "CompareBVH.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "SeekBVH.h"
+#include "Tests.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace usdBVHAnimPlugin;
+
+//! Returns an empty temporary directory for the files of a test
+static std::filesystem::path CreateTestDirectory()
+{
+    std::filesystem::path const directory = std::filesystem::temp_directory_path() / "usdBVHAnim_seek_tests";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    return directory;
+}
+
+static void WriteFile(std::filesystem::path const& filePath, std::string const& contents)
+{
+    std::ofstream stream(filePath, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream << contents;
+}
+
+BEGIN_TEST_FIXTURE(SeekBVHTests)
+
+TEST(BuildBVHSeekIndex_Indexes_Every_Interval_Of_Frames)
+{
+    std::string const contents = GenerateTestBVH(5, 1000);
+    BVHSeekIndex index;
+    TEST_REQUIRE(BuildBVHSeekIndex(contents.data(), contents.size(), index, 100));
+    TEST_REQUIRE(index.m_FileSize == contents.size());
+    TEST_REQUIRE(index.m_FrameInterval == 100);
+    TEST_REQUIRE(index.m_NumFrames == 1000);
+    TEST_REQUIRE(index.m_FrameOffsets.size() == 10);
+
+    // The first offset is the end of the header, and every offset is the start of a frame's line
+    BVHDocument header;
+    size_t numFrames = 0;
+    size_t headerSize = 0;
+    TEST_REQUIRE(ParseBVHHeader(contents.data(), contents.size(), header, numFrames, headerSize));
+    TEST_REQUIRE(numFrames == 1000);
+    TEST_REQUIRE(header.m_FrameTransforms.empty());
+    TEST_REQUIRE(index.m_FrameOffsets[0] == headerSize);
+    size_t lineStart = headerSize;
+    for (size_t frame = 0; frame < 1000; ++frame) {
+        if (frame % 100 == 0) {
+            TEST_REQUIRE(index.m_FrameOffsets[frame / 100] == lineStart);
+        }
+        lineStart = contents.find('\n', lineStart) + 1;
+    }
+
+    // A chunk reader gives the same index, regardless of how its contents are split into reads
+    BVHMemoryChunkReader reader(contents.data(), contents.size());
+    BVHSeekIndex readerIndex;
+    TEST_REQUIRE(BuildBVHSeekIndex(reader, readerIndex, 100));
+    TEST_REQUIRE(readerIndex.m_FrameOffsets == index.m_FrameOffsets);
+}
+
+TEST(BuildBVHSeekIndex_Fails_On_Missing_Frames)
+{
+    std::string const contents = GenerateTestBVH(2, 10);
+    BVHSeekIndex index;
+    TEST_REQUIRE(!BuildBVHSeekIndex(contents.data(), contents.size() / 2 + 200, index, 4));
+    TEST_REQUIRE(!BuildBVHSeekIndex("HIERARCHY", 9, index, 4));
+}
+
+TEST(ParseBVHFrameRange_Matches_Frames_Of_Whole_File)
+{
+    std::string const contents = GenerateTestBVH(20, 500);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), document));
+    BVHSeekIndex index;
+    TEST_REQUIRE(BuildBVHSeekIndex(contents.data(), contents.size(), index, 64));
+
+    // Ranges within a single interval, spanning intervals, on their boundaries, and beyond the last frame
+    std::pair<size_t, size_t> const ranges[] = { { 0, 1 }, { 0, 64 }, { 10, 20 }, { 63, 2 }, { 64, 64 }, { 100, 300 }, { 490, 100 }, { 500, 5 }, { 0, 500 } };
+    BVHJointSelection const selection { { "Joint7" }, {} };
+    for (auto const& [firstFrame, numFrames] : ranges) {
+        BVHDocument expected = document;
+        SelectBVHFrames(expected, firstFrame, numFrames);
+
+        BVHDocument seeked;
+        TEST_REQUIRE(ParseBVHFrameRange(contents.data(), contents.size(), index, firstFrame, numFrames, seeked));
+        TEST_REQUIRE(IsSameDocument(seeked, expected));
+
+        BVHMemoryChunkReader reader(contents.data(), contents.size());
+        BVHDocument scanned;
+        TEST_REQUIRE(ParseBVHFrameRange(reader, firstFrame, numFrames, scanned));
+        TEST_REQUIRE(IsSameDocument(scanned, expected));
+
+        TEST_REQUIRE(SelectBVHJoints(expected, selection));
+        BVHDocument selected;
+        TEST_REQUIRE(ParseBVHFrameRange(contents.data(), contents.size(), index, firstFrame, numFrames, selected, selection));
+        TEST_REQUIRE(IsSameDocument(selected, expected));
+    }
+
+    // An index of other contents is rejected
+    BVHDocument mismatched;
+    TEST_REQUIRE(!ParseBVHFrameRange(contents.data(), contents.size() - 1, index, 0, 1, mismatched));
+}
+
+TEST(FindOrBuildBVHSeekIndex_Writes_Sidecar_And_Detects_Changes)
+{
+    std::filesystem::path const directory = CreateTestDirectory();
+    std::string const filePath = (directory / "take.bvh").string();
+    WriteFile(filePath, GenerateTestBVH(4, 300));
+
+    // The first lookup builds the index and writes it next to the file, where the second finds it
+    BVHSeekIndex index;
+    TEST_REQUIRE(FindOrBuildBVHSeekIndex(filePath, {}, index, 32));
+    std::string const indexPath = GetBVHSeekIndexPath(filePath);
+    TEST_REQUIRE(indexPath == filePath + ".bvhidx");
+    TEST_REQUIRE(std::filesystem::exists(indexPath));
+    TEST_REQUIRE(IsBVHSeekIndexCurrent(filePath, index));
+    BVHSeekIndex readIndex;
+    TEST_REQUIRE(ReadBVHSeekIndex(indexPath, filePath, readIndex));
+    TEST_REQUIRE(readIndex.m_FrameOffsets == index.m_FrameOffsets);
+    TEST_REQUIRE(readIndex.m_ModificationTime == index.m_ModificationTime);
+
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(filePath, document));
+    SelectBVHFrames(document, 40, 70);
+    BVHDocument seeked;
+    TEST_REQUIRE(ParseBVHFrameRange(filePath, readIndex, 40, 70, seeked));
+    TEST_REQUIRE(IsSameDocument(seeked, document));
+
+    // Once the file changes, the index is out of date, and is rebuilt
+    WriteFile(filePath, GenerateTestBVH(4, 310));
+    TEST_REQUIRE(!IsBVHSeekIndexCurrent(filePath, readIndex));
+    TEST_REQUIRE(!ReadBVHSeekIndex(indexPath, filePath, readIndex));
+    BVHDocument stale;
+    TEST_REQUIRE(!ParseBVHFrameRange(filePath, index, 40, 70, stale));
+    TEST_REQUIRE(FindOrBuildBVHSeekIndex(filePath, {}, index, 32));
+    TEST_REQUIRE(index.m_NumFrames == 310);
+    TEST_REQUIRE(ReadBVHSeekIndex(indexPath, filePath, readIndex));
+
+    // A truncated index is never read
+    std::filesystem::resize_file(indexPath, std::filesystem::file_size(indexPath) - 8);
+    TEST_REQUIRE(!ReadBVHSeekIndex(indexPath, filePath, readIndex));
+    std::filesystem::remove_all(directory);
+}
+
+TEST(GetBVHSeekIndexPath_Names_Indices_In_Directory_By_File_Path)
+{
+    std::filesystem::path const directory = CreateTestDirectory();
+    std::filesystem::create_directories(directory / "a");
+    std::filesystem::create_directories(directory / "b");
+    std::filesystem::create_directories(directory / "indices");
+    std::string const firstPath = (directory / "a" / "take.bvh").string();
+    std::string const secondPath = (directory / "b" / "take.bvh").string();
+    WriteFile(firstPath, GenerateTestBVH(3, 50));
+    WriteFile(secondPath, GenerateTestBVH(3, 60));
+
+    // Files of the same name in different directories have their own index
+    std::string const indexDirectory = (directory / "indices").string();
+    std::string const firstIndexPath = GetBVHSeekIndexPath(firstPath, indexDirectory);
+    std::string const secondIndexPath = GetBVHSeekIndexPath(secondPath, indexDirectory);
+    TEST_REQUIRE(firstIndexPath != secondIndexPath);
+    TEST_REQUIRE(std::filesystem::path(firstIndexPath).parent_path() == directory / "indices");
+
+    BVHSeekIndex firstIndex;
+    BVHSeekIndex secondIndex;
+    TEST_REQUIRE(FindOrBuildBVHSeekIndex(firstPath, indexDirectory, firstIndex, 16));
+    TEST_REQUIRE(FindOrBuildBVHSeekIndex(secondPath, indexDirectory, secondIndex, 16));
+    TEST_REQUIRE(std::filesystem::exists(firstIndexPath) && std::filesystem::exists(secondIndexPath));
+    TEST_REQUIRE(!std::filesystem::exists(firstPath + ".bvhidx"));
+    TEST_REQUIRE(firstIndex.m_NumFrames == 50 && secondIndex.m_NumFrames == 60);
+    std::filesystem::remove_all(directory);
+}
+
+END_TEST_FIXTURE()
@@ -0,0 +1,194 @@
+#include "BVHChunkReaders.h"
+#include "GenerateTestBVH.h"
+#include "ParseBVH.h"
+#include "SampleBVH.h"
+#include "StatsBVH.h"
+#include "Tests.h"
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace usdBVHAnimPlugin;
+
+//! Find the range of every joint over the given frames one frame at a time, as a reference for the statistics
+static std::vector<BVHJointRange> FindReferenceRanges(BVHDocument const& document, size_t firstFrame, size_t endFrame)
+{
+    size_t const numJoints = document.m_JointNames.size();
+    std::vector<BVHTransform> worldPoses(document.m_FrameTransforms.begin(), document.m_FrameTransforms.end());
+    ComputeBVHWorldPoses(document, worldPoses.data(), worldPoses.size() / numJoints);
+
+    std::vector<BVHJointRange> ranges(numJoints);
+    for (size_t jointIndex = 0; jointIndex < numJoints; ++jointIndex) {
+        BVHJointRange& range = ranges[jointIndex];
+        for (size_t frame = firstFrame; frame < endFrame; ++frame) {
+            BVHTransform const& local = document.m_FrameTransforms[frame * numJoints + jointIndex];
+            BVHTransform const& world = worldPoses[frame * numJoints + jointIndex];
+            double const sign = local.m_RotationQuat[3] < 0.0 ? -1.0 : 1.0;
+            for (size_t i = 0; i < 3; ++i) {
+                range.m_MinTranslation[i] = frame == firstFrame ? local.m_Translation[i] : std::fmin(range.m_MinTranslation[i], local.m_Translation[i]);
+                range.m_MaxTranslation[i] = frame == firstFrame ? local.m_Translation[i] : std::fmax(range.m_MaxTranslation[i], local.m_Translation[i]);
+                range.m_MinPosition[i] = frame == firstFrame ? world.m_Translation[i] : std::fmin(range.m_MinPosition[i], world.m_Translation[i]);
+                range.m_MaxPosition[i] = frame == firstFrame ? world.m_Translation[i] : std::fmax(range.m_MaxPosition[i], world.m_Translation[i]);
+            }
+            for (size_t i = 0; i < 4; ++i) {
+                double const component = sign * local.m_RotationQuat[i];
+                range.m_MinRotation[i] = frame == firstFrame ? component : std::fmin(range.m_MinRotation[i], component);
+                range.m_MaxRotation[i] = frame == firstFrame ? component : std::fmax(range.m_MaxRotation[i], component);
+            }
+        }
+    }
+    return ranges;
+}
+
+static bool IsSameRange(BVHJointRange const& a, BVHJointRange const& b)
+{
+    for (size_t i = 0; i < 3; ++i) {
+        if (a.m_MinTranslation[i] != b.m_MinTranslation[i] || a.m_MaxTranslation[i] != b.m_MaxTranslation[i]
+            || a.m_MinPosition[i] != b.m_MinPosition[i] || a.m_MaxPosition[i] != b.m_MaxPosition[i]) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        if (a.m_MinRotation[i] != b.m_MinRotation[i] || a.m_MaxRotation[i] != b.m_MaxRotation[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+BEGIN_TEST_FIXTURE(StatsBVHTests)
+
+TEST(QueryBVHJointRanges_Matches_Reference)
+{
+    std::string const contents = GenerateTestBVH(9, 9000);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), document));
+    BVHMotionStats stats;
+    BuildBVHMotionStats(document, stats);
+    TEST_REQUIRE(stats.m_NumJoints == 9);
+    TEST_REQUIRE(stats.m_NumFrames == 9000);
+    TEST_REQUIRE(stats.m_Blocks.size() == 141 * 9);
+    TEST_REQUIRE(stats.m_Groups.size() == 3 * 9);
+    TEST_REQUIRE(stats.m_GroupRuns.size() == 2);
+
+    // Ranges within a block, on block and group boundaries, spanning groups, and beyond the last frame
+    std::pair<size_t, size_t> const ranges[] = { { 0, 1 }, { 5, 50 }, { 0, 64 }, { 63, 2 }, { 64, 128 }, { 100, 4000 }, { 0, 4096 },
+        { 4095, 4098 }, { 1, 8999 }, { 0, 9000 }, { 8190, 5000 }, { 8999, 1 } };
+    for (auto const& [firstFrame, numFrames] : ranges) {
+        std::vector<BVHJointRange> result;
+        TEST_REQUIRE(QueryBVHJointRanges(document, stats, firstFrame, numFrames, result));
+        std::vector<BVHJointRange> const expected = FindReferenceRanges(document, firstFrame, std::min(firstFrame + numFrames, size_t(9000)));
+        TEST_REQUIRE(result.size() == expected.size());
+        for (size_t jointIndex = 0; jointIndex < expected.size(); ++jointIndex) {
+            TEST_REQUIRE(IsSameRange(result[jointIndex], expected[jointIndex]));
+        }
+    }
+
+    // Empty ranges, and statistics of other documents, are rejected
+    std::vector<BVHJointRange> result;
+    TEST_REQUIRE(!QueryBVHJointRanges(document, stats, 9000, 1, result));
+    TEST_REQUIRE(!QueryBVHJointRanges(document, stats, 0, 0, result));
+    BVHDocument shorter = document;
+    SelectBVHFrames(shorter, 0, 100);
+    TEST_REQUIRE(!QueryBVHJointRanges(shorter, stats, 0, 1, result));
+}
+
+TEST(AppendBVHMotionStats_Matches_Whole_Document)
+{
+    std::string const contents = GenerateTestBVH(6, 5000);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), document));
+    BVHMotionStats expected;
+    BuildBVHMotionStats(document, expected);
+
+    // Chunks that do not line up with blocks or groups extend the last of them
+    BVHMemoryChunkReader reader(contents.data(), contents.size());
+    BVHDocument chunk;
+    BVHMotionStats stats;
+    TEST_REQUIRE(ParseBVHFrameChunks(reader, chunk, 1000, [&](BVHDocument const& chunkDocument, size_t, size_t) { return AppendBVHMotionStats(chunkDocument, stats); }));
+    TEST_REQUIRE(stats.m_NumFrames == expected.m_NumFrames);
+    TEST_REQUIRE(stats.m_Blocks.size() == expected.m_Blocks.size());
+    TEST_REQUIRE(stats.m_Groups.size() == expected.m_Groups.size());
+    for (size_t i = 0; i < expected.m_Blocks.size(); ++i) {
+        TEST_REQUIRE(IsSameRange(stats.m_Blocks[i], expected.m_Blocks[i]));
+    }
+    for (size_t i = 0; i < expected.m_Groups.size(); ++i) {
+        TEST_REQUIRE(IsSameRange(stats.m_Groups[i], expected.m_Groups[i]));
+    }
+
+    // Frames of another skeleton cannot be appended
+    std::string const otherContents = GenerateTestBVH(3, 10);
+    BVHDocument other;
+    TEST_REQUIRE(ParseBVH(otherContents.data(), otherContents.size(), other));
+    TEST_REQUIRE(!AppendBVHMotionStats(other, stats));
+}
+
+TEST(QueryBVHJointRanges_Merges_Runs_Of_Groups)
+{
+    std::string const contents = GenerateTestBVH(3, 45000);
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), document));
+    BVHMotionStats stats;
+    BuildBVHMotionStats(document, stats);
+
+    // Eleven groups are paired into runs of two, four, eight and sixteen groups
+    TEST_REQUIRE(stats.m_Groups.size() == 11 * 3);
+    TEST_REQUIRE(stats.m_GroupRuns.size() == 4);
+    size_t const numRuns[] = { 6, 3, 2, 1 };
+    for (size_t level = 0; level < stats.m_GroupRuns.size(); ++level) {
+        TEST_REQUIRE(stats.m_GroupRuns[level].size() == numRuns[level] * 3);
+    }
+
+    // Ranges of groups that start and end on runs of every size, and that hold the last, partial group
+    std::pair<size_t, size_t> const ranges[] = { { 4096, 8192 }, { 4095, 16386 }, { 12288, 24576 }, { 100, 44000 },
+        { 0, 45000 }, { 8192, 36808 }, { 40960, 4040 }, { 4000, 36960 }, { 20480, 100000 } };
+    for (auto const& [firstFrame, numFrames] : ranges) {
+        std::vector<BVHJointRange> result;
+        TEST_REQUIRE(QueryBVHJointRanges(document, stats, firstFrame, numFrames, result));
+        std::vector<BVHJointRange> const expected = FindReferenceRanges(document, firstFrame, std::min(firstFrame + numFrames, size_t(45000)));
+        for (size_t jointIndex = 0; jointIndex < expected.size(); ++jointIndex) {
+            TEST_REQUIRE(IsSameRange(result[jointIndex], expected[jointIndex]));
+        }
+    }
+
+    // Appending frames updates the runs that held the groups they extend
+    BVHMemoryChunkReader reader(contents.data(), contents.size());
+    BVHDocument chunk;
+    BVHMotionStats appended;
+    TEST_REQUIRE(ParseBVHFrameChunks(reader, chunk, 3000, [&](BVHDocument const& chunkDocument, size_t, size_t) { return AppendBVHMotionStats(chunkDocument, appended); }));
+    TEST_REQUIRE(appended.m_GroupRuns.size() == stats.m_GroupRuns.size());
+    for (size_t level = 0; level < stats.m_GroupRuns.size(); ++level) {
+        TEST_REQUIRE(appended.m_GroupRuns[level].size() == stats.m_GroupRuns[level].size());
+        for (size_t i = 0; i < stats.m_GroupRuns[level].size(); ++i) {
+            TEST_REQUIRE(IsSameRange(appended.m_GroupRuns[level][i], stats.m_GroupRuns[level][i]));
+        }
+    }
+}
+
+TEST(QueryBVHBounds_And_FindBVHMovingJoints)
+{
+    // A root that moves along X, with a child that holds still relative to it
+    std::string const contents = "HIERARCHY\nROOT Hips\n{\n  OFFSET 0 0 0\n  CHANNELS 3 Xposition Yposition Zposition\n"
+                                 "  JOINT Head\n  {\n    OFFSET 0 10 0\n    CHANNELS 3 Zrotation Xrotation Yrotation\n"
+                                 "    End Site\n    {\n      OFFSET 0 1 0\n    }\n  }\n}\n"
+                                 "MOTION\nFrames: 4\nFrame Time: 0.1\n0 0 0 0 0 0\n1 0 0 0 0 0\n2 0 0 0 0 0\n3 0 0 0 0 0\n";
+    BVHDocument document;
+    TEST_REQUIRE(ParseBVH(contents.data(), contents.size(), document));
+    BVHMotionStats stats;
+    BuildBVHMotionStats(document, stats);
+
+    double min[3];
+    double max[3];
+    TEST_REQUIRE(QueryBVHBounds(document, stats, 1, 2, min, max));
+    TEST_REQUIRE(min[0] == 1.0 && max[0] == 2.0);
+    TEST_REQUIRE(min[1] == 0.0 && max[1] == 10.0);
+    TEST_REQUIRE(min[2] == 0.0 && max[2] == 0.0);
+
+    std::vector<size_t> joints;
+    TEST_REQUIRE(FindBVHMovingJoints(document, stats, 0, 4, 1e-6, joints));
+    TEST_REQUIRE((joints == std::vector<size_t> { 0 }));
+    TEST_REQUIRE(FindBVHMovingJoints(document, stats, 2, 1, 1e-6, joints));
+    TEST_REQUIRE(joints.empty());
+}
+
+END_TEST_FIXTURE()
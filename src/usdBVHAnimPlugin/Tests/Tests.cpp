@@ -1,9 +1,61 @@
+#include "CallgrindBenchmarks.h"
+#include "FuzzBVH.h"
+#include "PerformanceTests.h"
 #include "Tests.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
 
-int main(int, char*[])
+int main(int argc, char* argv[])
 {
+    // Performance tests and benchmarks are run separately from the unit tests, as:
+    // usdBVHAnimPlugin_Shared_Tests --performance <baseline.json> <results.json> [--update-baseline]
+    // usdBVHAnimPlugin_Shared_Tests --scaling <layers> <results.json> [<max threads>]
+    // usdBVHAnimPlugin_Shared_Tests --authoring <frames> <results.json> [<max threads>]
+    // usdBVHAnimPlugin_Shared_Tests --indexing <frames> <results.json>
+    // usdBVHAnimPlugin_Shared_Tests --callgrind <benchmark>
+    // usdBVHAnimPlugin_Shared_Tests --fuzz <file or corpus directory>...
+    // usdBVHAnimPlugin_Shared_Tests --fuzz-pathological
+    if (argc >= 4 && std::string(argv[1]) == "--performance") {
+        return RunPerformanceTests(argv[2], argv[3], argc >= 5 && std::string(argv[4]) == "--update-baseline");
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--scaling") {
+        size_t const maxThreads = argc >= 5 ? std::strtoul(argv[4], nullptr, 10) : std::thread::hardware_concurrency();
+        return RunScalingBenchmark(std::strtoul(argv[2], nullptr, 10), std::max<size_t>(maxThreads, 1), argv[3]);
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--authoring") {
+        size_t const maxThreads = argc >= 5 ? std::strtoul(argv[4], nullptr, 10) : std::thread::hardware_concurrency();
+        return RunAuthoringBenchmark(std::strtoul(argv[2], nullptr, 10), std::max<size_t>(maxThreads, 1), argv[3]);
+    }
+    if (argc >= 4 && std::string(argv[1]) == "--indexing") {
+        return RunIndexingBenchmark(std::strtoul(argv[2], nullptr, 10), argv[3]);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--callgrind") {
+        return RunCallgrindBenchmark(argv[2]);
+    }
+    if (argc >= 3 && std::string(argv[1]) == "--fuzz") {
+        return RunFuzzCorpus(std::vector<std::string>(argv + 2, argv + argc));
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--fuzz-pathological") {
+        return RunFuzzPathologicalInputs();
+    }
+
     CALL_TEST_FIXTURE(ParseTests);
     CALL_TEST_FIXTURE(ParseBVHTests);
+    CALL_TEST_FIXTURE(IndexBVHTests);
+    CALL_TEST_FIXTURE(ResampleBVHTests);
+    CALL_TEST_FIXTURE(CompressBVHTests);
+    CALL_TEST_FIXTURE(SampleBVHTests);
+    CALL_TEST_FIXTURE(PrefetchBVHTests);
+    CALL_TEST_FIXTURE(CacheBVHTests);
+    CALL_TEST_FIXTURE(SeekBVHTests);
+    CALL_TEST_FIXTURE(StatsBVHTests);
+    CALL_TEST_FIXTURE(FuzzBVHTests);
+    CALL_TEST_FIXTURE(BVHChunkReadersTests);
+    CALL_TEST_FIXTURE(ExportBVHTensorTests);
+    CALL_TEST_FIXTURE(AllocationBudgetTests);
     CALL_TEST_FIXTURE(USDTests);
     return 0;
 }
@@ -1,15 +1,70 @@
+#include "AllocationCounter.h"
+#include "ConvertBVH.h"
+#include "GenerateTestBVH.h"
 #include "Parse.h"
 #include "Tests.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <pxr/base/tf/stringUtils.h>
 #include <pxr/base/vt/array.h>
+#include <pxr/usd/sdf/layer.h>
 #include <pxr/usd/sdf/path.h>
+#include <pxr/usd/sdf/primSpec.h>
+#include <pxr/usd/sdf/reference.h>
+#include <pxr/usd/sdf/zipFile.h>
 #include <pxr/usd/usd/prim.h>
 #include <pxr/usd/usd/stage.h>
+#include <pxr/usd/usd/variantSets.h>
+#include <pxr/usd/usdGeom/boundable.h>
 #include <pxr/usd/usdSkel/animation.h>
+#include <pxr/usd/usdSkel/bindingAPI.h>
 #include <pxr/usd/usdSkel/root.h>
 #include <pxr/usd/usdSkel/skeleton.h>
 
 using namespace usdBVHAnimPlugin;
 
+//! The rates at which reading a file through the file format allocates, as printed by
+//! `BvhFileFormatPlugin_Read_Allocations_Within_Budget` from a run of the CI build. Most of these
+//! allocations are made by USD rather than the plug-in, so they can only be recorded from a run. Until
+//! they are, the test reports the measured rates without comparing them.
+static std::optional<AllocationRates> const c_BvhFileFormatReadRecordedRates;
+
+//! The fraction by which reading a file may allocate more than its recorded rates, allowing for
+//! differences between the versions of USD that the plug-in is built against
+static double constexpr c_BvhFileFormatReadMargin = 0.1;
+
+static AllocationCounts CountBvhFileFormatReadAllocations(size_t numJoints, size_t numFrames)
+{
+    // Each measurement reads a distinct file, so that no layer is reused from the layer registry
+    static size_t s_NumFiles = 0;
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / ("usdBVHAnim_allocations_" + std::to_string(s_NumFiles++) + ".bvh");
+    {
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(numJoints, numFrames);
+    }
+
+    pxr::SdfLayerRefPtr layer;
+    AllocationCounts const counts = CountAllocations([&]() { layer = pxr::SdfLayer::FindOrOpen(filePath.string()); });
+    TEST_REQUIRE(layer);
+    layer.Reset();
+    std::filesystem::remove(filePath);
+    return counts;
+}
+
+//! Returns the contents of the given layer in the usda format, as BVH layers cannot be exported directly
+static std::string ExportLayerToUsda(pxr::SdfLayerHandle const& layer)
+{
+    pxr::SdfLayerRefPtr usdaLayer = pxr::SdfLayer::CreateAnonymous(".usda");
+    usdaLayer->TransferContent(layer);
+    std::string result;
+    usdaLayer->ExportToString(&result);
+    return result;
+}
+
 BEGIN_TEST_FIXTURE(USDTests)
 
 TEST(BvhFileFormatPlugin_WithoutScaleFileFormatArg_AppliesExpectedScale)
@@ -126,4 +181,391 @@ TEST(BvhFileFormatPlugin_WithScaleFileFormatArg_AppliesExpectedScale)
     }
 }
 
+TEST(BvhFileFormatPlugin_WithFpsFileFormatArg_ResamplesAnimation)
+{
+    // Expecting the 24fps test data to be resampled to 12fps
+    auto stage = pxr::UsdStage::Open("data/test_bvh_fps_arg.usda");
+    TEST_REQUIRE(stage);
+    TEST_REQUIRE(pxr::GfIsClose(stage->GetTimeCodesPerSecond(), 12.0, 1e-6));
+
+    auto animation = pxr::UsdSkelAnimation(stage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    TEST_REQUIRE(animation);
+
+    std::vector<double> timeSamples;
+    animation.GetTranslationsAttr().GetTimeSamples(&timeSamples);
+    TEST_REQUIRE(timeSamples.size() == 10);
+    animation.GetRotationsAttr().GetTimeSamples(&timeSamples);
+    TEST_REQUIRE(timeSamples.size() == 10);
+
+    // The final sample should match the second-to-last frame of the source animation
+    pxr::VtArray<pxr::GfVec3f> translations;
+    animation.GetTranslationsAttr().Get(&translations, timeSamples.back());
+    TEST_REQUIRE(translations.size() == 2);
+    TEST_REQUIRE(pxr::GfIsClose(translations[0][1], 0.991981f, 1e-3f));
+}
+
+TEST(BvhFileFormatPlugin_WithJointsFileFormatArg_ReadsJointSubset)
+{
+    // Expecting only the root joint of the test data to be read
+    auto stage = pxr::UsdStage::Open("data/test_bvh_joints_arg.usda");
+    TEST_REQUIRE(stage);
+
+    auto skeleton = pxr::UsdSkelSkeleton(stage->GetPrimAtPath(pxr::SdfPath("/Root/Skeleton")));
+    TEST_REQUIRE(skeleton);
+    pxr::VtArray<pxr::TfToken> joints;
+    skeleton.GetJointsAttr().Get(&joints);
+    TEST_REQUIRE(joints.size() == 1);
+    TEST_REQUIRE(joints[0] == pxr::TfToken("Root"));
+
+    auto animation = pxr::UsdSkelAnimation(stage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    TEST_REQUIRE(animation);
+    std::vector<double> timeSamples;
+    animation.GetRotationsAttr().GetTimeSamples(&timeSamples);
+    TEST_REQUIRE(timeSamples.size() == 20);
+    pxr::VtArray<pxr::GfQuatf> rotations;
+    animation.GetRotationsAttr().Get(&rotations, timeSamples.front());
+    TEST_REQUIRE(rotations.size() == 1);
+}
+
+TEST(BvhFileFormatPlugin_WithFramesFileFormatArg_ReadsFrameRange)
+{
+    // Expecting frames 5 to 14 of the test data, at the same time codes as when the whole file is read
+    auto stage = pxr::UsdStage::Open("data/test_bvh_frames_arg.usda");
+    TEST_REQUIRE(stage);
+    auto wholeStage = pxr::UsdStage::Open("data/test_bvh.bvh");
+    TEST_REQUIRE(wholeStage);
+    pxr::SdfLayerRefPtr const layer = pxr::SdfLayer::FindOrOpen("data/test_bvh.bvh", { { "frames", "5-14" } });
+    TEST_REQUIRE(layer && layer->GetStartTimeCode() == 6.0);
+
+    auto animation = pxr::UsdSkelAnimation(stage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    auto wholeAnimation = pxr::UsdSkelAnimation(wholeStage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    TEST_REQUIRE(animation && wholeAnimation);
+    std::vector<double> timeSamples;
+    animation.GetTranslationsAttr().GetTimeSamples(&timeSamples);
+    TEST_REQUIRE(timeSamples.size() == 10);
+    TEST_REQUIRE(timeSamples.front() == 6.0 && timeSamples.back() == 15.0);
+    for (double time : timeSamples) {
+        pxr::VtArray<pxr::GfVec3f> translations;
+        pxr::VtArray<pxr::GfVec3f> wholeTranslations;
+        animation.GetTranslationsAttr().Get(&translations, time);
+        wholeAnimation.GetTranslationsAttr().Get(&wholeTranslations, time);
+        TEST_REQUIRE(translations == wholeTranslations);
+    }
+
+    // A range that isn't a range of frames fails to read
+    pxr::SdfLayer::FileFormatArguments const invalidArguments { { "frames", "14-5" } };
+    TEST_REQUIRE(!pxr::SdfLayer::FindOrOpen("data/test_bvh.bvh", invalidArguments));
+}
+
+TEST(BvhFileFormatPlugin_WithBlockExtentsFileFormatArg_AuthorsBlockExtents)
+{
+    std::filesystem::path const filePath = std::filesystem::temp_directory_path() / "usdBVHAnim_block_extents.bvh";
+    {
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(12, 200);
+    }
+
+    // Expecting the bounds of each block of 64 frames, and of the one group that holds them all
+    pxr::SdfLayerRefPtr const layer = pxr::SdfLayer::FindOrOpen(filePath.string(), { { "blockExtents", "true" }, { "scale", "0.5" } });
+    TEST_REQUIRE(layer);
+    auto stage = pxr::UsdStage::Open(layer);
+    pxr::UsdPrim const root = stage->GetPrimAtPath(pxr::SdfPath("/Root"));
+    TEST_REQUIRE(root);
+    int blockSize = 0;
+    int groupSize = 0;
+    pxr::VtVec3fArray blockExtents;
+    pxr::VtVec3fArray groupExtents;
+    TEST_REQUIRE(root.GetAttribute(pxr::TfToken("usdBVHAnim:blockSize")).Get(&blockSize) && blockSize == 64);
+    TEST_REQUIRE(root.GetAttribute(pxr::TfToken("usdBVHAnim:groupSize")).Get(&groupSize) && groupSize == 4096);
+    TEST_REQUIRE(root.GetAttribute(pxr::TfToken("usdBVHAnim:blockExtents")).Get(&blockExtents) && blockExtents.size() == 8);
+    TEST_REQUIRE(root.GetAttribute(pxr::TfToken("usdBVHAnim:groupExtents")).Get(&groupExtents) && groupExtents.size() == 2);
+    for (size_t i = 0; i < 3; ++i) {
+        float min = blockExtents[0][i];
+        float max = blockExtents[1][i];
+        for (size_t block = 1; block < 4; ++block) {
+            TEST_REQUIRE(blockExtents[block * 2][i] <= blockExtents[block * 2 + 1][i]);
+            min = std::min(min, blockExtents[block * 2][i]);
+            max = std::max(max, blockExtents[block * 2 + 1][i]);
+        }
+        TEST_REQUIRE(groupExtents[0][i] == min && groupExtents[1][i] == max);
+    }
+
+    // Without the argument, no block extents are authored, and an invalid value fails to read
+    pxr::SdfLayerRefPtr const plainLayer = pxr::SdfLayer::FindOrOpen(filePath.string());
+    TEST_REQUIRE(plainLayer && !plainLayer->GetAttributeAtPath(pxr::SdfPath("/Root.usdBVHAnim:blockExtents")));
+    TEST_REQUIRE(!pxr::SdfLayer::FindOrOpen(filePath.string(), { { "blockExtents", "yes" } }));
+    std::filesystem::remove(filePath);
+}
+
+TEST(BvhFileFormatPlugin_WithLodFileFormatArg_AuthorsLodVariants)
+{
+    // Expecting a variant set with each level of detail, with the half density variant selected
+    auto stage = pxr::UsdStage::Open("data/test_bvh_lod_arg.usda");
+    TEST_REQUIRE(stage);
+
+    auto animation = pxr::UsdSkelAnimation(stage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    TEST_REQUIRE(animation);
+    pxr::UsdVariantSet lodVariantSet = animation.GetPrim().GetVariantSet("lod");
+    TEST_REQUIRE(lodVariantSet.IsValid());
+    TEST_REQUIRE((lodVariantSet.GetVariantNames() == std::vector<std::string> { "full", "half", "quarter" }));
+    TEST_REQUIRE(lodVariantSet.GetVariantSelection() == "half");
+
+    // Each level of detail keeps every n-th frame of the 20 source frames, along with the last frame
+    std::vector<double> timeSamples;
+    for (auto const& [variant, numSamples] : std::vector<std::pair<std::string, size_t>> { { "half", 11 }, { "quarter", 6 }, { "full", 20 } }) {
+        TEST_REQUIRE(lodVariantSet.SetVariantSelection(variant));
+        animation.GetTranslationsAttr().GetTimeSamples(&timeSamples);
+        TEST_REQUIRE(timeSamples.size() == numSamples);
+        animation.GetRotationsAttr().GetTimeSamples(&timeSamples);
+        TEST_REQUIRE(timeSamples.size() == numSamples);
+        TEST_REQUIRE(timeSamples.front() == 1.0 && timeSamples.back() == 20.0);
+    }
+
+    // Samples of the reduced variants are those of the full variant at the same times
+    pxr::VtArray<pxr::GfQuatf> fullRotations;
+    animation.GetRotationsAttr().Get(&fullRotations, 9.0);
+    TEST_REQUIRE(lodVariantSet.SetVariantSelection("quarter"));
+    pxr::VtArray<pxr::GfQuatf> quarterRotations;
+    animation.GetRotationsAttr().Get(&quarterRotations, 9.0);
+    TEST_REQUIRE(fullRotations == quarterRotations);
+
+    // Extents bound the joints of every frame, whichever level of detail was selected when reading
+    auto expectedStage = pxr::UsdStage::Open("data/test_bvh.bvh");
+    TEST_REQUIRE(expectedStage);
+    pxr::UsdGeomBoundable const root(stage->GetPrimAtPath(pxr::SdfPath("/Root")));
+    pxr::UsdGeomBoundable const expectedRoot(expectedStage->GetPrimAtPath(pxr::SdfPath("/Root")));
+    for (double time = 1.0; time <= 20.0; time += 1.0) {
+        pxr::VtVec3fArray extent, expectedExtent;
+        TEST_REQUIRE(root.GetExtentAttr().Get(&extent, time) && expectedRoot.GetExtentAttr().Get(&expectedExtent, time));
+        TEST_REQUIRE(extent.size() == 2 && extent == expectedExtent);
+    }
+}
+
+TEST(ConvertBVHToUsd_Matches_BvhFileFormat_Read)
+{
+    std::filesystem::path const directory = std::filesystem::temp_directory_path() / "usdBVHAnim_convert";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+    std::filesystem::path const bvhPath = directory / "take.bvh";
+    {
+        std::ofstream stream(bvhPath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(8, 150);
+    }
+
+    // Frames are written in chunks of 64 frames, to three clip layers
+    BVHConversionOptions options;
+    options.m_FramesPerChunk = 64;
+    std::filesystem::path const outputPath = directory / "take.usda";
+    TEST_REQUIRE(ConvertBVHToUsd(bvhPath.string(), outputPath.string(), options));
+    TEST_REQUIRE(std::filesystem::exists(directory / "take.0.usdc"));
+    TEST_REQUIRE(std::filesystem::exists(directory / "take.2.usdc"));
+    TEST_REQUIRE(!std::filesystem::exists(directory / "take.3.usdc"));
+
+    auto expectedStage = pxr::UsdStage::Open(bvhPath.string());
+    auto stage = pxr::UsdStage::Open(outputPath.string());
+    TEST_REQUIRE(expectedStage && stage);
+    TEST_REQUIRE(stage->GetTimeCodesPerSecond() == expectedStage->GetTimeCodesPerSecond());
+    TEST_REQUIRE(stage->GetEndTimeCode() == expectedStage->GetEndTimeCode());
+
+    auto expectedAnimation = pxr::UsdSkelAnimation(expectedStage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    auto animation = pxr::UsdSkelAnimation(stage->GetPrimAtPath(pxr::SdfPath("/Root/Animation")));
+    TEST_REQUIRE(expectedAnimation && animation);
+    pxr::VtArray<pxr::TfToken> expectedJoints, joints;
+    expectedAnimation.GetJointsAttr().Get(&expectedJoints);
+    animation.GetJointsAttr().Get(&joints);
+    TEST_REQUIRE(joints == expectedJoints);
+
+    // Every frame matches, as do times between frames that straddle the boundary between two clips
+    std::vector<double> times;
+    for (size_t frame = 1; frame <= 150; ++frame) {
+        times.push_back(static_cast<double>(frame));
+    }
+    times.push_back(64.5);
+    times.push_back(128.5);
+    for (double time : times) {
+        pxr::VtArray<pxr::GfVec3f> expectedTranslations, translations;
+        pxr::VtArray<pxr::GfQuatf> expectedRotations, rotations;
+        TEST_REQUIRE(expectedAnimation.GetTranslationsAttr().Get(&expectedTranslations, time));
+        TEST_REQUIRE(animation.GetTranslationsAttr().Get(&translations, time));
+        TEST_REQUIRE(expectedAnimation.GetRotationsAttr().Get(&expectedRotations, time));
+        TEST_REQUIRE(animation.GetRotationsAttr().Get(&rotations, time));
+        TEST_REQUIRE(translations.size() == expectedTranslations.size() && rotations.size() == expectedRotations.size());
+        for (size_t i = 0; i < translations.size(); ++i) {
+            TEST_REQUIRE(pxr::GfIsClose(translations[i], expectedTranslations[i], 1e-5));
+            TEST_REQUIRE(pxr::GfIsClose(pxr::GfVec4f(rotations[i].GetReal(), rotations[i].GetImaginary()[0], rotations[i].GetImaginary()[1], rotations[i].GetImaginary()[2]),
+                pxr::GfVec4f(expectedRotations[i].GetReal(), expectedRotations[i].GetImaginary()[0], expectedRotations[i].GetImaginary()[1], expectedRotations[i].GetImaginary()[2]), 1e-5));
+        }
+    }
+
+    // Extents are authored for every frame
+    pxr::VtVec3fArray extent;
+    TEST_REQUIRE(pxr::UsdGeomBoundable(stage->GetPrimAtPath(pxr::SdfPath("/Root"))).GetExtentAttr().Get(&extent, 100.0));
+    TEST_REQUIRE(extent.size() == 2);
+
+    stage.Reset();
+    expectedStage.Reset();
+    std::filesystem::remove_all(directory);
+}
+
+TEST(BvhFileFormatPlugin_Read_Concurrently_Matches_Serial)
+{
+    // Distinct files with the same contents, such that each is read into its own layer
+    size_t constexpr c_NumFiles = 32;
+    std::string const contents = GenerateTestBVH(16, 50);
+    std::vector<std::string> filePaths;
+    for (size_t i = 0; i < c_NumFiles; ++i) {
+        std::filesystem::path const filePath = std::filesystem::temp_directory_path() / ("usdBVHAnim_concurrent_" + std::to_string(i) + ".bvh");
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << contents;
+        filePaths.push_back(filePath.string());
+    }
+
+    pxr::SdfLayerRefPtr expectedLayer = pxr::SdfLayer::OpenAsAnonymous(filePaths[0]);
+    TEST_REQUIRE(expectedLayer);
+    std::string const expected = ExportLayerToUsda(expectedLayer);
+
+    std::vector<pxr::SdfLayerRefPtr> layers(c_NumFiles);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < c_NumFiles; ++i) {
+        threads.emplace_back([&, i]() { layers[i] = pxr::SdfLayer::FindOrOpen(filePaths[i]); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < c_NumFiles; ++i) {
+        TEST_REQUIRE(layers[i]);
+        TEST_REQUIRE(ExportLayerToUsda(layers[i]) == expected);
+        layers[i].Reset();
+        std::filesystem::remove(filePaths[i]);
+    }
+}
+
+TEST(BvhFileFormatPlugin_ReadFromString_Matches_Read)
+{
+    pxr::SdfLayerRefPtr expectedLayer = pxr::SdfLayer::OpenAsAnonymous("data/test_bvh.bvh");
+    TEST_REQUIRE(expectedLayer);
+
+    std::ifstream stream("data/test_bvh.bvh", std::ios::in | std::ios::binary);
+    std::stringstream contents;
+    contents << stream.rdbuf();
+    pxr::SdfLayerRefPtr layer = pxr::SdfLayer::CreateAnonymous(".bvh");
+    TEST_REQUIRE(layer);
+    TEST_REQUIRE(layer->ImportFromString(contents.str()));
+    TEST_REQUIRE(ExportLayerToUsda(layer) == ExportLayerToUsda(expectedLayer));
+}
+
+TEST(BvhFileFormatPlugin_Reads_File_Inside_Package)
+{
+    pxr::SdfLayerRefPtr expectedLayer = pxr::SdfLayer::OpenAsAnonymous("data/test_bvh.bvh");
+    TEST_REQUIRE(expectedLayer);
+
+    // The file is read through the asset resolver, without being extracted from the package
+    std::filesystem::path const packagePath = std::filesystem::temp_directory_path() / "usdBVHAnim_package.usdz";
+    {
+        pxr::SdfZipFileWriter writer = pxr::SdfZipFileWriter::CreateNew(packagePath.string());
+        TEST_REQUIRE(!writer.AddFile("data/test_bvh.bvh", "test_bvh.bvh").empty());
+        TEST_REQUIRE(writer.Save());
+    }
+    pxr::SdfLayerRefPtr layer = pxr::SdfLayer::OpenAsAnonymous(packagePath.string() + "[test_bvh.bvh]");
+    TEST_REQUIRE(layer);
+    TEST_REQUIRE(ExportLayerToUsda(layer) == ExportLayerToUsda(expectedLayer));
+    layer.Reset();
+    std::filesystem::remove(packagePath);
+}
+
+TEST(BvhFileFormatPlugin_WithSkeletonFileFormatArg_SharesSkeletonLayer)
+{
+    // Two clips of one skeleton, and a clip of another skeleton
+    std::vector<std::string> filePaths;
+    for (auto const& [numJoints, numFrames] : std::vector<std::pair<size_t, size_t>> { { 8, 10 }, { 8, 30 }, { 9, 10 } }) {
+        std::filesystem::path const filePath = std::filesystem::temp_directory_path() / ("usdBVHAnim_skeleton_" + std::to_string(filePaths.size()) + ".bvh");
+        std::ofstream stream(filePath, std::ios::out | std::ios::binary);
+        stream << GenerateTestBVH(numJoints, numFrames);
+        filePaths.push_back(filePath.string());
+    }
+
+    // Returns the layer that the skeleton's joints are authored in
+    auto getJointsLayer = [](pxr::UsdStageRefPtr const& stage) {
+        auto skeleton = pxr::UsdSkelSkeleton(stage->GetPrimAtPath(pxr::SdfPath("/Root/Skeleton")));
+        TEST_REQUIRE(skeleton);
+        std::vector<pxr::SdfPropertySpecHandle> const propertyStack = skeleton.GetJointsAttr().GetPropertyStack();
+        TEST_REQUIRE(propertyStack.size() == 1);
+        return propertyStack[0]->GetLayer();
+    };
+
+    std::vector<pxr::UsdStageRefPtr> stages;
+    for (std::string const& filePath : filePaths) {
+        pxr::SdfLayerRefPtr layer = pxr::SdfLayer::FindOrOpen(filePath, { { "skeleton", "shared" } });
+        TEST_REQUIRE(layer);
+        stages.push_back(pxr::UsdStage::Open(layer));
+        TEST_REQUIRE(stages.back());
+    }
+    TEST_REQUIRE(getJointsLayer(stages[0]) == getJointsLayer(stages[1]));
+    TEST_REQUIRE(getJointsLayer(stages[0]) != getJointsLayer(stages[2]));
+    TEST_REQUIRE(getJointsLayer(stages[0]) != pxr::SdfLayerHandle(stages[0]->GetRootLayer()));
+
+    // The composed skeleton matches that of the clip read with a skeleton of its own
+    auto expectedStage = pxr::UsdStage::Open(filePaths[1]);
+    TEST_REQUIRE(expectedStage);
+    TEST_REQUIRE(getJointsLayer(expectedStage) == pxr::SdfLayerHandle(expectedStage->GetRootLayer()));
+    auto expectedSkeleton = pxr::UsdSkelSkeleton(expectedStage->GetPrimAtPath(pxr::SdfPath("/Root/Skeleton")));
+    auto skeleton = pxr::UsdSkelSkeleton(stages[1]->GetPrimAtPath(pxr::SdfPath("/Root/Skeleton")));
+    pxr::VtArray<pxr::TfToken> expectedJoints, joints;
+    pxr::VtArray<pxr::GfMatrix4d> expectedBindTransforms, bindTransforms, expectedRestTransforms, restTransforms;
+    TEST_REQUIRE(expectedSkeleton.GetJointsAttr().Get(&expectedJoints) && skeleton.GetJointsAttr().Get(&joints));
+    TEST_REQUIRE(expectedSkeleton.GetBindTransformsAttr().Get(&expectedBindTransforms) && skeleton.GetBindTransformsAttr().Get(&bindTransforms));
+    TEST_REQUIRE(expectedSkeleton.GetRestTransformsAttr().Get(&expectedRestTransforms) && skeleton.GetRestTransformsAttr().Get(&restTransforms));
+    TEST_REQUIRE(joints == expectedJoints && bindTransforms == expectedBindTransforms && restTransforms == expectedRestTransforms);
+    pxr::SdfPathVector animationSources;
+    TEST_REQUIRE(pxr::UsdSkelBindingAPI(skeleton.GetPrim()).GetAnimationSourceRel().GetTargets(&animationSources));
+    TEST_REQUIRE(animationSources == pxr::SdfPathVector { pxr::SdfPath("/Root/Animation") });
+    pxr::VtVec3fArray expectedExtent, extent;
+    TEST_REQUIRE(pxr::UsdGeomBoundable(expectedStage->GetPrimAtPath(pxr::SdfPath("/Root"))).GetExtentAttr().Get(&expectedExtent, 10.0));
+    TEST_REQUIRE(pxr::UsdGeomBoundable(stages[1]->GetPrimAtPath(pxr::SdfPath("/Root"))).GetExtentAttr().Get(&extent, 10.0));
+    TEST_REQUIRE(extent.size() == 2 && extent == expectedExtent);
+
+    // Clips refer to the file of the first clip of their skeleton relative to their own, so that
+    // the skeleton still composes once a clip is exported
+    pxr::SdfPrimSpecHandle const skeletonSpec = stages[1]->GetRootLayer()->GetPrimAtPath(pxr::SdfPath("/Root/Skeleton"));
+    TEST_REQUIRE(skeletonSpec);
+    std::vector<pxr::SdfReference> const references = skeletonSpec->GetReferenceList().GetAddedOrExplicitItems();
+    TEST_REQUIRE(references.size() == 1);
+    TEST_REQUIRE(pxr::TfStringStartsWith(references[0].GetAssetPath(), "./usdBVHAnim_skeleton_0.bvh"));
+    TEST_REQUIRE(!pxr::SdfLayer::IsAnonymousLayerIdentifier(references[0].GetAssetPath()));
+    std::filesystem::path const exportPath = std::filesystem::temp_directory_path() / "usdBVHAnim_skeleton_1.usda";
+    TEST_REQUIRE(stages[1]->GetRootLayer()->Export(exportPath.string()));
+    {
+        auto exportedStage = pxr::UsdStage::Open(exportPath.string());
+        TEST_REQUIRE(exportedStage);
+        auto exportedSkeleton = pxr::UsdSkelSkeleton(exportedStage->GetPrimAtPath(pxr::SdfPath("/Root/Skeleton")));
+        pxr::VtArray<pxr::TfToken> exportedJoints;
+        TEST_REQUIRE(exportedSkeleton.GetJointsAttr().Get(&exportedJoints));
+        TEST_REQUIRE(exportedJoints == expectedJoints);
+    }
+    std::filesystem::remove(exportPath);
+
+    stages.clear();
+    expectedStage.Reset();
+    for (std::string const& filePath : filePaths) {
+        std::filesystem::remove(filePath);
+    }
+}
+
+TEST(BvhFileFormatPlugin_Read_Allocations_Within_Budget)
+{
+    AllocationRates const rates = MeasureAllocationRates(CountBvhFileFormatReadAllocations, 16, 50);
+    PrintAllocationRates(rates);
+    if (c_BvhFileFormatReadRecordedRates) {
+        AllocationRates const& recorded = *c_BvhFileFormatReadRecordedRates;
+        AllocationRates const budget = {
+            recorded.m_AllocationsPerJoint * (1.0 + c_BvhFileFormatReadMargin),
+            recorded.m_AllocationsPerFrame * (1.0 + c_BvhFileFormatReadMargin),
+            recorded.m_AllocationsPerJointFrame * (1.0 + c_BvhFileFormatReadMargin),
+            recorded.m_BytesPerJointFrame * (1.0 + c_BvhFileFormatReadMargin),
+        };
+        TEST_REQUIRE(IsWithinAllocationBudget(rates, budget));
+    }
+}
+
 END_TEST_FIXTURE()
\ No newline at end of file